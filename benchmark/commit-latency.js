@@ -0,0 +1,91 @@
+'use strict';
+// Measures commit latency of write transactions from several threads at once, on a Zipfian (hot key) workload, so
+// that transactions keep contending for the locks of the same few keys. Reports the latency percentiles, where the
+// tail (p99) shows how long committers wait on each other. Run with the number of threads as an argument.
+var testDirPath = new URL('./benchdata-commit.spdb', import.meta.url).toString().slice(7);
+import fs from 'fs';
+import os from 'os';
+import { Worker, isMainThread, parentPort } from 'worker_threads';
+
+import { open } from '../index.js';
+
+const total = 10000; // number of keys
+const theta = 0.99; // skew, as in YCSB
+const txnsPerThread = 5000;
+const writesPerTxn = 4;
+
+// The generator from "Quickly Generating Billion-Record Synthetic Databases" (Gray et al.), which YCSB uses
+function zipfian(n, theta) {
+  let zetan = 0;
+  for (let i = 1; i <= n; i++)
+    zetan += 1 / Math.pow(i, theta);
+  let zeta2 = 1 + 1 / Math.pow(2, theta);
+  let alpha = 1 / (1 - theta);
+  let eta = (1 - Math.pow(2 / n, 1 - theta)) / (1 - zeta2 / zetan);
+  return () => {
+    let u = Math.random();
+    let uz = u * zetan;
+    if (uz < 1)
+      return 0;
+    if (uz < zeta2)
+      return 1;
+    return Math.floor(n * Math.pow(eta * u - eta + 1, alpha));
+  };
+}
+
+// Each worker opens the store too, which shares the instance the main thread mounted (a store can only be mounted
+// once), so all the threads commit to the same store.
+function openStore() {
+  return open(testDirPath, {
+    name: 'mydb1',
+    keyIsUint32: true,
+  });
+}
+
+if (isMainThread) {
+  const threads = +process.argv[2] || os.cpus().length;
+  if (fs.existsSync(testDirPath))
+    fs.unlinkSync(testDirPath);
+  let store = openStore();
+  let lastPromise;
+  for (let i = 0; i < total; i++)
+    lastPromise = store.put(i, { count: 0 });
+  await lastPromise;
+
+  let start = process.hrtime.bigint();
+  let latencies = await Promise.all(Array.from({ length: threads }, () => new Promise((resolve, reject) => {
+    let worker = new Worker(new URL(import.meta.url));
+    worker.on('message', resolve);
+    worker.on('error', reject);
+  })));
+  let elapsed = Number(process.hrtime.bigint() - start) / 1e9;
+
+  let all = new Float64Array(latencies.reduce((length, l) => length + l.length, 0));
+  let offset = 0;
+  for (let l of latencies) {
+    all.set(l, offset);
+    offset += l.length;
+  }
+  all.sort();
+  let percentile = (p) => (all[Math.min(all.length - 1, Math.floor(all.length * p))] / 1000).toFixed(1) + 'us';
+  console.log(threads + ' threads: ' + Math.round(all.length / elapsed) + ' commits/sec');
+  console.log('commit latency p50 ' + percentile(0.5) + ', p99 ' + percentile(0.99) + ', p99.9 ' +
+    percentile(0.999) + ', max ' + percentile(1));
+  await store.close();
+} else {
+  let store = openStore();
+  let nextKey = zipfian(total, theta);
+  let latencies = new Float64Array(txnsPerThread);
+  for (let i = 0; i < txnsPerThread; i++) {
+    let start = process.hrtime.bigint();
+    store.transactionSync(() => {
+      for (let j = 0; j < writesPerTxn; j++) {
+        let key = nextKey();
+        let value = store.get(key);
+        store.put(key, { count: (value ? value.count : 0) + 1 });
+      }
+    });
+    latencies[i] = Number(process.hrtime.bigint() - start);
+  }
+  parentPort.postMessage(latencies);
+}
@@ -0,0 +1,94 @@
+'use strict';
+// Measures the per-call cost of the native functions through N-API against the direct V8 versions of them, with and
+// without fast API calls (see src/v8-functions.cpp), with an empty call and with get()s of small values, where the call
+// itself is much of the cost. Run with the node version the addon was compiled for, since the V8 functions depend on
+// its ABI. Each mode is measured in its own process: a call site that has seen more than one function is not
+// monomorphic, and TurboFan only makes fast calls from monomorphic ones.
+var testDirPath = new URL('./benchdata-fast-api.spdb', import.meta.url).toString().slice(7);
+import fs from 'fs';
+import { execFileSync } from 'child_process';
+import { fileURLToPath } from 'url';
+import { setFlagsFromString } from 'v8';
+
+const modes = {
+  napi: 'N-API',
+  v8: 'direct V8',
+  fast: 'V8 fast API',
+};
+const total = 10000;
+const calls = 10000000;
+const gets = 2000000;
+
+let mode = process.argv[2];
+if (!mode) {
+  let results = {};
+  for (let mode in modes) {
+    results[mode] = JSON.parse(execFileSync(process.execPath, [fileURLToPath(import.meta.url), mode],
+      { stdio: ['ignore', 'pipe', 'inherit'] }));
+    if (results[mode].error) {
+      console.log(results[mode].error);
+      process.exit(1);
+    }
+  }
+  for (let mode in modes) {
+    let result = results[mode];
+    if (result.unavailable)
+      console.log(modes[mode] + ': not in this build');
+    else
+      console.log(modes[mode] + ': empty call ' + result.call.toFixed(1) + 'ns, small value get ' +
+        result.get.toFixed(1) + 'ns');
+  }
+  process.exit(0);
+}
+
+if (mode == 'fast') // has to be set before any of the calling code is optimized
+  setFlagsFromString('--turbo-fast-api-calls');
+const { open } = await import('../index.js');
+const { nativeAddon, setNativeFunctions } = await import('../native.js');
+
+if (mode != 'napi') {
+  if (+process.versions.node.split('.')[0] != nativeAddon.version.nodeCompiledVersion) {
+    console.log(JSON.stringify({ error: 'the addon was compiled for node ' +
+      nativeAddon.version.nodeCompiledVersion + ', so it can not use the direct V8 functions on this version' }));
+    process.exit(0);
+  }
+  let v8Functions = {};
+  if (!nativeAddon.enableDirectV8(v8Functions, mode == 'fast') && mode == 'fast') {
+    console.log(JSON.stringify({ unavailable: true }));
+    process.exit(0);
+  }
+  setNativeFunctions(Object.assign({}, nativeAddon, v8Functions));
+  var noop = v8Functions.noop;
+} else
+  var noop = nativeAddon.noop;
+
+if (fs.existsSync(testDirPath))
+  fs.unlinkSync(testDirPath);
+let store = open(testDirPath, {
+  name: 'mydb1',
+  keyIsUint32: true,
+  encoding: 'binary',
+});
+let value = Buffer.from('a small value');
+let lastPromise;
+for (let i = 0; i < total; i++)
+  lastPromise = store.put(i, value);
+await lastPromise;
+
+for (let i = 0; i < 100000; i++) // warm up, so the loop is optimized
+  noop();
+let start = process.hrtime.bigint();
+for (let i = 0; i < calls; i++)
+  noop();
+let call = Number(process.hrtime.bigint() - start) / calls;
+
+let c = 0;
+for (let i = 0; i < 100000; i++)
+  store.getBinaryFast((c += 357) % total);
+start = process.hrtime.bigint();
+for (let i = 0; i < gets; i++)
+  store.getBinaryFast((c += 357) % total);
+let get = Number(process.hrtime.bigint() - start) / gets;
+
+await store.close();
+console.log(JSON.stringify({ call, get }));
@@ -0,0 +1,46 @@
+'use strict';
+// Measures get() throughput along with how much memory is retained per get(), which should be zero now that reads
+// reuse the (renewable) read txn instead of allocating a new one each time. Run with --expose-gc for stable numbers.
+var testDirPath = new URL('./benchdata-get.spdb', import.meta.url).toString().slice(7);
+import fs from 'fs';
+
+import { open } from '../index.js';
+
+const total = 10000;
+const getsPerTurn = 1000;
+const turns = 1000;
+if (fs.existsSync(testDirPath))
+  fs.unlinkSync(testDirPath);
+let store = open(testDirPath, {
+  name: 'mydb1',
+  keyIsUint32: true,
+});
+let lastPromise;
+for (let i = 0; i < total; i++)
+  lastPromise = store.put(i, { name: 'test', greeting: 'Hello, World!', index: i });
+await lastPromise;
+
+function memory() {
+  if (global.gc)
+    global.gc();
+  return process.memoryUsage().rss;
+}
+
+let c = 0;
+let result;
+// warm up, so we are just measuring the steady state
+for (let i = 0; i < total; i++)
+  result = store.get(i);
+let startMemory = memory();
+let start = process.hrtime.bigint();
+for (let turn = 0; turn < turns; turn++) {
+  for (let i = 0; i < getsPerTurn; i++)
+    result = store.get((c += 357) % total);
+  // let the read txn get reset and renewed, like it would across event turns
+  await new Promise((resolve) => setTimeout(resolve, 0));
+}
+let elapsed = Number(process.hrtime.bigint() - start) / 1e9;
+let gets = turns * getsPerTurn;
+console.log('get: ' + Math.round(gets / elapsed) + ' ops/sec (including turn delays)');
+console.log('retained memory: ' + ((memory() - startMemory) / gets).toFixed(2) + ' bytes per get');
+await store.close();
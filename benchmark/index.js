@@ -114,6 +114,15 @@ function getBinary() {
 function getBinaryFast() {
   result = store.getBinaryFast((c += 357) % total)
 }
+let manyKeys = new Array(1000)
+function getMany(deferred) {
+  for (let i = 0; i < manyKeys.length; i++)
+    manyKeys[i] = (c += 357) % total
+  store.getMany(manyKeys).then((values) => {
+    result = values
+    deferred.resolve()
+  })
+}
 let a = Buffer.from('this id\0\0\0\0\0')
 let b = Buffer.from('mmmmmmore text')
 //b = b.subarray(2,b.length)
@@ -134,6 +143,15 @@ function getRange() {
     i++
   }
 }
+function getRangeLarge() {
+  let i = 0
+  for (let entry of store.getRange({
+    start: 0,
+    end: 10000
+  })) {
+    i++
+  }
+}
 let jsonBuffer = JSON.stringify(data)
 function plainJSON() {
   result = JSON.parse(jsonBuffer)
@@ -198,7 +216,8 @@ cleanup(async function (err) {
     //suite.add('syncTxn', syncTxn);
     //suite.add('getBinaryFast', getBinaryFast);
 	 //suite.add('noop', noopTest);
-    //suite.add('getRange', getRange);
+    suite.add('getRange', getRange);
+    suite.add('getRange (10000 entries)', getRangeLarge);
     suite.add('setData', setData, /*{
       defer: true,
       fn: setData
@@ -213,6 +232,10 @@ cleanup(async function (err) {
     suite.add('getBinary', getBinary);
     //test
     suite.add('getBinaryFast', getBinaryFast);
+    suite.add('getMany (1000 keys)', {
+      defer: true,
+      fn: getMany
+    });
     suite.on('cycle', function (event) {
       console.log({result})
       if (result && result.then) {
@@ -0,0 +1,60 @@
+'use strict';
+// Measures how long it takes to reopen (mount) an existing store as the amount of data in it grows. Mounting
+// should only read the allocator and trunk super blocks, so the open time should stay flat across rounds.
+var testDirPath = new URL('./benchdata-open.spdb', import.meta.url).toString().slice(7);
+import fs from 'fs';
+import benchmark from 'benchmark';
+
+import { open } from '../index.js';
+
+let data = {
+  name: 'test',
+  greeting: 'Hello, World!',
+  flag: true,
+  littleNum: 3,
+  biggerNum: 32254435,
+  decimal:1.332232,
+  bigDecimal: 3.5522E102,
+  negative: -54,
+  aNull: null,
+  more: 'string',
+}
+const perRound = 100000;
+const rounds = 5;
+let store;
+let c = 0;
+
+function reopen() {
+  store = open(testDirPath, {
+    name: 'mydb1',
+    keyIsUint32: true,
+  });
+  store.close();
+}
+
+async function addData() {
+  store = open(testDirPath, {
+    name: 'mydb1',
+    keyIsUint32: true,
+  });
+  let lastPromise;
+  for (let i = 0; i < perRound; i++)
+    lastPromise = store.put(c++, data);
+  await lastPromise;
+  await store.close();
+}
+
+if (fs.existsSync(testDirPath))
+  fs.unlinkSync(testDirPath);
+for (let round = 0; round < rounds; round++) {
+  await addData();
+  await new Promise((resolve) => {
+    let suite = new benchmark.Suite();
+    suite.add('reopen with ' + c + ' entries', reopen);
+    suite.on('cycle', function (event) {
+      console.log(String(event.target));
+    });
+    suite.on('complete', resolve);
+    suite.run({ async: true });
+  });
+}
@@ -33,9 +33,13 @@
         "dependencies/lz4/lib/lz4.h",
         "dependencies/lz4/lib/lz4.c",
         "src/misc.cpp",
+        "src/compression.cpp",
         "src/env.cpp",
+        "src/reader.cpp",
+        "src/cursor.cpp",
         "src/writer.cpp",
         "src/txn.cpp",
+        "src/v8-functions.cpp",
       ],
       "include_dirs": [
         "<!(node -p \"require('node-addon-api').include_dir\")",
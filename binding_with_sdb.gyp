@@ -41,6 +41,7 @@
         "dependencies/splinterdb/src/splinterdb.c",
         "dependencies/splinterdb/src/task.c",
         "dependencies/splinterdb/src/tictoc_data.c",
+        "dependencies/splinterdb/src/tictoc_ts_cache.c",
         "dependencies/splinterdb/src/transaction.c",
         "dependencies/splinterdb/src/transaction_data_config.c",
         "dependencies/splinterdb/src/trunk.c",
@@ -53,7 +54,13 @@
         "dependencies/lz4/lib/lz4.h",
         "dependencies/lz4/lib/lz4.c",
         "src/misc.cpp",
+        "src/compression.cpp",
         "src/env.cpp",
+        "src/reader.cpp",
+        "src/cursor.cpp",
+        "src/writer.cpp",
+        "src/txn.cpp",
+        "src/v8-functions.cpp",
       ],
       "include_dirs": [
         "<!(node -p \"require('node-addon-api').include_dir\")",
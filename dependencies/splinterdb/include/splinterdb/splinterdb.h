@@ -67,6 +67,11 @@ typedef struct {
 
    // btree
    uint64 btree_rough_count_height;
+   // Compress the leaves of the btrees that are written to disk (with LZ4),
+   // each holding up to 4 pages worth of records in a page. This saves space
+   // and reads for small records that have a lot in common with their
+   // neighbors, at the cost of decompressing a leaf whenever it is read.
+   bool btree_compress_leaves;
 
    // filter
    uint64 filter_remainder_size;
@@ -168,7 +173,9 @@ splinterdb_close(splinterdb **kvs);
 // splinterdb_close will use scratch space, so the thread that calls it must
 // have been registered (or implicitly registered by being the initial thread).
 //
-// Note: There is currently a limit of MAX_THREADS registered at a given time
+// Note: There is currently a limit of MAX_THREADS (1024) registered at a given
+// time. Per-thread state is allocated as threads first use it, and is reused
+// by later threads once its thread deregisters.
 void
 splinterdb_register_thread(splinterdb *kvs);
 
@@ -179,6 +186,23 @@ splinterdb_register_thread(splinterdb *kvs);
 void
 splinterdb_deregister_thread(splinterdb *kvs);
 
+// The id of a thread that isn't registered with any instance
+#define SPLINTERDB_NO_THREAD_ID ((threadid)1024)
+
+// Get and set the id of the current thread.
+//
+// Each instance gives a thread that registers with it (or creates or opens it)
+// an id of its own, but a thread only has one current id, the one it was
+// given last. So a thread that uses more than one instance keeps the id that
+// each gave it, and sets it before calling into that instance, and sets
+// SPLINTERDB_NO_THREAD_ID before registering with (or creating or opening)
+// another one.
+threadid
+splinterdb_get_thread_id(void);
+
+void
+splinterdb_set_thread_id(threadid tid);
+
 // Insert a key and value.
 // Relies on data_config->encode_message
 int
@@ -258,6 +282,62 @@ splinterdb_lookup(const splinterdb         *kvs,   // IN
                   splinterdb_lookup_result *result // IN/OUT
 );
 
+// Asynchronous lookups
+//
+// An async lookup runs the same lookup as splinterdb_lookup, but when it
+// needs a page that isn't in the cache it starts the IO for it and returns,
+// instead of blocking. One thread can then keep many lookups in flight.
+
+// splinterdb_lookup_async started IO. The context's callback will be called
+// once it completes, and the lookup must then be continued.
+#define SPLINTERDB_ASYNC_IO_STARTED (-1)
+// splinterdb_lookup_async raced with a writer or ran out of IO requests, and
+// must be called again (possibly after polling for completed IO).
+#define SPLINTERDB_ASYNC_RETRY (-2)
+
+typedef struct splinterdb_async_lookup splinterdb_async_lookup;
+
+// Called from splinterdb_async_poll (on whichever thread calls it) when the IO
+// started for a lookup has completed. It should only schedule the lookup to be
+// continued, by calling splinterdb_lookup_async again with the same key and
+// result, on the thread that started the lookup (page references are held
+// per thread).
+typedef void (*splinterdb_async_cb)(void *arg);
+
+// Allocate a context for async lookups. A context can be used for one lookup
+// at a time, and reused for the next lookup once one has completed.
+int
+splinterdb_async_lookup_create(const splinterdb         *kvs,     // IN
+                               splinterdb_async_cb       cb,      // IN
+                               void                     *cb_arg,  // IN
+                               splinterdb_async_lookup **ctxt_out // OUT
+);
+
+// Free a context, which must not have a lookup in flight
+void
+splinterdb_async_lookup_destroy(const splinterdb        *kvs, // IN
+                                splinterdb_async_lookup *ctxt // IN
+);
+
+// Start or continue an async lookup of the message for a given key.
+//
+// Returns 0 once the lookup is done (with the result set, just as
+// splinterdb_lookup would), SPLINTERDB_ASYNC_IO_STARTED or
+// SPLINTERDB_ASYNC_RETRY if it is still in progress, or an error code.
+// Until it is done, each call must pass the same key (and key memory) and
+// result as the first.
+int
+splinterdb_lookup_async(const splinterdb         *kvs,    // IN
+                        slice                     key,    // IN
+                        splinterdb_lookup_result *result, // IN/OUT
+                        splinterdb_async_lookup  *ctxt    // IN/OUT
+);
+
+// Process completed IO, calling the callbacks of the lookups it was started
+// for.
+void
+splinterdb_async_poll(const splinterdb *kvs);
+
 
 /*
 Iterator API (range query)
@@ -268,9 +348,9 @@ replacement for most scenarios.
 This documentation is heavily inspired by
   https://github.com/facebook/rocksdb/wiki/Iterator
 
-The biggest difference is that RocksDB's Iterator exposes a Seek(key) method,
-while SplinterDB expects the starting key to be provided at the time the
-iterator is initialized.
+The iterator is initialized over a range (optionally bounded at both ends),
+and can be repositioned within it with splinterdb_iterator_seek, like
+RocksDB's Seek (or, for a reverse iterator, SeekForPrev).
 
 Similar to RocksDB, if there is no error, then status()==0.  If status() != 0,
 then valid() == false.  In other words, valid()==true implies status()== 0,
@@ -322,6 +402,60 @@ splinterdb_iterator_init(const splinterdb     *kvs,      // IN
                          slice                 start_key // IN
 );
 
+// Initialize a new iterator over the keys from start_key up to end_key
+//
+// The end key is excluded unless end_inclusive is set. If start_key is
+// NULL_SLICE, the iterator will start before the minimum key, and if end_key
+// is NULL_SLICE, it will run past the maximum key. Bounding the range up front
+// means none of the data past the end is read (or prefetched).
+int
+splinterdb_iterator_init_range(const splinterdb     *kvs,          // IN
+                               splinterdb_iterator **iter,         // OUT
+                               slice                 start_key,    // IN
+                               slice                 end_key,      // IN
+                               bool                  end_inclusive // IN
+);
+
+// Initialize a new iterator over the same range as
+// splinterdb_iterator_init_range, but starting at the last key of the range
+// and stepping backwards with splinterdb_iterator_prev.
+//
+// The keys are read in descending order directly from the trees, so a reverse
+// scan costs the same as a forward one.
+int
+splinterdb_iterator_init_reverse(const splinterdb     *kvs,          // IN
+                                 splinterdb_iterator **iter,         // OUT
+                                 slice                 start_key,    // IN
+                                 slice                 end_key,      // IN
+                                 bool                  end_inclusive // IN
+);
+
+// Reposition the iterator within its range, without reallocating it
+//
+// A forward iterator moves to the first key at or after key, and a reverse
+// iterator to the last key at or before it (clamped to the range). If key is
+// NULL_SLICE, the iterator moves back to the start of its range.
+//
+// When the new position is in the part of the tree the iterator is already
+// reading (or was, when it was released, and no memtable has been added to
+// the tree since), only the iterator's position within the branches it holds
+// is moved, so it still reads the data as of when it got to that part of the
+// tree. Otherwise it restarts from the root.
+int
+splinterdb_iterator_seek(splinterdb_iterator *iter, // IN
+                         slice                key   // IN
+);
+
+// Release the pages and memtables an iterator holds (which would otherwise
+// block inserts), but keep its memory, so that it can be reused later with
+// splinterdb_iterator_seek. It keeps the branches it was reading, which only
+// delays the reclamation of their space, until it is seeked elsewhere or
+// deinitialized.
+//
+// valid() == false until the iterator is seeked again.
+void
+splinterdb_iterator_release(splinterdb_iterator *iter);
+
 // Deinitialize an iterator
 //
 // Failing to do this may cause hangs.
@@ -340,6 +474,14 @@ splinterdb_iterator_valid(splinterdb_iterator *iter);
 void
 splinterdb_iterator_next(splinterdb_iterator *iter);
 
+// Attempts to move the iterator back to the previous item.
+// Any error will cause valid() == false and be visible with status()
+//
+// next() and prev() may be mixed (each change of direction restarts the
+// scan from the current item), but only while valid() == true.
+void
+splinterdb_iterator_prev(splinterdb_iterator *iter);
+
 // Sets *key and *value to the locations of the current item
 // Callers must not modify that memory pointed to by the slice
 //
@@ -357,6 +499,38 @@ splinterdb_iterator_get_current(splinterdb_iterator *iter, // IN
 int
 splinterdb_iterator_status(const splinterdb_iterator *iter);
 
+typedef enum splinterdb_count_mode {
+   // Iterate over the range, counting each key that is in it once
+   SPLINTERDB_COUNT_EXACT,
+   // Add up the counts the trees keep of their entries in the range, without
+   // reading it. This is fast no matter how large the range is, but counts
+   // each version of a key (and each delete) that hasn't been compacted away
+   // yet, so it can be higher than the exact count.
+   SPLINTERDB_COUNT_APPROXIMATE
+} splinterdb_count_mode;
+
+// Count the keys from start_key up to end_key, which are bounded just like the
+// range of splinterdb_iterator_init_range
+int
+splinterdb_count_range(const splinterdb     *kvs,           // IN
+                       slice                 start_key,     // IN
+                       slice                 end_key,       // IN
+                       bool                  end_inclusive, // IN
+                       splinterdb_count_mode mode,          // IN
+                       uint64               *count          // OUT
+);
+
+// Estimate the number of bytes of the keys and values from start_key up to
+// (but excluding) end_key, from the counts the trees keep, like
+// SPLINTERDB_COUNT_APPROXIMATE. Either key may be NULL_SLICE, for an unbounded
+// range.
+int
+splinterdb_approximate_size(const splinterdb *kvs,       // IN
+                            slice             start_key, // IN
+                            slice             end_key,   // IN
+                            uint64           *size       // OUT
+);
+
 /*
  * Statistics Printing
  *
@@ -51,7 +51,9 @@ transactional_splinterdb_close(transactional_splinterdb **txn_kvsb);
 // splinterdb_close will use scratch space, so the thread that calls it must
 // have been registered (or implicitly registered by being the initial thread).
 //
-// Note: There is currently a limit of MAX_THREADS registered at a given time
+// Note: There is currently a limit of MAX_THREADS (1024) registered at a given
+// time. Per-thread state is allocated as threads first use it, and is reused
+// by later threads once its thread deregisters.
 void
 transactional_splinterdb_register_thread(transactional_splinterdb *kvs);
 
@@ -72,18 +74,23 @@ typedef enum {
 
 typedef struct tictoc_rw_entry tictoc_rw_entry;
 
-#define TICTOC_RW_SET_SIZE_LIMIT 32
-
 // TODO: use interval_tree_node for tictoc_rw_entry
 typedef struct tictoc_transaction {
-   tictoc_rw_entry            *read_write_set[TICTOC_RW_SET_SIZE_LIMIT];
+   // The read and write sets grow as needed, and are freed when the txn ends
    tictoc_rw_entry           **read_set;
    tictoc_rw_entry           **write_set;
    uint64                      read_cnt;
    uint64                      write_cnt;
+   uint64                      read_set_size;
+   uint64                      write_set_size;
+   // A hash table of the write set by key (open addressing, with a power of 2
+   // slots), so that finding a key in it doesn't depend on the txn's size
+   tictoc_rw_entry           **write_index;
+   uint64                      write_index_size;
    uint64                      commit_rts;
    uint64                      commit_wts;
    transaction_isolation_level isol_level;
+   bool                        read_only;
 } tictoc_transaction;
 
 typedef struct transaction {
@@ -94,6 +101,17 @@ int
 transactional_splinterdb_begin(transactional_splinterdb *txn_kvsb,
                                transaction              *txn);
 
+// Begin a read-only transaction.
+//
+// Lookups through a read-only transaction see the latest committed data, but
+// are not recorded in its read set, since there is nothing to validate when
+// it ends. So it can be used for any number of lookups, doesn't allocate, and
+// can be ended with either commit or abort, and restarted with another begin.
+// Writes through it fail with EINVAL.
+int
+transactional_splinterdb_begin_read_only(transactional_splinterdb *txn_kvsb,
+                                         transaction              *txn);
+
 int
 transactional_splinterdb_commit(transactional_splinterdb *txn_kvsb,
                                 transaction              *txn);
@@ -108,6 +126,16 @@ transactional_splinterdb_insert(transactional_splinterdb *txn_kvsb,
                                 slice                     key,
                                 slice                     value);
 
+// Like transactional_splinterdb_insert, but the value is prefix followed by
+// value, put together in the txn's own copy of it, so that the caller doesn't
+// have to copy them into one buffer first (e.g. for a header of its own)
+int
+transactional_splinterdb_insert_with_prefix(transactional_splinterdb *txn_kvsb,
+                                            transaction              *txn,
+                                            slice                     user_key,
+                                            slice                     prefix,
+                                            slice                     value);
+
 int
 transactional_splinterdb_delete(transactional_splinterdb *txn_kvsb,
                                 transaction              *txn,
@@ -125,6 +153,132 @@ transactional_splinterdb_lookup(transactional_splinterdb *txn_kvsb,
                                 slice                     key,
                                 splinterdb_lookup_result *result);
 
+// Start or continue an async lookup, see splinterdb_lookup_async. Reads of
+// keys the txn has written are done immediately.
+int
+transactional_splinterdb_lookup_async(transactional_splinterdb *txn_kvsb,
+                                      transaction              *txn,
+                                      slice                     key,
+                                      splinterdb_lookup_result *result,
+                                      splinterdb_async_lookup  *ctxt);
+
+int
+transactional_splinterdb_async_lookup_create(
+   transactional_splinterdb *txn_kvsb,
+   splinterdb_async_cb       cb,
+   void                     *cb_arg,
+   splinterdb_async_lookup **ctxt_out);
+
+void
+transactional_splinterdb_async_lookup_destroy(
+   transactional_splinterdb *txn_kvsb,
+   splinterdb_async_lookup  *ctxt);
+
+void
+transactional_splinterdb_async_poll(transactional_splinterdb *txn_kvsb);
+
+// Iterate over the committed data from start_key up to end_key, see
+// splinterdb_iterator_init_range. Reads through the iterator are not tracked
+// by any transaction (see transactional_iterator_init for that). Use the
+// splinterdb_iterator functions to step, seek and deinit it, but
+// transactional_splinterdb_iterator_get_current to read from it.
+int
+transactional_splinterdb_iterator_init(transactional_splinterdb *txn_kvsb,
+                                       splinterdb_iterator     **iter,
+                                       slice                     start_key,
+                                       slice                     end_key,
+                                       int32                     end_inclusive);
+
+// Like transactional_splinterdb_iterator_init, but starting at the last key of
+// the range, see splinterdb_iterator_init_reverse
+int
+transactional_splinterdb_iterator_init_reverse(
+   transactional_splinterdb *txn_kvsb,
+   splinterdb_iterator     **iter,
+   slice                     start_key,
+   slice                     end_key,
+   int32                     end_inclusive);
+
+// Like splinterdb_iterator_get_current, but returns the value without the
+// timestamps that the transactions store with it
+void
+transactional_splinterdb_iterator_get_current(splinterdb_iterator *iter,
+                                              slice               *key,
+                                              slice               *value);
+
+typedef struct transactional_iterator transactional_iterator;
+
+// Iterate over the data from start_key up to end_key (see
+// splinterdb_iterator_init_range) as part of a txn, from the start of the
+// range, or if reverse is set, from its end down.
+//
+// Unlike the iterators above, this makes the scan one of the txn's reads: the
+// part of the range the iterator has stepped over (or all of it, once the
+// iterator has passed its last key) is recorded in the txn's read set, and
+// commit fails if another txn has since committed a write to a key in that
+// part, including one that inserts or deletes a key. So a txn can scan a range
+// and write based on what it found, and still be serializable.
+//
+// The iterator sees the committed data, not the txn's own writes. It has to be
+// deinited before the txn is committed or aborted.
+int
+transactional_iterator_init(transactional_splinterdb *txn_kvsb,
+                            transaction              *txn,
+                            transactional_iterator  **iter,
+                            slice                     start_key,
+                            slice                     end_key,
+                            int32                     end_inclusive,
+                            int32                     reverse);
+
+// Reposition the iterator within its range, see splinterdb_iterator_seek.
+//
+// The scan from the new position is recorded in the txn's read set as a scan
+// of its own, so the keys read before the seek stay covered, and the keys the
+// iterator jumped over are not.
+int
+transactional_iterator_seek(transactional_iterator *iter, slice key);
+
+// Release the pages and branches the iterator holds between uses, see
+// splinterdb_iterator_release. It is invalid until it is seeked again.
+void
+transactional_iterator_release(transactional_iterator *iter);
+
+int32
+transactional_iterator_valid(transactional_iterator *iter);
+
+// Step towards the other end of the range (down, for a reverse iterator)
+void
+transactional_iterator_next(transactional_iterator *iter);
+
+// Like transactional_splinterdb_iterator_get_current
+void
+transactional_iterator_get_current(transactional_iterator *iter,
+                                   slice                  *key,
+                                   slice                  *value);
+
+int
+transactional_iterator_status(const transactional_iterator *iter);
+
+void
+transactional_iterator_deinit(transactional_iterator *iter);
+
+// Count the committed keys in a range, see splinterdb_count_range. The values
+// the transactions store include their timestamps, so they count towards the
+// approximate size.
+int
+transactional_splinterdb_count_range(transactional_splinterdb *txn_kvsb,
+                                     slice                     start_key,
+                                     slice                     end_key,
+                                     int32                     end_inclusive,
+                                     splinterdb_count_mode     mode,
+                                     uint64                   *count);
+
+int
+transactional_splinterdb_approximate_size(transactional_splinterdb *txn_kvsb,
+                                          slice                     start_key,
+                                          slice                     end_key,
+                                          uint64                   *size);
+
 // XXX: These functions wouldn't be necessary if txn_kvsb were public
 void
 transactional_splinterdb_lookup_result_init(
@@ -2,6 +2,8 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "btree_private.h"
+#include "splinterdb/limits.h"
+#include "lz4.h"
 #include "poison.h"
 
 /******************************************************************
@@ -268,7 +270,7 @@ btree_fill_leaf_entry(const btree_config *cfg,
 {
    debug_assert(
       pointer_byte_offset(entry, leaf_entry_required_capacity(tuple_key, msg))
-      <= pointer_byte_offset(hdr, btree_page_size(cfg)));
+      <= pointer_byte_offset(hdr, btree_max_node_size(cfg)));
    copy_tuple_to_ondisk_tuple(entry, tuple_key, msg);
    debug_assert(ondisk_tuple_message_class(entry) == message_class(msg),
                 "entry->type not large enough to hold message_class");
@@ -1025,6 +1027,65 @@ btree_alloc(cache          *cc,
    return TRUE;
 }
 
+/*
+ *-----------------------------------------------------------------------------
+ * btree_decompress_node --
+ *
+ *      Returns a decompressed copy of a compressed leaf, which is freed by
+ *      btree_node_unget. The entries are laid out in order right after the
+ *      table of offsets, with no free space, since the copy is only read.
+ *-----------------------------------------------------------------------------
+ */
+static btree_hdr *
+btree_decompress_node(const btree_config *cfg, const btree_compressed_hdr *chdr)
+{
+   uint64     node_size = btree_max_node_size(cfg);
+   btree_hdr *hdr =
+      TYPED_MANUAL_MALLOC(platform_get_heap_id(), hdr, node_size);
+   platform_assert(hdr != NULL);
+   hdr->next_addr        = chdr->next_addr;
+   hdr->next_extent_addr = chdr->next_extent_addr;
+   hdr->generation       = 0;
+   hdr->height           = chdr->height;
+   hdr->num_entries      = chdr->num_entries;
+
+   char       *entries = (char *)&hdr->offsets[chdr->num_entries];
+   char       *target  = entries;
+   const char *source  = chdr->data;
+   for (uint8 i = 0; i < chdr->num_blocks; i++) {
+      // each block was compressed with the ones before it as its dictionary
+      int length = LZ4_decompress_safe_usingDict(source,
+                                                 target,
+                                                 chdr->block_lengths[i],
+                                                 node_size
+                                                    - diff_ptr(hdr, target),
+                                                 entries,
+                                                 diff_ptr(entries, target));
+      platform_assert(length >= 0, "corrupt compressed btree leaf\n");
+      source += chdr->block_lengths[i];
+      target += length;
+   }
+   platform_assert(diff_ptr(entries, target) == chdr->entries_length);
+
+   leaf_entry *entry = (leaf_entry *)entries;
+   for (table_index i = 0; i < chdr->num_entries; i++) {
+      hdr->offsets[i] = diff_ptr(hdr, entry);
+      entry = pointer_byte_offset(entry, sizeof_leaf_entry(entry));
+   }
+   hdr->next_entry = diff_ptr(hdr, entries);
+   return hdr;
+}
+
+static inline void
+btree_node_init_hdr(const btree_config *cfg, btree_node *node)
+{
+   node->hdr = (btree_hdr *)(node->page->data);
+   if (node->hdr->generation == BTREE_COMPRESSED_GENERATION) {
+      node->hdr =
+         btree_decompress_node(cfg, (btree_compressed_hdr *)node->page->data);
+   }
+}
+
 /*
  *-----------------------------------------------------------------------------
  * btree_node_[get,release] --
@@ -1041,7 +1102,7 @@ btree_node_get(cache              *cc,
    debug_assert(node->addr != 0);
 
    node->page = cache_get(cc, node->addr, TRUE, type);
-   node->hdr  = (btree_hdr *)(node->page->data);
+   btree_node_init_hdr(cfg, node);
 }
 
 static inline bool
@@ -1082,6 +1143,10 @@ btree_node_unget(cache              *cc,  // IN
                  const btree_config *cfg, // IN
                  btree_node         *node)        // IN
 {
+   if ((char *)node->hdr != node->page->data) {
+      // a decompressed copy (or a compressed leaf that is being packed)
+      platform_free(platform_get_heap_id(), node->hdr);
+   }
    cache_unget(cc, node->page);
    node->page = NULL;
    node->hdr  = NULL;
@@ -1104,7 +1169,7 @@ btree_node_get_from_cache_ctxt(const btree_config *cfg,  // IN
 {
    node->addr = ctxt->page->disk_addr;
    node->page = ctxt->page;
-   node->hdr  = (btree_hdr *)node->page->data;
+   btree_node_init_hdr(cfg, node);
 }
 
 
@@ -2365,6 +2430,9 @@ btree_lookup_and_merge_async(cache             *cc,          // IN
 static bool
 btree_iterator_is_at_end(btree_iterator *itor)
 {
+   if (itor->reverse) {
+      return itor->before_start;
+   }
    return itor->curr.addr == itor->end_addr && itor->idx == itor->end_idx;
 }
 
@@ -2381,7 +2449,6 @@ btree_iterator_get_curr(iterator *base_itor, key *curr_key, message *data)
    debug_assert(itor->idx < btree_num_entries(itor->curr.hdr));
    debug_assert(itor->curr.page != NULL);
    debug_assert(itor->curr.page->disk_addr == itor->curr.addr);
-   debug_assert((char *)itor->curr.hdr == itor->curr.page->data);
    cache_validate_page(itor->cc, itor->curr.page, itor->curr.addr);
    if (itor->curr.hdr->height == 0) {
       *curr_key = btree_get_tuple_key(itor->cfg, itor->curr.hdr, itor->idx);
@@ -2500,6 +2567,106 @@ btree_iterator_advance_leaf(btree_iterator *itor)
    }
 }
 
+/*
+ *-----------------------------------------------------------------------------
+ * Reverse iteration (leaves only)
+ *
+ * Leaves are only linked forwards, so a reverse iterator finds the previous
+ * leaf by descending from the root again, for the last key before the 0th
+ * key of the current leaf.  As explained in btree_iterator_advance_leaf,
+ * every leaf but the left-most one has its 0th key as its pivot in its
+ * parent, and no smaller key can be inserted into it, so the 0th key remains
+ * the boundary between the leaves while we release the current leaf for the
+ * descent (which we must, to avoid deadlocks with inserters).
+ *-----------------------------------------------------------------------------
+ */
+
+/*
+ * Positions the iterator on idx in curr, or before the start if there is no
+ * such entry or it is below min_key.
+ */
+static void
+btree_iterator_reverse_set_idx(btree_iterator *itor, int64 idx)
+{
+   if (idx < 0
+       || btree_key_compare(
+             itor->cfg,
+             btree_get_tuple_key(itor->cfg, itor->curr.hdr, idx),
+             itor->min_key)
+             < 0)
+   {
+      itor->before_start = TRUE;
+      itor->idx          = 0;
+      return;
+   }
+   itor->idx = idx;
+}
+
+/*
+ * Gets the leaf holding the last key before target into curr, and positions
+ * the iterator on that key.
+ */
+static void
+btree_iterator_reverse_seek(btree_iterator *itor, key target)
+{
+   cache        *cc  = itor->cc;
+   btree_config *cfg = itor->cfg;
+   btree_node    node, child_node;
+   bool          found;
+   int64         idx;
+
+   node.addr = itor->root_addr;
+   btree_node_get(cc, cfg, &node, itor->page_type);
+   for (uint32 h = btree_height(node.hdr); h > 0; h--) {
+      if (key_is_positive_infinity(target)) {
+         idx = btree_num_entries(node.hdr) - 1;
+      } else {
+         idx = btree_find_pivot(cfg, node.hdr, target, &found);
+         if (found) {
+            // the child starts at target, the keys before it are to the left
+            idx--;
+         }
+      }
+      if (idx < 0) {
+         idx = 0;
+      }
+      child_node.addr = index_entry_child_addr(
+         btree_get_index_entry(cfg, node.hdr, idx));
+      btree_node_get(cc, cfg, &child_node, itor->page_type);
+      btree_node_unget(cc, cfg, &node);
+      node = child_node;
+   }
+   itor->curr = node;
+
+   if (key_is_positive_infinity(target)) {
+      idx = btree_num_entries(node.hdr) - 1;
+   } else {
+      idx = btree_find_tuple(cfg, node.hdr, target, &found);
+      if (found) {
+         idx--;
+      }
+   }
+   btree_iterator_reverse_set_idx(itor, idx);
+}
+
+static void
+btree_iterator_reverse_advance(btree_iterator *itor)
+{
+   if (itor->idx > 0) {
+      btree_iterator_reverse_set_idx(itor, itor->idx - 1);
+      return;
+   }
+
+   // continue in the previous leaf, before this leaf's 0th key
+   key    first_key = btree_get_tuple_key(itor->cfg, itor->curr.hdr, 0);
+   char   first_key_buffer[MAX_KEY_SIZE];
+   uint64 length = key_length(first_key);
+   platform_assert(length <= sizeof(first_key_buffer));
+   memcpy(first_key_buffer, key_data(first_key), length);
+   btree_node_unget(itor->cc, itor->cfg, &itor->curr);
+   btree_iterator_reverse_seek(itor, key_create(length, first_key_buffer));
+}
+
 platform_status
 btree_iterator_advance(iterator *base_itor)
 {
@@ -2510,6 +2677,11 @@ btree_iterator_advance(iterator *base_itor)
    debug_assert(!btree_iterator_is_at_end(itor));
    debug_assert(itor->idx < btree_num_entries(itor->curr.hdr));
 
+   if (itor->reverse) {
+      btree_iterator_reverse_advance(itor);
+      return STATUS_OK;
+   }
+
    itor->idx++;
 
    if (!btree_iterator_is_at_end(itor)
@@ -2679,6 +2851,44 @@ btree_iterator_init(cache          *cc,
                 || itor->idx < btree_num_entries(itor->curr.hdr));
 }
 
+/*
+ *-----------------------------------------------------------------------------
+ * Initializes an iterator over the keys in [min_key, max_key) of a btree, in
+ * descending order.  Reverse iterators only iterate over leaves (height 0)
+ * and don't prefetch.
+ *
+ * Caller must guarantee:
+ *    min_key needs to be valid until at_end() returns true
+ *-----------------------------------------------------------------------------
+ */
+void
+btree_iterator_init_reverse(cache          *cc,
+                            btree_config   *cfg,
+                            btree_iterator *itor,
+                            uint64          root_addr,
+                            page_type       page_type,
+                            key             min_key,
+                            key             max_key)
+{
+   platform_assert(root_addr != 0);
+   debug_assert(page_type == PAGE_TYPE_MEMTABLE
+                || page_type == PAGE_TYPE_BRANCH);
+
+   debug_assert(!key_is_null(min_key) && !key_is_null(max_key));
+
+   ZERO_CONTENTS(itor);
+   itor->cc        = cc;
+   itor->cfg       = cfg;
+   itor->root_addr = root_addr;
+   itor->min_key   = min_key;
+   itor->max_key   = max_key;
+   itor->page_type = page_type;
+   itor->reverse   = TRUE;
+   itor->super.ops = &btree_iterator_ops;
+
+   btree_iterator_reverse_seek(itor, max_key);
+}
+
 void
 btree_iterator_deinit(btree_iterator *itor)
 {
@@ -2690,6 +2900,142 @@ btree_iterator_deinit(btree_iterator *itor)
  * B-tree packing functions
  ****************************/
 
+/*
+ * Compressing the leaves of a packed btree: the entries of the leaf that is
+ * being packed go into a (decompressed) node as usual, and are also copied in
+ * order into the compressor, which compresses them into blocks on the leaf's
+ * page as it goes. A leaf only takes an entry if the blocks still to be
+ * compressed, with the entry, fit in the page however badly they compress.
+ */
+// how much of the entries to compress at a time
+#define BTREE_COMPRESSED_BLOCK_SIZE 1024
+
+typedef struct btree_pack_compressor {
+   LZ4_stream_t stream;
+   uint64       entries_length;    // of the current leaf
+   uint64       block_start;       // of the entries not compressed yet
+   uint64       compressed_length; // of the blocks so far
+   char         entries[];
+} btree_pack_compressor;
+
+static inline uint64
+btree_compressed_capacity(const btree_config *cfg)
+{
+   return btree_page_size(cfg) - sizeof(btree_compressed_hdr);
+}
+
+static inline btree_compressed_hdr *
+btree_compressed_hdr_of(btree_node *leaf)
+{
+   return (btree_compressed_hdr *)leaf->page->data;
+}
+
+static void
+btree_pack_compress_block(btree_pack_req *req, btree_node *leaf)
+{
+   btree_pack_compressor *comp    = req->compressor;
+   btree_compressed_hdr  *chdr    = btree_compressed_hdr_of(leaf);
+   uint64                 pending = comp->entries_length - comp->block_start;
+   int                    length  = LZ4_compress_fast_continue(
+      &comp->stream,
+      comp->entries + comp->block_start,
+      chdr->data + comp->compressed_length,
+      pending,
+      btree_compressed_capacity(req->cfg) - comp->compressed_length,
+      1);
+   platform_assert(0 < length
+                   && chdr->num_blocks < BTREE_COMPRESSED_MAX_BLOCKS);
+   chdr->block_lengths[chdr->num_blocks++] = length;
+   comp->compressed_length += length;
+   comp->block_start = comp->entries_length;
+}
+
+// the fields of the node's header that are set after its entries
+static inline void
+btree_pack_sync_compressed_hdr(btree_node *leaf)
+{
+   btree_compressed_hdr *chdr = btree_compressed_hdr_of(leaf);
+   chdr->next_addr            = leaf->hdr->next_addr;
+   chdr->next_extent_addr     = leaf->hdr->next_extent_addr;
+}
+
+static void
+btree_pack_start_compressed_leaf(btree_pack_req *req, btree_node *leaf)
+{
+   btree_compressed_hdr *chdr = btree_compressed_hdr_of(leaf);
+   memset(chdr, 0, sizeof(*chdr));
+   chdr->generation = BTREE_COMPRESSED_GENERATION;
+
+   uint64 node_size = btree_max_node_size(req->cfg);
+   leaf->hdr =
+      TYPED_MANUAL_MALLOC(platform_get_heap_id(), leaf->hdr, node_size);
+   platform_assert(leaf->hdr != NULL);
+   btree_init_hdr(req->cfg, leaf->hdr);
+   leaf->hdr->next_entry = node_size;
+
+   btree_pack_compressor *comp = req->compressor;
+   LZ4_resetStream_fast(&comp->stream);
+   comp->entries_length    = 0;
+   comp->block_start       = 0;
+   comp->compressed_length = 0;
+}
+
+static void
+btree_pack_finish_compressed_leaf(btree_pack_req *req, btree_node *leaf)
+{
+   if (req->compressor->block_start < req->compressor->entries_length) {
+      btree_pack_compress_block(req, leaf);
+   }
+   btree_pack_sync_compressed_hdr(leaf);
+}
+
+static bool
+btree_pack_compressed_leaf_has_room(btree_pack_req *req,
+                                    btree_node     *leaf,
+                                    key             tuple_key,
+                                    message         msg)
+{
+   btree_pack_compressor *comp     = req->compressor;
+   uint64                 capacity = btree_compressed_capacity(req->cfg);
+   uint64 required = leaf_entry_required_capacity(tuple_key, msg);
+   uint64 pending  = comp->entries_length - comp->block_start;
+   if (comp->compressed_length + LZ4_COMPRESSBOUND(pending + required)
+       <= capacity)
+   {
+      return TRUE;
+   }
+   // compress what is pending to see how much room is really left (keeping a
+   // block for the entry)
+   if (pending == 0
+       || BTREE_COMPRESSED_MAX_BLOCKS - 1
+             <= btree_compressed_hdr_of(leaf)->num_blocks)
+   {
+      return FALSE;
+   }
+   btree_pack_compress_block(req, leaf);
+   return comp->compressed_length + LZ4_COMPRESSBOUND(required) <= capacity;
+}
+
+static void
+btree_pack_compress_entry(btree_pack_req *req, btree_node *leaf)
+{
+   btree_pack_compressor *comp = req->compressor;
+   table_index            k    = btree_num_entries(leaf->hdr) - 1;
+   leaf_entry            *entry  = btree_get_leaf_entry(req->cfg, leaf->hdr, k);
+   uint64                 length = sizeof_leaf_entry(entry);
+   memcpy(comp->entries + comp->entries_length, entry, length);
+   comp->entries_length += length;
+
+   btree_compressed_hdr *chdr = btree_compressed_hdr_of(leaf);
+   chdr->num_entries          = k + 1;
+   chdr->entries_length       = comp->entries_length;
+   if (BTREE_COMPRESSED_BLOCK_SIZE <= comp->entries_length - comp->block_start
+       && chdr->num_blocks < BTREE_COMPRESSED_MAX_BLOCKS - 1)
+   {
+      btree_pack_compress_block(req, leaf);
+   }
+}
+
 // generation number isn't used in packed btrees
 static inline void
 btree_pack_node_init_hdr(const btree_config *cfg,
@@ -2754,6 +3100,9 @@ btree_pack_link_node(btree_pack_req *req,
    key                pivot = height ? btree_get_pivot(req->cfg, edge->hdr, 0)
                                      : btree_get_tuple_key(req->cfg, edge->hdr, 0);
    edge->hdr->next_extent_addr = next_extent_addr;
+   if (height == 0 && req->compressor) {
+      btree_pack_sync_compressed_hdr(edge);
+   }
    btree_node_unlock(req->cc, req->cfg, edge);
    btree_node_unclaim(req->cc, req->cfg, edge);
    // Cannot fully unlock edge yet because the key "pivot" may point into it.
@@ -2806,6 +3155,13 @@ btree_pack_create_next_node(btree_pack_req *req, uint64 height, key pivot)
                PAGE_TYPE_BRANCH,
                &new_node);
    btree_pack_node_init_hdr(req->cfg, new_node.hdr, 0, height);
+   if (height == 0 && req->compressor) {
+      btree_node *old_leaf = btree_pack_get_current_node(req, 0);
+      if (old_leaf) {
+         btree_pack_finish_compressed_leaf(req, old_leaf);
+      }
+      btree_pack_start_compressed_leaf(req, &new_node);
+   }
 
    if (0 < req->num_edges[height]) {
       btree_node *old_node     = btree_pack_get_current_node(req, height);
@@ -2839,6 +3195,8 @@ btree_pack_loop(btree_pack_req *req,       // IN/OUT
    btree_node *leaf = btree_pack_get_current_node(req, 0);
 
    if (!leaf
+       || (req->compressor
+           && !btree_pack_compressed_leaf_has_room(req, leaf, tuple_key, msg))
        || !btree_set_leaf_entry(
           req->cfg, leaf->hdr, btree_num_entries(leaf->hdr), tuple_key, msg))
    {
@@ -2847,6 +3205,9 @@ btree_pack_loop(btree_pack_req *req,       // IN/OUT
          btree_set_leaf_entry(req->cfg, leaf->hdr, 0, tuple_key, msg);
       platform_assert(result);
    }
+   if (req->compressor) {
+      btree_pack_compress_entry(req, leaf);
+   }
 
    btree_pivot_stats *leaf_stats = btree_pack_get_current_node_stats(req, 0);
    leaf_stats->num_kvs++;
@@ -2884,6 +3245,11 @@ btree_pack_post_loop(btree_pack_req *req, key last_key)
       return;
    }
 
+   if (req->compressor) {
+      btree_pack_finish_compressed_leaf(req,
+                                        btree_pack_get_current_node(req, 0));
+   }
+
    int h = 0;
    while (h < req->height || 1 < req->num_edges[h]) {
       btree_pack_link_extent(req, h, 0);
@@ -2895,7 +3261,10 @@ btree_pack_post_loop(btree_pack_req *req, key last_key)
    debug_only bool success = btree_node_claim(cc, cfg, &root);
    debug_assert(success);
    btree_node_lock(cc, cfg, &root);
-   memmove(root.hdr, req->edge[req->height][0].hdr, btree_page_size(cfg));
+   // (the page, rather than the node, in case it is a compressed leaf)
+   memmove(root.hdr,
+           req->edge[req->height][0].page->data,
+           btree_page_size(cfg));
    // fix the root next extent
    root.hdr->next_extent_addr = 0;
    btree_node_full_unlock(cc, cfg, &root);
@@ -2938,9 +3307,25 @@ btree_pack_abort(btree_pack_req *req)
  * Otherwise, returns standard errors, e.g. STATUS_NO_MEMORY, etc.
  *-----------------------------------------------------------------------------
  */
+static void
+btree_pack_free_compressor(btree_pack_req *req)
+{
+   if (req->compressor) {
+      platform_free(platform_get_heap_id(), req->compressor);
+   }
+}
+
 platform_status
 btree_pack(btree_pack_req *req)
 {
+   if (req->cfg->compress_leaves) {
+      req->compressor = TYPED_MANUAL_MALLOC(
+         platform_get_heap_id(),
+         req->compressor,
+         sizeof(btree_pack_compressor) + btree_max_node_size(req->cfg));
+      platform_assert(req->compressor != NULL);
+      LZ4_initStream(&req->compressor->stream, sizeof(LZ4_stream_t));
+   }
    btree_pack_setup_start(req);
 
    key     tuple_key = NEGATIVE_INFINITY_KEY;
@@ -2952,18 +3337,21 @@ btree_pack(btree_pack_req *req)
       if (!btree_pack_can_fit_tuple(req, tuple_key, data)) {
          platform_error_log("btree_pack exceeded output size limit\n");
          btree_pack_abort(req);
+         btree_pack_free_compressor(req);
          return STATUS_LIMIT_EXCEEDED;
       }
       platform_status rc = btree_pack_loop(req, tuple_key, data);
       if (!SUCCESS(rc)) {
          platform_error_log("%s error status: %d\n", __func__, rc.r);
          btree_pack_abort(req);
+         btree_pack_free_compressor(req);
          return rc;
       }
       iterator_advance(req->itor);
    }
 
    btree_pack_post_loop(req, tuple_key);
+   btree_pack_free_compressor(req);
    platform_assert(IMPLIES(req->num_tuples == 0, req->root_addr == 0));
    return STATUS_OK;
 }
@@ -3522,6 +3910,7 @@ btree_config_init(btree_config *btree_cfg,
    btree_cfg->cache_cfg          = cache_cfg;
    btree_cfg->data_cfg           = data_cfg;
    btree_cfg->rough_count_height = rough_count_height;
+   btree_cfg->compress_leaves    = FALSE;
 
    uint64 page_size           = btree_page_size(btree_cfg);
    uint64 max_inline_key_size = MAX_INLINE_KEY_SIZE(page_size);
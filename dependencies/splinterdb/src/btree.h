@@ -79,6 +79,8 @@ typedef struct btree_config {
    cache_config *cache_cfg;
    data_config  *data_cfg;
    uint64        rough_count_height;
+   // compress the leaves of packed btrees (see btree_compressed_hdr)
+   bool compress_leaves;
 } btree_config;
 
 typedef struct ONDISK btree_hdr btree_hdr;
@@ -143,6 +145,10 @@ typedef struct btree_iterator {
    uint64     end_addr;
    uint64     end_idx;
    uint64     end_generation;
+
+   // reverse iterators walk from the last key before max_key down to min_key
+   bool reverse;
+   bool before_start;
 } btree_iterator;
 
 typedef struct btree_pack_req {
@@ -163,6 +169,9 @@ typedef struct btree_pack_req {
 
    mini_allocator mini;
 
+   // state for compressing the current leaf, if the leaves are compressed
+   struct btree_pack_compressor *compressor;
+
    // output of the compaction
    uint64 root_addr;     // root address of the output tree
    uint64 num_tuples;    // no. of tuples in the output tree
@@ -320,6 +329,15 @@ btree_iterator_init(cache          *cc,
                     bool            do_prefetch,
                     uint32          height);
 
+void
+btree_iterator_init_reverse(cache          *cc,
+                            btree_config   *cfg,
+                            btree_iterator *iterator,
+                            uint64          root_addr,
+                            page_type       page_type,
+                            key             min_key,
+                            key             max_key);
+
 void
 btree_iterator_deinit(btree_iterator *itor);
 
@@ -42,6 +42,37 @@ struct ONDISK btree_hdr {
    table_entry offsets[];
 };
 
+/*
+ * *************************************************************************
+ * Compressed BTree leaves: Disk-resident structure
+ * Leaves of packed btrees are compressed when the btree_config asks for it.
+ * The page starts like a btree_hdr (with no entries), so that next_addr and
+ * next_extent_addr can be followed without decompressing it, and generation
+ * set to BTREE_COMPRESSED_GENERATION to tell it apart. It is followed by the
+ * leaf's entries, in order, compressed with LZ4 in blocks that each use the
+ * entries before them as their dictionary. A compressed leaf holds up to
+ * BTREE_COMPRESSED_NODE_PAGES pages worth of entries, and is read through a
+ * decompressed copy of the node (see btree_node_get).
+ * *************************************************************************
+ */
+#define BTREE_COMPRESSED_GENERATION UINT64_MAX
+#define BTREE_COMPRESSED_NODE_PAGES 4
+#define BTREE_COMPRESSED_MAX_BLOCKS 32
+
+typedef struct ONDISK btree_compressed_hdr {
+   uint64      next_addr;
+   uint64      next_extent_addr;
+   uint64      generation;
+   uint8       height;
+   node_offset unused_next_entry;
+   table_index unused_num_entries;
+   table_index num_entries;
+   uint16      entries_length; // decompressed
+   uint8       num_blocks;
+   uint16      block_lengths[BTREE_COMPRESSED_MAX_BLOCKS]; // compressed
+   char        data[];
+} btree_compressed_hdr;
+
 /*
  * *************************************************************************
  * BTree Node index entries: Disk-resident structure
@@ -156,6 +187,13 @@ btree_page_size(const btree_config *cfg)
    return cache_config_page_size(cfg->cache_cfg);
 }
 
+// The most a node (once decompressed) can hold
+static inline uint64
+btree_max_node_size(const btree_config *cfg)
+{
+   return BTREE_COMPRESSED_NODE_PAGES * btree_page_size(cfg);
+}
+
 static inline uint64
 btree_extent_size(const btree_config *cfg)
 {
@@ -221,11 +259,12 @@ btree_get_leaf_entry(const btree_config *cfg,
     */
    debug_assert(diff_ptr(hdr, &hdr->offsets[hdr->num_entries])
                 <= hdr->offsets[k]);
-   debug_assert(hdr->offsets[k] + sizeof(leaf_entry) <= btree_page_size(cfg));
+   debug_assert(hdr->offsets[k] + sizeof(leaf_entry)
+                <= btree_max_node_size(cfg));
    leaf_entry *entry =
       (leaf_entry *)const_pointer_byte_offset(hdr, hdr->offsets[k]);
    debug_assert(hdr->offsets[k] + sizeof_leaf_entry(entry)
-                <= btree_page_size(cfg));
+                <= btree_max_node_size(cfg));
    return entry;
 }
 
@@ -31,6 +31,14 @@
 #define CC_UNMAPPED_ENTRY UINT32_MAX
 #define CC_UNMAPPED_ADDR  UINT64_MAX
 
+/*
+ * The lookup table covers the whole disk capacity, but it is backed by a
+ * lazily faulted mapping so that only the parts covering addresses in use take
+ * memory. So that the untouched (zero-filled) parts read as unmapped, entry
+ * numbers are stored complemented, which maps CC_UNMAPPED_ENTRY to 0.
+ */
+#define CC_LOOKUP_CODE(entry_number) (~(uint32)(entry_number))
+
 // Number of entries to clean/evict/get_free in a per-thread batch
 #define CC_ENTRIES_PER_BATCH 64
 
@@ -653,7 +661,7 @@ clockcache_record_backtrace(clockcache *cc, uint32 entry_number)
 
    myEntry->history[myhistindex].status   = myEntry->status;
    myEntry->history[myhistindex].refcount = 0;
-   for (threadid i = 0; i < MAX_THREADS; i++) {
+   for (threadid i = 0; i < CC_RC_WIDTH; i++) {
       myEntry->history[myhistindex].refcount +=
          cc->refcount[i * cc->cfg->page_capacity + entry_number];
    }
@@ -699,7 +707,7 @@ static inline uint32
 clockcache_lookup(const clockcache *cc, uint64 addr)
 {
    uint64 lookup_no    = clockcache_divide_by_page_size(cc, addr);
-   uint32 entry_number = cc->lookup[lookup_no];
+   uint32 entry_number = CC_LOOKUP_CODE(cc->lookup[lookup_no]);
 
    debug_assert(((entry_number < cc->cfg->page_capacity)
                  || (entry_number == CC_UNMAPPED_ENTRY)),
@@ -770,6 +778,36 @@ clockcache_wait(clockcache *cc)
    io_cleanup(cc->io, CC_DEFAULT_MAX_IO_EVENTS);
 }
 
+/*
+ *-----------------------------------------------------------------------------
+ * per thread state
+ *
+ *      Each thread has its own free hand and stats, allocated the first time
+ *      that thread id uses the cache. Thread ids are recycled, and so is this
+ *      state.
+ *-----------------------------------------------------------------------------
+ */
+
+static void
+clockcache_thread_init(void *state)
+{
+   clockcache_thread *thread = (clockcache_thread *)state;
+   thread->free_hand         = CC_UNMAPPED_ENTRY;
+   thread->enable_sync_get   = TRUE;
+}
+
+static inline clockcache_thread *
+clockcache_get_thread(clockcache *cc, threadid tid)
+{
+   return (clockcache_thread *)thread_state_get(&cc->per_thread, tid);
+}
+
+static inline cache_stats *
+clockcache_get_stats(clockcache *cc, threadid tid)
+{
+   return &clockcache_get_thread(cc, tid)->stats;
+}
+
 
 /*
  *-----------------------------------------------------------------------------
@@ -880,7 +918,7 @@ clockcache_assert_no_refs(clockcache *cc)
 {
    threadid        i;
    volatile uint32 j;
-   for (i = 0; i < MAX_THREADS; i++) {
+   for (i = 0; i < CC_RC_WIDTH; i++) {
       for (j = 0; j < cc->cfg->page_capacity; j++) {
          if (clockcache_get_ref(cc, j, i) != 0) {
             clockcache_get_ref(cc, j, i);
@@ -895,7 +933,7 @@ clockcache_assert_no_refs_and_pins(clockcache *cc)
 {
    threadid i;
    uint32   j;
-   for (i = 0; i < MAX_THREADS; i++) {
+   for (i = 0; i < CC_RC_WIDTH; i++) {
       for (j = 0; j < cc->cfg->page_capacity; j++) {
          platform_assert(clockcache_get_ref(cc, j, i) == 0);
       }
@@ -1373,8 +1411,9 @@ clockcache_batch_start_writeback(clockcache *cc, uint64 batch, bool is_urgent)
          req->bytes = clockcache_multiply_by_page_size(cc, req_count);
 
          if (cc->cfg->use_stats) {
-            cc->stats[tid].page_writes[entry->type] += req_count;
-            cc->stats[tid].writes_issued++;
+            cache_stats *stats = clockcache_get_stats(cc, tid);
+            stats->page_writes[entry->type] += req_count;
+            stats->writes_issued++;
          }
 
          for (i = 0; i < req_count; i++) {
@@ -1487,7 +1526,7 @@ clockcache_try_evict(clockcache *cc, uint32 entry_number)
    uint64 addr = entry->page.disk_addr;
    if (addr != CC_UNMAPPED_ADDR) {
       uint64 lookup_no      = clockcache_divide_by_page_size(cc, addr);
-      cc->lookup[lookup_no] = CC_UNMAPPED_ENTRY;
+      cc->lookup[lookup_no] = CC_LOOKUP_CODE(CC_UNMAPPED_ENTRY);
       entry->page.disk_addr = CC_UNMAPPED_ADDR;
    }
    debug_only uint32 debug_status =
@@ -1554,13 +1593,13 @@ clockcache_evict_batch(clockcache *cc, uint32 batch)
 void
 clockcache_move_hand(clockcache *cc, bool is_urgent)
 {
-   const threadid tid = platform_get_tid();
-   volatile bool *evict_batch_busy;
-   volatile bool *clean_batch_busy;
-   uint64         cleaner_hand;
+   clockcache_thread *thread = clockcache_get_thread(cc, platform_get_tid());
+   volatile bool     *evict_batch_busy;
+   volatile bool     *clean_batch_busy;
+   uint64             cleaner_hand;
 
    /* move the hand a batch forward */
-   uint64          evict_hand = cc->per_thread[tid].free_hand;
+   uint64          evict_hand = thread->free_hand;
    debug_only bool was_busy   = TRUE;
    if (evict_hand != CC_UNMAPPED_ENTRY) {
       evict_batch_busy = &cc->batch_busy[evict_hand];
@@ -1582,7 +1621,7 @@ clockcache_move_hand(clockcache *cc, bool is_urgent)
    } while (!__sync_bool_compare_and_swap(evict_batch_busy, FALSE, TRUE));
 
    clockcache_evict_batch(cc, evict_hand % cc->cfg->batch_capacity);
-   cc->per_thread[tid].free_hand = evict_hand % cc->cfg->batch_capacity;
+   thread->free_hand = evict_hand % cc->cfg->batch_capacity;
 }
 
 
@@ -1599,15 +1638,15 @@ clockcache_get_free_page(clockcache *cc,
                          bool        refcount,
                          bool        blocking)
 {
-   uint32            entry_no;
-   uint64            num_passes = 0;
-   const threadid    tid        = platform_get_tid();
-   uint64            max_hand   = cc->per_thread[tid].free_hand;
-   clockcache_entry *entry;
-   timestamp         wait_start;
+   uint32             entry_no;
+   uint64             num_passes = 0;
+   const threadid     tid        = platform_get_tid();
+   clockcache_thread *thread     = clockcache_get_thread(cc, tid);
+   uint64             max_hand   = thread->free_hand;
+   clockcache_entry  *entry;
+   timestamp          wait_start;
 
-   debug_assert((tid < MAX_THREADS), "Invalid tid=%lu\n", tid);
-   if (cc->per_thread[tid].free_hand == CC_UNMAPPED_ENTRY) {
+   if (thread->free_hand == CC_UNMAPPED_ENTRY) {
       clockcache_move_hand(cc, FALSE);
    }
 
@@ -1619,7 +1658,7 @@ clockcache_get_free_page(clockcache *cc,
    while (num_passes < 3
           || (blocking && !io_max_latency_elapsed(cc->io, wait_start)))
    {
-      uint64 start_entry = cc->per_thread[tid].free_hand * CC_ENTRIES_PER_BATCH;
+      uint64 start_entry = thread->free_hand * CC_ENTRIES_PER_BATCH;
       uint64 end_entry   = start_entry + CC_ENTRIES_PER_BATCH;
       for (entry_no = start_entry; entry_no < end_entry; entry_no++) {
          entry = &cc->entry[entry_no];
@@ -1637,7 +1676,7 @@ clockcache_get_free_page(clockcache *cc,
       }
 
       clockcache_move_hand(cc, num_passes != 0);
-      if (cc->per_thread[tid].free_hand < max_hand) {
+      if (thread->free_hand < max_hand) {
          num_passes++;
          /*
           * The first pass doesn't really have a fair chance at having
@@ -1653,7 +1692,7 @@ clockcache_get_free_page(clockcache *cc,
          }
          clockcache_wait(cc);
       }
-      max_hand = cc->per_thread[tid].free_hand;
+      max_hand = thread->free_hand;
    }
    if (blocking) {
       platform_default_log("cache locked (num_passes=%lu time=%lu nsecs)\n",
@@ -1770,8 +1809,7 @@ clockcache_init(clockcache          *cc,   // OUT
                 platform_heap_id     hid,  // IN
                 platform_module_id   mid)    // IN
 {
-   int      i;
-   threadid thr_i;
+   int i;
 
    platform_assert(cc != NULL);
    ZERO_CONTENTS(cc);
@@ -1809,14 +1847,12 @@ clockcache_init(clockcache          *cc,   // OUT
    cc->heap_id     = hid;
 
    /* lookup maps addrs to entries, entry contains the entries themselves */
-   cc->lookup =
-      TYPED_ARRAY_MALLOC(cc->heap_id, cc->lookup, allocator_page_capacity);
-   if (!cc->lookup) {
+   cc->lookup_bh = platform_buffer_create(
+      allocator_page_capacity * sizeof(*cc->lookup), cc->heap_handle, mid);
+   if (!cc->lookup_bh) {
       goto alloc_error;
    }
-   for (i = 0; i < allocator_page_capacity; i++) {
-      cc->lookup[i] = CC_UNMAPPED_ENTRY;
-   }
+   cc->lookup = platform_buffer_getaddr(cc->lookup_bh);
 
    cc->entry =
       TYPED_ARRAY_ZALLOC(cc->heap_id, cc->entry, cc->cfg->page_capacity);
@@ -1853,10 +1889,10 @@ clockcache_init(clockcache          *cc,   // OUT
    /* The hands and associated page */
    cc->free_hand  = 0;
    cc->evict_hand = 1;
-   for (thr_i = 0; thr_i < MAX_THREADS; thr_i++) {
-      cc->per_thread[thr_i].free_hand       = CC_UNMAPPED_ENTRY;
-      cc->per_thread[thr_i].enable_sync_get = TRUE;
-   }
+   thread_state_table_init(&cc->per_thread,
+                           cc->heap_id,
+                           sizeof(clockcache_thread),
+                           clockcache_thread_init);
    cc->batch_busy =
       TYPED_ARRAY_ZALLOC(cc->heap_id,
                          cc->batch_busy,
@@ -1893,7 +1929,9 @@ clockcache_deinit(clockcache *cc) // IN/OUT
    }
 
    platform_free(cc->heap_id, cc->entry);
-   platform_free(cc->heap_id, cc->lookup);
+   if (cc->lookup_bh) {
+      platform_buffer_destroy(cc->lookup_bh);
+   }
    if (cc->bh) {
       platform_buffer_destroy(cc->bh);
    }
@@ -1902,6 +1940,7 @@ clockcache_deinit(clockcache *cc) // IN/OUT
    if (cc->pincount) {
       platform_free_volatile(cc->heap_id, cc->pincount);
    }
+   thread_state_table_deinit(&cc->per_thread);
 }
 
 /*
@@ -1923,7 +1962,7 @@ clockcache_alloc(clockcache *cc, uint64 addr, page_type type)
    entry->page.disk_addr      = addr;
    entry->type                = type;
    uint64 lookup_no = clockcache_divide_by_page_size(cc, entry->page.disk_addr);
-   cc->lookup[lookup_no] = entry_no;
+   cc->lookup[lookup_no] = CC_LOOKUP_CODE(entry_no);
 
    clockcache_log(entry->page.disk_addr,
                   entry_no,
@@ -2007,7 +2046,7 @@ clockcache_try_page_discard(clockcache *cc, uint64 addr)
 
       /* 5. clear lookup and disk addr; set status to CC_FREE_STATUS */
       uint64 lookup_no      = clockcache_divide_by_page_size(cc, addr);
-      cc->lookup[lookup_no] = CC_UNMAPPED_ENTRY;
+      cc->lookup[lookup_no] = CC_LOOKUP_CODE(CC_UNMAPPED_ENTRY);
       debug_assert(entry->page.disk_addr == addr);
       entry->page.disk_addr = CC_UNMAPPED_ADDR;
 
@@ -2154,7 +2193,7 @@ clockcache_get_internal(clockcache   *cc,       // IN
       entry = clockcache_get_entry(cc, entry_number);
 
       if (cc->cfg->use_stats) {
-         cc->stats[tid].cache_hits[type]++;
+         clockcache_get_stats(cc, tid)->cache_hits[type]++;
       }
       clockcache_log(addr,
                      entry_number,
@@ -2179,7 +2218,9 @@ clockcache_get_internal(clockcache   *cc,       // IN
     * do it.
     */
    if (!__sync_bool_compare_and_swap(
-          &cc->lookup[lookup_no], CC_UNMAPPED_ENTRY, entry_number))
+          &cc->lookup[lookup_no],
+          CC_LOOKUP_CODE(CC_UNMAPPED_ENTRY),
+          CC_LOOKUP_CODE(entry_number)))
    {
       clockcache_dec_ref(cc, entry_number, tid);
       entry->status = CC_FREE_STATUS;
@@ -2202,9 +2243,10 @@ clockcache_get_internal(clockcache   *cc,       // IN
 
    if (cc->cfg->use_stats) {
       elapsed = platform_timestamp_elapsed(start);
-      cc->stats[tid].cache_misses[type]++;
-      cc->stats[tid].page_reads[type]++;
-      cc->stats[tid].cache_miss_time_ns[type] += elapsed;
+      cache_stats *stats = clockcache_get_stats(cc, tid);
+      stats->cache_misses[type]++;
+      stats->page_reads[type]++;
+      stats->cache_miss_time_ns[type] += elapsed;
    }
 
    clockcache_log(addr,
@@ -2238,7 +2280,7 @@ clockcache_get(clockcache *cc, uint64 addr, bool blocking, page_type type)
    bool         retry;
    page_handle *handle;
 
-   debug_assert(cc->per_thread[platform_get_tid()].enable_sync_get
+   debug_assert(clockcache_get_thread(cc, platform_get_tid())->enable_sync_get
                 || type == PAGE_TYPE_MEMTABLE
                 || type == PAGE_TYPE_LOCK_NO_DATA);
    while (1) {
@@ -2276,7 +2318,7 @@ clockcache_read_async_callback(void           *metadata,
 
    if (cc->cfg->use_stats) {
       threadid tid = platform_get_tid();
-      cc->stats[tid].page_reads[entry->type]++;
+      clockcache_get_stats(cc, tid)->page_reads[entry->type]++;
       ctxt->stats.compl_ts = platform_get_timestamp();
    }
 
@@ -2374,7 +2416,7 @@ clockcache_get_async(clockcache       *cc,   // IN
       entry = clockcache_get_entry(cc, entry_number);
 
       if (cc->cfg->use_stats) {
-         cc->stats[tid].cache_hits[type]++;
+         clockcache_get_stats(cc, tid)->cache_hits[type]++;
       }
       clockcache_log(addr,
                      entry_number,
@@ -2403,7 +2445,9 @@ clockcache_get_async(clockcache       *cc,   // IN
     * do it.
     */
    if (!__sync_bool_compare_and_swap(
-          &cc->lookup[lookup_no], CC_UNMAPPED_ENTRY, entry_number))
+          &cc->lookup[lookup_no],
+          CC_LOOKUP_CODE(CC_UNMAPPED_ENTRY),
+          CC_LOOKUP_CODE(entry_number)))
    {
       /*
        * This is rare but when it happens, we could burn CPU retrying
@@ -2428,7 +2472,7 @@ clockcache_get_async(clockcache       *cc,   // IN
 
    io_async_req *req = io_get_async_req(cc->io, FALSE);
    if (req == NULL) {
-      cc->lookup[lookup_no] = CC_UNMAPPED_ENTRY;
+      cc->lookup[lookup_no] = CC_LOOKUP_CODE(CC_UNMAPPED_ENTRY);
       entry->page.disk_addr = CC_UNMAPPED_ADDR;
       entry->status         = CC_FREE_STATUS;
       clockcache_dec_ref(cc, entry_number, tid);
@@ -2448,7 +2492,7 @@ clockcache_get_async(clockcache       *cc,   // IN
    platform_assert_status_ok(status);
 
    if (cc->cfg->use_stats) {
-      cc->stats[tid].cache_misses[type]++;
+      clockcache_get_stats(cc, tid)->cache_misses[type]++;
    }
 
    return async_io_started;
@@ -2469,7 +2513,7 @@ clockcache_async_done(clockcache *cc, page_type type, cache_async_ctxt *ctxt)
    if (cc->cfg->use_stats) {
       threadid tid = platform_get_tid();
 
-      cc->stats[tid].cache_miss_time_ns[type] +=
+      clockcache_get_stats(cc, tid)->cache_miss_time_ns[type] +=
          platform_timestamp_diff(ctxt->stats.issue_ts, ctxt->stats.compl_ts);
    }
 }
@@ -2672,8 +2716,9 @@ clockcache_page_sync(clockcache  *cc,
    }
 
    if (cc->cfg->use_stats) {
-      cc->stats[tid].page_writes[type]++;
-      cc->stats[tid].syncs_issued++;
+      cache_stats *stats = clockcache_get_stats(cc, tid);
+      stats->page_writes[type]++;
+      stats->syncs_issued++;
    }
 
    if (!is_blocking) {
@@ -2847,8 +2892,9 @@ clockcache_prefetch_callback(void           *metadata,
 
    if (cc->cfg->use_stats) {
       threadid tid = platform_get_tid();
-      cc->stats[tid].page_reads[type] += count;
-      cc->stats[tid].prefetches_issued[type]++;
+      cache_stats *stats = clockcache_get_stats(cc, tid);
+      stats->page_reads[type] += count;
+      stats->prefetches_issued[type]++;
    }
 }
 
@@ -2915,7 +2961,9 @@ clockcache_prefetch(clockcache *cc, uint64 base_addr, page_type type)
             entry->type             = type;
             uint64 lookup_no        = clockcache_divide_by_page_size(cc, addr);
             if (__sync_bool_compare_and_swap(
-                   &cc->lookup[lookup_no], CC_UNMAPPED_ENTRY, free_entry_no))
+                   &cc->lookup[lookup_no],
+                   CC_LOOKUP_CODE(CC_UNMAPPED_ENTRY),
+                   CC_LOOKUP_CODE(free_entry_no)))
             {
                if (pages_in_req == 0) {
                   debug_assert(req_start_addr == CC_UNMAPPED_ADDR);
@@ -3036,9 +3084,13 @@ clockcache_io_stats(clockcache *cc, uint64 *read_bytes, uint64 *write_bytes)
    uint64 read_pages  = 0;
    uint64 write_pages = 0;
    for (uint64 i = 0; i < MAX_THREADS; i++) {
+      clockcache_thread *thread = thread_state_peek(&cc->per_thread, i);
+      if (thread == NULL) {
+         continue;
+      }
       for (page_type type = 0; type < NUM_PAGE_TYPES; type++) {
-         write_pages += cc->stats[i].page_writes[type];
-         read_pages += cc->stats[i].page_reads[type];
+         write_pages += thread->stats.page_writes[type];
+         read_pages += thread->stats.page_reads[type];
       }
    }
 
@@ -3060,19 +3112,23 @@ clockcache_print_stats(platform_log_handle *log_handle, clockcache *cc)
    uint64 page_writes = 0;
    ZERO_CONTENTS(&global_stats);
    for (i = 0; i < MAX_THREADS; i++) {
+      clockcache_thread *thread = thread_state_peek(&cc->per_thread, i);
+      if (thread == NULL) {
+         continue;
+      }
+      cache_stats *stats = &thread->stats;
       for (type = 0; type < NUM_PAGE_TYPES; type++) {
-         global_stats.cache_hits[type] += cc->stats[i].cache_hits[type];
-         global_stats.cache_misses[type] += cc->stats[i].cache_misses[type];
+         global_stats.cache_hits[type] += stats->cache_hits[type];
+         global_stats.cache_misses[type] += stats->cache_misses[type];
          global_stats.cache_miss_time_ns[type] +=
-            cc->stats[i].cache_miss_time_ns[type];
-         global_stats.page_writes[type] += cc->stats[i].page_writes[type];
-         page_writes += cc->stats[i].page_writes[type];
-         global_stats.page_reads[type] += cc->stats[i].page_reads[type];
-         global_stats.prefetches_issued[type] +=
-            cc->stats[i].prefetches_issued[type];
+            stats->cache_miss_time_ns[type];
+         global_stats.page_writes[type] += stats->page_writes[type];
+         page_writes += stats->page_writes[type];
+         global_stats.page_reads[type] += stats->page_reads[type];
+         global_stats.prefetches_issued[type] += stats->prefetches_issued[type];
       }
-      global_stats.writes_issued += cc->stats[i].writes_issued;
-      global_stats.syncs_issued += cc->stats[i].syncs_issued;
+      global_stats.writes_issued += stats->writes_issued;
+      global_stats.syncs_issued += stats->syncs_issued;
    }
 
    fraction miss_time[NUM_PAGE_TYPES];
@@ -3156,7 +3212,11 @@ clockcache_reset_stats(clockcache *cc)
    uint64 i;
 
    for (i = 0; i < MAX_THREADS; i++) {
-      cache_stats *stats = &cc->stats[i];
+      clockcache_thread *thread = thread_state_peek(&cc->per_thread, i);
+      if (thread == NULL) {
+         continue;
+      }
+      cache_stats *stats = &thread->stats;
 
       memset(stats->cache_hits, 0, sizeof(stats->cache_hits));
       memset(stats->cache_misses, 0, sizeof(stats->cache_misses));
@@ -3209,7 +3269,7 @@ clockcache_present(clockcache *cc, page_handle *page)
 static void
 clockcache_enable_sync_get(clockcache *cc, bool enabled)
 {
-   cc->per_thread[platform_get_tid()].enable_sync_get = enabled;
+   clockcache_get_thread(cc, platform_get_tid())->enable_sync_get = enabled;
 }
 
 static allocator *
@@ -12,6 +12,7 @@
 #include "allocator.h"
 #include "cache.h"
 #include "io.h"
+#include "util.h"
 
 //#define ADDR_TRACING
 #define TRACE_ADDR  (UINT64_MAX - 1)
@@ -22,6 +23,16 @@
 /* how distributed the rw locks are */
 #define CC_RC_WIDTH 4
 
+/*
+ * State of the cache that is private to each thread, see
+ * clockcache_get_thread().
+ */
+typedef struct clockcache_thread {
+   volatile uint32 free_hand;
+   bool            enable_sync_get;
+   cache_stats     stats;
+} clockcache_thread;
+
 /*
  * Configuration struct to setup the clock cache sub-system.
  */
@@ -114,7 +125,8 @@ struct clockcache {
    allocator         *al;
    io_handle         *io;
 
-   uint32              *lookup;
+   uint32              *lookup; // see CC_LOOKUP_CODE
+   buffer_handle       *lookup_bh;
    clockcache_entry    *entry;
    buffer_handle       *bh;   // actual memory for pages
    char                *data; // convenience pointer for bh
@@ -133,13 +145,8 @@ struct clockcache {
    volatile bool  *batch_busy;
    uint64          cleaner_gap;
 
-   volatile struct {
-      volatile uint32 free_hand;
-      bool            enable_sync_get;
-   } PLATFORM_CACHELINE_ALIGNED per_thread[MAX_THREADS];
-
-   // Stats
-   cache_stats stats[MAX_THREADS];
+   // Per thread hands and stats (clockcache_thread)
+   thread_state_table per_thread;
 };
 
 
@@ -12,9 +12,7 @@ interval_tree_key_compare(interval_tree_key key1, interval_tree_key key2)
 {
    platform_assert(key1.app_data_cfg == key2.app_data_cfg);
 
-   return data_key_compare(key1.app_data_cfg,
-                           key_create_from_slice(key1.data),
-                           key_create_from_slice(key2.data));
+   return data_key_compare(key1.app_data_cfg, key1.data, key2.data);
 }
 
 INTERVAL_TREE_DEFINE(tictoc_rw_entry,
@@ -27,27 +25,48 @@ INTERVAL_TREE_DEFINE(tictoc_rw_entry,
                      interval_tree,
                      interval_tree_key_compare);
 
-// To make a compiler quiet
-#define SUPPRESS_UNUSED_WARN(var)                                              \
-   void _dummy_tmp_##var(void)                                                 \
-   {                                                                           \
-      (void)(var);                                                             \
-   }
+/*
+ * Point locks are partitioned by the hash of their key, so that txns locking
+ * different keys rarely contend. Ranges can't be hashed, so they go in a tree
+ * of their own, which point locks only look at while it is not empty.
+ */
+#define LOCK_TABLE_NUM_SHARDS 256
+
+// How many times a busy lock is retried before waiting for it to be released
+#define LOCK_TABLE_SPIN_LIMIT 64
 
-SUPPRESS_UNUSED_WARN(interval_tree_iter_next);
+typedef struct lock_table_shard {
+   platform_spinlock lock;
+   struct rb_root    root;
+   // Txns waiting for a lock of the shard (or a range over one of its keys) to
+   // be released. release_gen is bumped by every release, so that a waiter can
+   // tell if it missed one.
+   platform_condvar wait_cv;
+   volatile uint64  release_gen;
+   volatile uint64  num_waiters;
+} PLATFORM_CACHELINE_ALIGNED lock_table_shard;
 
 typedef struct lock_table {
-   struct rb_root root;
-   platform_mutex lock;
+   lock_table_shard shards[LOCK_TABLE_NUM_SHARDS];
+   platform_mutex   range_lock;
+   struct rb_root   range_root;
+   // The number of ranges that are locked, or being locked
+   volatile uint64 num_ranges;
 } lock_table;
 
 lock_table *
 lock_table_create()
 {
    lock_table *lt;
-   lt       = TYPED_ZALLOC(0, lt);
-   lt->root = RB_ROOT;
-   platform_mutex_init(&lt->lock, 0, 0);
+   lt = TYPED_ZALLOC(0, lt);
+   for (uint64 i = 0; i < LOCK_TABLE_NUM_SHARDS; i++) {
+      platform_spinlock_init(&lt->shards[i].lock, 0, 0);
+      lt->shards[i].root = RB_ROOT;
+      platform_status rc = platform_condvar_init(&lt->shards[i].wait_cv, 0);
+      platform_assert(SUCCESS(rc));
+   }
+   platform_mutex_init(&lt->range_lock, 0, 0);
+   lt->range_root = RB_ROOT;
    return lt;
 }
 
@@ -55,42 +74,234 @@ void
 lock_table_destroy(lock_table *lock_tbl)
 {
    // TODO: destroy all elements
-   platform_mutex_destroy(&lock_tbl->lock);
+   for (uint64 i = 0; i < LOCK_TABLE_NUM_SHARDS; i++) {
+      platform_spinlock_destroy(&lock_tbl->shards[i].lock);
+      platform_condvar_destroy(&lock_tbl->shards[i].wait_cv);
+   }
+   platform_mutex_destroy(&lock_tbl->range_lock);
    platform_free(0, lock_tbl);
 }
 
-lock_table_rc
-lock_table_try_acquire_entry_lock(lock_table *lock_tbl, tictoc_rw_entry *entry)
+static lock_table_shard *
+lock_table_get_shard(lock_table *lock_tbl, const tictoc_rw_entry *entry)
 {
-   platform_mutex_lock(&lock_tbl->lock);
-   tictoc_rw_entry *node = interval_tree_iter_first(
-      &lock_tbl->root, GET_ITSTART(entry), GET_ITLAST(entry));
-   if (node) {
-      if (node->owner != entry->owner) {
-         platform_mutex_unlock(&lock_tbl->lock);
+   platform_assert(!entry->is_range);
+   key    user_key = entry->start.data;
+   uint32 hash     = entry->start.app_data_cfg->key_hash(
+      key_data(user_key), key_length(user_key), 0);
+   return &lock_tbl->shards[hash % LOCK_TABLE_NUM_SHARDS];
+}
+
+/*
+ * Entries of different txns conflict, unless both are reads and one of them is
+ * a range: a range is only locked to keep writers out of it while it is
+ * validated.
+ */
+static bool
+lock_table_entries_conflict(const tictoc_rw_entry *held,
+                            const tictoc_rw_entry *entry)
+{
+   bool is_write =
+      held->op != MESSAGE_TYPE_INVALID || entry->op != MESSAGE_TYPE_INVALID;
+   return is_write || (!held->is_range && !entry->is_range);
+}
+
+/*
+ * Checks the entry against the locks in a tree that overlap it: returns
+ * LOCK_TABLE_RC_BUSY if one of another txn conflicts with it, and
+ * LOCK_TABLE_RC_DEADLK if one is the txn's own.
+ */
+static lock_table_rc
+lock_table_check_tree(struct rb_root *root, const tictoc_rw_entry *entry)
+{
+   lock_table_rc rc = LOCK_TABLE_RC_OK;
+   for (tictoc_rw_entry *node = interval_tree_iter_first(
+           root, GET_ITSTART(entry), GET_ITLAST(entry));
+        node != NULL;
+        node = interval_tree_iter_next(
+           node, GET_ITSTART(entry), GET_ITLAST(entry)))
+   {
+      if (node->owner == entry->owner) {
+         rc = LOCK_TABLE_RC_DEADLK;
+      } else if (lock_table_entries_conflict(node, entry)) {
          return LOCK_TABLE_RC_BUSY;
       }
+   }
+   return rc;
+}
+
+static void
+lock_table_remove(struct rb_root *root, tictoc_rw_entry *entry)
+{
+   if (!RB_EMPTY_NODE(&entry->rb)) {
+      interval_tree_remove(entry, root);
+      RB_CLEAR_NODE(&entry->rb);
+   }
+}
+
+/*
+ * A point is locked in its shard, and then checked against the locked ranges,
+ * while a range is added to the ranges and then checked against every shard.
+ * Both are full barriers in between, so of a point and a range that are being
+ * locked at the same time, at least one sees the other.
+ */
+static lock_table_rc
+lock_table_try_acquire_point_lock(lock_table *lock_tbl, tictoc_rw_entry *entry)
+{
+   lock_table_shard *shard = lock_table_get_shard(lock_tbl, entry);
+
+   platform_spin_lock(&shard->lock);
+   lock_table_rc rc = lock_table_check_tree(&shard->root, entry);
+   if (rc != LOCK_TABLE_RC_BUSY) {
+      interval_tree_insert(entry, &shard->root);
+   }
+   platform_spin_unlock(&shard->lock);
+
+   // Reads don't conflict with ranges, and without any ranges there is nothing
+   // else to check
+   if (rc == LOCK_TABLE_RC_BUSY || entry->op == MESSAGE_TYPE_INVALID
+       || __sync_add_and_fetch(&lock_tbl->num_ranges, 0) == 0)
+   {
+      return rc;
+   }
+
+   platform_mutex_lock(&lock_tbl->range_lock);
+   lock_table_rc range_rc = lock_table_check_tree(&lock_tbl->range_root, entry);
+   platform_mutex_unlock(&lock_tbl->range_lock);
+
+   if (range_rc == LOCK_TABLE_RC_BUSY) {
+      platform_spin_lock(&shard->lock);
+      lock_table_remove(&shard->root, entry);
+      platform_spin_unlock(&shard->lock);
+      return LOCK_TABLE_RC_BUSY;
+   }
+   return range_rc == LOCK_TABLE_RC_DEADLK ? range_rc : rc;
+}
+
+static lock_table_rc
+lock_table_try_acquire_range_lock(lock_table *lock_tbl, tictoc_rw_entry *entry)
+{
+   __sync_fetch_and_add(&lock_tbl->num_ranges, 1);
+
+   platform_mutex_lock(&lock_tbl->range_lock);
+   lock_table_rc rc = lock_table_check_tree(&lock_tbl->range_root, entry);
+   if (rc != LOCK_TABLE_RC_BUSY) {
+      interval_tree_insert(entry, &lock_tbl->range_root);
+   }
+   platform_mutex_unlock(&lock_tbl->range_lock);
+
+   if (rc == LOCK_TABLE_RC_BUSY) {
+      __sync_fetch_and_sub(&lock_tbl->num_ranges, 1);
+      return rc;
+   }
+
+   for (uint64 i = 0; i < LOCK_TABLE_NUM_SHARDS; i++) {
+      lock_table_shard *shard = &lock_tbl->shards[i];
+      platform_spin_lock(&shard->lock);
+      lock_table_rc shard_rc = lock_table_check_tree(&shard->root, entry);
+      platform_spin_unlock(&shard->lock);
+      if (shard_rc == LOCK_TABLE_RC_BUSY) {
+         lock_table_release_entry_lock(lock_tbl, entry);
+         return shard_rc;
+      }
+      if (shard_rc == LOCK_TABLE_RC_DEADLK) {
+         rc = shard_rc;
+      }
+   }
+   return rc;
+}
+
+/*
+ * Returns LOCK_TABLE_RC_DEADLK (with the entry locked as well) if the txn
+ * already holds a lock that overlaps it.
+ */
+lock_table_rc
+lock_table_try_acquire_entry_lock(lock_table *lock_tbl, tictoc_rw_entry *entry)
+{
+   if (entry->is_range) {
+      return lock_table_try_acquire_range_lock(lock_tbl, entry);
+   }
+   return lock_table_try_acquire_point_lock(lock_tbl, entry);
+}
 
-      platform_mutex_unlock(&lock_tbl->lock);
-      return LOCK_TABLE_RC_DEADLK;
+/*
+ * The waiter counts itself before it checks release_gen, and a release bumps
+ * release_gen before it checks for waiters, so a waiter can't miss a release.
+ */
+static void
+lock_table_wake_waiters(lock_table_shard *shard)
+{
+   __sync_fetch_and_add(&shard->release_gen, 1);
+   if (__sync_add_and_fetch(&shard->num_waiters, 0) > 0) {
+      platform_condvar_lock(&shard->wait_cv);
+      platform_condvar_broadcast(&shard->wait_cv);
+      platform_condvar_unlock(&shard->wait_cv);
    }
+}
 
-   interval_tree_insert(entry, &lock_tbl->root);
+static void
+lock_table_wait_for_release(lock_table_shard *shard, uint64 release_gen)
+{
+   platform_condvar_lock(&shard->wait_cv);
+   __sync_fetch_and_add(&shard->num_waiters, 1);
+   while (__sync_add_and_fetch(&shard->release_gen, 0) == release_gen) {
+      platform_status rc = platform_condvar_wait(&shard->wait_cv);
+      platform_assert(SUCCESS(rc));
+   }
+   __sync_fetch_and_sub(&shard->num_waiters, 1);
+   platform_condvar_unlock(&shard->wait_cv);
+}
 
-   platform_mutex_unlock(&lock_tbl->lock);
-   return LOCK_TABLE_RC_OK;
+/*
+ * Like lock_table_try_acquire_entry_lock, but if the lock is busy, it is
+ * retried a few times and then waited for, instead of failing. Txns that wait
+ * for locks while holding others must acquire them in key order, so that
+ * they can't wait for each other.
+ */
+lock_table_rc
+lock_table_acquire_entry_lock(lock_table *lock_tbl, tictoc_rw_entry *entry)
+{
+   platform_assert(!entry->is_range);
+   lock_table_shard *shard = lock_table_get_shard(lock_tbl, entry);
+
+   for (uint64 attempts = 0;; attempts++) {
+      uint64        release_gen = shard->release_gen;
+      lock_table_rc rc = lock_table_try_acquire_point_lock(lock_tbl, entry);
+      if (rc != LOCK_TABLE_RC_BUSY) {
+         return rc;
+      }
+      if (attempts < LOCK_TABLE_SPIN_LIMIT) {
+         platform_pause();
+      } else {
+         lock_table_wait_for_release(shard, release_gen);
+      }
+   }
 }
 
 void
 lock_table_release_entry_lock(lock_table *lock_tbl, tictoc_rw_entry *entry)
 {
-   platform_mutex_lock(&lock_tbl->lock);
-   tictoc_rw_entry *node = interval_tree_iter_first(
-      &lock_tbl->root, GET_ITSTART(entry), GET_ITLAST(entry));
-   if (node) {
-      if (node->owner == entry->owner) {
-         interval_tree_remove(node, &lock_tbl->root);
+   if (entry->is_range) {
+      platform_mutex_lock(&lock_tbl->range_lock);
+      bool was_locked = !RB_EMPTY_NODE(&entry->rb);
+      lock_table_remove(&lock_tbl->range_root, entry);
+      platform_mutex_unlock(&lock_tbl->range_lock);
+      if (was_locked) {
+         __sync_fetch_and_sub(&lock_tbl->num_ranges, 1);
+         // Writers that the range kept out wait on the shards of their keys
+         for (uint64 i = 0; i < LOCK_TABLE_NUM_SHARDS; i++) {
+            lock_table_wake_waiters(&lock_tbl->shards[i]);
+         }
       }
+      return;
+   }
+
+   lock_table_shard *shard = lock_table_get_shard(lock_tbl, entry);
+   platform_spin_lock(&shard->lock);
+   bool was_locked = !RB_EMPTY_NODE(&entry->rb);
+   lock_table_remove(&shard->root, entry);
+   platform_spin_unlock(&shard->lock);
+   if (was_locked) {
+      lock_table_wake_waiters(shard);
    }
-   platform_mutex_unlock(&lock_tbl->lock);
 }
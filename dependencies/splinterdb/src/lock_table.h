@@ -6,19 +6,21 @@
 
 #include "splinterdb/data.h"
 #include "interval_tree/interval_tree_generic.h"
+#include "data_internal.h"
 #include "util.h"
 
 /*
  * Lock Table Entry call tictoc_rw_entry
  */
 
+// The bounds of a range can be infinite
 typedef struct interval_tree_key {
-   slice              data;
+   key                data;
    const data_config *app_data_cfg;
 } interval_tree_key;
 
 static inline interval_tree_key
-interval_tree_key_create(slice data, const data_config *app_data_cfg)
+interval_tree_key_create(key data, const data_config *app_data_cfg)
 {
    return (interval_tree_key){.data = data, .app_data_cfg = app_data_cfg};
 }
@@ -29,6 +31,7 @@ typedef struct tictoc_rw_entry {
    writable_buffer key;
    writable_buffer key_last; // The upper bound of a range, which can be empty
                              // in the case of a point key
+   bool            is_range;
    writable_buffer tuple;
 
    uint64 owner;
@@ -60,6 +63,8 @@ lock_table_destroy(lock_table *lock_tbl);
 
 lock_table_rc
 lock_table_try_acquire_entry_lock(lock_table *lock_tbl, tictoc_rw_entry *entry);
+lock_table_rc
+lock_table_acquire_entry_lock(lock_table *lock_tbl, tictoc_rw_entry *entry);
 void
 lock_table_release_entry_lock(lock_table *lock_tbl, tictoc_rw_entry *entry);
 
@@ -71,3 +71,6 @@ log_magic(log_handle *log)
 
 log_handle *
 log_create(cache *cc, log_config *cfg, platform_heap_id hid);
+
+void
+log_destroy(log_handle *log, platform_heap_id hid);
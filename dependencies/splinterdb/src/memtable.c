@@ -126,7 +126,7 @@ memtable_insert(memtable_context *ctxt,
    platform_status rc = btree_insert(ctxt->cc,
                                      ctxt->cfg.btree_cfg,
                                      heap_id,
-                                     &ctxt->scratch[tid],
+                                     thread_state_get(&ctxt->scratch, tid),
                                      mt->root_addr,
                                      &mt->mini,
                                      tuple_key,
@@ -292,6 +292,8 @@ memtable_context_create(platform_heap_id hid,
    platform_spinlock_init(
       &ctxt->incorporation_lock, platform_get_module_id(), hid);
 
+   thread_state_table_init(&ctxt->scratch, hid, sizeof(btree_scratch), NULL);
+
    for (uint64 mt_no = 0; mt_no < cfg->max_memtables; mt_no++) {
       uint64 generation = mt_no;
       memtable_init(&ctxt->mt[mt_no], cc, cfg, generation);
@@ -319,6 +321,8 @@ memtable_context_destroy(platform_heap_id hid, memtable_context *ctxt)
 
    platform_spinlock_destroy(&ctxt->incorporation_lock);
 
+   thread_state_table_deinit(&ctxt->scratch);
+
    /*
     * lookup lock and insert lock share extents but not pages.
     * this deallocs both.
@@ -131,8 +131,8 @@ typedef struct memtable_context {
 
    bool is_empty;
 
-   // Effectively thread local, no locking at all:
-   btree_scratch scratch[MAX_THREADS];
+   // Effectively thread local, no locking at all (btree_scratch):
+   thread_state_table scratch;
 
    memtable mt[];
 } memtable_context;
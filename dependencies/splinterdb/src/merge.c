@@ -39,14 +39,26 @@ static iterator_ops merge_ops = {
  * first attempt comparison matched
  **/
 
+/*
+ * Key order of the merge iterator: ascending, or descending for a reverse
+ * merge iterator (so the array is a max-heap instead of a min-heap).
+ */
+static inline int
+merge_key_compare(const merge_iterator *merge_itor, key key_one, key key_two)
+{
+   int cmp = data_key_compare(merge_itor->cfg, key_one, key_two);
+   return merge_itor->reverse ? -cmp : cmp;
+}
+
 /* Comparison function for bsearch of the min ritor array */
 static inline int
 bsearch_comp(const ordered_iterator *itor_one,
              const ordered_iterator *itor_two,
-             const data_config      *cfg,
+             const merge_iterator   *merge_itor,
              bool                   *keys_equal)
 {
-   int cmp     = data_key_compare(cfg, itor_one->curr_key, itor_two->curr_key);
+   int cmp =
+      merge_key_compare(merge_itor, itor_one->curr_key, itor_two->curr_key);
    *keys_equal = (cmp == 0);
    if (cmp == 0) {
       cmp = itor_two->seq - itor_one->seq;
@@ -61,11 +73,11 @@ bsearch_comp(const ordered_iterator *itor_one,
 static int
 merge_comp(const void *one, const void *two, void *ctxt)
 {
-   const ordered_iterator *itor_one = *(ordered_iterator **)one;
-   const ordered_iterator *itor_two = *(ordered_iterator **)two;
-   data_config            *cfg      = (data_config *)ctxt;
+   const ordered_iterator *itor_one   = *(ordered_iterator **)one;
+   const ordered_iterator *itor_two   = *(ordered_iterator **)two;
+   merge_iterator         *merge_itor = (merge_iterator *)ctxt;
    bool                    ignore_keys_equal;
-   return bsearch_comp(itor_one, itor_two, cfg, &ignore_keys_equal);
+   return bsearch_comp(itor_one, itor_two, merge_itor, &ignore_keys_equal);
 }
 
 // Returns index (from base0) where key belongs
@@ -73,7 +85,7 @@ static inline int
 bsearch_insert(register const ordered_iterator *key,
                ordered_iterator               **base0,
                const size_t                     nmemb,
-               const data_config               *cfg,
+               const merge_iterator            *merge_itor,
                bool                            *prev_equal_out,
                bool                            *next_equal_out)
 {
@@ -87,7 +99,7 @@ bsearch_insert(register const ordered_iterator *key,
    for (lim = nmemb; lim != 0; lim >>= 1) {
       p = base + (lim >> 1);
       bool keys_equal;
-      cmp = bsearch_comp(key, *p, cfg, &keys_equal);
+      cmp = bsearch_comp(key, *p, merge_itor, &keys_equal);
       debug_assert(cmp != 0);
 
       if (cmp > 0) { /* key > p: move right */
@@ -132,9 +144,9 @@ debug_verify_sorted(debug_only merge_iterator *merge_itor,
       return;
    }
    const int cmp =
-      data_key_compare(merge_itor->cfg,
-                       merge_itor->ordered_iterators[index]->curr_key,
-                       merge_itor->ordered_iterators[index + 1]->curr_key);
+      merge_key_compare(merge_itor,
+                        merge_itor->ordered_iterators[index]->curr_key,
+                        merge_itor->ordered_iterators[index + 1]->curr_key);
    if (merge_itor->ordered_iterators[index]->next_key_equal) {
       debug_assert(cmp == 0);
    } else {
@@ -191,7 +203,7 @@ advance_and_resort_min_ritor(merge_iterator *merge_itor)
                + bsearch_insert(*merge_itor->ordered_iterators,
                                 merge_itor->ordered_iterators + 1,
                                 merge_itor->num_remaining - 1,
-                                merge_itor->cfg,
+                                merge_itor,
                                 &prev_equal,
                                 &next_equal);
    debug_assert(index >= 0);
@@ -379,6 +391,15 @@ advance_one_loop(merge_iterator *merge_itor, bool *retry)
    return STATUS_OK;
 }
 
+static platform_status
+merge_iterator_create_internal(platform_heap_id hid,
+                               data_config     *cfg,
+                               int              num_trees,
+                               iterator       **itor_arr,
+                               merge_behavior   merge_mode,
+                               bool             reverse,
+                               merge_iterator **out_itor);
+
 /*
  *-----------------------------------------------------------------------------
  * merge_iterator_create --
@@ -400,45 +421,53 @@ merge_iterator_create(platform_heap_id hid,
                       merge_behavior   merge_mode,
                       merge_iterator **out_itor)
 {
-   int               i;
-   platform_status   rc = STATUS_OK, merge_iterator_rc;
-   merge_iterator   *merge_itor;
-   ordered_iterator *temp;
-
-   if (!out_itor || !itor_arr || !cfg || num_trees < 0
-       || num_trees >= ARRAY_SIZE(merge_itor->ordered_iterator_stored))
-   {
-      platform_error_log("merge_iterator_create: bad parameter merge_itor %p"
-                         " num_trees %d itor_arr %p cfg %p\n",
-                         out_itor,
-                         num_trees,
-                         itor_arr,
-                         cfg);
-      return STATUS_BAD_PARAM;
-   }
+   return merge_iterator_create_internal(
+      hid, cfg, num_trees, itor_arr, merge_mode, FALSE, out_itor);
+}
 
-   _Static_assert(ARRAY_SIZE(merge_itor->ordered_iterator_stored)
-                     == ARRAY_SIZE(merge_itor->ordered_iterators),
-                  "size mismatch");
+/*
+ *-----------------------------------------------------------------------------
+ * merge_iterator_create_reverse --
+ *
+ *      Initialize a merge iterator that emits keys in descending order.
+ *
+ *      Prerequisite:
+ *         All input iterators must be homogeneous for data_type, and
+ *         must themselves iterate in descending key order.
+ *
+ * Results:
+ *      0 if successful, error otherwise
+ *-----------------------------------------------------------------------------
+ */
+platform_status
+merge_iterator_create_reverse(platform_heap_id hid,
+                              data_config     *cfg,
+                              int              num_trees,
+                              iterator       **itor_arr,
+                              merge_behavior   merge_mode,
+                              merge_iterator **out_itor)
+{
+   return merge_iterator_create_internal(
+      hid, cfg, num_trees, itor_arr, merge_mode, TRUE, out_itor);
+}
 
-   merge_itor = TYPED_ZALLOC(hid, merge_itor);
-   if (merge_itor == NULL) {
-      return STATUS_NO_MEMORY;
-   }
-   merge_accumulator_init(&merge_itor->merge_buffer, hid);
+/*
+ * Sets up the ordered iterators over itor_arr and positions the merge
+ * iterator on the first key.
+ */
+static platform_status
+merge_iterator_start(merge_iterator *merge_itor,
+                     int             num_trees,
+                     iterator      **itor_arr)
+{
+   int               i;
+   platform_status   rc;
+   ordered_iterator *temp;
 
-   merge_itor->super.ops = &merge_ops;
    merge_itor->num_trees = num_trees;
-
-   debug_assert(merge_mode == MERGE_RAW || merge_mode == MERGE_INTERMEDIATE
-                || merge_mode == MERGE_FULL);
-   merge_itor->merge_messages   = merge_mode != MERGE_RAW;
-   merge_itor->finalize_updates = merge_mode == MERGE_FULL;
-   merge_itor->emit_deletes     = merge_mode != MERGE_FULL;
-
-   merge_itor->at_end   = FALSE;
-   merge_itor->cfg      = cfg;
-   merge_itor->curr_key = NULL_KEY;
+   merge_itor->at_end    = FALSE;
+   merge_itor->curr_key  = NULL_KEY;
+   merge_itor->curr_data = NULL_MESSAGE;
 
    // index -1 initializes the pad variable
    for (i = -1; i < num_trees; i++) {
@@ -460,7 +489,7 @@ merge_iterator_create(platform_heap_id hid,
       bool at_end;
       rc = iterator_at_end(merge_itor->ordered_iterators[i]->itor, &at_end);
       if (!SUCCESS(rc)) {
-         goto destroy;
+         return rc;
       }
       if (at_end) {
          ordered_iterator *tmp =
@@ -470,7 +499,8 @@ merge_iterator_create(platform_heap_id hid,
          merge_itor->ordered_iterators[i] = tmp;
          merge_itor->num_remaining--;
       } else {
-         set_curr_ordered_iterator(cfg, merge_itor->ordered_iterators[i]);
+         set_curr_ordered_iterator(merge_itor->cfg,
+                                   merge_itor->ordered_iterators[i]);
          i++;
       }
    }
@@ -478,14 +508,14 @@ merge_iterator_create(platform_heap_id hid,
                       merge_itor->num_remaining,
                       sizeof(*merge_itor->ordered_iterators),
                       merge_comp,
-                      merge_itor->cfg,
+                      merge_itor,
                       &temp);
    // Generate initial value for next_key_equal bits
    for (i = 0; i + 1 < merge_itor->num_remaining; ++i) {
       int cmp =
-         data_key_compare(merge_itor->cfg,
-                          merge_itor->ordered_iterators[i]->curr_key,
-                          merge_itor->ordered_iterators[i + 1]->curr_key);
+         merge_key_compare(merge_itor,
+                           merge_itor->ordered_iterators[i]->curr_key,
+                           merge_itor->ordered_iterators[i + 1]->curr_key);
       debug_assert(cmp <= 0);
       merge_itor->ordered_iterators[i]->next_key_equal = (cmp == 0);
    }
@@ -493,38 +523,108 @@ merge_iterator_create(platform_heap_id hid,
    bool retry;
    rc = advance_one_loop(merge_itor, &retry);
    if (!SUCCESS(rc)) {
-      goto out;
+      return rc;
    }
 
    if (retry) {
       rc = merge_advance((iterator *)merge_itor);
    }
+   if (SUCCESS(rc) && !merge_itor->at_end) {
+      debug_assert_message_type_valid(merge_itor);
+   }
+   return rc;
+}
 
-   goto out;
+static platform_status
+merge_iterator_create_internal(platform_heap_id hid,
+                               data_config     *cfg,
+                               int              num_trees,
+                               iterator       **itor_arr,
+                               merge_behavior   merge_mode,
+                               bool             reverse,
+                               merge_iterator **out_itor)
+{
+   platform_status rc = STATUS_OK, merge_iterator_rc;
+   merge_iterator *merge_itor;
 
-destroy:
-   merge_iterator_rc = merge_iterator_destroy(hid, &merge_itor);
-   if (!SUCCESS(merge_iterator_rc)) {
-      platform_error_log("merge_iterator_create: exception while releasing\n");
-      if (SUCCESS(rc)) {
-         platform_error_log("merge_iterator_create: clobbering rc\n");
-         rc = merge_iterator_rc;
-      }
+   if (!out_itor || !itor_arr || !cfg || num_trees < 0
+       || num_trees >= ARRAY_SIZE(merge_itor->ordered_iterator_stored))
+   {
+      platform_error_log("merge_iterator_create: bad parameter merge_itor %p"
+                         " num_trees %d itor_arr %p cfg %p\n",
+                         out_itor,
+                         num_trees,
+                         itor_arr,
+                         cfg);
+      return STATUS_BAD_PARAM;
    }
 
-out:
+   _Static_assert(ARRAY_SIZE(merge_itor->ordered_iterator_stored)
+                     == ARRAY_SIZE(merge_itor->ordered_iterators),
+                  "size mismatch");
+
+   merge_itor = TYPED_ZALLOC(hid, merge_itor);
+   if (merge_itor == NULL) {
+      return STATUS_NO_MEMORY;
+   }
+   merge_accumulator_init(&merge_itor->merge_buffer, hid);
+
+   merge_itor->super.ops = &merge_ops;
+
+   debug_assert(merge_mode == MERGE_RAW || merge_mode == MERGE_INTERMEDIATE
+                || merge_mode == MERGE_FULL);
+   merge_itor->merge_messages   = merge_mode != MERGE_RAW;
+   merge_itor->finalize_updates = merge_mode == MERGE_FULL;
+   merge_itor->emit_deletes     = merge_mode != MERGE_FULL;
+
+   merge_itor->reverse = reverse;
+   merge_itor->cfg     = cfg;
+
+   rc = merge_iterator_start(merge_itor, num_trees, itor_arr);
    if (!SUCCESS(rc)) {
       platform_error_log("merge_iterator_create: exception: %s\n",
                          platform_status_to_string(rc));
-   } else {
-      *out_itor = merge_itor;
-      if (!merge_itor->at_end) {
-         debug_assert_message_type_valid(merge_itor);
+      merge_iterator_rc = merge_iterator_destroy(hid, &merge_itor);
+      if (!SUCCESS(merge_iterator_rc)) {
+         platform_error_log(
+            "merge_iterator_create: exception while releasing\n");
       }
+      return rc;
    }
+
+   *out_itor = merge_itor;
    return rc;
 }
 
+/*
+ *-----------------------------------------------------------------------------
+ * merge_iterator_reset --
+ *
+ *      Restarts a merge iterator over a new set of input iterators, keeping
+ *      its mode and direction.  This avoids allocating (and zeroing) a new
+ *      merge iterator, which is large, each time a range is repositioned.
+ *
+ * Results:
+ *      0 if successful, error otherwise
+ *-----------------------------------------------------------------------------
+ */
+platform_status
+merge_iterator_reset(merge_iterator *merge_itor,
+                     int             num_trees,
+                     iterator      **itor_arr)
+{
+   if (!itor_arr || num_trees < 0
+       || num_trees >= ARRAY_SIZE(merge_itor->ordered_iterator_stored))
+   {
+      platform_error_log("merge_iterator_reset: bad parameter num_trees %d"
+                         " itor_arr %p\n",
+                         num_trees,
+                         itor_arr);
+      return STATUS_BAD_PARAM;
+   }
+   return merge_iterator_start(merge_itor, num_trees, itor_arr);
+}
+
 
 /*
  *-----------------------------------------------------------------------------
@@ -63,6 +63,7 @@ typedef struct merge_iterator {
    bool         finalize_updates;
    bool         emit_deletes;
    bool         at_end;
+   bool         reverse;       // keys are emitted in descending order
    int          num_remaining; // number of ritors not at end
    data_config *cfg;           // point message tree data config
    key          curr_key;      // current key
@@ -99,6 +100,19 @@ merge_iterator_create(platform_heap_id hid,
                       merge_behavior   merge_mode,
                       merge_iterator **out_itor);
 
+platform_status
+merge_iterator_create_reverse(platform_heap_id hid,
+                              data_config     *cfg,
+                              int              num_trees,
+                              iterator       **itor_arr,
+                              merge_behavior   merge_mode,
+                              merge_iterator **out_itor);
+
+platform_status
+merge_iterator_reset(merge_iterator *merge_itor,
+                     int             num_trees,
+                     iterator      **itor_arr);
+
 platform_status
 merge_iterator_destroy(platform_heap_id hid, merge_iterator **merge_itor);
 
@@ -62,13 +62,14 @@
 #define ARRAY_SIZE(x) ASSERT_EXPR(IS_ARRAY(x), (sizeof(x) / sizeof((x)[0])))
 
 /*
- * MAX_THREADS is used primarily for convenience, where allocations made on a
- * per-thread basis create an array with MAX_THREADS items, e.g. the
- * trunk_stats field in trunk_handle. The task subsystem also uses a 64-bit
- * bit-array to track thread IDs in use. This could be changed relatively
- * easily if needed.
+ * MAX_THREADS is the ceiling on thread IDs in use at the same time. The task
+ * subsystem tracks the IDs in use with a bit-array of MAX_THREADS bits, and
+ * per-thread state is kept in tables of MAX_THREADS pointers (see
+ * thread_state_table in util.h), allocated the first time a thread ID uses
+ * it, so memory scales with the threads actually registered rather than with
+ * this limit.
  */
-#define MAX_THREADS (64)
+#define MAX_THREADS (1024)
 #define INVALID_TID (MAX_THREADS)
 
 #define HASH_SEED (42)
@@ -222,6 +222,34 @@ rc_allocator_extent_number(rc_allocator *al, uint64 addr)
    return (addr / al->cfg->io_cfg->extent_size);
 }
 
+static checksum128
+rc_allocator_extents_checksum(rc_allocator_meta_page *meta_page)
+{
+   return platform_checksum128(&meta_page->capacity,
+                               sizeof(meta_page->capacity)
+                                  + sizeof(meta_page->active_extents),
+                               RC_ALLOCATOR_META_PAGE_CSUM_SEED);
+}
+
+/*
+ * Checksum and persist the meta page. Caller must hold al->lock (or be the
+ * only thread using the allocator, as in mount/unmount).
+ */
+static platform_status
+rc_allocator_write_meta_page(rc_allocator *al)
+{
+   al->meta_page->checksum =
+      platform_checksum128(al->meta_page,
+                           sizeof(al->meta_page->splinters),
+                           RC_ALLOCATOR_META_PAGE_CSUM_SEED);
+   al->meta_page->extents_checksum =
+      rc_allocator_extents_checksum(al->meta_page);
+   return io_write(al->io,
+                   al->meta_page,
+                   al->cfg->io_cfg->page_size,
+                   RC_ALLOCATOR_BASE_OFFSET);
+}
+
 static platform_status
 rc_allocator_init_meta_page(rc_allocator *al)
 {
@@ -366,6 +394,19 @@ rc_allocator_init(rc_allocator        *al,
    al->ref_count = platform_buffer_getaddr(al->bh);
    memset(al->ref_count, 0, buffer_size);
 
+   /*
+    * Start out handing out extents from the beginning of the device only (but
+    * with enough room for the super block and ref count extents), and grow
+    * from there as extents are used up.
+    */
+   rc_extent_count = (buffer_size + al->cfg->io_cfg->extent_size - 1)
+                     / al->cfg->io_cfg->extent_size;
+   al->active_extents = MIN(
+      cfg->extent_capacity,
+      MAX(RC_ALLOCATOR_INITIAL_ACTIVE_EXTENTS, 2 * (rc_extent_count + 1)));
+   al->meta_page->capacity       = cfg->capacity;
+   al->meta_page->active_extents = al->active_extents;
+
    // allocate the super block
    allocator_alloc(&al->super, &addr, PAGE_TYPE_SUPERBLOCK);
    // super block extent should always start from address 0.
@@ -375,8 +416,6 @@ rc_allocator_init(rc_allocator        *al,
     * Allocate room for the ref counts, use same rounded up size used in buffer
     * creation.
     */
-   rc_extent_count = (buffer_size + al->cfg->io_cfg->extent_size - 1)
-                     / al->cfg->io_cfg->extent_size;
    for (uint64 i = 0; i < rc_extent_count; i++) {
       allocator_alloc(&al->super, &addr, PAGE_TYPE_SUPERBLOCK);
       platform_assert(addr == cfg->io_cfg->extent_size * (i + 1));
@@ -434,16 +473,6 @@ rc_allocator_mount(rc_allocator        *al,
    }
 
    platform_assert(cfg->io_cfg->page_size % 4096 == 0);
-   platform_assert(cfg->capacity
-                   == cfg->io_cfg->extent_size * cfg->extent_capacity);
-   platform_assert(cfg->capacity
-                   == cfg->io_cfg->page_size * cfg->page_capacity);
-
-   uint32 buffer_size = cfg->extent_capacity * sizeof(uint8);
-   buffer_size        = ROUNDUP(buffer_size, cfg->io_cfg->page_size);
-   al->bh = platform_buffer_create(buffer_size, al->heap_handle, mid);
-   platform_assert(al->bh != NULL);
-   al->ref_count = platform_buffer_getaddr(al->bh);
 
    // load the meta page from disk.
    status = io_read(
@@ -457,14 +486,54 @@ rc_allocator_mount(rc_allocator        *al,
    if (!platform_checksum_is_equal(al->meta_page->checksum, currChecksum)) {
       platform_assert(0, "Corrupt Meta Page upon mount");
    }
+   checksum128 zero_checksum = {0};
+   bool        legacy_meta_page =
+      al->meta_page->capacity == 0 && al->meta_page->active_extents == 0
+      && platform_checksum_is_equal(al->meta_page->extents_checksum,
+                                    zero_checksum);
+   if (!legacy_meta_page
+       && !platform_checksum_is_equal(
+          al->meta_page->extents_checksum,
+          rc_allocator_extents_checksum(al->meta_page)))
+   {
+      platform_assert(0, "Corrupt Meta Page extents upon mount");
+   }
 
-   // load the ref counts from disk.
-   uint32 io_size =
-      ROUNDUP(al->cfg->extent_capacity, al->cfg->io_cfg->page_size);
+   /*
+    * The capacity the device was formatted with determines where the ref
+    * counts live, so it takes precedence over the configured one.
+    */
+   if (al->meta_page->capacity != 0 && al->meta_page->capacity != cfg->capacity)
+   {
+      platform_default_log("Mounting device formatted with capacity %lu bytes"
+                           " (configured capacity is %lu bytes).\n",
+                           al->meta_page->capacity,
+                           cfg->capacity);
+      allocator_config_init(cfg, cfg->io_cfg, al->meta_page->capacity);
+   }
+   platform_assert(cfg->capacity
+                   == cfg->io_cfg->extent_size * cfg->extent_capacity);
+   platform_assert(cfg->capacity
+                   == cfg->io_cfg->page_size * cfg->page_capacity);
+   al->active_extents = al->meta_page->active_extents == 0
+                           ? cfg->extent_capacity
+                           : MIN(al->meta_page->active_extents,
+                                 cfg->extent_capacity);
+   al->meta_page->capacity       = cfg->capacity;
+   al->meta_page->active_extents = al->active_extents;
+
+   uint32 buffer_size = cfg->extent_capacity * sizeof(uint8);
+   buffer_size        = ROUNDUP(buffer_size, cfg->io_cfg->page_size);
+   al->bh = platform_buffer_create(buffer_size, al->heap_handle, mid);
+   platform_assert(al->bh != NULL);
+   al->ref_count = platform_buffer_getaddr(al->bh);
+
+   // load the ref counts of the active extents from disk, the rest are free.
+   uint32 io_size = ROUNDUP(al->active_extents, al->cfg->io_cfg->page_size);
    status = io_read(io, al->ref_count, io_size, cfg->io_cfg->extent_size);
    platform_assert_status_ok(status);
 
-   for (uint64 i = 0; i < al->cfg->extent_capacity; i++) {
+   for (uint64 i = 0; i < al->active_extents; i++) {
       if (al->ref_count[i] != 0) {
          al->stats.curr_allocated++;
       }
@@ -478,12 +547,13 @@ rc_allocator_unmount(rc_allocator *al)
 {
    platform_status status;
 
-   // persist the ref counts upon unmount.
-   uint32 io_size =
-      ROUNDUP(al->cfg->extent_capacity, al->cfg->io_cfg->page_size);
+   // persist the ref counts of the active extents upon unmount.
+   uint32 io_size = ROUNDUP(al->active_extents, al->cfg->io_cfg->page_size);
    status =
       io_write(al->io, al->ref_count, io_size, al->cfg->io_cfg->extent_size);
    platform_assert_status_ok(status);
+   status = rc_allocator_write_meta_page(al);
+   platform_assert_status_ok(status);
    rc_allocator_deinit(al);
 }
 
@@ -599,14 +669,7 @@ rc_allocator_alloc_super_addr(rc_allocator     *al,
          // assign the first available slot and update the on disk metadata.
          al->meta_page->splinters[idx] = allocator_root_id;
          *addr                         = (1 + idx) * al->cfg->io_cfg->page_size;
-         al->meta_page->checksum =
-            platform_checksum128(al->meta_page,
-                                 sizeof(al->meta_page->splinters),
-                                 RC_ALLOCATOR_META_PAGE_CSUM_SEED);
-         platform_status io_status = io_write(al->io,
-                                              al->meta_page,
-                                              al->cfg->io_cfg->page_size,
-                                              RC_ALLOCATOR_BASE_OFFSET);
+         platform_status io_status     = rc_allocator_write_meta_page(al);
          platform_assert_status_ok(io_status);
          status = STATUS_OK;
          break;
@@ -630,14 +693,7 @@ rc_allocator_remove_super_addr(rc_allocator     *al,
        */
       if (al->meta_page->splinters[idx] == allocator_root_id) {
          al->meta_page->splinters[idx] = INVALID_ALLOCATOR_ROOT_ID;
-         al->meta_page->checksum =
-            platform_checksum128(al->meta_page,
-                                 sizeof(al->meta_page->splinters),
-                                 RC_ALLOCATOR_META_PAGE_CSUM_SEED);
-         platform_status status = io_write(al->io,
-                                           al->meta_page,
-                                           al->cfg->io_cfg->page_size,
-                                           RC_ALLOCATOR_BASE_OFFSET);
+         platform_status status        = rc_allocator_write_meta_page(al);
          platform_assert_status_ok(status);
          platform_mutex_unlock(&al->lock);
          return;
@@ -674,11 +730,43 @@ rc_allocator_get_config(rc_allocator *al)
    return al->cfg;
 }
 
+/*
+ *----------------------------------------------------------------------
+ * rc_allocator_grow--
+ *
+ *      Grows the range of extents the allocator hands out from, which
+ *      the caller observed as seen_active_extents, doubling it up to the
+ *      capacity. Returns TRUE if the range has grown, either here or
+ *      concurrently by another thread.
+ *----------------------------------------------------------------------
+ */
+static bool
+rc_allocator_grow(rc_allocator *al, uint64 seen_active_extents)
+{
+   bool grown = FALSE;
+
+   platform_mutex_lock(&al->lock);
+   if (al->active_extents != seen_active_extents) {
+      grown = TRUE;
+   } else if (seen_active_extents < al->cfg->extent_capacity) {
+      uint64 active_extents =
+         MIN(2 * seen_active_extents, al->cfg->extent_capacity);
+      al->meta_page->active_extents = active_extents;
+      platform_status status        = rc_allocator_write_meta_page(al);
+      platform_assert_status_ok(status);
+      __atomic_store_n(&al->active_extents, active_extents, __ATOMIC_RELEASE);
+      grown = TRUE;
+   }
+   platform_mutex_unlock(&al->lock);
+   return grown;
+}
+
 /*
  *----------------------------------------------------------------------
  * rc_allocator_alloc--
  *
- *      Allocate an extent
+ *      Allocate an extent, from the active extents. The active extents are
+ *      grown once they are 7/8ths used, or if there are no free ones left.
  *----------------------------------------------------------------------
  */
 platform_status
@@ -686,18 +774,22 @@ rc_allocator_alloc(rc_allocator *al,   // IN
                    uint64       *addr, // OUT
                    page_type     type)     // IN
 {
-   uint64 first_hand = al->hand % al->cfg->extent_capacity;
+   uint64 active_extents =
+      __atomic_load_n(&al->active_extents, __ATOMIC_ACQUIRE);
+   uint64 first_hand = al->hand % active_extents;
    uint64 hand;
    bool   extent_is_free = FALSE;
 
    do {
-      hand = __sync_fetch_and_add(&al->hand, 1) % al->cfg->extent_capacity;
+      hand = __sync_fetch_and_add(&al->hand, 1) % active_extents;
       if (al->ref_count[hand] == 0)
          extent_is_free =
             __sync_bool_compare_and_swap(&al->ref_count[hand], 0, 2);
-   } while (!extent_is_free
-            && (hand + 1) % al->cfg->extent_capacity != first_hand);
+   } while (!extent_is_free && (hand + 1) % active_extents != first_hand);
    if (!extent_is_free) {
+      if (rc_allocator_grow(al, active_extents)) {
+         return rc_allocator_alloc(al, addr, type);
+      }
       platform_default_log(
          "Out of Space, while allocating an extent of type=%d (%s):"
          " allocated %lu out of %lu extents.\n",
@@ -715,6 +807,11 @@ rc_allocator_alloc(rc_allocator *al,   // IN
       max_allocated = al->stats.max_allocated;
    }
    __sync_add_and_fetch(&al->stats.extent_allocs[type], 1);
+   if (curr_allocated > active_extents - active_extents / 8
+       && active_extents < al->cfg->extent_capacity)
+   {
+      rc_allocator_grow(al, active_extents);
+   }
    *addr = hand * al->cfg->io_cfg->extent_size;
    if (SHOULD_TRACE(*addr)) {
       platform_default_log(
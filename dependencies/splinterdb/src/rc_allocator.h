@@ -21,6 +21,15 @@
  */
 #define RC_ALLOCATOR_MAX_ROOT_IDS (30)
 
+/*
+ * Number of extents the allocator initially hands out from. The allocator
+ * grows this (up to the configured capacity) as the in-use extents approach
+ * it, so the backing file only grows as data is added, and the configured
+ * disk size acts as an upper bound rather than a size that has to be guessed
+ * up front.
+ */
+#define RC_ALLOCATOR_INITIAL_ACTIVE_EXTENTS (512)
+
 /*
  *----------------------------------------------------------------------
  * rc_allocator_meta_page -- Disk-resident structure.
@@ -33,6 +42,17 @@
 typedef struct ONDISK rc_allocator_meta_page {
    allocator_root_id splinters[RC_ALLOCATOR_MAX_ROOT_IDS];
    checksum128       checksum;
+   /*
+    * Capacity the device was formatted with, which fixes the layout of the
+    * ref count table, and the number of extents currently handed out from.
+    * These have a checksum of their own, since the one above only covers
+    * the splinters. All are 0 on devices formatted before these were
+    * recorded, in which case the configured capacity is used and all
+    * extents are active.
+    */
+   uint64      capacity;
+   uint64      active_extents;
+   checksum128 extents_checksum;
 } rc_allocator_meta_page;
 
 _Static_assert(offsetof(rc_allocator_meta_page, splinters) == 0,
@@ -61,6 +81,7 @@ typedef struct rc_allocator {
    buffer_handle          *bh;
    uint8                  *ref_count;
    uint64                  hand;
+   uint64                  active_extents;
    io_handle              *io;
    rc_allocator_meta_page *meta_page;
 
@@ -70,10 +70,18 @@ shard_log_checksum(shard_log_config *cfg, page_handle *page)
       page->data + 16, shard_log_page_size(cfg) - 16, cfg->seed);
 }
 
+static void
+shard_log_thread_data_init(void *state)
+{
+   shard_log_thread_data *thread_data = (shard_log_thread_data *)state;
+   thread_data->addr                  = SHARD_UNMAPPED;
+   thread_data->offset                = 0;
+}
+
 static inline shard_log_thread_data *
 shard_log_get_thread_data(shard_log *log, threadid thr_id)
 {
-   return &log->thread_data[thr_id];
+   return (shard_log_thread_data *)thread_state_get(&log->thread_data, thr_id);
 }
 
 page_handle *
@@ -84,7 +92,10 @@ shard_log_alloc(shard_log *log, uint64 *next_extent)
 }
 
 platform_status
-shard_log_init(shard_log *log, cache *cc, shard_log_config *cfg)
+shard_log_init(shard_log        *log,
+               cache            *cc,
+               shard_log_config *cfg,
+               platform_heap_id  hid)
 {
    memset(log, 0, sizeof(shard_log));
    log->cc        = cc;
@@ -98,12 +109,10 @@ shard_log_init(shard_log *log, cache *cc, shard_log_config *cfg)
    platform_status rc = allocator_alloc(al, &log->meta_head, PAGE_TYPE_LOG);
    platform_assert_status_ok(rc);
 
-   for (threadid thr_i = 0; thr_i < MAX_THREADS; thr_i++) {
-      shard_log_thread_data *thread_data =
-         shard_log_get_thread_data(log, thr_i);
-      thread_data->addr   = SHARD_UNMAPPED;
-      thread_data->offset = 0;
-   }
+   thread_state_table_init(&log->thread_data,
+                           hid,
+                           sizeof(shard_log_thread_data),
+                           shard_log_thread_data_init);
 
    // the log uses an unkeyed mini allocator
    log->addr = mini_init(&log->mini,
@@ -120,16 +129,21 @@ shard_log_init(shard_log *log, cache *cc, shard_log_config *cfg)
    return STATUS_OK;
 }
 
+void
+shard_log_deinit(shard_log *log)
+{
+   thread_state_table_deinit(&log->thread_data);
+}
+
+/*
+ * Destroys the log on disk and releases its in-memory state.
+ */
 void
 shard_log_zap(shard_log *log)
 {
    cache *cc = log->cc;
 
-   for (threadid i = 0; i < MAX_THREADS; i++) {
-      shard_log_thread_data *thread_data = shard_log_get_thread_data(log, i);
-      thread_data->addr                  = SHARD_UNMAPPED;
-      thread_data->offset                = 0;
-   }
+   shard_log_deinit(log);
 
    mini_unkeyed_dec_ref(cc, log->meta_head, PAGE_TYPE_LOG, FALSE);
 }
@@ -324,11 +338,18 @@ log_create(cache *cc, log_config *lcfg, platform_heap_id hid)
 {
    shard_log_config *cfg  = (shard_log_config *)lcfg;
    shard_log        *slog = TYPED_MALLOC(hid, slog);
-   platform_status   rc   = shard_log_init(slog, cc, cfg);
+   platform_status   rc   = shard_log_init(slog, cc, cfg, hid);
    platform_assert(SUCCESS(rc));
    return (log_handle *)slog;
 }
 
+void
+log_destroy(log_handle *log, platform_heap_id hid)
+{
+   shard_log_deinit((shard_log *)log);
+   platform_free(hid, log);
+}
+
 platform_status
 shard_log_iterator_init(cache              *cc,
                         shard_log_config   *cfg,
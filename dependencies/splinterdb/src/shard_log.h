@@ -34,14 +34,14 @@ typedef struct shard_log_thread_data {
  * Sharded log context structure.
  */
 typedef struct shard_log {
-   log_handle            super; // handle to log I/O ops abstraction.
-   cache                *cc;
-   shard_log_config     *cfg;
-   shard_log_thread_data thread_data[MAX_THREADS];
-   mini_allocator        mini;
-   uint64                addr;
-   uint64                meta_head;
-   uint64                magic;
+   log_handle         super; // handle to log I/O ops abstraction.
+   cache             *cc;
+   shard_log_config  *cfg;
+   thread_state_table thread_data; // of shard_log_thread_data
+   mini_allocator     mini;
+   uint64             addr;
+   uint64             meta_head;
+   uint64             magic;
 } shard_log;
 
 typedef struct log_entry log_entry;
@@ -69,7 +69,13 @@ typedef struct ONDISK shard_log_hdr {
 } shard_log_hdr;
 
 platform_status
-shard_log_init(shard_log *log, cache *cc, shard_log_config *cfg);
+shard_log_init(shard_log        *log,
+               cache            *cc,
+               shard_log_config *cfg,
+               platform_heap_id  hid);
+
+void
+shard_log_deinit(shard_log *log);
 
 void
 shard_log_zap(shard_log *log);
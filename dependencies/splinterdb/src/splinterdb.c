@@ -219,6 +219,7 @@ splinterdb_init_config(const splinterdb_config *kvs_cfg, // IN
    if (!SUCCESS(rc)) {
       return rc;
    }
+   kvs->trunk_cfg.btree_cfg.compress_leaves = cfg.btree_compress_leaves;
 
    return STATUS_OK;
 }
@@ -450,6 +451,21 @@ splinterdb_deregister_thread(splinterdb *kvs)
    task_deregister_this_thread(kvs->task_sys);
 }
 
+_Static_assert(SPLINTERDB_NO_THREAD_ID == INVALID_TID,
+               "SPLINTERDB_NO_THREAD_ID has to be the invalid thread id");
+
+threadid
+splinterdb_get_thread_id(void)
+{
+   return platform_get_tid();
+}
+
+void
+splinterdb_set_thread_id(threadid tid)
+{
+   platform_set_tid(tid);
+}
+
 /*
  *-----------------------------------------------------------------------------
  * splinterdb_insert_raw_message --
@@ -574,10 +590,110 @@ splinterdb_lookup(const splinterdb         *kvs, // IN
 }
 
 
+struct splinterdb_async_lookup {
+   trunk_async_ctxt    ctxt;
+   splinterdb_async_cb cb;
+   void               *cb_arg;
+};
+
+/*
+ * Called by the trunk's async state machine when IO it started has
+ * completed, and the lookup can be continued.
+ */
+static void
+splinterdb_async_lookup_callback(trunk_async_ctxt *ctxt)
+{
+   splinterdb_async_lookup *lookup =
+      container_of(ctxt, splinterdb_async_lookup, ctxt);
+   lookup->cb(lookup->cb_arg);
+}
+
+int
+splinterdb_async_lookup_create(const splinterdb         *kvs,     // IN
+                               splinterdb_async_cb       cb,      // IN
+                               void                     *cb_arg,  // IN
+                               splinterdb_async_lookup **ctxt_out // OUT
+)
+{
+   splinterdb_async_lookup *lookup = TYPED_MALLOC(kvs->spl->heap_id, lookup);
+   if (lookup == NULL) {
+      platform_error_log("TYPED_MALLOC error\n");
+      return platform_status_to_int(STATUS_NO_MEMORY);
+   }
+   trunk_async_ctxt_init(&lookup->ctxt, splinterdb_async_lookup_callback);
+   lookup->cb     = cb;
+   lookup->cb_arg = cb_arg;
+   *ctxt_out      = lookup;
+   return 0;
+}
+
+void
+splinterdb_async_lookup_destroy(const splinterdb        *kvs, // IN
+                                splinterdb_async_lookup *ctxt // IN
+)
+{
+   debug_assert(ctxt->ctxt.state == async_state_start);
+   platform_free(kvs->spl->heap_id, ctxt);
+}
+
+bool
+splinterdb_async_lookup_started(const splinterdb_async_lookup *ctxt)
+{
+   return ctxt->ctxt.state != async_state_start;
+}
+
+int
+splinterdb_lookup_async(const splinterdb         *kvs,    // IN
+                        slice                     user_key,
+                        splinterdb_lookup_result *result, // IN/OUT
+                        splinterdb_async_lookup  *ctxt)   // IN/OUT
+{
+   _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)result;
+   key                        target  = key_create_from_slice(user_key);
+
+   platform_assert(kvs != NULL);
+   cache_async_result res =
+      trunk_lookup_async(kvs->spl, target, &_result->value, &ctxt->ctxt);
+   switch (res) {
+      case async_success:
+         // ready for the next lookup
+         trunk_async_ctxt_init(&ctxt->ctxt, splinterdb_async_lookup_callback);
+         return 0;
+      case async_io_started:
+         return SPLINTERDB_ASYNC_IO_STARTED;
+      case async_locked:
+      case async_no_reqs:
+         return SPLINTERDB_ASYNC_RETRY;
+      default:
+         platform_assert(0);
+   }
+   return 0;
+}
+
+void
+splinterdb_async_poll(const splinterdb *kvs)
+{
+   io_cleanup((io_handle *)&kvs->io_handle, 0);
+}
+
+
 struct splinterdb_iterator {
    trunk_range_iterator sri;
    platform_status      last_rc;
    const splinterdb    *parent;
+   // The range iterator's max key is exclusive, so an inclusive top key (the
+   // end key, or the key a reverse seek starts from) is looked up (into
+   // top_value) once the range iterator reaches it (or, in reverse, before it
+   // starts)
+   bool              end_inclusive;
+   bool              at_top_key;
+   bool              top_key_done;
+   // Changing direction restarts the range iterator from the current key
+   bool              reverse;
+   key_buffer        start_key;
+   key_buffer        end_key;
+   key_buffer        top_key;
+   merge_accumulator top_value;
 };
 
 int
@@ -585,6 +701,52 @@ splinterdb_iterator_init(const splinterdb     *kvs,           // IN
                          splinterdb_iterator **iter,          // OUT
                          slice                 user_start_key // IN
 )
+{
+   return splinterdb_iterator_init_range(
+      kvs, iter, user_start_key, NULL_SLICE, FALSE);
+}
+
+static int
+splinterdb_iterator_init_internal(const splinterdb     *kvs,            // IN
+                                  splinterdb_iterator **iter,           // OUT
+                                  slice                 user_start_key, // IN
+                                  slice                 user_end_key,   // IN
+                                  bool                  end_inclusive,  // IN
+                                  bool                  reverse         // IN
+);
+
+int
+splinterdb_iterator_init_range(const splinterdb     *kvs,            // IN
+                               splinterdb_iterator **iter,           // OUT
+                               slice                 user_start_key, // IN
+                               slice                 user_end_key,   // IN
+                               bool                  end_inclusive   // IN
+)
+{
+   return splinterdb_iterator_init_internal(
+      kvs, iter, user_start_key, user_end_key, end_inclusive, FALSE);
+}
+
+int
+splinterdb_iterator_init_reverse(const splinterdb     *kvs,            // IN
+                                 splinterdb_iterator **iter,           // OUT
+                                 slice                 user_start_key, // IN
+                                 slice                 user_end_key,   // IN
+                                 bool                  end_inclusive   // IN
+)
+{
+   return splinterdb_iterator_init_internal(
+      kvs, iter, user_start_key, user_end_key, end_inclusive, TRUE);
+}
+
+static int
+splinterdb_iterator_init_internal(const splinterdb     *kvs,            // IN
+                                  splinterdb_iterator **iter,           // OUT
+                                  slice                 user_start_key, // IN
+                                  slice                 user_end_key,   // IN
+                                  bool                  end_inclusive,  // IN
+                                  bool                  reverse         // IN
+)
 {
    splinterdb_iterator *it = TYPED_MALLOC(kvs->spl->heap_id, it);
    if (it == NULL) {
@@ -595,20 +757,52 @@ splinterdb_iterator_init(const splinterdb     *kvs,           // IN
 
    trunk_range_iterator *range_itor = &(it->sri);
    key                   start_key;
+   key                   end_key;
 
    if (slice_is_null(user_start_key)) {
       start_key = NEGATIVE_INFINITY_KEY;
    } else {
       start_key = key_create_from_slice(user_start_key);
    }
+   if (slice_is_null(user_end_key)) {
+      end_key       = POSITIVE_INFINITY_KEY;
+      end_inclusive = FALSE;
+   } else {
+      end_key = key_create_from_slice(user_end_key);
+   }
 
-   platform_status rc = trunk_range_iterator_init(
-      kvs->spl, range_itor, start_key, POSITIVE_INFINITY_KEY, UINT64_MAX);
+   // Branches and leaves past the end key are never visited (or prefetched)
+   platform_status rc;
+   if (reverse) {
+      rc = trunk_range_iterator_init_reverse(
+         kvs->spl, range_itor, start_key, end_key, UINT64_MAX);
+   } else {
+      rc = trunk_range_iterator_init(
+         kvs->spl, range_itor, start_key, end_key, UINT64_MAX);
+   }
    if (!SUCCESS(rc)) {
-      platform_free(kvs->spl->heap_id, *iter);
+      platform_free(kvs->spl->heap_id, it);
       return platform_status_to_int(rc);
    }
-   it->parent = kvs;
+   it->parent        = kvs;
+   it->end_inclusive = end_inclusive;
+   it->at_top_key    = FALSE;
+   it->reverse       = reverse;
+   // the end key is only in the range if it isn't before the start key
+   it->top_key_done =
+      !end_inclusive || trunk_key_compare(kvs->spl, end_key, start_key) < 0;
+   key_buffer_init_from_key(&it->start_key, kvs->spl->heap_id, start_key);
+   key_buffer_init_from_key(&it->end_key, kvs->spl->heap_id, end_key);
+   key_buffer_init_from_key(&it->top_key, kvs->spl->heap_id, end_key);
+   merge_accumulator_init(&it->top_value, kvs->spl->heap_id);
+
+   if (reverse && !it->top_key_done) {
+      // going backwards, the end key comes first
+      it->top_key_done = TRUE;
+      it->last_rc = trunk_lookup(kvs->spl, end_key, &it->top_value);
+      it->at_top_key =
+         SUCCESS(it->last_rc) && trunk_lookup_found(&it->top_value);
+   }
 
    *iter = it;
    return EXIT_SUCCESS;
@@ -620,6 +814,11 @@ splinterdb_iterator_deinit(splinterdb_iterator *iter)
    trunk_range_iterator *range_itor = &(iter->sri);
    trunk_range_iterator_deinit(range_itor);
 
+   key_buffer_deinit(&iter->start_key);
+   key_buffer_deinit(&iter->end_key);
+   key_buffer_deinit(&iter->top_key);
+   merge_accumulator_deinit(&iter->top_value);
+
    trunk_handle *spl = range_itor->spl;
    platform_free(spl->heap_id, range_itor);
 }
@@ -630,18 +829,184 @@ splinterdb_iterator_valid(splinterdb_iterator *kvi)
    if (!SUCCESS(kvi->last_rc)) {
       return FALSE;
    }
+   if (kvi->at_top_key) {
+      return TRUE;
+   }
    bool      at_end;
    iterator *itor = &(kvi->sri.super);
    kvi->last_rc   = iterator_at_end(itor, &at_end);
    if (!SUCCESS(kvi->last_rc)) {
       return FALSE;
    }
+   if (at_end && !kvi->top_key_done) {
+      // the range iterator stopped before the (inclusive) end key
+      kvi->top_key_done = TRUE;
+      kvi->last_rc      = trunk_lookup(kvi->parent->spl,
+                                  key_buffer_key(&kvi->top_key),
+                                  &kvi->top_value);
+      if (!SUCCESS(kvi->last_rc)) {
+         return FALSE;
+      }
+      kvi->at_top_key = trunk_lookup_found(&kvi->top_value);
+      return kvi->at_top_key;
+   }
    return !at_end;
 }
 
+/*
+ * Points the (inclusive) top key at key, which is only looked up if the
+ * iterator gets to it
+ */
+static void
+splinterdb_iterator_set_top_key(splinterdb_iterator *kvi, key top_key)
+{
+   kvi->last_rc = key_buffer_copy_key(&kvi->top_key, top_key);
+}
+
+/*
+ * Restarts the range iterator in the other direction, from the current key
+ * (which is excluded).
+ */
+static void
+splinterdb_iterator_turn(splinterdb_iterator *kvi)
+{
+   trunk_handle *spl = kvi->parent->spl;
+   key           curr_key;
+   message       msg;
+   if (kvi->at_top_key) {
+      curr_key = key_buffer_key(&kvi->top_key);
+   } else {
+      iterator_get_curr(&kvi->sri.super, &curr_key, &msg);
+   }
+   platform_status rc;
+   KEY_CREATE_LOCAL_COPY(rc, from_key, spl->heap_id, curr_key);
+   if (!SUCCESS(rc)) {
+      kvi->last_rc = rc;
+      return;
+   }
+   kvi->reverse    = !kvi->reverse;
+   kvi->at_top_key = FALSE;
+
+   if (kvi->reverse) {
+      // the top key (if it is included) comes before everything going back
+      kvi->top_key_done = TRUE;
+      kvi->last_rc      = trunk_range_iterator_seek(
+         &kvi->sri, key_buffer_key(&kvi->start_key), from_key, TRUE);
+      return;
+   }
+
+   key end_key       = key_buffer_key(&kvi->end_key);
+   kvi->top_key_done = !kvi->end_inclusive
+                       || trunk_key_compare(spl, from_key, end_key) >= 0;
+   splinterdb_iterator_set_top_key(kvi, end_key);
+   if (!SUCCESS(kvi->last_rc)) {
+      return;
+   }
+   kvi->last_rc =
+      trunk_range_iterator_seek(&kvi->sri, from_key, end_key, FALSE);
+   if (!SUCCESS(kvi->last_rc)) {
+      return;
+   }
+   bool at_end;
+   iterator_at_end(&kvi->sri.super, &at_end);
+   if (!at_end) {
+      iterator_get_curr(&kvi->sri.super, &curr_key, &msg);
+      if (trunk_key_compare(spl, curr_key, from_key) == 0) {
+         kvi->last_rc = iterator_advance(&kvi->sri.super);
+      }
+   }
+}
+
+int
+splinterdb_iterator_seek(splinterdb_iterator *kvi,     // IN
+                         slice                user_key // IN
+)
+{
+   trunk_handle *spl       = kvi->parent->spl;
+   key           start_key = key_buffer_key(&kvi->start_key);
+   key           end_key   = key_buffer_key(&kvi->end_key);
+   kvi->at_top_key         = FALSE;
+
+   if (kvi->reverse) {
+      // the last key at or before the target, the target being the top key
+      key  max_key   = end_key;
+      bool inclusive = kvi->end_inclusive;
+      if (!slice_is_null(user_key)) {
+         key target = key_create_from_slice(user_key);
+         if (trunk_key_compare(spl, target, end_key) < 0) {
+            max_key   = target;
+            inclusive = TRUE;
+         }
+      }
+      inclusive = inclusive && trunk_key_compare(spl, max_key, start_key) >= 0;
+      splinterdb_iterator_set_top_key(kvi, max_key);
+      if (!SUCCESS(kvi->last_rc)) {
+         return platform_status_to_int(kvi->last_rc);
+      }
+      kvi->top_key_done = TRUE;
+      kvi->last_rc =
+         trunk_range_iterator_seek(&kvi->sri, start_key, max_key, TRUE);
+      if (SUCCESS(kvi->last_rc) && inclusive) {
+         kvi->last_rc =
+            trunk_lookup(spl, key_buffer_key(&kvi->top_key), &kvi->top_value);
+         kvi->at_top_key =
+            SUCCESS(kvi->last_rc) && trunk_lookup_found(&kvi->top_value);
+      }
+      return platform_status_to_int(kvi->last_rc);
+   }
+
+   // the first key at or after the target
+   key min_key = start_key;
+   if (!slice_is_null(user_key)) {
+      key target = key_create_from_slice(user_key);
+      if (trunk_key_compare(spl, target, start_key) > 0) {
+         min_key = target;
+      }
+   }
+   kvi->top_key_done =
+      !kvi->end_inclusive || trunk_key_compare(spl, end_key, min_key) < 0;
+   splinterdb_iterator_set_top_key(kvi, end_key);
+   if (SUCCESS(kvi->last_rc)) {
+      kvi->last_rc =
+         trunk_range_iterator_seek(&kvi->sri, min_key, end_key, FALSE);
+   }
+   return platform_status_to_int(kvi->last_rc);
+}
+
+void
+splinterdb_iterator_release(splinterdb_iterator *kvi)
+{
+   trunk_range_iterator_release(&kvi->sri);
+   kvi->at_top_key   = FALSE;
+   kvi->top_key_done = TRUE;
+}
+
 void
 splinterdb_iterator_next(splinterdb_iterator *kvi)
 {
+   if (kvi->reverse) {
+      splinterdb_iterator_turn(kvi);
+      return;
+   }
+   if (kvi->at_top_key) {
+      kvi->at_top_key = FALSE;
+      return;
+   }
+   iterator *itor = &(kvi->sri.super);
+   kvi->last_rc   = iterator_advance(itor);
+}
+
+void
+splinterdb_iterator_prev(splinterdb_iterator *kvi)
+{
+   if (!kvi->reverse) {
+      splinterdb_iterator_turn(kvi);
+      return;
+   }
+   if (kvi->at_top_key) {
+      kvi->at_top_key = FALSE;
+      return;
+   }
    iterator *itor = &(kvi->sri.super);
    kvi->last_rc   = iterator_advance(itor);
 }
@@ -658,6 +1023,12 @@ splinterdb_iterator_get_current(splinterdb_iterator *iter,   // IN
                                 slice               *value   // OUT
 )
 {
+   if (iter->at_top_key) {
+      *value  = merge_accumulator_to_value(&iter->top_value);
+      *outkey = key_slice(key_buffer_key(&iter->top_key));
+      return;
+   }
+
    key       result_key;
    message   msg;
    iterator *itor = &(iter->sri.super);
@@ -667,6 +1038,76 @@ splinterdb_iterator_get_current(splinterdb_iterator *iter,   // IN
    *outkey = key_slice(result_key);
 }
 
+int
+splinterdb_count_range(const splinterdb     *kvs,            // IN
+                       slice                 user_start_key, // IN
+                       slice                 user_end_key,   // IN
+                       bool                  end_inclusive,  // IN
+                       splinterdb_count_mode mode,           // IN
+                       uint64               *count           // OUT
+)
+{
+   *count = 0;
+   if (mode == SPLINTERDB_COUNT_EXACT) {
+      splinterdb_iterator *it;
+      int                  rc = splinterdb_iterator_init_range(
+         kvs, &it, user_start_key, user_end_key, end_inclusive);
+      if (rc != 0) {
+         return rc;
+      }
+      for (; splinterdb_iterator_valid(it); splinterdb_iterator_next(it)) {
+         *count += 1;
+      }
+      rc = splinterdb_iterator_status(it);
+      splinterdb_iterator_deinit(it);
+      return rc;
+   }
+
+   key start_key = slice_is_null(user_start_key)
+                      ? NEGATIVE_INFINITY_KEY
+                      : key_create_from_slice(user_start_key);
+   key end_key   = slice_is_null(user_end_key)
+                      ? POSITIVE_INFINITY_KEY
+                      : key_create_from_slice(user_end_key);
+   uint64          num_kv_bytes;
+   platform_status rc =
+      trunk_count_in_range(kvs->spl, start_key, end_key, count, &num_kv_bytes);
+   if (!SUCCESS(rc) || !end_inclusive || slice_is_null(user_end_key)
+       || trunk_key_compare(kvs->spl, end_key, start_key) < 0)
+   {
+      return platform_status_to_int(rc);
+   }
+
+   // the counts are of a half-open range, so the end key is looked up
+   merge_accumulator end_value;
+   merge_accumulator_init(&end_value, kvs->spl->heap_id);
+   rc = trunk_lookup(kvs->spl, end_key, &end_value);
+   if (SUCCESS(rc) && trunk_lookup_found(&end_value)) {
+      *count += 1;
+   }
+   merge_accumulator_deinit(&end_value);
+   return platform_status_to_int(rc);
+}
+
+int
+splinterdb_approximate_size(const splinterdb *kvs,            // IN
+                            slice             user_start_key, // IN
+                            slice             user_end_key,   // IN
+                            uint64           *size            // OUT
+)
+{
+   key start_key = slice_is_null(user_start_key)
+                      ? NEGATIVE_INFINITY_KEY
+                      : key_create_from_slice(user_start_key);
+   key end_key   = slice_is_null(user_end_key)
+                      ? POSITIVE_INFINITY_KEY
+                      : key_create_from_slice(user_end_key);
+   uint64          num_tuples;
+   platform_status rc =
+      trunk_count_in_range(kvs->spl, start_key, end_key, &num_tuples, size);
+   return platform_status_to_int(rc);
+}
+
 void
 splinterdb_stats_print_insertion(const splinterdb *kvs)
 {
@@ -679,6 +1120,14 @@ splinterdb_stats_print_lookup(const splinterdb *kvs)
    trunk_print_lookup_stats(Platform_default_log_handle, kvs->spl);
 }
 
+void
+splinterdb_stats_range_seeks(const splinterdb *kvs,
+                             uint64           *seeks,
+                             uint64           *in_leaf)
+{
+   trunk_range_seek_stats(kvs->spl, seeks, in_leaf);
+}
+
 void
 splinterdb_stats_reset(splinterdb *kvs)
 {
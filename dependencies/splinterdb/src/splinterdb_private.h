@@ -31,6 +31,10 @@ _Static_assert(alignof(splinterdb_lookup_result)
                   == alignof(_splinterdb_lookup_result),
                "mismatched alignment for splinterdb_lookup_result");
 
+// Whether an async lookup is in progress in ctxt
+bool
+splinterdb_async_lookup_started(const splinterdb_async_lookup *ctxt);
+
 int
 splinterdb_create_or_open(const splinterdb_config *kvs_cfg,      // IN
                           splinterdb             **kvs_out,      // OUT
@@ -40,4 +44,11 @@ splinterdb_create_or_open(const splinterdb_config *kvs_cfg,      // IN
 bool
 validate_key_in_range(const splinterdb *kvs, slice key);
 
+// The number of iterator seeks, and of those that skipped rebuilding the
+// iterator, as it was still in the trunk leaf the seek lands in
+void
+splinterdb_stats_range_seeks(const splinterdb *kvs,
+                             uint64           *seeks,
+                             uint64           *in_leaf);
+
 #endif // __SPLINTERDB_PRIVATE_H__
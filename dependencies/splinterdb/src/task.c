@@ -27,23 +27,23 @@ _Static_assert((ARRAY_SIZE(task_type_name) == NUM_TASK_TYPES),
  * the task system structure to indicate that no threads are currently active.
  */
 static void
-task_init_tid_bitmask(uint64 *tid_bitmask)
+task_init_tid_bitmask(uint64 tid_bitmask[TASK_TID_BITMASK_WORDS])
 {
-   // We use a 64 bit word to act as the thread bitmap.
-   _Static_assert(MAX_THREADS == 64, "Max threads should be 64");
+   // We use an array of 64 bit words to act as the thread bitmap.
+   _Static_assert(MAX_THREADS % 64 == 0, "Max threads should be 64-aligned");
    /*
     * This is a special bitmask where 1 indicates free and 0 indicates
     * allocated. So, we set all bits to 1 during init.
     */
    for (int i = 0; i < MAX_THREADS; i++) {
-      *tid_bitmask |= (1ULL << i);
+      tid_bitmask[i / 64] |= (1ULL << (i % 64));
    }
 }
 
 static inline uint64 *
 task_system_get_tid_bitmask(task_system *ts)
 {
-   return &ts->tid_bitmask;
+   return ts->tid_bitmask;
 }
 
 static threadid *
@@ -53,12 +53,13 @@ task_system_get_max_tid(task_system *ts)
 }
 
 /*
- * Return the bitmasks of tasks active. Mainly intended as a testing hook.
+ * Return the bitmask of the first 64 thread IDs (the word holding thread 0).
+ * Mainly intended as a testing hook.
  */
 uint64
 task_active_tasks_mask(task_system *ts)
 {
-   return *task_system_get_tid_bitmask(ts);
+   return task_system_get_tid_bitmask(ts)[0];
 }
 
 /*
@@ -69,25 +70,31 @@ task_allocate_threadid(task_system *ts)
 {
    threadid tid         = INVALID_TID;
    uint64  *tid_bitmask = task_system_get_tid_bitmask(ts);
+   uint64   word        = 0;
    uint64   old_bitmask;
    uint64   new_bitmask;
 
    do {
-      old_bitmask = *tid_bitmask;
+      old_bitmask = tid_bitmask[word];
       // first bit set to 1 starting from LSB.
       uint64 pos = __builtin_ffsl(old_bitmask);
 
-      // If all threads are in-use, bitmask will be all 0s.
-      if (pos == 0) {
-         return INVALID_TID;
+      // If all threads of a word are in-use, it will be all 0s, so move on
+      // to the next one. If all words are, there is no tid to be had.
+      while (pos == 0) {
+         if (++word == TASK_TID_BITMASK_WORDS) {
+            return INVALID_TID;
+         }
+         old_bitmask = tid_bitmask[word];
+         pos         = __builtin_ffsl(old_bitmask);
       }
 
       // builtin_ffsl returns the position plus 1.
-      tid = pos - 1;
+      tid = word * 64 + pos - 1;
       // set bit at that position to 0, indicating in use.
       new_bitmask = (old_bitmask & ~(1ULL << (pos - 1)));
-   } while (
-      !__sync_bool_compare_and_swap(tid_bitmask, old_bitmask, new_bitmask));
+   } while (!__sync_bool_compare_and_swap(
+      &tid_bitmask[word], old_bitmask, new_bitmask));
 
    // Invariant: we have successfully allocated tid
 
@@ -107,22 +114,23 @@ task_allocate_threadid(task_system *ts)
 static void
 task_deallocate_threadid(task_system *ts, threadid tid)
 {
-   uint64 *tid_bitmask = task_system_get_tid_bitmask(ts);
+   uint64 *tid_bitmask = &task_system_get_tid_bitmask(ts)[tid / 64];
+   uint64  tid_bit      = 1ULL << (tid % 64);
 
    uint64 bitmask_val = *tid_bitmask;
 
    // Ensure that caller is only clearing for a thread that's in-use.
-   platform_assert(!(bitmask_val & (1ULL << tid)),
+   platform_assert(!(bitmask_val & tid_bit),
                    "Thread [%lu] is expected to be in-use. Bitmap: 0x%lx",
                    tid,
                    bitmask_val);
 
    // set bit back to 1 to indicate a free slot.
    uint64 tmp_bitmask = *tid_bitmask;
-   uint64 new_value   = tmp_bitmask | (1ULL << tid);
+   uint64 new_value   = tmp_bitmask | tid_bit;
    while (!__sync_bool_compare_and_swap(tid_bitmask, tmp_bitmask, new_value)) {
       tmp_bitmask = *tid_bitmask;
-      new_value   = tmp_bitmask | (1ULL << tid);
+      new_value   = tmp_bitmask | tid_bit;
    }
 }
 
@@ -458,6 +466,12 @@ task_group_get_next_task(task_group *group)
    return assigned_task;
 }
 
+static inline task_stats *
+task_group_get_stats(task_group *group, threadid tid)
+{
+   return (task_stats *)thread_state_get(&group->stats, tid);
+}
+
 /*
  * Do not need to hold lock on the group. (And advisably should not
  * hold lock on group for performance reasons.)
@@ -469,11 +483,12 @@ task_group_run_task(task_group *group, task *assigned_task)
    timestamp      current;
 
    if (group->use_stats) {
+      task_stats *stats         = task_group_get_stats(group, tid);
       current                   = platform_get_timestamp();
       timestamp queue_wait_time = current - assigned_task->enqueue_time;
-      group->stats[tid].total_queue_wait_time_ns += queue_wait_time;
-      if (queue_wait_time > group->stats[tid].max_queue_wait_time_ns) {
-         group->stats[tid].max_queue_wait_time_ns = queue_wait_time;
+      stats->total_queue_wait_time_ns += queue_wait_time;
+      if (queue_wait_time > stats->max_queue_wait_time_ns) {
+         stats->max_queue_wait_time_ns = queue_wait_time;
       }
    }
 
@@ -481,10 +496,11 @@ task_group_run_task(task_group *group, task *assigned_task)
                        task_system_get_thread_scratch(group->ts, tid));
 
    if (group->use_stats) {
-      current = platform_timestamp_elapsed(current);
-      if (current > group->stats[tid].max_runtime_ns) {
-         group->stats[tid].max_runtime_ns   = current;
-         group->stats[tid].max_runtime_func = assigned_task->func;
+      task_stats *stats = task_group_get_stats(group, tid);
+      current           = platform_timestamp_elapsed(current);
+      if (current > stats->max_runtime_ns) {
+         stats->max_runtime_ns   = current;
+         stats->max_runtime_func = assigned_task->func;
       }
    }
 
@@ -514,8 +530,10 @@ task_worker_thread(void *arg)
       if (task_to_run != NULL) {
          __sync_fetch_and_add(&group->current_executing_tasks, 1);
          task_group_unlock(group);
-         const threadid tid = platform_get_tid();
-         group->stats[tid].total_bg_task_executions++;
+         if (group->use_stats) {
+            const threadid tid = platform_get_tid();
+            task_group_get_stats(group, tid)->total_bg_task_executions++;
+         }
          task_group_run_task(group, task_to_run);
          platform_free(group->ts->heap_id, task_to_run);
          rc = task_group_lock(group);
@@ -544,7 +562,7 @@ task_group_stop_and_wait_for_threads(task_group *group)
                    "Attempt to shut down task group with %lu waiting tasks",
                    group->current_waiting_tasks);
 
-   uint8 num_threads = group->bg.num_threads;
+   uint64 num_threads = group->bg.num_threads;
 
    // Inform the background thread that it's time to exit now.
    group->bg.stop = TRUE;
@@ -552,10 +570,14 @@ task_group_stop_and_wait_for_threads(task_group *group)
    task_group_unlock(group);
 
    // Allow all background threads to wrap up their work.
-   for (uint8 i = 0; i < num_threads; i++) {
+   for (uint64 i = 0; i < num_threads; i++) {
       platform_thread_join(group->bg.threads[i]);
       group->bg.num_threads--;
    }
+   if (group->bg.threads != NULL) {
+      platform_free(group->ts->heap_id, group->bg.threads);
+      group->bg.threads = NULL;
+   }
 }
 
 static void
@@ -563,13 +585,14 @@ task_group_deinit(task_group *group)
 {
    task_group_stop_and_wait_for_threads(group);
    platform_condvar_destroy(&group->cv);
+   thread_state_table_deinit(&group->stats);
 }
 
 static platform_status
 task_group_init(task_group  *group,
                 task_system *ts,
                 bool         use_stats,
-                uint8        num_bg_threads,
+                uint64       num_bg_threads,
                 uint64       scratch_size)
 {
    ZERO_CONTENTS(group);
@@ -578,12 +601,23 @@ task_group_init(task_group  *group,
    platform_heap_id hid = ts->heap_id;
    platform_status  rc;
 
+   thread_state_table_init(&group->stats, hid, sizeof(task_stats), NULL);
+
    rc = platform_condvar_init(&group->cv, hid);
    if (!SUCCESS(rc)) {
       return rc;
    }
 
-   for (uint8 i = 0; i < num_bg_threads; i++) {
+   if (num_bg_threads) {
+      group->bg.threads =
+         TYPED_ARRAY_ZALLOC(hid, group->bg.threads, num_bg_threads);
+      if (group->bg.threads == NULL) {
+         rc = STATUS_NO_MEMORY;
+         goto out;
+      }
+   }
+
+   for (uint64 i = 0; i < num_bg_threads; i++) {
       rc = task_thread_create("splinter-bg-thread",
                               task_worker_thread,
                               (void *)group,
@@ -602,6 +636,7 @@ task_group_init(task_group  *group,
 out:
    debug_assert(!SUCCESS(rc));
    platform_condvar_destroy(&group->cv);
+   thread_state_table_deinit(&group->stats);
    return rc;
 }
 
@@ -654,10 +689,9 @@ task_enqueue(task_system *ts,
       new_task->enqueue_time = platform_get_timestamp();
    }
    if (group->use_stats) {
-      const threadid tid = platform_get_tid();
-      if (group->current_waiting_tasks
-          > group->stats[tid].max_outstanding_tasks) {
-         group->stats[tid].max_outstanding_tasks = group->current_waiting_tasks;
+      task_stats *stats = task_group_get_stats(group, platform_get_tid());
+      if (group->current_waiting_tasks > stats->max_outstanding_tasks) {
+         stats->max_outstanding_tasks = group->current_waiting_tasks;
       }
    }
    platform_condvar_signal(&group->cv);
@@ -706,8 +740,10 @@ task_group_perform_one(task_group *group, uint64 queue_scale_percent)
    task_group_unlock(group);
 
    if (assigned_task) {
-      const threadid tid = platform_get_tid();
-      group->stats[tid].total_fg_task_executions++;
+      if (group->use_stats) {
+         const threadid tid = platform_get_tid();
+         task_group_get_stats(group, tid)->total_fg_task_executions++;
+      }
       task_group_run_task(group, assigned_task);
       __sync_fetch_and_sub(&group->current_executing_tasks, 1);
       platform_free(group->ts->heap_id, assigned_task);
@@ -868,7 +904,7 @@ task_system_create(platform_heap_id          hid,
    ts->cfg     = cfg;
    ts->ioh     = ioh;
    ts->heap_id = hid;
-   task_init_tid_bitmask(&ts->tid_bitmask);
+   task_init_tid_bitmask(ts->tid_bitmask);
 
    // task initialization
    register_standard_hooks();
@@ -923,9 +959,12 @@ task_system_destroy(platform_heap_id hid, task_system **ts_in)
    if (tid != INVALID_TID) {
       task_deregister_this_thread(ts);
    }
-   if (ts->tid_bitmask != ((uint64)-1)) {
-      platform_error_log(
-         "Destroying task system that still has some registered threads.\n");
+   for (uint64 word = 0; word < TASK_TID_BITMASK_WORDS; word++) {
+      if (ts->tid_bitmask[word] != ((uint64)-1)) {
+         platform_error_log(
+            "Destroying task system that still has some registered threads.\n");
+         break;
+      }
    }
    platform_free(hid, ts);
    *ts_in = (task_system *)NULL;
@@ -967,22 +1006,22 @@ task_group_print_stats(task_group *group, task_type type)
    task_stats global = {0};
 
    for (threadid i = 0; i < MAX_THREADS; i++) {
-      global.total_bg_task_executions +=
-         group->stats[i].total_bg_task_executions;
-      global.total_fg_task_executions +=
-         group->stats[i].total_fg_task_executions;
-      global.total_queue_wait_time_ns +=
-         group->stats[i].total_queue_wait_time_ns;
-      if (group->stats[i].max_runtime_ns > global.max_runtime_ns) {
-         global.max_runtime_ns   = group->stats[i].max_runtime_ns;
-         global.max_runtime_func = group->stats[i].max_runtime_func;
+      task_stats *stats = thread_state_peek(&group->stats, i);
+      if (stats == NULL) {
+         continue;
+      }
+      global.total_bg_task_executions += stats->total_bg_task_executions;
+      global.total_fg_task_executions += stats->total_fg_task_executions;
+      global.total_queue_wait_time_ns += stats->total_queue_wait_time_ns;
+      if (stats->max_runtime_ns > global.max_runtime_ns) {
+         global.max_runtime_ns   = stats->max_runtime_ns;
+         global.max_runtime_func = stats->max_runtime_func;
       }
-      if (group->stats[i].max_queue_wait_time_ns
-          > global.max_queue_wait_time_ns) {
-         global.max_queue_wait_time_ns = group->stats[i].max_queue_wait_time_ns;
+      if (stats->max_queue_wait_time_ns > global.max_queue_wait_time_ns) {
+         global.max_queue_wait_time_ns = stats->max_queue_wait_time_ns;
       }
-      global.max_outstanding_tasks = MAX(global.max_outstanding_tasks,
-                                         group->stats[i].max_outstanding_tasks);
+      global.max_outstanding_tasks =
+         MAX(global.max_outstanding_tasks, stats->max_outstanding_tasks);
    }
 
    switch (type) {
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "platform.h"
+#include "util.h"
 
 typedef struct task_system task_system;
 
@@ -38,9 +39,9 @@ typedef struct task_queue {
 } task_queue;
 
 typedef struct task_bg_thread_group {
-   bool            stop;
-   uint8           num_threads;
-   platform_thread threads[MAX_THREADS];
+   bool             stop;
+   uint64           num_threads;
+   platform_thread *threads; // num_threads of them
 } task_bg_thread_group;
 
 /*
@@ -57,9 +58,9 @@ typedef struct task_group {
    platform_condvar     cv;
    task_bg_thread_group bg;
 
-   // Per thread stats.
-   bool       use_stats;
-   task_stats stats[MAX_THREADS];
+   // Per thread stats (task_stats), only used if use_stats.
+   bool               use_stats;
+   thread_state_table stats;
 } task_group;
 
 /*
@@ -88,6 +89,7 @@ task_system_config_init(task_system_config *task_cfg,
                         const uint64 num_background_threads[NUM_TASK_TYPES],
                         uint64       scratch_size);
 
+#define TASK_TID_BITMASK_WORDS (MAX_THREADS / 64)
 
 /*
  * ----------------------------------------------------------------------
@@ -109,12 +111,12 @@ struct task_system {
    platform_io_handle *ioh;
    platform_heap_id    heap_id;
    /*
-    * bitmask used for generating and clearing thread id's.
-    * If a bit is set to 0, it means we have an in use thread id for that
-    * particular position, 1 means it is unset and that thread id is available
-    * for use.
+    * bitmask used for generating and clearing thread id's, thread id n being
+    * bit (n % 64) of word (n / 64). If a bit is set to 0, it means we have an
+    * in use thread id for that particular position, 1 means it is unset and
+    * that thread id is available for use.
     */
-   uint64 tid_bitmask;
+   uint64 tid_bitmask[TASK_TID_BITMASK_WORDS];
    // max thread id so far.
    threadid max_tid;
    void    *thread_scratch[MAX_THREADS];
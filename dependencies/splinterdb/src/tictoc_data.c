@@ -2,6 +2,18 @@
 
 #include "data_internal.h"
 
+void
+tictoc_range_tuple_add_key(tictoc_range_tuple *tuple,
+                           slice               key,
+                           tictoc_timestamp    wts)
+{
+   // a sum, so that it doesn't depend on the order the keys are read in
+   tuple->num_keys++;
+   tuple->fingerprint +=
+      platform_hash64(slice_data(key), slice_length(key), wts);
+   tuple->ts_set.wts = MAX(tuple->ts_set.wts, wts);
+}
+
 tictoc_timestamp_set
 get_ts_from_tictoc_rw_entry(tictoc_rw_entry *entry)
 {
@@ -37,9 +49,46 @@ tictoc_rw_entry_set_point_key(tictoc_rw_entry   *entry,
 {
    writable_buffer_init_from_slice(&entry->key, 0, key);
    entry->start = interval_tree_key_create(
-      writable_buffer_to_slice(&entry->key), app_data_cfg);
-   entry->last = interval_tree_key_create(writable_buffer_to_slice(&entry->key),
-                                          app_data_cfg);
+      key_create_from_slice(writable_buffer_to_slice(&entry->key)),
+      app_data_cfg);
+   entry->last = entry->start;
+}
+
+/*
+ * Copies a range bound into the entry's buffer for it, returning the key for
+ * it, or infinity if the bound is NULL_SLICE
+ */
+static key
+tictoc_rw_entry_copy_bound(writable_buffer *wb, slice bound, key infinity)
+{
+   if (slice_is_null(bound)) {
+      writable_buffer_set_to_null(wb);
+      return infinity;
+   }
+   writable_buffer_copy_slice(wb, bound);
+   return key_create_from_slice(writable_buffer_to_slice(wb));
+}
+
+void
+tictoc_rw_entry_set_range_start(tictoc_rw_entry   *entry,
+                                slice              key_start,
+                                const data_config *app_data_cfg)
+{
+   platform_assert(entry->is_range);
+   key start = tictoc_rw_entry_copy_bound(
+      &entry->key, key_start, NEGATIVE_INFINITY_KEY);
+   entry->start = interval_tree_key_create(start, app_data_cfg);
+}
+
+void
+tictoc_rw_entry_set_range_last(tictoc_rw_entry   *entry,
+                               slice              key_last,
+                               const data_config *app_data_cfg)
+{
+   platform_assert(entry->is_range);
+   key last = tictoc_rw_entry_copy_bound(
+      &entry->key_last, key_last, POSITIVE_INFINITY_KEY);
+   entry->last = interval_tree_key_create(last, app_data_cfg);
 }
 
 void
@@ -48,29 +97,53 @@ tictoc_rw_entry_set_range_key(tictoc_rw_entry   *entry,
                               slice              key_last,
                               const data_config *app_data_cfg)
 {
-   writable_buffer_init_from_slice(&entry->key, 0, key_start);
-   entry->start = interval_tree_key_create(
-      writable_buffer_to_slice(&entry->key), app_data_cfg);
-
-   writable_buffer_init_from_slice(&entry->key_last, 0, key_last);
-   entry->last = interval_tree_key_create(
-      writable_buffer_to_slice(&entry->key_last), app_data_cfg);
+   if (!entry->is_range) {
+      writable_buffer_init(&entry->key, 0);
+      writable_buffer_init(&entry->key_last, 0);
+      entry->is_range = TRUE;
+   }
+   tictoc_rw_entry_set_range_start(entry, key_start, app_data_cfg);
+   tictoc_rw_entry_set_range_last(entry, key_last, app_data_cfg);
 }
 
 static void
 tictoc_rw_entry_deinit(tictoc_rw_entry *entry)
 {
    writable_buffer_deinit(&entry->key);
-   if (!writable_buffer_is_null(&entry->key_last)) {
-      writable_buffer_deinit(&entry->key_last);
-   }
+   writable_buffer_deinit(&entry->key_last);
    writable_buffer_deinit(&entry->tuple);
 }
 
+#define TICTOC_RW_SET_INITIAL_SIZE 16
+
+/*
+ * Makes room for one more entry in a read or write set, doubling it when it is
+ * full. Returns FALSE if it can't be allocated.
+ */
+static bool
+tictoc_rw_set_reserve(tictoc_rw_entry ***set, uint64 cnt, uint64 *size)
+{
+   if (cnt < *size) {
+      return TRUE;
+   }
+
+   uint64 new_size = *size == 0 ? TICTOC_RW_SET_INITIAL_SIZE : 2 * *size;
+   tictoc_rw_entry **new_set =
+      platform_realloc(0, *set, new_size * sizeof(tictoc_rw_entry *));
+   if (new_set == NULL) {
+      return FALSE;
+   }
+   *set  = new_set;
+   *size = new_size;
+   return TRUE;
+}
+
 tictoc_rw_entry *
 tictoc_get_new_read_set_entry(tictoc_transaction *tt_txn)
 {
-   if (tt_txn->read_cnt == TICTOC_RW_SET_SIZE_LIMIT / 2) {
+   if (!tictoc_rw_set_reserve(
+          &tt_txn->read_set, tt_txn->read_cnt, &tt_txn->read_set_size))
+   {
       return NULL;
    }
 
@@ -86,19 +159,101 @@ tictoc_get_read_set_entry(tictoc_transaction *tt_txn, uint64 i)
    return i < tt_txn->read_cnt ? tt_txn->read_set[i] : NULL;
 }
 
+static uint64
+tictoc_write_index_slot(tictoc_transaction *tt_txn,
+                        slice               user_key,
+                        const data_config  *cfg)
+{
+   return cfg->key_hash(slice_data(user_key), slice_length(user_key), 0)
+          & (tt_txn->write_index_size - 1);
+}
+
+static void
+tictoc_write_index_insert(tictoc_transaction *tt_txn,
+                          tictoc_rw_entry    *entry,
+                          const data_config  *cfg)
+{
+   slice  wkey = writable_buffer_to_slice(&entry->key);
+   uint64 slot = tictoc_write_index_slot(tt_txn, wkey, cfg);
+   while (tt_txn->write_index[slot] != NULL) {
+      slot = (slot + 1) & (tt_txn->write_index_size - 1);
+   }
+   tt_txn->write_index[slot] = entry;
+}
+
+/*
+ * Keeps the write index at most half full, rebuilding it twice as large when
+ * it would get fuller. Returns FALSE if it can't be allocated.
+ */
+static bool
+tictoc_write_index_reserve(tictoc_transaction *tt_txn, const data_config *cfg)
+{
+   if (2 * (tt_txn->write_cnt + 1) <= tt_txn->write_index_size) {
+      return TRUE;
+   }
+
+   uint64 new_size = tt_txn->write_index_size == 0
+                        ? 2 * TICTOC_RW_SET_INITIAL_SIZE
+                        : 2 * tt_txn->write_index_size;
+   tictoc_rw_entry **new_index;
+   new_index = TYPED_ARRAY_ZALLOC(0, new_index, new_size);
+   if (new_index == NULL) {
+      return FALSE;
+   }
+   if (tt_txn->write_index != NULL) {
+      platform_free(0, tt_txn->write_index);
+   }
+   tt_txn->write_index      = new_index;
+   tt_txn->write_index_size = new_size;
+   for (uint64 i = 0; i < tt_txn->write_cnt; ++i) {
+      tictoc_write_index_insert(tt_txn, tt_txn->write_set[i], cfg);
+   }
+   return TRUE;
+}
+
 tictoc_rw_entry *
-tictoc_get_new_write_set_entry(tictoc_transaction *tt_txn)
+tictoc_get_new_write_set_entry(tictoc_transaction *tt_txn,
+                               slice               user_key,
+                               const data_config  *cfg)
 {
-   if (tt_txn->write_cnt == TICTOC_RW_SET_SIZE_LIMIT / 2) {
+   if (!tictoc_rw_set_reserve(
+          &tt_txn->write_set, tt_txn->write_cnt, &tt_txn->write_set_size)
+       || !tictoc_write_index_reserve(tt_txn, cfg))
+   {
       return NULL;
    }
 
-   tictoc_rw_entry *new_entry             = tictoc_rw_entry_create(tt_txn);
+   tictoc_rw_entry *new_entry = tictoc_rw_entry_create(tt_txn);
+   tictoc_rw_entry_set_point_key(new_entry, user_key, cfg);
    tt_txn->write_set[tt_txn->write_cnt++] = new_entry;
+   tictoc_write_index_insert(tt_txn, new_entry, cfg);
 
    return new_entry;
 }
 
+tictoc_rw_entry *
+tictoc_find_write_set_entry(tictoc_transaction *tt_txn,
+                            slice               user_key,
+                            const data_config  *cfg)
+{
+   if (tt_txn->write_cnt == 0) {
+      return NULL;
+   }
+
+   key    ukey = key_create_from_slice(user_key);
+   uint64 slot = tictoc_write_index_slot(tt_txn, user_key, cfg);
+   for (tictoc_rw_entry *w = tt_txn->write_index[slot]; w != NULL;
+        w                  = tt_txn->write_index[slot])
+   {
+      key wkey = key_create_from_slice(writable_buffer_to_slice(&w->key));
+      if (data_key_compare(cfg, wkey, ukey) == 0) {
+         return w;
+      }
+      slot = (slot + 1) & (tt_txn->write_index_size - 1);
+   }
+   return NULL;
+}
+
 tictoc_rw_entry *
 tictoc_get_write_set_entry(tictoc_transaction *tt_txn, uint64 i)
 {
@@ -110,36 +265,27 @@ tictoc_rw_entry_is_not_in_write_set(tictoc_transaction *tt_txn,
                                     tictoc_rw_entry    *entry,
                                     const data_config  *cfg)
 {
-   slice entry_key = writable_buffer_to_slice(&entry->key);
-
-   // TODO: feel free to implement binary search
-   for (uint64 i = 0; i < tt_txn->write_cnt; ++i) {
-      tictoc_rw_entry *w    = tictoc_get_write_set_entry(tt_txn, i);
-      slice            wkey = writable_buffer_to_slice(&w->key);
-
-      if (data_key_compare(
-             cfg, key_create_from_slice(entry_key), key_create_from_slice(wkey))
-          == 0)
-      {
-         return FALSE;
-      }
-   }
-
-   return TRUE;
+   return tictoc_find_write_set_entry(
+             tt_txn, writable_buffer_to_slice(&entry->key), cfg)
+          == NULL;
 }
 
 void
 tictoc_transaction_init(tictoc_transaction         *tt_txn,
                         transaction_isolation_level isol_level)
 {
-   tt_txn->read_set           = &tt_txn->read_write_set[0];
-   const uint64 read_set_size = TICTOC_RW_SET_SIZE_LIMIT / 2;
-   tt_txn->write_set          = &tt_txn->read_write_set[read_set_size];
-   tt_txn->read_cnt           = 0;
-   tt_txn->write_cnt          = 0;
-   tt_txn->commit_rts         = 0;
-   tt_txn->commit_wts         = 0;
-   tt_txn->isol_level         = isol_level;
+   tt_txn->read_set         = NULL;
+   tt_txn->write_set        = NULL;
+   tt_txn->read_cnt         = 0;
+   tt_txn->write_cnt        = 0;
+   tt_txn->read_set_size    = 0;
+   tt_txn->write_set_size   = 0;
+   tt_txn->write_index      = NULL;
+   tt_txn->write_index_size = 0;
+   tt_txn->commit_rts       = 0;
+   tt_txn->commit_wts       = 0;
+   tt_txn->isol_level       = isol_level;
+   tt_txn->read_only        = FALSE;
 }
 
 void
@@ -156,6 +302,23 @@ tictoc_transaction_deinit(tictoc_transaction *tt_txn, lock_table *lock_tbl)
       tictoc_rw_entry_deinit(w);
       platform_free(0, w);
    }
+
+   if (tt_txn->read_set != NULL) {
+      platform_free(0, tt_txn->read_set);
+   }
+   if (tt_txn->write_set != NULL) {
+      platform_free(0, tt_txn->write_set);
+   }
+   if (tt_txn->write_index != NULL) {
+      platform_free(0, tt_txn->write_index);
+   }
+
+   // so that ending a transaction more than once is harmless
+   tt_txn->read_cnt         = 0;
+   tt_txn->write_cnt        = 0;
+   tt_txn->read_set_size    = 0;
+   tt_txn->write_set_size   = 0;
+   tt_txn->write_index_size = 0;
 }
 
 static int
@@ -183,27 +346,19 @@ tictoc_transaction_sort_write_set(tictoc_transaction *tt_txn,
                       NULL);
 }
 
-bool
+/*
+ * The write set has to be sorted, so that txns lock their keys in the same
+ * order, and never wait for each other's locks.
+ */
+void
 tictoc_transaction_lock_all_write_set(tictoc_transaction *tt_txn,
                                       lock_table         *lock_tbl)
 {
-   uint64 locked_cnt = 0;
    for (uint64 i = 0; i < tt_txn->write_cnt; ++i) {
-      lock_table_rc rc = lock_table_try_acquire_entry_lock(
+      lock_table_rc rc = lock_table_acquire_entry_lock(
          lock_tbl, tictoc_get_write_set_entry(tt_txn, i));
-      if (rc == LOCK_TABLE_RC_BUSY) {
-         for (uint64 j = 0; j < locked_cnt; ++j) {
-            lock_table_release_entry_lock(
-               lock_tbl, tictoc_get_write_set_entry(tt_txn, j));
-         }
-
-         return FALSE;
-      }
-
-      ++locked_cnt;
+      platform_assert(rc == LOCK_TABLE_RC_OK);
    }
-
-   return TRUE;
 }
 
 void
@@ -21,6 +21,23 @@ typedef struct ONDISK tictoc_tuple_header {
    char                 value[]; // value provided by application
 } tictoc_tuple_header;
 
+/*
+ * The tuple of a range in a read set: its wts is the largest of the keys read
+ * in it, and validation reads it again to compare the number of keys and a
+ * hash of them and their wts. Its last key is excluded unless last_inclusive.
+ */
+typedef struct tictoc_range_tuple {
+   tictoc_timestamp_set ts_set;
+   uint64               num_keys;
+   uint64               fingerprint;
+   bool                 last_inclusive;
+} tictoc_range_tuple;
+
+void
+tictoc_range_tuple_add_key(tictoc_range_tuple *tuple,
+                           slice               key,
+                           tictoc_timestamp    wts);
+
 tictoc_timestamp_set
 get_ts_from_tictoc_rw_entry(tictoc_rw_entry *entry);
 
@@ -30,11 +47,21 @@ void
 tictoc_rw_entry_set_point_key(tictoc_rw_entry   *entry,
                               slice              key,
                               const data_config *app_data_cfg);
+// A NULL_SLICE start or last is unbounded. The bounds can be set again, see
+// tictoc_rw_entry_set_range_start and tictoc_rw_entry_set_range_last.
 void
 tictoc_rw_entry_set_range_key(tictoc_rw_entry   *entry,
                               slice              key_start,
                               slice              key_last,
                               const data_config *app_data_cfg);
+void
+tictoc_rw_entry_set_range_start(tictoc_rw_entry   *entry,
+                                slice              key_start,
+                                const data_config *app_data_cfg);
+void
+tictoc_rw_entry_set_range_last(tictoc_rw_entry   *entry,
+                               slice              key_last,
+                               const data_config *app_data_cfg);
 
 bool
 tictoc_rw_entry_is_invalid(tictoc_rw_entry *entry);
@@ -44,6 +71,11 @@ tictoc_rw_entry_is_not_in_write_set(tictoc_transaction *tt_txn,
                                     tictoc_rw_entry    *entry,
                                     const data_config  *cfg);
 
+tictoc_rw_entry *
+tictoc_find_write_set_entry(tictoc_transaction *tt_txn,
+                            slice               user_key,
+                            const data_config  *cfg);
+
 void
 tictoc_transaction_init(tictoc_transaction         *tt_txn,
                         transaction_isolation_level isol_level);
@@ -57,8 +89,11 @@ tictoc_get_new_read_set_entry(tictoc_transaction *tt_txn);
 tictoc_rw_entry *
 tictoc_get_read_set_entry(tictoc_transaction *tt_txn, uint64 i);
 
+// The key has to be set here, since the entries are indexed by it
 tictoc_rw_entry *
-tictoc_get_new_write_set_entry(tictoc_transaction *tt_txn);
+tictoc_get_new_write_set_entry(tictoc_transaction *tt_txn,
+                               slice               user_key,
+                               const data_config  *cfg);
 
 tictoc_rw_entry *
 tictoc_get_write_set_entry(tictoc_transaction *tt_txn, uint64 i);
@@ -67,7 +102,8 @@ void
 tictoc_transaction_sort_write_set(tictoc_transaction *tt_txn,
                                   const data_config  *cfg);
 
-bool
+// Waits for any of the locks that are busy
+void
 tictoc_transaction_lock_all_write_set(tictoc_transaction *tt_txn,
                                       lock_table         *lock_tbl);
 
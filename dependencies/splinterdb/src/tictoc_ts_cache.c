@@ -0,0 +1,138 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "tictoc_ts_cache.h"
+
+#include "platform.h"
+#include "poison.h"
+
+// Longer keys are not cached. This makes a slot one cache line.
+#define TICTOC_TS_CACHE_MAX_KEY_SIZE 44
+
+/*
+ * A slot is a seqlock: seq is odd while the slot is written, and readers
+ * retry (or give up) if it changed while they read.
+ */
+typedef struct tictoc_ts_cache_slot {
+   volatile uint64      seq;
+   tictoc_timestamp_set ts_set;
+   uint32               key_length;
+   char                 key[TICTOC_TS_CACHE_MAX_KEY_SIZE];
+} PLATFORM_CACHELINE_ALIGNED tictoc_ts_cache_slot;
+
+_Static_assert(sizeof(tictoc_ts_cache_slot) == PLATFORM_CACHELINE_SIZE,
+               "A slot should be one cache line");
+
+struct tictoc_ts_cache {
+   const data_config    *app_data_cfg;
+   uint64                num_slots;
+   tictoc_ts_cache_slot *slots;
+};
+
+tictoc_ts_cache *
+tictoc_ts_cache_create(const data_config *app_data_cfg, uint64 num_slots)
+{
+   tictoc_ts_cache *cache;
+   cache               = TYPED_ZALLOC(0, cache);
+   cache->app_data_cfg = app_data_cfg;
+   cache->num_slots    = num_slots;
+   cache->slots        = TYPED_ARRAY_ZALLOC(0, cache->slots, num_slots);
+   platform_assert(cache->slots != NULL);
+   return cache;
+}
+
+void
+tictoc_ts_cache_destroy(tictoc_ts_cache *cache)
+{
+   platform_free(0, cache->slots);
+   platform_free(0, cache);
+}
+
+static tictoc_ts_cache_slot *
+tictoc_ts_cache_get_slot(tictoc_ts_cache *cache, slice user_key)
+{
+   if (slice_length(user_key) > TICTOC_TS_CACHE_MAX_KEY_SIZE) {
+      return NULL;
+   }
+   uint32 hash = cache->app_data_cfg->key_hash(
+      slice_data(user_key), slice_length(user_key), 0);
+   return &cache->slots[hash % cache->num_slots];
+}
+
+static bool
+tictoc_ts_cache_slot_has_key(const tictoc_ts_cache_slot *slot, slice user_key)
+{
+   return slot->key_length == slice_length(user_key)
+          && memcmp(slot->key, slice_data(user_key), slot->key_length) == 0;
+}
+
+// Sets a slot that is held by having made its seq odd
+static void
+tictoc_ts_cache_slot_write(tictoc_ts_cache_slot *slot,
+                           slice                 user_key,
+                           tictoc_timestamp_set  ts_set)
+{
+   slot->ts_set     = ts_set;
+   slot->key_length = slice_length(user_key);
+   memcpy(slot->key, slice_data(user_key), slot->key_length);
+   __sync_synchronize();
+   slot->seq++;
+}
+
+bool
+tictoc_ts_cache_lookup(tictoc_ts_cache      *cache,
+                       slice                 user_key,
+                       tictoc_timestamp_set *ts_set,
+                       uint64               *fill_token)
+{
+   tictoc_ts_cache_slot *slot = tictoc_ts_cache_get_slot(cache, user_key);
+   if (slot == NULL) {
+      *fill_token = 1; // odd, so that it is never filled
+      return FALSE;
+   }
+
+   uint64 seq = slot->seq;
+   __sync_synchronize();
+   bool found = (seq % 2 == 0) && tictoc_ts_cache_slot_has_key(slot, user_key);
+   *ts_set    = slot->ts_set;
+   __sync_synchronize();
+
+   *fill_token = seq;
+   return found && slot->seq == seq;
+}
+
+void
+tictoc_ts_cache_fill(tictoc_ts_cache     *cache,
+                     slice                user_key,
+                     tictoc_timestamp_set ts_set,
+                     uint64               fill_token)
+{
+   tictoc_ts_cache_slot *slot = tictoc_ts_cache_get_slot(cache, user_key);
+   if (slot == NULL || fill_token % 2 != 0
+       || !__sync_bool_compare_and_swap(&slot->seq, fill_token, fill_token + 1))
+   {
+      return;
+   }
+   tictoc_ts_cache_slot_write(slot, user_key, ts_set);
+}
+
+void
+tictoc_ts_cache_set(tictoc_ts_cache     *cache,
+                    slice                user_key,
+                    tictoc_timestamp_set ts_set)
+{
+   tictoc_ts_cache_slot *slot = tictoc_ts_cache_get_slot(cache, user_key);
+   if (slot == NULL) {
+      return;
+   }
+
+   // Other keys can share the slot, so it may be held by another writer
+   uint64 seq = slot->seq;
+   while (seq % 2 != 0
+          || !__sync_bool_compare_and_swap(&slot->seq, seq, seq + 1))
+   {
+      platform_pause();
+      seq = slot->seq;
+   }
+   tictoc_ts_cache_slot_write(slot, user_key, ts_set);
+}
@@ -0,0 +1,52 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _TICTOC_TS_CACHE_H_
+#define _TICTOC_TS_CACHE_H_
+
+#include "tictoc_data.h"
+
+/*
+ * A bounded cache of the timestamps of keys, so that commit doesn't have to
+ * look up (and copy) a whole value just to read the timestamps at its start.
+ *
+ * Each key can only be in one slot, picked by its hash, so a key evicts
+ * whatever was there before. The timestamps of a key in the cache are always
+ * the ones in splinterdb: every change to them has to go through
+ * tictoc_ts_cache_set, by the txn that holds the key's lock, while keys that
+ * are read from splinterdb are only added if no change has raced with that.
+ */
+
+typedef struct tictoc_ts_cache tictoc_ts_cache;
+
+tictoc_ts_cache *
+tictoc_ts_cache_create(const data_config *app_data_cfg, uint64 num_slots);
+
+void
+tictoc_ts_cache_destroy(tictoc_ts_cache *cache);
+
+/*
+ * Returns TRUE with the timestamps of the key if it's in the cache. Otherwise
+ * sets fill_token, to pass to tictoc_ts_cache_fill once the timestamps have
+ * been read from splinterdb.
+ */
+bool
+tictoc_ts_cache_lookup(tictoc_ts_cache      *cache,
+                       slice                 user_key,
+                       tictoc_timestamp_set *ts_set,
+                       uint64               *fill_token);
+
+// Adds the key, unless its slot has changed since the lookup
+void
+tictoc_ts_cache_fill(tictoc_ts_cache     *cache,
+                     slice                user_key,
+                     tictoc_timestamp_set ts_set,
+                     uint64               fill_token);
+
+// Records a change of the timestamps of a key, which the caller has locked
+void
+tictoc_ts_cache_set(tictoc_ts_cache     *cache,
+                    slice                user_key,
+                    tictoc_timestamp_set ts_set);
+
+#endif // _TICTOC_TS_CACHE_H_
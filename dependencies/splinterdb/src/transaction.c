@@ -1,6 +1,7 @@
 #include "splinterdb/transaction.h"
 #include "platform.h"
 #include "tictoc_data.h"
+#include "tictoc_ts_cache.h"
 #include "transaction_internal.h"
 #include "splinterdb_internal.h"
 #include "platform_linux/platform.h"
@@ -36,6 +37,23 @@ get_ts_from_splinterdb(const splinterdb     *kvsb,
    return 0;
 }
 
+/*
+ * Gets the timestamps of a key from the cache of them, or from splinterdb
+ * (and adds them to the cache) if they aren't there
+ */
+static void
+tictoc_get_ts(transactional_splinterdb *txn_kvsb,
+              slice                     key,
+              tictoc_timestamp_set     *ts)
+{
+   uint64 fill_token;
+   if (tictoc_ts_cache_lookup(txn_kvsb->ts_cache, key, ts, &fill_token)) {
+      return;
+   }
+   get_ts_from_splinterdb(txn_kvsb->kvsb, key, ts);
+   tictoc_ts_cache_fill(txn_kvsb->ts_cache, key, *ts, fill_token);
+}
+
 static inline bool
 is_serializable(tictoc_transaction *tt_txn)
 {
@@ -58,49 +76,83 @@ is_repeatable_read(tictoc_transaction *tt_txn)
  * Algorithm 1: Read Phase
  */
 
-static int
-tictoc_read(transactional_splinterdb *txn_kvsb,
-            tictoc_transaction       *tt_txn,
-            slice                     user_key,
-            splinterdb_lookup_result *result)
+/*
+ * Serves a read from the txn's own write set, if it has written the key.
+ * Returns TRUE if it did.
+ */
+static bool
+tictoc_read_from_write_set(transactional_splinterdb *txn_kvsb,
+                           tictoc_transaction       *tt_txn,
+                           slice                     user_key,
+                           splinterdb_lookup_result *result)
 {
-   key ukey = key_create_from_slice(user_key);
-   for (uint64 i = 0; i < tt_txn->write_cnt; ++i) {
-      tictoc_rw_entry *w = tictoc_get_write_set_entry(tt_txn, i);
-      platform_assert(!tictoc_rw_entry_is_invalid(w));
-
-      if (data_key_compare(
-             txn_kvsb->tcfg->kvsb_cfg.data_cfg,
-             ukey,
-             key_create_from_slice(writable_buffer_to_slice(&w->key)))
-          == 0)
-      {
-         tictoc_tuple_header *tuple = writable_buffer_data(&w->tuple);
-         uint64               app_value_size =
-            writable_buffer_length(&w->tuple) - sizeof(tictoc_tuple_header);
-         _splinterdb_lookup_result *_result =
-            (_splinterdb_lookup_result *)result;
-         merge_accumulator_resize(&_result->value, app_value_size);
-         memcpy(merge_accumulator_data(&_result->value),
-                tuple->value,
-                app_value_size);
-
-         tictoc_rw_entry *r = tictoc_get_new_read_set_entry(tt_txn);
-         platform_assert(!tictoc_rw_entry_is_invalid(r));
-         writable_buffer_init_from_slice(
-            &r->tuple, 0, writable_buffer_to_slice(&w->tuple));
-         tictoc_rw_entry_set_point_key(
-            r, user_key, txn_kvsb->tcfg->kvsb_cfg.data_cfg);
-         tuple = writable_buffer_data(&r->tuple);
-         get_ts_from_splinterdb(txn_kvsb->kvsb, user_key, &tuple->ts_set);
-
-         return 0;
-      }
+   tictoc_rw_entry *w = tictoc_find_write_set_entry(
+      tt_txn, user_key, txn_kvsb->tcfg->kvsb_cfg.data_cfg);
+   if (w == NULL) {
+      return FALSE;
    }
 
-   int rc = splinterdb_lookup(txn_kvsb->kvsb, user_key, result);
+   tictoc_tuple_header *tuple = writable_buffer_data(&w->tuple);
+   uint64               app_value_size =
+      writable_buffer_length(&w->tuple) - sizeof(tictoc_tuple_header);
+   _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)result;
+   merge_accumulator_resize(&_result->value, app_value_size);
+   memcpy(
+      merge_accumulator_data(&_result->value), tuple->value, app_value_size);
+
+   tictoc_rw_entry *r = tictoc_get_new_read_set_entry(tt_txn);
+   platform_assert(!tictoc_rw_entry_is_invalid(r));
+   writable_buffer_init_from_slice(
+      &r->tuple, 0, writable_buffer_to_slice(&w->tuple));
+   tictoc_rw_entry_set_point_key(
+      r, user_key, txn_kvsb->tcfg->kvsb_cfg.data_cfg);
+   tuple = writable_buffer_data(&r->tuple);
+   tictoc_get_ts(txn_kvsb, user_key, &tuple->ts_set);
+
+   return TRUE;
+}
+
+/*
+ * Records that a key was not found, as a point read of it with a wts of 0.
+ * Validation checks that it is still absent, like any other point read, but
+ * as it has no rts to extend, later inserts of it are kept after the txn by
+ * range_rts instead.
+ */
+static void
+tictoc_read_set_add_absent_key(transactional_splinterdb *txn_kvsb,
+                               tictoc_transaction       *tt_txn,
+                               slice                     user_key)
+{
+   tictoc_rw_entry *r = tictoc_get_new_read_set_entry(tt_txn);
+   platform_assert(!tictoc_rw_entry_is_invalid(r));
+   writable_buffer_init(&r->tuple, 0);
+   writable_buffer_resize(&r->tuple, sizeof(tictoc_tuple_header));
+   tictoc_tuple_header *tuple = writable_buffer_data(&r->tuple);
+   tuple->ts_set              = ZERO_TICTOC_TIMESTAMP_SET;
+   tictoc_rw_entry_set_point_key(
+      r, user_key, txn_kvsb->tcfg->kvsb_cfg.data_cfg);
+}
+
+/*
+ * Finishes a read once the lookup in splinterdb is done: records the tuple
+ * (with its timestamps) in the read set, or that the key is absent, and
+ * strips the timestamps from the result.
+ */
+static void
+tictoc_read_finish(transactional_splinterdb *txn_kvsb,
+                   tictoc_transaction       *tt_txn,
+                   slice                     user_key,
+                   splinterdb_lookup_result *result)
+{
+   if (!splinterdb_lookup_found(result)) {
+      if (!tt_txn->read_only) {
+         tictoc_read_set_add_absent_key(txn_kvsb, tt_txn, user_key);
+      }
+      return;
+   }
 
-   if (splinterdb_lookup_found(result)) {
+   if (!tt_txn->read_only) {
+      // read-only txns have nothing to validate, so they don't keep a read set
       tictoc_rw_entry *r = tictoc_get_new_read_set_entry(tt_txn);
       platform_assert(!tictoc_rw_entry_is_invalid(r));
 
@@ -109,16 +161,45 @@ tictoc_read(transactional_splinterdb *txn_kvsb,
       writable_buffer_init_from_slice(&r->tuple, 0, value);
       tictoc_rw_entry_set_point_key(
          r, user_key, txn_kvsb->tcfg->kvsb_cfg.data_cfg);
+   }
+
+   _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)result;
+   uint64 app_value_size = merge_accumulator_length(&_result->value)
+                           - sizeof(tictoc_tuple_header);
+   tictoc_tuple_header *tuple = merge_accumulator_data(&_result->value);
+   memmove(tuple, tuple->value, app_value_size);
+   merge_accumulator_resize(&_result->value, app_value_size);
+}
 
-      tictoc_tuple_header       *tuple   = writable_buffer_data(&r->tuple);
-      _splinterdb_lookup_result *_result = (_splinterdb_lookup_result *)result;
-      uint64 app_value_size = merge_accumulator_length(&_result->value)
-                              - sizeof(tictoc_tuple_header);
-      memmove(
-         merge_accumulator_data(&_result->value), tuple->value, app_value_size);
-      merge_accumulator_resize(&_result->value, app_value_size);
+static int
+tictoc_read(transactional_splinterdb *txn_kvsb,
+            tictoc_transaction       *tt_txn,
+            slice                     user_key,
+            splinterdb_lookup_result *result)
+{
+   if (!tt_txn->read_only
+       && tictoc_read_from_write_set(txn_kvsb, tt_txn, user_key, result))
+   {
+      return 0;
    }
 
+   // The lookup reads the timestamps anyway, so it fills the cache as well
+   tictoc_timestamp_set ts;
+   uint64               fill_token;
+   bool                 is_cached =
+      tictoc_ts_cache_lookup(txn_kvsb->ts_cache, user_key, &ts, &fill_token);
+
+   int rc = splinterdb_lookup(txn_kvsb->kvsb, user_key, result);
+   if (rc == 0 && !is_cached) {
+      ts = ZERO_TICTOC_TIMESTAMP_SET;
+      if (splinterdb_lookup_found(result)) {
+         slice value;
+         splinterdb_lookup_result_value(result, &value);
+         memcpy(&ts, slice_data(value), sizeof(tictoc_timestamp_set));
+      }
+      tictoc_ts_cache_fill(txn_kvsb->ts_cache, user_key, ts, fill_token);
+   }
+   tictoc_read_finish(txn_kvsb, tt_txn, user_key, result);
    return rc;
 }
 
@@ -187,8 +268,8 @@ tictoc_validation(transactional_splinterdb *txn_kvsb,
             return FALSE;
          }
 
-         uint32 new_rts = MAX(tt_txn->commit_rts, tuple_ts.rts);
-         bool   need_to_update_rts =
+         tictoc_timestamp new_rts = MAX(tt_txn->commit_rts, tuple_ts.rts);
+         bool             need_to_update_rts =
             (new_rts != tuple_ts.rts) && !is_repeatable_read(tt_txn);
          if (need_to_update_rts) {
             writable_buffer ts;
@@ -206,6 +287,71 @@ tictoc_validation(transactional_splinterdb *txn_kvsb,
 }
 */
 
+/*
+ * Makes writes that commit from here on get a wts after commit_ts, as they
+ * could be to a key a txn found missing, or to one in a range it read.
+ */
+static void
+tictoc_extend_range_rts(transactional_splinterdb *txn_kvsb, uint64 commit_ts)
+{
+   uint64 range_rts = txn_kvsb->range_rts;
+   while (range_rts < commit_ts
+          && !__sync_bool_compare_and_swap(
+             &txn_kvsb->range_rts, range_rts, commit_ts))
+   {
+      range_rts = txn_kvsb->range_rts;
+   }
+}
+
+/*
+ * Validates a range in the read set. It is locked to keep writers out of it,
+ * and read again, which has to find the same keys with the same wts. Writes
+ * to it after that get a wts after commit_ts, see range_rts.
+ */
+static bool
+tictoc_validate_range(transactional_splinterdb *txn_kvsb,
+                      tictoc_rw_entry          *r,
+                      uint64                    commit_ts)
+{
+   lock_table_rc rc = lock_table_try_acquire_entry_lock(txn_kvsb->lock_tbl, r);
+   if (rc == LOCK_TABLE_RC_BUSY) {
+      return FALSE;
+   }
+
+   const tictoc_range_tuple *read_tuple = writable_buffer_data(&r->tuple);
+   tictoc_range_tuple        tuple      = {0};
+   splinterdb_iterator      *iter;
+   int                       iter_rc =
+      splinterdb_iterator_init_range(txn_kvsb->kvsb,
+                                     &iter,
+                                     writable_buffer_to_slice(&r->key),
+                                     writable_buffer_to_slice(&r->key_last),
+                                     read_tuple->last_inclusive);
+   bool is_valid = (iter_rc == 0);
+   if (is_valid) {
+      for (; splinterdb_iterator_valid(iter)
+             && tuple.num_keys <= read_tuple->num_keys;
+           splinterdb_iterator_next(iter))
+      {
+         slice key, value;
+         splinterdb_iterator_get_current(iter, &key, &value);
+         const tictoc_tuple_header *header = slice_data(value);
+         tictoc_range_tuple_add_key(&tuple, key, header->ts_set.wts);
+      }
+      is_valid = splinterdb_iterator_status(iter) == 0
+                 && tuple.num_keys == read_tuple->num_keys
+                 && tuple.fingerprint == read_tuple->fingerprint;
+      splinterdb_iterator_deinit(iter);
+   }
+
+   if (is_valid) {
+      tictoc_extend_range_rts(txn_kvsb, commit_ts);
+   }
+
+   lock_table_release_entry_lock(txn_kvsb->lock_tbl, r);
+   return is_valid;
+}
+
 /*
  * Algorithm 3: Write Phase
  */
@@ -249,86 +395,106 @@ tictoc_write(transactional_splinterdb *txn_kvsb, tictoc_transaction *tt_txn)
 
       platform_assert(rc == 0, "Error from SplinterDB: %d\n", rc);
 
+      // A deleted key reads as having no timestamps
+      tictoc_ts_cache_set(txn_kvsb->ts_cache,
+                          wkey,
+                          w->op == MESSAGE_TYPE_DELETE
+                             ? ZERO_TICTOC_TIMESTAMP_SET
+                             : write_entry_ts);
+
       writable_buffer_deinit(&w->tuple);
    }
 }
 
+/*
+ * Sets the tuple of a write set entry to the timestamps, followed by prefix
+ * and value
+ */
+static void
+tictoc_rw_entry_set_tuple(tictoc_rw_entry     *w,
+                          tictoc_timestamp_set ts_set,
+                          slice                prefix,
+                          slice                value)
+{
+   writable_buffer_resize(&w->tuple,
+                          sizeof(tictoc_timestamp_set) + slice_length(prefix)
+                             + slice_length(value));
+
+   tictoc_tuple_header *tuple = writable_buffer_data(&w->tuple);
+
+   memcpy(&tuple->ts_set, &ts_set, sizeof(tictoc_timestamp_set));
+   memcpy(tuple->value, slice_data(prefix), slice_length(prefix));
+   memcpy(tuple->value + slice_length(prefix),
+          slice_data(value),
+          slice_length(value));
+}
+
+/*
+ * A definitive message (an insert) can have its value split in a prefix and
+ * the rest, which are put together in the tuple.
+ */
 static int
 tictoc_local_write(transactional_splinterdb *txn_kvsb,
                    tictoc_transaction       *txn,
                    tictoc_timestamp_set      ts_set,
                    slice                     user_key,
+                   slice                     prefix,
                    message                   msg)
 {
-   const data_config *cfg =
-      txn_kvsb->tcfg->txn_data_cfg->application_data_config;
-
-   key ukey = key_create_from_slice(user_key);
-   // TODO: this part can be done by binary search if the write_set is sorted
-   for (uint64 i = 0; i < txn->write_cnt; ++i) {
-      tictoc_rw_entry *w = tictoc_get_write_set_entry(txn, i);
-      key wkey = key_create_from_slice(writable_buffer_to_slice(&w->key));
-      if (data_key_compare(cfg, wkey, ukey) == 0) {
-         if (message_is_definitive(msg)) {
-            w->op = message_class(msg);
+   platform_assert(slice_is_null(prefix) || message_is_definitive(msg));
 
-            slice value = message_slice(msg);
-            writable_buffer_resize(
-               &w->tuple, sizeof(tictoc_timestamp_set) + slice_length(value));
-
-            tictoc_tuple_header *tuple = writable_buffer_data(&w->tuple);
+   if (txn->read_only) {
+      return EINVAL;
+   }
 
-            memcpy(&tuple->ts_set, &ts_set, sizeof(tictoc_timestamp_set));
-            memcpy(tuple->value, slice_data(value), slice_length(value));
-         } else {
-            platform_assert(w->op != MESSAGE_TYPE_DELETE);
+   const data_config *cfg =
+      txn_kvsb->tcfg->txn_data_cfg->application_data_config;
 
-            merge_accumulator new_message;
-            merge_accumulator_init_from_message(&new_message, 0, msg);
+   key              ukey = key_create_from_slice(user_key);
+   tictoc_rw_entry *w    = tictoc_find_write_set_entry(txn, user_key, cfg);
+   if (w != NULL) {
+      if (message_is_definitive(msg)) {
+         w->op = message_class(msg);
+         tictoc_rw_entry_set_tuple(w, ts_set, prefix, message_slice(msg));
+      } else {
+         platform_assert(w->op != MESSAGE_TYPE_DELETE);
 
-            tictoc_tuple_header *tuple = writable_buffer_data(&w->tuple);
-            slice   old_value   = slice_create(writable_buffer_length(&w->tuple)
-                                              - sizeof(tictoc_tuple_header),
-                                           tuple->value);
-            message old_message = message_create(w->op, old_value);
+         merge_accumulator new_message;
+         merge_accumulator_init_from_message(&new_message, 0, msg);
 
-            data_merge_tuples(cfg, ukey, old_message, &new_message);
+         tictoc_tuple_header *tuple = writable_buffer_data(&w->tuple);
+         slice   old_value   = slice_create(writable_buffer_length(&w->tuple)
+                                           - sizeof(tictoc_tuple_header),
+                                        tuple->value);
+         message old_message = message_create(w->op, old_value);
 
-            writable_buffer_resize(&w->tuple,
-                                   sizeof(tictoc_timestamp_set)
-                                      + merge_accumulator_length(&new_message));
+         data_merge_tuples(cfg, ukey, old_message, &new_message);
 
-            tuple = writable_buffer_data(&w->tuple);
+         writable_buffer_resize(&w->tuple,
+                                sizeof(tictoc_timestamp_set)
+                                   + merge_accumulator_length(&new_message));
 
-            memcpy(&tuple->ts_set, &ts_set, sizeof(tictoc_timestamp_set));
-            memcpy(tuple->value,
-                   merge_accumulator_data(&new_message),
-                   merge_accumulator_length(&new_message));
+         tuple = writable_buffer_data(&w->tuple);
 
-            merge_accumulator_deinit(&new_message);
-         }
+         memcpy(&tuple->ts_set, &ts_set, sizeof(tictoc_timestamp_set));
+         memcpy(tuple->value,
+                merge_accumulator_data(&new_message),
+                merge_accumulator_length(&new_message));
 
-         return 0;
+         merge_accumulator_deinit(&new_message);
       }
+
+      return 0;
    }
 
-   tictoc_rw_entry *w = tictoc_get_new_write_set_entry(txn);
+   w = tictoc_get_new_write_set_entry(
+      txn, user_key, txn_kvsb->tcfg->kvsb_cfg.data_cfg);
    platform_assert(!tictoc_rw_entry_is_invalid(w));
 
    w->op = message_class(msg);
-   tictoc_rw_entry_set_point_key(
-      w, user_key, txn_kvsb->tcfg->kvsb_cfg.data_cfg);
-
-   slice value = message_slice(msg);
 
    writable_buffer_init(&w->tuple, 0); // FIXME: use a correct heap_id
-   writable_buffer_resize(&w->tuple,
-                          sizeof(tictoc_timestamp_set) + slice_length(value));
-
-   tictoc_tuple_header *tuple = writable_buffer_data(&w->tuple);
-
-   memcpy(&tuple->ts_set, &ts_set, sizeof(tictoc_timestamp_set));
-   memcpy(tuple->value, slice_data(value), slice_length(value));
+   tictoc_rw_entry_set_tuple(w, ts_set, prefix, message_slice(msg));
 
    return 0;
 }
@@ -366,6 +532,8 @@ transactional_splinterdb_create_or_open(const splinterdb_config   *kvsb_cfg,
    }
 
    _txn_kvsb->lock_tbl = lock_table_create();
+   _txn_kvsb->ts_cache = tictoc_ts_cache_create(kvsb_cfg->data_cfg,
+                                                TICTOC_TS_CACHE_NUM_SLOTS);
 
    *txn_kvsb = _txn_kvsb;
 
@@ -394,6 +562,7 @@ transactional_splinterdb_close(transactional_splinterdb **txn_kvsb)
    splinterdb_close(&_txn_kvsb->kvsb);
 
    lock_table_destroy(_txn_kvsb->lock_tbl);
+   tictoc_ts_cache_destroy(_txn_kvsb->ts_cache);
 
    platform_free(0, _txn_kvsb->tcfg->txn_data_cfg);
    platform_free(0, _txn_kvsb->tcfg);
@@ -422,6 +591,15 @@ transactional_splinterdb_begin(transactional_splinterdb *txn_kvsb,
    return 0;
 }
 
+int
+transactional_splinterdb_begin_read_only(transactional_splinterdb *txn_kvsb,
+                                         transaction              *txn)
+{
+   tictoc_transaction_init(&txn->tictoc, txn_kvsb->tcfg->isol_level);
+   txn->tictoc.read_only = TRUE;
+   return 0;
+}
+
 int
 transactional_splinterdb_commit(transactional_splinterdb *txn_kvsb,
                                 transaction              *txn)
@@ -456,34 +634,40 @@ transactional_splinterdb_commit(transactional_splinterdb *txn_kvsb,
 
    tictoc_transaction_sort_write_set(tt_txn, txn_kvsb->tcfg->kvsb_cfg.data_cfg);
 
-   while (tictoc_transaction_lock_all_write_set(tt_txn, txn_kvsb->lock_tbl)
-          == FALSE)
-   {
-      platform_sleep_ns(
-         1000); // 1us is the value that is mentioned in the paper
-   }
+   tictoc_transaction_lock_all_write_set(tt_txn, txn_kvsb->lock_tbl);
 
    for (uint64 i = 0; i < tt_txn->write_cnt; ++i) {
       tictoc_rw_entry     *w = tictoc_get_write_set_entry(tt_txn, i);
       tictoc_timestamp_set tuple_ts;
-      get_ts_from_splinterdb(
-         txn_kvsb->kvsb, writable_buffer_to_slice(&w->key), &tuple_ts);
+      tictoc_get_ts(txn_kvsb, writable_buffer_to_slice(&w->key), &tuple_ts);
       tt_txn->commit_wts = MAX(tt_txn->commit_wts, tuple_ts.rts + 1);
    }
+   if (tt_txn->write_cnt > 0) {
+      tt_txn->commit_wts = MAX(tt_txn->commit_wts, txn_kvsb->range_rts + 1);
+   }
 
    uint64 commit_ts =
       is_snapshot_isolation(tt_txn) ? tt_txn->commit_rts : tt_txn->commit_wts;
 
    bool is_aborted = FALSE;
    for (uint64 i = 0; i < tt_txn->read_cnt; ++i) {
-      tictoc_rw_entry     *r             = tictoc_get_read_set_entry(tt_txn, i);
+      tictoc_rw_entry *r = tictoc_get_read_set_entry(tt_txn, i);
+      if (r->is_range) {
+         // there is no rts to go by, so ranges are always validated
+         if (!tictoc_validate_range(txn_kvsb, r, commit_ts)) {
+            is_aborted = TRUE;
+            break;
+         }
+         continue;
+      }
+
       slice                rkey          = writable_buffer_to_slice(&r->key);
       tictoc_timestamp_set read_entry_ts = get_ts_from_tictoc_rw_entry(r);
 
       bool is_read_entry_invalid = read_entry_ts.rts < commit_ts;
       if (is_read_entry_invalid) {
          tictoc_timestamp_set tuple_ts;
-         get_ts_from_splinterdb(txn_kvsb->kvsb, rkey, &tuple_ts);
+         tictoc_get_ts(txn_kvsb, rkey, &tuple_ts);
 
          if (tuple_ts.wts != read_entry_ts.wts) {
             is_aborted = TRUE;
@@ -498,7 +682,7 @@ transactional_splinterdb_commit(transactional_splinterdb *txn_kvsb,
          }
 
          if (rc != LOCK_TABLE_RC_DEADLK) {
-            get_ts_from_splinterdb(txn_kvsb->kvsb, rkey, &tuple_ts);
+            tictoc_get_ts(txn_kvsb, rkey, &tuple_ts);
          }
 
          if (tuple_ts.wts != read_entry_ts.wts) {
@@ -507,14 +691,19 @@ transactional_splinterdb_commit(transactional_splinterdb *txn_kvsb,
             break;
          }
 
-         uint32 new_rts = MAX(commit_ts, tuple_ts.rts);
-         if (new_rts > tuple_ts.rts) {
+         tictoc_timestamp new_rts = MAX(commit_ts, tuple_ts.rts);
+         if (read_entry_ts.wts == 0) {
+            // the key is still missing, and there is no tuple to keep a rts
+            tictoc_extend_range_rts(txn_kvsb, commit_ts);
+         } else if (new_rts > tuple_ts.rts) {
             writable_buffer ts;
             writable_buffer_init(&ts, 0);
             writable_buffer_append(&ts, sizeof(tictoc_timestamp), &new_rts);
             splinterdb_update(
                txn_kvsb->kvsb, rkey, writable_buffer_to_slice(&ts));
             writable_buffer_deinit(&ts);
+            tuple_ts.rts = new_rts;
+            tictoc_ts_cache_set(txn_kvsb->ts_cache, rkey, tuple_ts);
          }
 
          lock_table_release_entry_lock(txn_kvsb->lock_tbl, r);
@@ -550,6 +739,22 @@ transactional_splinterdb_insert(transactional_splinterdb *txn_kvsb,
                              &txn->tictoc,
                              ZERO_TICTOC_TIMESTAMP_SET,
                              user_key,
+                             NULL_SLICE,
+                             message_create(MESSAGE_TYPE_INSERT, value));
+}
+
+int
+transactional_splinterdb_insert_with_prefix(transactional_splinterdb *txn_kvsb,
+                                            transaction              *txn,
+                                            slice                     user_key,
+                                            slice                     prefix,
+                                            slice                     value)
+{
+   return tictoc_local_write(txn_kvsb,
+                             &txn->tictoc,
+                             ZERO_TICTOC_TIMESTAMP_SET,
+                             user_key,
+                             prefix,
                              message_create(MESSAGE_TYPE_INSERT, value));
 }
 
@@ -562,6 +767,7 @@ transactional_splinterdb_delete(transactional_splinterdb *txn_kvsb,
                              &txn->tictoc,
                              ZERO_TICTOC_TIMESTAMP_SET,
                              user_key,
+                             NULL_SLICE,
                              DELETE_MESSAGE);
 }
 
@@ -575,6 +781,7 @@ transactional_splinterdb_update(transactional_splinterdb *txn_kvsb,
                              &txn->tictoc,
                              ZERO_TICTOC_TIMESTAMP_SET,
                              user_key,
+                             NULL_SLICE,
                              message_create(MESSAGE_TYPE_UPDATE, delta));
 }
 
@@ -587,6 +794,300 @@ transactional_splinterdb_lookup(transactional_splinterdb *txn_kvsb,
    return tictoc_read(txn_kvsb, &txn->tictoc, user_key, result);
 }
 
+int
+transactional_splinterdb_lookup_async(transactional_splinterdb *txn_kvsb,
+                                      transaction              *txn,
+                                      slice                     user_key,
+                                      splinterdb_lookup_result *result,
+                                      splinterdb_async_lookup  *ctxt)
+{
+   tictoc_transaction *tt_txn = &txn->tictoc;
+   if (!tt_txn->read_only && !splinterdb_async_lookup_started(ctxt)
+       && tictoc_read_from_write_set(txn_kvsb, tt_txn, user_key, result))
+   {
+      return 0;
+   }
+
+   int rc = splinterdb_lookup_async(txn_kvsb->kvsb, user_key, result, ctxt);
+   if (rc == 0) {
+      tictoc_read_finish(txn_kvsb, tt_txn, user_key, result);
+   }
+   return rc;
+}
+
+int
+transactional_splinterdb_async_lookup_create(
+   transactional_splinterdb *txn_kvsb,
+   splinterdb_async_cb       cb,
+   void                     *cb_arg,
+   splinterdb_async_lookup **ctxt_out)
+{
+   return splinterdb_async_lookup_create(txn_kvsb->kvsb, cb, cb_arg, ctxt_out);
+}
+
+void
+transactional_splinterdb_async_lookup_destroy(
+   transactional_splinterdb *txn_kvsb,
+   splinterdb_async_lookup  *ctxt)
+{
+   splinterdb_async_lookup_destroy(txn_kvsb->kvsb, ctxt);
+}
+
+void
+transactional_splinterdb_async_poll(transactional_splinterdb *txn_kvsb)
+{
+   splinterdb_async_poll(txn_kvsb->kvsb);
+}
+
+int
+transactional_splinterdb_iterator_init(transactional_splinterdb *txn_kvsb,
+                                       splinterdb_iterator     **iter,
+                                       slice                     start_key,
+                                       slice                     end_key,
+                                       int32                     end_inclusive)
+{
+   return splinterdb_iterator_init_range(
+      txn_kvsb->kvsb, iter, start_key, end_key, end_inclusive);
+}
+
+int
+transactional_splinterdb_iterator_init_reverse(
+   transactional_splinterdb *txn_kvsb,
+   splinterdb_iterator     **iter,
+   slice                     start_key,
+   slice                     end_key,
+   int32                     end_inclusive)
+{
+   return splinterdb_iterator_init_reverse(
+      txn_kvsb->kvsb, iter, start_key, end_key, end_inclusive);
+}
+
+void
+transactional_splinterdb_iterator_get_current(splinterdb_iterator *iter,
+                                              slice               *key,
+                                              slice               *value)
+{
+   slice tuple;
+   splinterdb_iterator_get_current(iter, key, &tuple);
+   platform_assert(slice_length(tuple) >= sizeof(tictoc_tuple_header));
+   const tictoc_tuple_header *header = slice_data(tuple);
+   *value = slice_create(slice_length(tuple) - sizeof(tictoc_tuple_header),
+                         header->value);
+}
+
+struct transactional_iterator {
+   splinterdb_iterator *iter;
+   const data_config   *cfg;
+   // The txn the scans are recorded in, NULL if it doesn't keep a read set
+   tictoc_transaction *tt_txn;
+   // The read set entry for the part of the range the iterator has stepped
+   // over since it was last positioned, NULL if the txn doesn't keep one
+   tictoc_rw_entry *range;
+   // Where the iteration starts and ends (the start and end keys, swapped in
+   // reverse), the entry is extended to the end once the iterator gets there
+   writable_buffer scan_begin;
+   writable_buffer scan_end;
+   bool            end_inclusive;
+   bool            reverse;
+};
+
+/*
+ * Extends the txn's range entry over the key the iterator is at, or over the
+ * rest of the range once the iterator has passed its last key.
+ */
+static void
+transactional_iterator_record(transactional_iterator *iter)
+{
+   if (iter->range == NULL) {
+      return;
+   }
+
+   tictoc_range_tuple *tuple = writable_buffer_data(&iter->range->tuple);
+   bool                is_at_key = splinterdb_iterator_valid(iter->iter);
+   slice               bound;
+   if (is_at_key) {
+      slice value;
+      splinterdb_iterator_get_current(iter->iter, &bound, &value);
+      const tictoc_tuple_header *header = slice_data(value);
+      tictoc_range_tuple_add_key(tuple, bound, header->ts_set.wts);
+   } else if (splinterdb_iterator_status(iter->iter) == 0) {
+      bound = writable_buffer_to_slice(&iter->scan_end);
+   } else {
+      // the keys read before the error are still covered
+      return;
+   }
+
+   if (iter->reverse) {
+      tictoc_rw_entry_set_range_start(iter->range, bound, iter->cfg);
+   } else {
+      tictoc_rw_entry_set_range_last(iter->range, bound, iter->cfg);
+      tuple->last_inclusive = is_at_key || iter->end_inclusive;
+   }
+}
+
+/*
+ * Starts a new read set entry for a scan from scan_start, where the iterator
+ * has just been positioned. The entries of earlier scans stay in the read set,
+ * since the keys they covered have been read.
+ */
+static void
+transactional_iterator_start_range(transactional_iterator *iter,
+                                   slice                   scan_start,
+                                   bool                    start_inclusive)
+{
+   if (iter->tt_txn == NULL) {
+      return;
+   }
+
+   iter->range = tictoc_get_new_read_set_entry(iter->tt_txn);
+   platform_assert(!tictoc_rw_entry_is_invalid(iter->range));
+   writable_buffer_init(&iter->range->tuple, 0);
+   writable_buffer_resize(&iter->range->tuple, sizeof(tictoc_range_tuple));
+   tictoc_range_tuple *tuple = writable_buffer_data(&iter->range->tuple);
+   memset(tuple, 0, sizeof(*tuple));
+
+   // starts out empty where the iterator starts
+   tictoc_rw_entry_set_range_key(
+      iter->range, scan_start, scan_start, iter->cfg);
+   tuple->last_inclusive = iter->reverse ? start_inclusive : TRUE;
+   transactional_iterator_record(iter);
+}
+
+int
+transactional_iterator_init(transactional_splinterdb *txn_kvsb,
+                            transaction              *txn,
+                            transactional_iterator  **iter,
+                            slice                     start_key,
+                            slice                     end_key,
+                            int32                     end_inclusive,
+                            int32                     reverse)
+{
+   transactional_iterator *it;
+   it = TYPED_ZALLOC(0, it);
+   if (it == NULL) {
+      return ENOMEM;
+   }
+
+   int rc = reverse ? splinterdb_iterator_init_reverse(txn_kvsb->kvsb,
+                                                       &it->iter,
+                                                       start_key,
+                                                       end_key,
+                                                       end_inclusive)
+                    : splinterdb_iterator_init_range(txn_kvsb->kvsb,
+                                                     &it->iter,
+                                                     start_key,
+                                                     end_key,
+                                                     end_inclusive);
+   if (rc != 0) {
+      platform_free(0, it);
+      return rc;
+   }
+
+   it->cfg           = txn_kvsb->tcfg->kvsb_cfg.data_cfg;
+   it->tt_txn        = txn->tictoc.read_only ? NULL : &txn->tictoc;
+   it->end_inclusive = end_inclusive;
+   it->reverse       = reverse;
+   writable_buffer_init(&it->scan_begin, 0);
+   writable_buffer_init(&it->scan_end, 0);
+   slice scan_start = reverse ? end_key : start_key;
+   slice scan_end   = reverse ? start_key : end_key;
+   if (!slice_is_null(scan_start)) {
+      writable_buffer_copy_slice(&it->scan_begin, scan_start);
+   }
+   if (!slice_is_null(scan_end)) {
+      writable_buffer_copy_slice(&it->scan_end, scan_end);
+   }
+
+   transactional_iterator_start_range(it, scan_start, end_inclusive);
+
+   *iter = it;
+   return 0;
+}
+
+int
+transactional_iterator_seek(transactional_iterator *iter, slice key)
+{
+   int rc = splinterdb_iterator_seek(iter->iter, key);
+   if (rc != 0) {
+      return rc;
+   }
+   if (slice_is_null(key)) {
+      slice scan_start = writable_buffer_to_slice(&iter->scan_begin);
+      transactional_iterator_start_range(
+         iter, scan_start, iter->end_inclusive);
+   } else {
+      transactional_iterator_start_range(iter, key, TRUE);
+   }
+   return 0;
+}
+
+void
+transactional_iterator_release(transactional_iterator *iter)
+{
+   splinterdb_iterator_release(iter->iter);
+}
+
+int32
+transactional_iterator_valid(transactional_iterator *iter)
+{
+   return splinterdb_iterator_valid(iter->iter);
+}
+
+void
+transactional_iterator_next(transactional_iterator *iter)
+{
+   if (iter->reverse) {
+      splinterdb_iterator_prev(iter->iter);
+   } else {
+      splinterdb_iterator_next(iter->iter);
+   }
+   transactional_iterator_record(iter);
+}
+
+void
+transactional_iterator_get_current(transactional_iterator *iter,
+                                   slice                  *key,
+                                   slice                  *value)
+{
+   transactional_splinterdb_iterator_get_current(iter->iter, key, value);
+}
+
+int
+transactional_iterator_status(const transactional_iterator *iter)
+{
+   return splinterdb_iterator_status(iter->iter);
+}
+
+void
+transactional_iterator_deinit(transactional_iterator *iter)
+{
+   splinterdb_iterator_deinit(iter->iter);
+   writable_buffer_deinit(&iter->scan_begin);
+   writable_buffer_deinit(&iter->scan_end);
+   platform_free(0, iter);
+}
+
+int
+transactional_splinterdb_count_range(transactional_splinterdb *txn_kvsb,
+                                     slice                     start_key,
+                                     slice                     end_key,
+                                     int32                     end_inclusive,
+                                     splinterdb_count_mode     mode,
+                                     uint64                   *count)
+{
+   return splinterdb_count_range(
+      txn_kvsb->kvsb, start_key, end_key, end_inclusive, mode, count);
+}
+
+int
+transactional_splinterdb_approximate_size(transactional_splinterdb *txn_kvsb,
+                                          slice                     start_key,
+                                          slice                     end_key,
+                                          uint64                   *size)
+{
+   return splinterdb_approximate_size(txn_kvsb->kvsb, start_key, end_key, size);
+}
+
 void
 transactional_splinterdb_lookup_result_init(
    transactional_splinterdb *txn_kvsb,   // IN
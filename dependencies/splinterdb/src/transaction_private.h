@@ -4,6 +4,10 @@
 #include "platform.h"
 #include "transactional_data_config.h"
 #include "tictoc_data.h"
+#include "tictoc_ts_cache.h"
+
+// The number of keys whose timestamps are cached, see tictoc_ts_cache
+#define TICTOC_TS_CACHE_NUM_SLOTS (1 << 16)
 
 typedef struct transactional_splinterdb_config {
    splinterdb_config           kvsb_cfg;
@@ -15,7 +19,12 @@ typedef struct transactional_splinterdb {
    splinterdb                      *kvsb;
    transactional_splinterdb_config *tcfg;
    lock_table                      *lock_tbl;
+   tictoc_ts_cache                 *ts_cache;
    platform_mutex                   g_lock;
+   // The latest commit ts of the txns that have read a range or a missing key.
+   // Writes get a later wts, since they could be to a key in one of the ranges
+   // or to the missing key, which doesn't have a rts of its own to go by.
+   volatile uint64                  range_rts;
 } transactional_splinterdb;
 
 
@@ -1209,7 +1209,7 @@ trunk_set_initial_pivots(trunk_handle *spl, trunk_node *node)
    copy_key_to_ondisk_key(&pdata->pivot, POSITIVE_INFINITY_KEY);
 }
 
-debug_only static inline key
+static inline key
 trunk_min_key(trunk_handle *spl, trunk_node *node)
 {
    return trunk_get_pivot(spl, node, 0);
@@ -5665,12 +5665,220 @@ const static iterator_ops trunk_range_iterator_ops = {
    .advance  = trunk_range_iterator_advance,
 };
 
+static platform_status
+trunk_range_iterator_init_internal(trunk_handle         *spl,
+                                   trunk_range_iterator *range_itor,
+                                   key                   min_key,
+                                   key                   max_key,
+                                   uint64                num_tuples,
+                                   bool                  reverse);
+
+static void
+trunk_range_iterator_release_all(trunk_range_iterator *range_itor);
+
 platform_status
 trunk_range_iterator_init(trunk_handle         *spl,
                           trunk_range_iterator *range_itor,
                           key                   min_key,
                           key                   max_key,
                           uint64                num_tuples)
+{
+   range_itor->merge_itor = NULL;
+   return trunk_range_iterator_init_internal(
+      spl, range_itor, min_key, max_key, num_tuples, FALSE);
+}
+
+/*
+ * A reverse range iterator returns the keys in [min_key, max_key) in
+ * descending order. It works through the trunk leaves from the one holding
+ * the last key before max_key down, merging the branches of each one with
+ * reverse btree iterators.
+ */
+platform_status
+trunk_range_iterator_init_reverse(trunk_handle         *spl,
+                                  trunk_range_iterator *range_itor,
+                                  key                   min_key,
+                                  key                   max_key,
+                                  uint64                num_tuples)
+{
+   range_itor->merge_itor = NULL;
+   return trunk_range_iterator_init_internal(
+      spl, range_itor, min_key, max_key, num_tuples, TRUE);
+}
+
+/*
+ * Sets up the btree iterators over the branches gathered by the range
+ * iterator, between its local min and max keys, and the merge iterator over
+ * them. A merge iterator left from an earlier leaf (or seek) going the same
+ * way is reset rather than reallocated.
+ */
+static platform_status
+trunk_range_iterator_start(trunk_range_iterator *range_itor)
+{
+   trunk_handle *spl        = range_itor->spl;
+   bool          reverse    = range_itor->reverse;
+   uint64        num_tuples = range_itor->num_tuples;
+
+   for (uint64 i = 0; i < range_itor->num_branches; i++) {
+      uint64          branch_no  = range_itor->num_branches - i - 1;
+      btree_iterator *btree_itor = &range_itor->btree_itor[branch_no];
+      trunk_branch   *branch     = &range_itor->branch[branch_no];
+      if (reverse) {
+         btree_iterator_init_reverse(
+            spl->cc,
+            &spl->cfg.btree_cfg,
+            btree_itor,
+            branch->root_addr,
+            range_itor->compacted[branch_no] ? PAGE_TYPE_BRANCH
+                                             : PAGE_TYPE_MEMTABLE,
+            key_buffer_key(&range_itor->local_min_key),
+            key_buffer_key(&range_itor->local_max_key));
+      } else if (range_itor->compacted[branch_no]) {
+         bool do_prefetch =
+            range_itor->compacted[branch_no] && num_tuples > TRUNK_PREFETCH_MIN
+               ? TRUE
+               : FALSE;
+         trunk_branch_iterator_init(spl,
+                                    btree_itor,
+                                    branch,
+                                    key_buffer_key(&range_itor->local_min_key),
+                                    key_buffer_key(&range_itor->local_max_key),
+                                    do_prefetch,
+                                    FALSE);
+      } else {
+         uint64 mt_root_addr = branch->root_addr;
+         bool   is_live      = branch_no == 0;
+         trunk_memtable_iterator_init(
+            spl,
+            btree_itor,
+            mt_root_addr,
+            key_buffer_key(&range_itor->local_min_key),
+            key_buffer_key(&range_itor->local_max_key),
+            is_live,
+            FALSE);
+      }
+      range_itor->itor[i] = &btree_itor->super;
+   }
+
+   if (range_itor->merge_itor != NULL
+       && range_itor->merge_itor->reverse == reverse)
+   {
+      return merge_iterator_reset(
+         range_itor->merge_itor, range_itor->num_branches, range_itor->itor);
+   }
+   if (range_itor->merge_itor != NULL) {
+      merge_iterator_destroy(spl->heap_id, &range_itor->merge_itor);
+   }
+
+   platform_status rc;
+   if (reverse) {
+      rc = merge_iterator_create_reverse(spl->heap_id,
+                                         spl->cfg.data_cfg,
+                                         range_itor->num_branches,
+                                         range_itor->itor,
+                                         MERGE_FULL,
+                                         &range_itor->merge_itor);
+   } else {
+      rc = merge_iterator_create(spl->heap_id,
+                                 spl->cfg.data_cfg,
+                                 range_itor->num_branches,
+                                 range_itor->itor,
+                                 MERGE_FULL,
+                                 &range_itor->merge_itor);
+   }
+   return rc;
+}
+
+/*
+ * If the merge itor is already exhausted, and there are more keys in the
+ * db/range, moves to the next (or, in reverse, previous) leaf
+ */
+static platform_status
+trunk_range_iterator_finish(trunk_range_iterator *range_itor,
+                            key                   min_key,
+                            key                   max_key)
+{
+   trunk_handle   *spl     = range_itor->spl;
+   bool            reverse = range_itor->reverse;
+   platform_status rc      = STATUS_OK;
+
+   bool at_end;
+   iterator_at_end(&range_itor->merge_itor->super, &at_end);
+
+   if (at_end && reverse) {
+      KEY_CREATE_LOCAL_COPY(rc,
+                            local_min_key,
+                            spl->heap_id,
+                            key_buffer_key(&range_itor->local_min_key));
+      if (!SUCCESS(rc)) {
+         return rc;
+      }
+      KEY_CREATE_LOCAL_COPY(rc,
+                            rebuild_key,
+                            spl->heap_id,
+                            key_buffer_key(&range_itor->rebuild_key));
+      if (!SUCCESS(rc)) {
+         return rc;
+      }
+      trunk_range_iterator_release_all(range_itor);
+      if (trunk_key_compare(spl, local_min_key, NEGATIVE_INFINITY_KEY) != 0
+          && trunk_key_compare(spl, min_key, local_min_key) < 0)
+      {
+         rc = trunk_range_iterator_init_internal(spl,
+                                                 range_itor,
+                                                 min_key,
+                                                 rebuild_key,
+                                                 range_itor->num_tuples,
+                                                 TRUE);
+         if (!SUCCESS(rc)) {
+            return rc;
+         }
+         iterator_at_end(&range_itor->merge_itor->super, &at_end);
+      }
+   } else if (at_end) {
+      KEY_CREATE_LOCAL_COPY(rc,
+                            local_max_key,
+                            spl->heap_id,
+                            key_buffer_key(&range_itor->local_max_key));
+      if (!SUCCESS(rc)) {
+         return rc;
+      }
+      KEY_CREATE_LOCAL_COPY(rc,
+                            rebuild_key,
+                            spl->heap_id,
+                            key_buffer_key(&range_itor->rebuild_key));
+      if (!SUCCESS(rc)) {
+         return rc;
+      }
+      trunk_range_iterator_release_all(range_itor);
+      if (1 && trunk_key_compare(spl, local_max_key, POSITIVE_INFINITY_KEY) != 0
+          && trunk_key_compare(spl, local_max_key, max_key) < 0)
+      {
+         rc = trunk_range_iterator_init_internal(spl,
+                                                 range_itor,
+                                                 rebuild_key,
+                                                 max_key,
+                                                 range_itor->num_tuples,
+                                                 FALSE);
+         if (!SUCCESS(rc)) {
+            return rc;
+         }
+         iterator_at_end(&range_itor->merge_itor->super, &at_end);
+      }
+   }
+
+   range_itor->at_end = at_end;
+
+   return rc;
+}
+
+static platform_status
+trunk_range_iterator_init_internal(trunk_handle         *spl,
+                                   trunk_range_iterator *range_itor,
+                                   key                   min_key,
+                                   key                   max_key,
+                                   uint64                num_tuples,
+                                   bool                  reverse)
 {
    debug_assert(!key_is_null(min_key));
    debug_assert(!key_is_null(max_key));
@@ -5679,10 +5887,14 @@ trunk_range_iterator_init(trunk_handle         *spl,
    range_itor->super.ops    = &trunk_range_iterator_ops;
    range_itor->num_branches = 0;
    range_itor->num_tuples   = num_tuples;
+   range_itor->reverse      = reverse;
+   range_itor->parked       = FALSE;
    key_buffer_init_from_key(&range_itor->min_key, spl->heap_id, min_key);
    key_buffer_init_from_key(&range_itor->max_key, spl->heap_id, max_key);
 
    if (trunk_key_compare(spl, max_key, min_key) <= 0) {
+      key_buffer_deinit(&range_itor->min_key);
+      key_buffer_deinit(&range_itor->max_key);
       range_itor->at_end = TRUE;
       return STATUS_OK;
    }
@@ -5735,8 +5947,18 @@ trunk_range_iterator_init(trunk_handle         *spl,
    // index btrees
    uint16 height = trunk_height(&node);
    for (uint16 h = height; h > 0; h--) {
-      uint16 pivot_no = trunk_find_pivot(
-         spl, &node, key_buffer_key(&range_itor->min_key), less_than_or_equal);
+      // a reverse iterator starts from the leaf with the last key before
+      // max_key
+      uint16 pivot_no;
+      if (reverse) {
+         pivot_no = trunk_find_pivot(
+            spl, &node, key_buffer_key(&range_itor->max_key), less_than);
+      } else {
+         pivot_no = trunk_find_pivot(spl,
+                                     &node,
+                                     key_buffer_key(&range_itor->min_key),
+                                     less_than_or_equal);
+      }
       debug_assert(pivot_no < trunk_num_children(spl, &node));
       trunk_pivot_data *pdata = trunk_get_pivot_data(spl, &node, pivot_no);
 
@@ -5786,101 +6008,43 @@ trunk_range_iterator_init(trunk_handle         *spl,
    }
 
    // have a leaf, use to get rebuild key
-   key rebuild_key =
-      trunk_key_compare(spl, trunk_max_key(spl, &node), max_key) < 0
-         ? trunk_max_key(spl, &node)
-         : max_key;
-   key_buffer_init_from_key(
-      &range_itor->rebuild_key, spl->heap_id, rebuild_key);
-   if (trunk_key_compare(spl, max_key, rebuild_key) < 0) {
+   if (reverse) {
+      key rebuild_key =
+         trunk_key_compare(spl, trunk_min_key(spl, &node), min_key) > 0
+            ? trunk_min_key(spl, &node)
+            : min_key;
+      key_buffer_init_from_key(
+         &range_itor->rebuild_key, spl->heap_id, rebuild_key);
+      key_buffer_init_from_key(
+         &range_itor->local_min_key, spl->heap_id, rebuild_key);
       key_buffer_init_from_key(
          &range_itor->local_max_key, spl->heap_id, max_key);
    } else {
+      key rebuild_key =
+         trunk_key_compare(spl, trunk_max_key(spl, &node), max_key) < 0
+            ? trunk_max_key(spl, &node)
+            : max_key;
       key_buffer_init_from_key(
-         &range_itor->local_max_key, spl->heap_id, rebuild_key);
-   }
-
-   trunk_node_unget(spl->cc, &node);
-
-   for (uint64 i = 0; i < range_itor->num_branches; i++) {
-      uint64          branch_no  = range_itor->num_branches - i - 1;
-      btree_iterator *btree_itor = &range_itor->btree_itor[branch_no];
-      trunk_branch   *branch     = &range_itor->branch[branch_no];
-      if (range_itor->compacted[branch_no]) {
-         bool do_prefetch =
-            range_itor->compacted[branch_no] && num_tuples > TRUNK_PREFETCH_MIN
-               ? TRUE
-               : FALSE;
-         trunk_branch_iterator_init(spl,
-                                    btree_itor,
-                                    branch,
-                                    key_buffer_key(&range_itor->min_key),
-                                    key_buffer_key(&range_itor->local_max_key),
-                                    do_prefetch,
-                                    FALSE);
+         &range_itor->rebuild_key, spl->heap_id, rebuild_key);
+      key_buffer_init_from_key(
+         &range_itor->local_min_key, spl->heap_id, min_key);
+      if (trunk_key_compare(spl, max_key, rebuild_key) < 0) {
+         key_buffer_init_from_key(
+            &range_itor->local_max_key, spl->heap_id, max_key);
       } else {
-         uint64 mt_root_addr = branch->root_addr;
-         bool   is_live      = branch_no == 0;
-         trunk_memtable_iterator_init(
-            spl,
-            btree_itor,
-            mt_root_addr,
-            key_buffer_key(&range_itor->min_key),
-            key_buffer_key(&range_itor->local_max_key),
-            is_live,
-            FALSE);
+         key_buffer_init_from_key(
+            &range_itor->local_max_key, spl->heap_id, rebuild_key);
       }
-      range_itor->itor[i] = &btree_itor->super;
    }
 
-   platform_status rc = merge_iterator_create(spl->heap_id,
-                                              spl->cfg.data_cfg,
-                                              range_itor->num_branches,
-                                              range_itor->itor,
-                                              MERGE_FULL,
-                                              &range_itor->merge_itor);
+   trunk_node_unget(spl->cc, &node);
+
+   platform_status rc = trunk_range_iterator_start(range_itor);
    if (!SUCCESS(rc)) {
       return rc;
    }
 
-   bool at_end;
-   iterator_at_end(&range_itor->merge_itor->super, &at_end);
-
-   /*
-    * if the merge itor is already exhausted, and there are more keys in the
-    * db/range, move to next leaf
-    */
-   if (at_end) {
-      KEY_CREATE_LOCAL_COPY(rc,
-                            local_max_key,
-                            spl->heap_id,
-                            key_buffer_key(&range_itor->local_max_key));
-      if (!SUCCESS(rc)) {
-         return rc;
-      }
-      KEY_CREATE_LOCAL_COPY(rc,
-                            rebuild_key,
-                            spl->heap_id,
-                            key_buffer_key(&range_itor->rebuild_key));
-      if (!SUCCESS(rc)) {
-         return rc;
-      }
-      trunk_range_iterator_deinit(range_itor);
-      if (1 && trunk_key_compare(spl, local_max_key, POSITIVE_INFINITY_KEY) != 0
-          && trunk_key_compare(spl, local_max_key, max_key) < 0)
-      {
-         rc = trunk_range_iterator_init(
-            spl, range_itor, rebuild_key, max_key, range_itor->num_tuples);
-         if (!SUCCESS(rc)) {
-            return rc;
-         }
-         iterator_at_end(&range_itor->merge_itor->super, &at_end);
-      }
-   }
-
-   range_itor->at_end = at_end;
-
-   return rc;
+   return trunk_range_iterator_finish(range_itor, min_key, max_key);
 }
 
 void
@@ -5902,7 +6066,36 @@ trunk_range_iterator_advance(iterator *itor)
    iterator_at_end(&range_itor->merge_itor->super, &at_end);
    platform_status rc;
    // robj: shouldn't this be a while loop, like in the init function?
-   if (at_end) {
+   if (at_end && range_itor->reverse) {
+      KEY_CREATE_LOCAL_COPY(rc,
+                            min_key,
+                            range_itor->spl->heap_id,
+                            key_buffer_key(&range_itor->min_key));
+      if (!SUCCESS(rc)) {
+         return rc;
+      }
+      KEY_CREATE_LOCAL_COPY(rc,
+                            rebuild_key,
+                            range_itor->spl->heap_id,
+                            key_buffer_key(&range_itor->rebuild_key));
+      if (!SUCCESS(rc)) {
+         return rc;
+      }
+      trunk_range_iterator_release_all(range_itor);
+      rc = trunk_range_iterator_init_internal(range_itor->spl,
+                                              range_itor,
+                                              min_key,
+                                              rebuild_key,
+                                              range_itor->num_tuples,
+                                              TRUE);
+      if (!SUCCESS(rc)) {
+         return rc;
+      }
+      if (!range_itor->at_end) {
+         iterator_at_end(&range_itor->merge_itor->super, &at_end);
+         platform_assert(!at_end);
+      }
+   } else if (at_end) {
       KEY_CREATE_LOCAL_COPY(rc,
                             rebuild_key,
                             range_itor->spl->heap_id,
@@ -5917,12 +6110,13 @@ trunk_range_iterator_advance(iterator *itor)
       if (!SUCCESS(rc)) {
          return rc;
       }
-      trunk_range_iterator_deinit(range_itor);
-      rc = trunk_range_iterator_init(range_itor->spl,
-                                     range_itor,
-                                     rebuild_key,
-                                     max_key,
-                                     range_itor->num_tuples);
+      trunk_range_iterator_release_all(range_itor);
+      rc = trunk_range_iterator_init_internal(range_itor->spl,
+                                              range_itor,
+                                              rebuild_key,
+                                              max_key,
+                                              range_itor->num_tuples,
+                                              FALSE);
       if (!SUCCESS(rc)) {
          return rc;
       }
@@ -5945,32 +6139,189 @@ trunk_range_iterator_at_end(iterator *itor, bool *at_end)
    return STATUS_OK;
 }
 
+/*
+ * Releases the pages and memtables the range iterator holds (which would
+ * otherwise block inserts and the recycling of memtables), leaving it at the
+ * end, parked. It keeps its merge iterator, and the branches and keys of the
+ * leaf it was in, so that a seek within that leaf only has to take the
+ * memtables back (see trunk_range_iterator_seek).
+ */
 void
-trunk_range_iterator_deinit(trunk_range_iterator *range_itor)
+trunk_range_iterator_release(trunk_range_iterator *range_itor)
 {
-   // If the iterator is at end, then it has already been deinitialized
+   // If the iterator is at end, then it has already been released
    if (range_itor->at_end) {
       return;
    }
    trunk_handle *spl = range_itor->spl;
-   merge_iterator_destroy(range_itor->spl->heap_id, &range_itor->merge_itor);
    for (uint64 i = 0; i < range_itor->num_branches; i++) {
       btree_iterator *btree_itor = &range_itor->btree_itor[i];
       if (range_itor->compacted[i]) {
-         uint64 root_addr = btree_itor->root_addr;
          trunk_branch_iterator_deinit(spl, btree_itor, FALSE);
-         btree_unblock_dec_ref(spl->cc, &spl->cfg.btree_cfg, root_addr);
       } else {
          uint64 mt_gen = range_itor->memtable_start_gen - i;
          trunk_memtable_iterator_deinit(spl, btree_itor, mt_gen, FALSE);
          trunk_memtable_dec_ref(spl, mt_gen);
       }
    }
+   range_itor->at_end = TRUE;
+   range_itor->parked = TRUE;
+}
+
+/*
+ * Releases everything the range iterator holds but its merge iterator,
+ * including the branches and keys a parked iterator keeps.
+ */
+static void
+trunk_range_iterator_release_all(trunk_range_iterator *range_itor)
+{
+   trunk_range_iterator_release(range_itor);
+   if (!range_itor->parked) {
+      return;
+   }
+   trunk_handle *spl = range_itor->spl;
+   for (uint64 i = 0; i < range_itor->num_branches; i++) {
+      if (range_itor->compacted[i]) {
+         btree_unblock_dec_ref(
+            spl->cc, &spl->cfg.btree_cfg, range_itor->branch[i].root_addr);
+      }
+   }
 
    key_buffer_deinit(&range_itor->min_key);
    key_buffer_deinit(&range_itor->max_key);
+   key_buffer_deinit(&range_itor->local_min_key);
    key_buffer_deinit(&range_itor->local_max_key);
    key_buffer_deinit(&range_itor->rebuild_key);
+   range_itor->parked = FALSE;
+}
+
+/*
+ * Takes back the memtables a parked range iterator read, which is only
+ * possible while they are the same ones it would read if it were rebuilt: no
+ * memtable has been started or incorporated into the tree since. So the
+ * branches it kept still hold everything else in its leaf, though it may
+ * have been flushed or compacted into others since.
+ */
+static bool
+trunk_range_iterator_unpark(trunk_range_iterator *range_itor)
+{
+   trunk_handle *spl       = range_itor->spl;
+   page_handle  *lock_page = memtable_get_lookup_lock(spl->mt_ctxt);
+   bool          unchanged =
+      memtable_generation(spl->mt_ctxt) == range_itor->memtable_start_gen
+      && memtable_generation_retired(spl->mt_ctxt)
+            == range_itor->memtable_end_gen;
+   if (unchanged) {
+      for (uint64 i = 0; i < range_itor->num_memtable_branches; i++) {
+         if (!range_itor->compacted[i]) {
+            trunk_memtable_inc_ref(spl, range_itor->memtable_start_gen - i);
+         }
+      }
+   }
+   memtable_unget_lookup_lock(spl->mt_ctxt, lock_page);
+   return unchanged;
+}
+
+/*
+ * Repositions the range iterator onto the range [min_key, max_key), going in
+ * the given direction.
+ *
+ * If the iterator is still in (or parked in) the trunk leaf the new range
+ * starts in (ends in, in reverse), with the same end (start) as before, only
+ * its btree iterators are moved, over the same branches and memtables as
+ * before, and the merge iterator is reset over them. Otherwise the iterator is
+ * rebuilt, still reusing the merge iterator. Either way, nothing is allocated.
+ */
+platform_status
+trunk_range_iterator_seek(trunk_range_iterator *range_itor,
+                          key                   min_key,
+                          key                   max_key,
+                          bool                  reverse)
+{
+   trunk_handle *spl = range_itor->spl;
+
+   bool in_leaf = FALSE;
+   if ((!range_itor->at_end || range_itor->parked)
+       && range_itor->reverse == reverse)
+   {
+      key curr_min_key  = key_buffer_key(&range_itor->min_key);
+      key curr_max_key  = key_buffer_key(&range_itor->max_key);
+      key local_min_key = key_buffer_key(&range_itor->local_min_key);
+      key local_max_key = key_buffer_key(&range_itor->local_max_key);
+      if (reverse) {
+         in_leaf = trunk_key_compare(spl, min_key, curr_min_key) == 0
+                   && trunk_key_compare(spl, local_min_key, max_key) < 0
+                   && trunk_key_compare(spl, max_key, curr_max_key) <= 0;
+      } else {
+         in_leaf = trunk_key_compare(spl, max_key, curr_max_key) == 0
+                   && trunk_key_compare(spl, curr_min_key, min_key) <= 0
+                   && trunk_key_compare(spl, min_key, local_max_key) < 0;
+      }
+   }
+
+   if (in_leaf && range_itor->parked) {
+      in_leaf = trunk_range_iterator_unpark(range_itor);
+   }
+   if (spl->cfg.use_stats) {
+      threadid tid = platform_get_tid();
+      spl->stats[tid].range_seeks++;
+      if (in_leaf) {
+         spl->stats[tid].range_seeks_in_leaf++;
+      }
+   }
+
+   if (!in_leaf) {
+      trunk_range_iterator_release_all(range_itor);
+      return trunk_range_iterator_init_internal(
+         spl, range_itor, min_key, max_key, range_itor->num_tuples, reverse);
+   }
+
+   if (range_itor->parked) {
+      // its btree iterators were already deinitialized when it was parked
+      range_itor->parked = FALSE;
+   } else {
+      for (uint64 i = 0; i < range_itor->num_branches; i++) {
+         btree_iterator *btree_itor = &range_itor->btree_itor[i];
+         if (range_itor->compacted[i]) {
+            trunk_branch_iterator_deinit(spl, btree_itor, FALSE);
+         } else {
+            uint64 mt_gen = range_itor->memtable_start_gen - i;
+            trunk_memtable_iterator_deinit(spl, btree_itor, mt_gen, FALSE);
+         }
+      }
+   }
+
+   platform_status rc;
+   if (reverse) {
+      rc = key_buffer_copy_key(&range_itor->max_key, max_key);
+      if (SUCCESS(rc)) {
+         rc = key_buffer_copy_key(&range_itor->local_max_key, max_key);
+      }
+   } else {
+      rc = key_buffer_copy_key(&range_itor->min_key, min_key);
+      if (SUCCESS(rc)) {
+         rc = key_buffer_copy_key(&range_itor->local_min_key, min_key);
+      }
+   }
+   if (!SUCCESS(rc)) {
+      return rc;
+   }
+
+   rc = trunk_range_iterator_start(range_itor);
+   if (!SUCCESS(rc)) {
+      return rc;
+   }
+
+   return trunk_range_iterator_finish(range_itor, min_key, max_key);
+}
+
+void
+trunk_range_iterator_deinit(trunk_range_iterator *range_itor)
+{
+   trunk_range_iterator_release_all(range_itor);
+   if (range_itor->merge_itor != NULL) {
+      merge_iterator_destroy(range_itor->spl->heap_id, &range_itor->merge_itor);
+   }
 }
 
 /*
@@ -6606,6 +6957,15 @@ trunk_lookup_async(trunk_handle      *spl,    // IN
                   break;
                }
             }
+            if (ctxt->state == async_state_found_final_answer_early) {
+               break;
+            }
+            /*
+             * Don't repeat the memtable lookup (and take its lock again) if
+             * getting the root has to be retried, and let the IO callback
+             * know which node it got.
+             */
+            trunk_async_set_state(ctxt, async_state_get_root_reentrant);
             // fallthrough
          }
          case async_state_get_root_reentrant:
@@ -6651,6 +7011,15 @@ trunk_lookup_async(trunk_handle      *spl,    // IN
          }
          case async_state_trunk_node_lookup:
          {
+            if (ctxt->trunk_node.page == NULL) {
+               // The root was loaded by async IO, finish getting it
+               trunk_node_async_done(spl, ctxt);
+               ctxt->trunk_node.page = ctxt->cache_ctxt.page;
+               ctxt->trunk_node.hdr =
+                  (trunk_hdr *)(ctxt->cache_ctxt.page->data);
+               memtable_unget_lookup_lock(spl->mt_ctxt, ctxt->mt_lock_page);
+               ctxt->mt_lock_page = NULL;
+            }
             ctxt->height = trunk_height(node);
             uint16 pivot_no =
                trunk_find_pivot(spl, node, target, less_than_or_equal);
@@ -7019,6 +7388,166 @@ trunk_lookup_async(trunk_handle      *spl,    // IN
 }
 
 
+/*
+ *-----------------------------------------------------------------------------
+ * Range counts
+ *
+ *      Estimates the number of tuples in a range, and the bytes of their keys
+ *      and messages, from the counts the trunk and branches keep, rather than
+ *      by merging the range. Every version of a key (and every delete) in a
+ *      different branch is counted, so the estimate is an upper bound on the
+ *      number of live keys, which becomes tight as the data is compacted.
+ *-----------------------------------------------------------------------------
+ */
+
+/*
+ * Memtables don't keep counts (see btree.c), so their tuples in the range are
+ * counted one by one. Memtables are small, so this is bounded.
+ */
+static void
+trunk_memtable_count_in_range(trunk_handle *spl,
+                              uint64        root_addr,
+                              key           min_key,
+                              key           max_key,
+                              uint64       *num_tuples,
+                              uint64       *num_kv_bytes)
+{
+   btree_iterator btree_itor;
+   iterator      *itor = &btree_itor.super;
+   trunk_memtable_iterator_init(
+      spl, &btree_itor, root_addr, min_key, max_key, FALSE, FALSE);
+
+   bool at_end;
+   iterator_at_end(itor, &at_end);
+   while (!at_end) {
+      key     curr_key;
+      message msg;
+      iterator_get_curr(itor, &curr_key, &msg);
+      *num_tuples += 1;
+      *num_kv_bytes += key_length(curr_key) + message_length(msg);
+      iterator_advance(itor);
+      iterator_at_end(itor, &at_end);
+   }
+   btree_iterator_deinit(&btree_itor);
+}
+
+/*
+ * Adds the tuples in [min_key, max_key) in the subtree of node. The pivots
+ * that are entirely in the range are counted from the pivot counts, and those
+ * at the ends of the range from the ranks in each of their branches.
+ */
+static void
+trunk_node_count_in_range(trunk_handle *spl,
+                          trunk_node   *node,
+                          key           min_key,
+                          key           max_key,
+                          uint64       *num_tuples,
+                          uint64       *num_kv_bytes)
+{
+   uint16 num_children = trunk_num_children(spl, node);
+   for (uint16 pivot_no = 0; pivot_no < num_children; pivot_no++) {
+      key pivot_min_key = trunk_get_pivot(spl, node, pivot_no);
+      key pivot_max_key = trunk_get_pivot(spl, node, pivot_no + 1);
+      if (trunk_key_compare(spl, pivot_max_key, min_key) <= 0) {
+         continue;
+      }
+      if (trunk_key_compare(spl, max_key, pivot_min_key) <= 0) {
+         break;
+      }
+
+      bool whole_pivot = trunk_key_compare(spl, min_key, pivot_min_key) <= 0
+                         && trunk_key_compare(spl, pivot_max_key, max_key) <= 0;
+      trunk_pivot_data *pdata = trunk_get_pivot_data(spl, node, pivot_no);
+      if (whole_pivot) {
+         *num_tuples += trunk_pivot_num_tuples(spl, node, pivot_no);
+         *num_kv_bytes += trunk_pivot_kv_bytes(spl, node, pivot_no);
+      } else {
+         key local_min_key =
+            trunk_key_compare(spl, min_key, pivot_min_key) > 0 ? min_key
+                                                               : pivot_min_key;
+         key local_max_key =
+            trunk_key_compare(spl, max_key, pivot_max_key) < 0 ? max_key
+                                                               : pivot_max_key;
+         for (uint16 branch_no = pdata->start_branch;
+              branch_no != trunk_end_branch(spl, node);
+              branch_no = trunk_add_branch_number(spl, branch_no, 1))
+         {
+            trunk_branch     *branch = trunk_get_branch(spl, node, branch_no);
+            btree_pivot_stats stats;
+            btree_count_in_range(spl->cc,
+                                 trunk_btree_config(spl),
+                                 branch->root_addr,
+                                 local_min_key,
+                                 local_max_key,
+                                 &stats);
+            *num_tuples += stats.num_kvs;
+            *num_kv_bytes += stats.key_bytes + stats.message_bytes;
+         }
+      }
+
+      if (trunk_is_index(node)) {
+         trunk_node child;
+         trunk_node_get(spl->cc, pdata->addr, &child);
+         trunk_node_count_in_range(
+            spl, &child, min_key, max_key, num_tuples, num_kv_bytes);
+         trunk_node_unget(spl->cc, &child);
+      }
+   }
+}
+
+/*
+ * Estimates the number of tuples in [min_key, max_key) and the bytes of their
+ * keys and messages, see above. This reads the trunk nodes over the range, the
+ * paths to the ends of the range in each branch, and the memtables.
+ */
+platform_status
+trunk_count_in_range(trunk_handle *spl,
+                     key           min_key,
+                     key           max_key,
+                     uint64       *num_tuples,
+                     uint64       *num_kv_bytes)
+{
+   *num_tuples   = 0;
+   *num_kv_bytes = 0;
+   if (trunk_key_compare(spl, max_key, min_key) <= 0) {
+      return STATUS_OK;
+   }
+
+   page_handle *mt_lookup_lock_page = memtable_get_lookup_lock(spl->mt_ctxt);
+   uint64       mt_gen_start        = memtable_generation(spl->mt_ctxt);
+   uint64       mt_gen_end          = memtable_generation_retired(spl->mt_ctxt);
+   for (uint64 mt_gen = mt_gen_start; mt_gen != mt_gen_end; mt_gen--) {
+      bool   compacted;
+      uint64 root_addr =
+         trunk_memtable_root_addr_for_lookup(spl, mt_gen, &compacted);
+      if (compacted) {
+         btree_pivot_stats stats;
+         btree_count_in_range(spl->cc,
+                              trunk_btree_config(spl),
+                              root_addr,
+                              min_key,
+                              max_key,
+                              &stats);
+         *num_tuples += stats.num_kvs;
+         *num_kv_bytes += stats.key_bytes + stats.message_bytes;
+      } else {
+         trunk_memtable_count_in_range(
+            spl, root_addr, min_key, max_key, num_tuples, num_kv_bytes);
+      }
+   }
+
+   // hold root read lock to prevent memtable flush
+   trunk_node node;
+   trunk_node_get(spl->cc, spl->root_addr, &node);
+   memtable_unget_lookup_lock(spl->mt_ctxt, mt_lookup_lock_page);
+
+   trunk_node_count_in_range(
+      spl, &node, min_key, max_key, num_tuples, num_kv_bytes);
+   trunk_node_unget(spl->cc, &node);
+   return STATUS_OK;
+}
+
+
 platform_status
 trunk_range(trunk_handle  *spl,
             key            start_key,
@@ -7286,7 +7815,7 @@ trunk_prepare_for_shutdown(trunk_handle *spl)
 
    // release the log
    if (spl->cfg.use_log) {
-      platform_free(spl->heap_id, spl->log);
+      log_destroy(spl->log, spl->heap_id);
    }
 
    // release the trunk mini allocator
@@ -8560,8 +9089,10 @@ trunk_print_lookup_stats(platform_log_handle *log_handle, trunk_handle *spl)
          global->filter_false_positives[h] += spl->stats[thr_i].filter_false_positives[h];
          global->filter_negatives[h]       += spl->stats[thr_i].filter_negatives[h];
       }
-      global->lookups_found     += spl->stats[thr_i].lookups_found;
-      global->lookups_not_found += spl->stats[thr_i].lookups_not_found;
+      global->lookups_found       += spl->stats[thr_i].lookups_found;
+      global->lookups_not_found   += spl->stats[thr_i].lookups_not_found;
+      global->range_seeks         += spl->stats[thr_i].range_seeks;
+      global->range_seeks_in_leaf += spl->stats[thr_i].range_seeks_in_leaf;
    }
    lookups = global->lookups_found + global->lookups_not_found;
 
@@ -8571,6 +9102,8 @@ trunk_print_lookup_stats(platform_log_handle *log_handle, trunk_handle *spl)
    platform_log(log_handle, "| lookups:           %lu\n", lookups);
    platform_log(log_handle, "| lookups found:     %lu\n", global->lookups_found);
    platform_log(log_handle, "| lookups not found: %lu\n", global->lookups_not_found);
+   platform_log(log_handle, "| range seeks:       %lu\n", global->range_seeks);
+   platform_log(log_handle, "| in the same leaf:  %lu\n", global->range_seeks_in_leaf);
    platform_log(log_handle, "-----------------------------------------------------------------------------------\n");
    platform_log(log_handle, "\n");
 
@@ -8778,6 +9311,21 @@ trunk_print_lookup(trunk_handle        *spl,
    platform_close_log_stream(&stream, Platform_default_log_handle);
 }
 
+// The number of range iterator seeks, and of those that stayed in their leaf
+void
+trunk_range_seek_stats(trunk_handle *spl, uint64 *seeks, uint64 *in_leaf)
+{
+   *seeks   = 0;
+   *in_leaf = 0;
+   if (!spl->cfg.use_stats) {
+      return;
+   }
+   for (threadid thr_i = 0; thr_i < MAX_THREADS; thr_i++) {
+      *seeks   += spl->stats[thr_i].range_seeks;
+      *in_leaf += spl->stats[thr_i].range_seeks_in_leaf;
+   }
+}
+
 void
 trunk_reset_stats(trunk_handle *spl)
 {
@@ -145,6 +145,8 @@ typedef struct trunk_stats {
 
    uint64 lookups_found;
    uint64 lookups_not_found;
+   uint64 range_seeks;
+   uint64 range_seeks_in_leaf;
    uint64 filter_lookups[TRUNK_MAX_HEIGHT];
    uint64 branch_lookups[TRUNK_MAX_HEIGHT];
    uint64 filter_false_positives[TRUNK_MAX_HEIGHT];
@@ -205,15 +207,6 @@ struct trunk_handle {
    // Link inside the splinter list
    List_Links links;
 
-   /*
-    * Per thread task and per splinter table task counter. Used to decide when
-    * to run tasks.
-    */
-
-   struct {
-      uint64 counter;
-   } PLATFORM_CACHELINE_ALIGNED task_countup[MAX_THREADS];
-
    // space rec queue
    srq srq;
 
@@ -231,8 +224,11 @@ typedef struct trunk_range_iterator {
    bool            compacted[TRUNK_RANGE_ITOR_MAX_BRANCHES];
    merge_iterator *merge_itor;
    bool            at_end;
+   bool            reverse;
+   bool            parked; // released, but still holding its leaf's branches
    key_buffer      min_key;
    key_buffer      max_key;
+   key_buffer      local_min_key;
    key_buffer      local_max_key;
    key_buffer      rebuild_key;
    btree_iterator  btree_itor[TRUNK_RANGE_ITOR_MAX_BRANCHES];
@@ -352,9 +348,29 @@ trunk_range_iterator_init(trunk_handle         *spl,
                           key                   min_key,
                           key                   max_key,
                           uint64                num_tuples);
+platform_status
+trunk_range_iterator_init_reverse(trunk_handle         *spl,
+                                  trunk_range_iterator *range_itor,
+                                  key                   min_key,
+                                  key                   max_key,
+                                  uint64                num_tuples);
+void
+trunk_range_iterator_release(trunk_range_iterator *range_itor);
+platform_status
+trunk_range_iterator_seek(trunk_range_iterator *range_itor,
+                          key                   min_key,
+                          key                   max_key,
+                          bool                  reverse);
 void
 trunk_range_iterator_deinit(trunk_range_iterator *range_itor);
 
+platform_status
+trunk_count_in_range(trunk_handle *spl,
+                     key           min_key,
+                     key           max_key,
+                     uint64       *num_tuples,
+                     uint64       *num_kv_bytes);
+
 typedef void (*tuple_function)(key tuple_key, message value, void *arg);
 platform_status
 trunk_range(trunk_handle  *spl,
@@ -392,6 +408,8 @@ trunk_print_insertion_stats(platform_log_handle *log_handle, trunk_handle *spl);
 void
 trunk_print_lookup_stats(platform_log_handle *log_handle, trunk_handle *spl);
 void
+trunk_range_seek_stats(trunk_handle *spl, uint64 *seeks, uint64 *in_leaf);
+void
 trunk_reset_stats(trunk_handle *spl);
 
 void
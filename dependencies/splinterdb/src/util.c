@@ -46,6 +46,50 @@ writable_buffer_resize(writable_buffer *wb, uint64 newlength)
    return rc;
 }
 
+void
+thread_state_table_init(thread_state_table  *table,
+                        platform_heap_id     hid,
+                        uint64               size,
+                        thread_state_init_fn init)
+{
+   ZERO_CONTENTS(table);
+   table->heap_id = hid;
+   table->size    = size;
+   table->init    = init;
+}
+
+void
+thread_state_table_deinit(thread_state_table *table)
+{
+   for (threadid tid = 0; tid < MAX_THREADS; tid++) {
+      void *state = table->state[tid];
+      if (state != NULL) {
+         platform_free(table->heap_id, state);
+         table->state[tid] = NULL;
+      }
+   }
+}
+
+void *
+thread_state_alloc(thread_state_table *table, threadid tid)
+{
+   platform_assert(tid < MAX_THREADS, "Invalid tid=%lu", tid);
+   char *state = TYPED_MANUAL_ZALLOC(table->heap_id, state, table->size);
+   platform_assert(state != NULL);
+   if (table->init != NULL) {
+      table->init(state);
+   }
+   /*
+    * Only the thread holding tid allocates its state, but other threads may
+    * be walking the table, so publish it atomically.
+    */
+   if (!__sync_bool_compare_and_swap(&table->state[tid], NULL, state)) {
+      platform_free(table->heap_id, state);
+      return table->state[tid];
+   }
+   return state;
+}
+
 /*
  *----------------------------------------------------------------------
  * Utility function; you should not use this directly
@@ -276,6 +276,57 @@ writable_buffer_append(writable_buffer *wb, uint64 length, const void *newdata)
    writable_buffer_copy_slice(&dst##wb, src);                                  \
    slice dst = writable_buffer_to_slice(&dst##wb);
 
+/*
+ * Per-thread state, indexed by thread ID. Each thread's state is allocated
+ * the first time that thread looks it up, so a structure holding one of
+ * these carries MAX_THREADS pointers rather than MAX_THREADS copies of the
+ * state. Thread IDs are recycled by the task system, and so is their state:
+ * it is left in place when a thread deregisters, for the next thread given
+ * that ID, and only freed by thread_state_table_deinit().
+ */
+typedef void (*thread_state_init_fn)(void *state);
+
+typedef struct thread_state_table {
+   platform_heap_id     heap_id;
+   uint64               size;
+   thread_state_init_fn init; // may be NULL, state starts out zeroed
+   void *volatile       state[MAX_THREADS];
+} thread_state_table;
+
+void
+thread_state_table_init(thread_state_table  *table,
+                        platform_heap_id     hid,
+                        uint64               size,
+                        thread_state_init_fn init);
+
+void
+thread_state_table_deinit(thread_state_table *table);
+
+void *
+thread_state_alloc(thread_state_table *table, threadid tid);
+
+/* Returns the state of thread tid, allocating it if this is its first use. */
+static inline void *
+thread_state_get(thread_state_table *table, threadid tid)
+{
+   debug_assert(tid < MAX_THREADS, "Invalid tid=%lu", tid);
+   void *state = table->state[tid];
+   if (LIKELY(state != NULL)) {
+      return state;
+   }
+   return thread_state_alloc(table, tid);
+}
+
+/*
+ * Returns the state of thread tid, or NULL if no thread with that ID has
+ * used it yet. For walking over all threads' state, e.g. to sum up stats.
+ */
+static inline void *
+thread_state_peek(const thread_state_table *table, threadid tid)
+{
+   return table->state[tid];
+}
+
 /*
  * try_string_to_(u)int64
  *
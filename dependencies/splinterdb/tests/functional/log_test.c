@@ -51,7 +51,7 @@ test_log_crash(clockcache             *cc,
    DECLARE_AUTO_KEY_BUFFER(keybuffer, hid);
 
    platform_assert(cc != NULL);
-   rc = shard_log_init(log, (cache *)cc, cfg);
+   rc = shard_log_init(log, (cache *)cc, cfg, hid);
    platform_assert_status_ok(rc);
    logh = (log_handle *)log;
 
@@ -172,7 +172,7 @@ test_log_perf(cache                  *cc,
    uint64          start_time;
    platform_status ret;
 
-   ret = shard_log_init(log, (cache *)cc, cfg);
+   ret = shard_log_init(log, (cache *)cc, cfg, hid);
    platform_assert_status_ok(ret);
 
    for (uint64 i = 0; i < num_threads; i++) {
@@ -371,6 +371,7 @@ log_test(int argc, char *argv[])
    }
 
    clockcache_deinit(cc);
+   shard_log_deinit(log);
    platform_free(hid, log);
    platform_free(hid, cc);
    rc_allocator_deinit(&al);
@@ -0,0 +1,265 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * lock_table_test.c --
+ *
+ *  Exercises the lock table in lock_table.c under contention: many threads
+ *  lock overlapping sets of keys (the way txns lock their write sets at
+ *  commit), and ranges over them (the way txns validate the ranges they
+ *  read). No two threads may hold conflicting locks at once, and since the
+ *  write sets are locked in key order, the threads must never deadlock.
+ * -----------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <pthread.h>
+
+#include "splinterdb/public_platform.h"
+#include "splinterdb/default_data_config.h"
+#include "unit_tests.h"
+#include "lock_table.h"
+#include "tictoc_data.h"
+#include "../functional/random.h"
+#include "ctest.h" // This is required for all test-case files.
+
+#define TEST_MAX_KEY_SIZE 16
+
+// Few keys, so that the sets of the threads overlap a lot
+#define NUM_KEYS     16
+#define KEYS_PER_SET 4
+#define NUM_THREADS  8
+#define NUM_ROUNDS   20000
+
+// Hard-coded format string to generate keys, which sort in numeric order
+static const char key_fmt[] = "key-%02d";
+#define TEST_KEY_LENGTH (6)
+
+// Configuration and results of each worker thread
+typedef struct {
+   lock_table        *lock_tbl;
+   const data_config *cfg;
+   // How many threads hold a write lock of each key
+   volatile uint64 *holders;
+   uint64           seed;
+   bool             lock_ranges;
+   // Times the thread saw a conflicting lock held along with its own
+   uint64 conflicts;
+} worker_config;
+
+static void *
+exec_write_set_worker(void *w);
+
+static void *
+exec_range_worker(void *w);
+
+static void
+run_workers(worker_config *wcfg, int num_range_workers);
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(lock_table)
+{
+   lock_table     *lock_tbl;
+   data_config     default_data_cfg;
+   volatile uint64 holders[NUM_KEYS];
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(lock_table)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   default_data_config_init(TEST_MAX_KEY_SIZE, &data->default_data_cfg);
+   data->lock_tbl = lock_table_create();
+   for (int i = 0; i < NUM_KEYS; i++) {
+      data->holders[i] = 0;
+   }
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(lock_table)
+{
+   lock_table_destroy(data->lock_tbl);
+}
+
+/*
+ * Threads lock random, overlapping sets of keys in key order, waiting for the
+ * ones that are busy.
+ */
+CTEST2(lock_table, test_write_sets_in_key_order)
+{
+   worker_config wcfg[NUM_THREADS];
+   for (int i = 0; i < NUM_THREADS; i++) {
+      wcfg[i] = (worker_config){.lock_tbl = data->lock_tbl,
+                                .cfg      = &data->default_data_cfg,
+                                .holders  = data->holders,
+                                .seed     = i + 1};
+   }
+
+   run_workers(wcfg, 0);
+
+   for (int i = 0; i < NUM_THREADS; i++) {
+      ASSERT_EQUAL(0, wcfg[i].conflicts, "Thread %d saw conflicts\n", i);
+   }
+   for (int i = 0; i < NUM_KEYS; i++) {
+      ASSERT_EQUAL(0, data->holders[i]);
+   }
+}
+
+/*
+ * Like test_write_sets_in_key_order, while other threads lock ranges of keys,
+ * which exclude the writes to the keys in them.
+ */
+CTEST2(lock_table, test_write_sets_and_ranges)
+{
+   worker_config wcfg[NUM_THREADS];
+   for (int i = 0; i < NUM_THREADS; i++) {
+      wcfg[i] = (worker_config){.lock_tbl    = data->lock_tbl,
+                                .cfg         = &data->default_data_cfg,
+                                .holders     = data->holders,
+                                .seed        = i + 1,
+                                .lock_ranges = i % 2};
+   }
+
+   run_workers(wcfg, NUM_THREADS / 2);
+
+   for (int i = 0; i < NUM_THREADS; i++) {
+      ASSERT_EQUAL(0, wcfg[i].conflicts, "Thread %d saw conflicts\n", i);
+   }
+   for (int i = 0; i < NUM_KEYS; i++) {
+      ASSERT_EQUAL(0, data->holders[i]);
+   }
+}
+
+static void
+run_workers(worker_config *wcfg, int num_range_workers)
+{
+   pthread_t thread_ids[NUM_THREADS];
+   for (int i = 0; i < NUM_THREADS; i++) {
+      int rc = pthread_create(&thread_ids[i],
+                              NULL,
+                              wcfg[i].lock_ranges ? &exec_range_worker
+                                                  : &exec_write_set_worker,
+                              &wcfg[i]);
+      ASSERT_EQUAL(0, rc);
+   }
+
+   CTEST_LOG_INFO("Waiting for %d worker threads (%d locking ranges) ...\n",
+                  NUM_THREADS,
+                  num_range_workers);
+   for (int i = 0; i < NUM_THREADS; i++) {
+      int rc = pthread_join(thread_ids[i], NULL);
+      ASSERT_EQUAL(0, rc);
+   }
+}
+
+static slice
+make_key(char *buffer, int i)
+{
+   snprintf(buffer, TEST_KEY_LENGTH + 1, key_fmt, i);
+   return slice_create(TEST_KEY_LENGTH, buffer);
+}
+
+/*
+ * Locks the write sets of NUM_ROUNDS txns, each of KEYS_PER_SET random keys,
+ * and checks that no other thread holds any of them meanwhile.
+ */
+static void *
+exec_write_set_worker(void *w)
+{
+   worker_config *wcfg = (worker_config *)w;
+   random_state   rand_state;
+   random_init(&rand_state, wcfg->seed, 0);
+
+   for (int round = 0; round < NUM_ROUNDS; round++) {
+      tictoc_transaction tt_txn;
+      tictoc_transaction_init(&tt_txn,
+                              TRANSACTION_ISOLATION_LEVEL_SERIALIZABLE);
+
+      // added in random order, and sorted before they are locked, like a txn
+      int    keys[KEYS_PER_SET];
+      uint64 chosen = 0;
+      for (int i = 0; i < KEYS_PER_SET; i++) {
+         int k;
+         do {
+            k = random_next_uint32(&rand_state) % NUM_KEYS;
+         } while (chosen & (1ULL << k));
+         chosen |= 1ULL << k;
+         keys[i] = k;
+
+         char             key_buffer[TEST_MAX_KEY_SIZE];
+         tictoc_rw_entry *entry = tictoc_get_new_write_set_entry(
+            &tt_txn, make_key(key_buffer, k), wcfg->cfg);
+         platform_assert(entry != NULL);
+         entry->op = MESSAGE_TYPE_INSERT;
+      }
+      tictoc_transaction_sort_write_set(&tt_txn, wcfg->cfg);
+      tictoc_transaction_lock_all_write_set(&tt_txn, wcfg->lock_tbl);
+
+      for (int i = 0; i < KEYS_PER_SET; i++) {
+         if (__sync_add_and_fetch(&wcfg->holders[keys[i]], 1) != 1) {
+            wcfg->conflicts++;
+         }
+      }
+      platform_pause();
+      for (int i = 0; i < KEYS_PER_SET; i++) {
+         __sync_sub_and_fetch(&wcfg->holders[keys[i]], 1);
+      }
+
+      tictoc_transaction_unlock_all_write_set(&tt_txn, wcfg->lock_tbl);
+      tictoc_transaction_deinit(&tt_txn, wcfg->lock_tbl);
+   }
+   return NULL;
+}
+
+/*
+ * Locks NUM_ROUNDS random ranges of keys for reading, retrying while they are
+ * busy, and checks that no thread holds a write lock in them meanwhile.
+ */
+static void *
+exec_range_worker(void *w)
+{
+   worker_config *wcfg = (worker_config *)w;
+   random_state   rand_state;
+   random_init(&rand_state, wcfg->seed, 0);
+
+   for (int round = 0; round < NUM_ROUNDS; round++) {
+      tictoc_transaction tt_txn;
+      tictoc_transaction_init(&tt_txn,
+                              TRANSACTION_ISOLATION_LEVEL_SERIALIZABLE);
+
+      int start = random_next_uint32(&rand_state) % NUM_KEYS;
+      int last  = start + random_next_uint32(&rand_state) % KEYS_PER_SET;
+      if (last >= NUM_KEYS) {
+         last = NUM_KEYS - 1;
+      }
+      char             start_buffer[TEST_MAX_KEY_SIZE];
+      char             last_buffer[TEST_MAX_KEY_SIZE];
+      tictoc_rw_entry *entry = tictoc_get_new_read_set_entry(&tt_txn);
+      platform_assert(entry != NULL);
+      tictoc_rw_entry_set_range_key(entry,
+                                    make_key(start_buffer, start),
+                                    make_key(last_buffer, last),
+                                    wcfg->cfg);
+
+      while (lock_table_try_acquire_entry_lock(wcfg->lock_tbl, entry)
+             == LOCK_TABLE_RC_BUSY)
+      {
+         platform_yield();
+      }
+
+      for (int k = start; k <= last; k++) {
+         if (wcfg->holders[k] != 0) {
+            wcfg->conflicts++;
+         }
+      }
+
+      lock_table_release_entry_lock(wcfg->lock_tbl, entry);
+      tictoc_transaction_deinit(&tt_txn, wcfg->lock_tbl);
+   }
+   return NULL;
+}
@@ -27,6 +27,7 @@
 #include <stdlib.h> // Needed for system calls; e.g. free
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
 
 #include "splinterdb/splinterdb.h"
 #include "splinterdb/data.h"
@@ -37,6 +38,7 @@
 #include "test_data.h"
 #include "ctest.h" // This is required for all test-case files.
 #include "btree.h" // for MAX_INLINE_MESSAGE_SIZE
+#include "splinterdb_private.h"
 
 #define TEST_MAX_KEY_SIZE 13
 
@@ -65,6 +67,9 @@ insert_keys(splinterdb *kvsb, const int minkey, int numkeys, const int incr);
 static int
 check_current_tuple(splinterdb_iterator *it, const int expected_i);
 
+static uint64
+make_compressible_value(char *buffer, const int i);
+
 static int
 custom_key_comparator(const data_config *cfg, slice key1, slice key2);
 
@@ -632,6 +637,364 @@ CTEST2(splinterdb_quick,
    }
 }
 
+/*
+ * Test case to exercise splinterdb iterator with an end-key, which bounds the
+ * scan (exclusively by default, or inclusively) whether or not it exists.
+ */
+CTEST2(splinterdb_quick, test_splinterdb_iterator_with_end_key)
+{
+   const int num_inserts = 50;
+   // Should insert keys: 0, 2, 4, ... 98
+   int rc = insert_keys(data->kvsb, 0, num_inserts, 2);
+   ASSERT_EQUAL(0, rc);
+
+   char start[TEST_INSERT_KEY_LENGTH] = {0};
+   char end[TEST_INSERT_KEY_LENGTH]   = {0};
+   struct {
+      int  start;
+      int  end;
+      bool end_inclusive;
+      int  expected_first;
+      int  expected_count;
+   } cases[] = {
+      {10, 20, FALSE, 10, 5}, // end key exists, excluded
+      {10, 20, TRUE, 10, 6},  // end key exists, included
+      {10, 21, TRUE, 10, 6},  // end key doesn't exist
+      {10, 10, TRUE, 10, 1},  // just the start key
+      {10, 10, FALSE, 10, 0}, // empty range
+      {20, 10, TRUE, 20, 0},  // end before start
+      {90, 200, FALSE, 90, 5} // end past the last key
+   };
+
+   for (int c = 0; c < ARRAY_SIZE(cases); c++) {
+      snprintf(start, sizeof(start), key_fmt, cases[c].start);
+      snprintf(end, sizeof(end), key_fmt, cases[c].end);
+      splinterdb_iterator *it = NULL;
+      rc = splinterdb_iterator_init_range(data->kvsb,
+                                          &it,
+                                          slice_create(sizeof(start), start),
+                                          slice_create(sizeof(end), end),
+                                          cases[c].end_inclusive);
+      ASSERT_EQUAL(0, rc);
+
+      int count = 0;
+      for (; splinterdb_iterator_valid(it); splinterdb_iterator_next(it)) {
+         rc = check_current_tuple(it, cases[c].expected_first + 2 * count);
+         ASSERT_EQUAL(0, rc);
+         count++;
+      }
+      ASSERT_EQUAL(0, splinterdb_iterator_status(it));
+      ASSERT_EQUAL(cases[c].expected_count, count, "case %d", c);
+
+      splinterdb_iterator_deinit(it);
+   }
+}
+
+CTEST2(splinterdb_quick, test_splinterdb_iterator_reverse)
+{
+   const int num_inserts = 50;
+   // Should insert keys: 0, 2, 4, ... 98
+   int rc = insert_keys(data->kvsb, 0, num_inserts, 2);
+   ASSERT_EQUAL(0, rc);
+
+   char start[TEST_INSERT_KEY_LENGTH] = {0};
+   char end[TEST_INSERT_KEY_LENGTH]   = {0};
+   struct {
+      int  start;
+      int  end;
+      bool end_inclusive;
+      int  expected_first;
+      int  expected_count;
+   } cases[] = {
+      {10, 20, FALSE, 18, 5}, // end key exists, excluded
+      {10, 20, TRUE, 20, 6},  // end key exists, included
+      {10, 21, FALSE, 20, 6}, // end key doesn't exist
+      {10, 10, TRUE, 10, 1},  // just the start key
+      {10, 10, FALSE, 10, 0}, // empty range
+      {20, 10, TRUE, 20, 0},  // end before start
+      {90, 200, FALSE, 98, 5} // end past the last key
+   };
+
+   for (int c = 0; c < ARRAY_SIZE(cases); c++) {
+      snprintf(start, sizeof(start), key_fmt, cases[c].start);
+      snprintf(end, sizeof(end), key_fmt, cases[c].end);
+      splinterdb_iterator *it = NULL;
+      rc = splinterdb_iterator_init_reverse(data->kvsb,
+                                            &it,
+                                            slice_create(sizeof(start), start),
+                                            slice_create(sizeof(end), end),
+                                            cases[c].end_inclusive);
+      ASSERT_EQUAL(0, rc);
+
+      int count = 0;
+      for (; splinterdb_iterator_valid(it); splinterdb_iterator_prev(it)) {
+         rc = check_current_tuple(it, cases[c].expected_first - 2 * count);
+         ASSERT_EQUAL(0, rc);
+         count++;
+      }
+      ASSERT_EQUAL(0, splinterdb_iterator_status(it));
+      ASSERT_EQUAL(cases[c].expected_count, count, "case %d", c);
+
+      splinterdb_iterator_deinit(it);
+   }
+
+   // changing direction continues from the current key
+   splinterdb_iterator *it = NULL;
+   rc = splinterdb_iterator_init(data->kvsb, &it, NULL_SLICE);
+   ASSERT_EQUAL(0, rc);
+   splinterdb_iterator_next(it);
+   splinterdb_iterator_next(it);
+   ASSERT_EQUAL(0, check_current_tuple(it, 4));
+   splinterdb_iterator_prev(it);
+   ASSERT_EQUAL(0, check_current_tuple(it, 2));
+   splinterdb_iterator_prev(it);
+   ASSERT_EQUAL(0, check_current_tuple(it, 0));
+   splinterdb_iterator_next(it);
+   ASSERT_EQUAL(0, check_current_tuple(it, 2));
+   splinterdb_iterator_prev(it);
+   splinterdb_iterator_prev(it);
+   ASSERT_FALSE(splinterdb_iterator_valid(it));
+   ASSERT_EQUAL(0, splinterdb_iterator_status(it));
+   splinterdb_iterator_deinit(it);
+}
+
+/*
+ * Test case to exercise repositioning an iterator with seek, in both
+ * directions, within its range, and after it has been released.
+ */
+CTEST2(splinterdb_quick, test_splinterdb_iterator_seek)
+{
+   const int num_inserts = 50;
+   // Should insert keys: 0, 2, 4, ... 98
+   int rc = insert_keys(data->kvsb, 0, num_inserts, 2);
+   ASSERT_EQUAL(0, rc);
+
+   char start[TEST_INSERT_KEY_LENGTH] = {0};
+   char end[TEST_INSERT_KEY_LENGTH]   = {0};
+   char key[TEST_INSERT_KEY_LENGTH]   = {0};
+   snprintf(start, sizeof(start), key_fmt, 10);
+   snprintf(end, sizeof(end), key_fmt, 60);
+   struct {
+      int  target; // -1 for NULL_SLICE
+      bool release;
+      int  expected_forward; // -1 for the end of the range
+      int  expected_reverse;
+   } cases[] = {
+      {20, FALSE, 20, 20}, // key exists
+      {21, FALSE, 22, 20}, // key doesn't exist
+      {30, TRUE, 30, 30},  // after release
+      {4, FALSE, 10, -1},  // before the range
+      {60, FALSE, -1, 58}, // the (exclusive) end key
+      {70, FALSE, -1, 58}, // past the range
+      {-1, FALSE, 10, 58}, // the whole range
+      {12, FALSE, 12, 12}, // back again
+   };
+
+   for (int reverse = 0; reverse < 2; reverse++) {
+      splinterdb_iterator *it         = NULL;
+      slice                start_slice = slice_create(sizeof(start), start);
+      slice                end_slice   = slice_create(sizeof(end), end);
+      if (reverse) {
+         rc = splinterdb_iterator_init_reverse(
+            data->kvsb, &it, start_slice, end_slice, FALSE);
+      } else {
+         rc = splinterdb_iterator_init_range(
+            data->kvsb, &it, start_slice, end_slice, FALSE);
+      }
+      ASSERT_EQUAL(0, rc);
+
+      for (int c = 0; c < ARRAY_SIZE(cases); c++) {
+         if (cases[c].release) {
+            splinterdb_iterator_release(it);
+            ASSERT_FALSE(splinterdb_iterator_valid(it));
+         }
+         slice target = NULL_SLICE;
+         if (cases[c].target >= 0) {
+            snprintf(key, sizeof(key), key_fmt, cases[c].target);
+            target = slice_create(sizeof(key), key);
+         }
+         rc = splinterdb_iterator_seek(it, target);
+         ASSERT_EQUAL(0, rc);
+
+         int expected = reverse ? cases[c].expected_reverse
+                                : cases[c].expected_forward;
+         if (expected < 0) {
+            ASSERT_FALSE(splinterdb_iterator_valid(it), "case %d", c);
+            ASSERT_EQUAL(0, splinterdb_iterator_status(it));
+            continue;
+         }
+         ASSERT_TRUE(splinterdb_iterator_valid(it), "case %d", c);
+         ASSERT_EQUAL(0, check_current_tuple(it, expected));
+         if (reverse) {
+            splinterdb_iterator_prev(it);
+            expected -= 2;
+         } else {
+            splinterdb_iterator_next(it);
+            expected += 2;
+         }
+         if (expected >= 10 && expected < 60) {
+            ASSERT_EQUAL(0, check_current_tuple(it, expected));
+         } else {
+            ASSERT_FALSE(splinterdb_iterator_valid(it));
+         }
+      }
+
+      splinterdb_iterator_deinit(it);
+   }
+}
+
+/*
+ * Seeks within the leaf an iterator is in only reposition it, even once it has
+ * been released, as long as it can take back the memtables it was reading.
+ * Once a memtable has been added to the tree, a seek rebuilds the iterator.
+ */
+CTEST2(splinterdb_quick, test_splinterdb_iterator_seek_in_leaf)
+{
+   splinterdb_close(&data->kvsb);
+   data->cfg.use_stats         = TRUE;
+   data->cfg.memtable_capacity = 1 * Mega;
+   int rc                      = splinterdb_create(&data->cfg, &data->kvsb);
+   ASSERT_EQUAL(0, rc);
+
+   // Should insert keys: 0, 2, 4, ... 98
+   rc = insert_keys(data->kvsb, 0, 50, 2);
+   ASSERT_EQUAL(0, rc);
+
+   char key[TEST_INSERT_KEY_LENGTH] = {0};
+   char val[TEST_INSERT_VAL_LENGTH] = {0};
+   splinterdb_iterator *it          = NULL;
+   rc = splinterdb_iterator_init(data->kvsb, &it, NULL_SLICE);
+   ASSERT_EQUAL(0, rc);
+
+   uint64 seeks, in_leaf;
+   int    targets[] = {20, 30, 40};
+   for (int t = 0; t < ARRAY_SIZE(targets); t++) {
+      // the first seek is made while the iterator is held, the others after
+      // it has been released
+      if (t > 0) {
+         splinterdb_iterator_release(it);
+      }
+      snprintf(key, sizeof(key), key_fmt, targets[t]);
+      rc = splinterdb_iterator_seek(it, slice_create(sizeof(key), key));
+      ASSERT_EQUAL(0, rc);
+      ASSERT_EQUAL(0, check_current_tuple(it, targets[t]));
+      splinterdb_iterator_next(it);
+      ASSERT_EQUAL(0, check_current_tuple(it, targets[t] + 2));
+   }
+   splinterdb_stats_range_seeks(data->kvsb, &seeks, &in_leaf);
+   ASSERT_EQUAL(ARRAY_SIZE(targets), seeks);
+   ASSERT_EQUAL(ARRAY_SIZE(targets), in_leaf);
+
+   // an insert into the memtable the released iterator was reading is seen
+   splinterdb_iterator_release(it);
+   snprintf(key, sizeof(key), key_fmt, 51);
+   snprintf(val, sizeof(val), val_fmt, 51);
+   rc = splinterdb_insert(data->kvsb,
+                          slice_create(sizeof(key), key),
+                          slice_create(sizeof(val), val));
+   ASSERT_EQUAL(0, rc);
+   snprintf(key, sizeof(key), key_fmt, 50);
+   rc = splinterdb_iterator_seek(it, slice_create(sizeof(key), key));
+   ASSERT_EQUAL(0, rc);
+   ASSERT_EQUAL(0, check_current_tuple(it, 50));
+   splinterdb_iterator_next(it);
+   ASSERT_EQUAL(0, check_current_tuple(it, 51));
+   splinterdb_stats_range_seeks(data->kvsb, &seeks, &in_leaf);
+   ASSERT_EQUAL(ARRAY_SIZE(targets) + 1, in_leaf);
+
+   // fill enough memtables (with keys after the others) to add some to the
+   // tree, after which the released iterator has to be rebuilt
+   splinterdb_iterator_release(it);
+   for (int i = 0; i < 40000; i++) {
+      char filler_key[TEST_MAX_KEY_SIZE];
+      char filler_val[TEST_MAX_VALUE_SIZE];
+      snprintf(filler_key, sizeof(filler_key), "zz-%08x", i);
+      memset(filler_val, 'v', sizeof(filler_val));
+      rc = splinterdb_insert(data->kvsb,
+                             slice_create(strlen(filler_key), filler_key),
+                             slice_create(sizeof(filler_val), filler_val));
+      ASSERT_EQUAL(0, rc);
+   }
+   snprintf(key, sizeof(key), key_fmt, 60);
+   rc = splinterdb_iterator_seek(it, slice_create(sizeof(key), key));
+   ASSERT_EQUAL(0, rc);
+   ASSERT_EQUAL(0, check_current_tuple(it, 60));
+   splinterdb_iterator_next(it);
+   ASSERT_EQUAL(0, check_current_tuple(it, 62));
+   splinterdb_stats_range_seeks(data->kvsb, &seeks, &in_leaf);
+   ASSERT_EQUAL(ARRAY_SIZE(targets) + 2, seeks);
+   ASSERT_EQUAL(ARRAY_SIZE(targets) + 1, in_leaf);
+
+   splinterdb_iterator_deinit(it);
+}
+
+/*
+ * Test case to exercise exact and approximate range counts. Each key is only
+ * inserted once, so the approximate counts are exact too.
+ */
+CTEST2(splinterdb_quick, test_splinterdb_count_range)
+{
+   const int num_inserts = 50;
+   // Should insert keys: 0, 2, 4, ... 98
+   int rc = insert_keys(data->kvsb, 0, num_inserts, 2);
+   ASSERT_EQUAL(0, rc);
+
+   char start[TEST_INSERT_KEY_LENGTH] = {0};
+   char end[TEST_INSERT_KEY_LENGTH]   = {0};
+   struct {
+      int  start; // -1 for NULL_SLICE
+      int  end;
+      bool end_inclusive;
+      int  expected_count;
+   } cases[] = {
+      {-1, -1, FALSE, 50}, // everything
+      {10, 20, FALSE, 5},  // end key exists, excluded
+      {10, 20, TRUE, 6},   // end key exists, included
+      {10, 21, TRUE, 6},   // end key doesn't exist
+      {10, 10, TRUE, 1},   // just the start key
+      {20, 10, TRUE, 0},   // end before start
+      {90, -1, FALSE, 5},  // to the end
+   };
+
+   for (int c = 0; c < ARRAY_SIZE(cases); c++) {
+      slice start_slice = NULL_SLICE;
+      slice end_slice   = NULL_SLICE;
+      if (cases[c].start >= 0) {
+         snprintf(start, sizeof(start), key_fmt, cases[c].start);
+         start_slice = slice_create(sizeof(start), start);
+      }
+      if (cases[c].end >= 0) {
+         snprintf(end, sizeof(end), key_fmt, cases[c].end);
+         end_slice = slice_create(sizeof(end), end);
+      }
+      uint64 count;
+      rc = splinterdb_count_range(data->kvsb,
+                                  start_slice,
+                                  end_slice,
+                                  cases[c].end_inclusive,
+                                  SPLINTERDB_COUNT_EXACT,
+                                  &count);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_EQUAL(cases[c].expected_count, count, "case %d", c);
+
+      rc = splinterdb_count_range(data->kvsb,
+                                  start_slice,
+                                  end_slice,
+                                  cases[c].end_inclusive,
+                                  SPLINTERDB_COUNT_APPROXIMATE,
+                                  &count);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_EQUAL(cases[c].expected_count, count, "case %d", c);
+
+      // the size is of the half-open range, without an inclusive end key
+      uint64 size;
+      rc = splinterdb_approximate_size(
+         data->kvsb, start_slice, end_slice, &size);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_EQUAL(cases[c].expected_count > 1, size > 0, "case %d", c);
+   }
+}
+
 /*
  * Test case to verify the interfaces to close() and reopen() a KVS work
  * as expected. After reopening the KVS, we should be able to retrieve data
@@ -673,6 +1036,65 @@ CTEST2(splinterdb_quick, test_close_and_reopen)
    splinterdb_lookup_result_deinit(&result);
 }
 
+/*
+ * One thread using two instances: each gives the thread an id of its own, so
+ * the thread sets no id before creating the second one, and sets the id each
+ * gave it before calling into it.
+ */
+CTEST2(splinterdb_quick, test_two_instances_on_one_thread)
+{
+   threadid first_tid = splinterdb_get_thread_id();
+   ASSERT_NOT_EQUAL(SPLINTERDB_NO_THREAD_ID, first_tid);
+
+   splinterdb_config second_cfg = data->cfg;
+   second_cfg.filename          = TEST_DB_NAME "_second";
+   splinterdb *second_kvsb;
+   splinterdb_set_thread_id(SPLINTERDB_NO_THREAD_ID);
+   int rc = splinterdb_create(&second_cfg, &second_kvsb);
+   ASSERT_EQUAL(0, rc);
+   threadid second_tid = splinterdb_get_thread_id();
+   ASSERT_NOT_EQUAL(SPLINTERDB_NO_THREAD_ID, second_tid);
+
+   // the same key in both, with a different value in each
+   slice user_key = slice_create(strlen("some-key"), "some-key");
+   splinterdb_set_thread_id(first_tid);
+   rc = splinterdb_insert(
+      data->kvsb, user_key, slice_create(strlen("first"), "first"));
+   ASSERT_EQUAL(0, rc);
+   splinterdb_set_thread_id(second_tid);
+   rc = splinterdb_insert(
+      second_kvsb, user_key, slice_create(strlen("second"), "second"));
+   ASSERT_EQUAL(0, rc);
+
+   splinterdb_lookup_result result;
+   slice                    value;
+   splinterdb_set_thread_id(first_tid);
+   splinterdb_lookup_result_init(data->kvsb, &result, 0, NULL);
+   rc = splinterdb_lookup(data->kvsb, user_key, &result);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_TRUE(splinterdb_lookup_found(&result));
+   splinterdb_lookup_result_value(&result, &value);
+   ASSERT_EQUAL(strlen("first"), slice_length(value));
+   ASSERT_STREQN("first", slice_data(value), slice_length(value));
+   splinterdb_lookup_result_deinit(&result);
+
+   splinterdb_set_thread_id(second_tid);
+   splinterdb_lookup_result_init(second_kvsb, &result, 0, NULL);
+   rc = splinterdb_lookup(second_kvsb, user_key, &result);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_TRUE(splinterdb_lookup_found(&result));
+   splinterdb_lookup_result_value(&result, &value);
+   ASSERT_EQUAL(strlen("second"), slice_length(value));
+   ASSERT_STREQN("second", slice_data(value), slice_length(value));
+   splinterdb_lookup_result_deinit(&result);
+
+   // closing deregisters the thread, which leaves it without an id
+   splinterdb_close(&second_kvsb);
+   ASSERT_EQUAL(SPLINTERDB_NO_THREAD_ID, splinterdb_get_thread_id());
+   remove(second_cfg.filename);
+   splinterdb_set_thread_id(first_tid);
+}
+
 /*
  * Regression test for bug where repeating a cycle of insert-close-reopen
  * causes a space leak and eventually hits an assertion
@@ -698,6 +1120,237 @@ CTEST2(splinterdb_quick, test_repeated_insert_close_reopen)
    }
 }
 
+/*
+ * The disk size of a device is fixed when it is created, since it determines
+ * where the allocator's ref counts live. Verify that reopening with a
+ * different configured disk size still mounts the device as it was created.
+ */
+CTEST2(splinterdb_quick, test_reopen_with_different_disk_size)
+{
+   slice        user_key = slice_create(strlen("some-key"), "some-key");
+   const char  *val      = "some-value";
+   const size_t val_len  = strlen(val);
+
+   int rc = splinterdb_insert(data->kvsb, user_key, slice_create(val_len, val));
+   ASSERT_EQUAL(0, rc);
+
+   splinterdb_close(&data->kvsb);
+   data->cfg.disk_size = 2 * data->cfg.disk_size;
+   rc                  = splinterdb_open(&data->cfg, &data->kvsb);
+   ASSERT_EQUAL(0, rc);
+
+   splinterdb_lookup_result result;
+   splinterdb_lookup_result_init(data->kvsb, &result, 0, NULL);
+   rc = splinterdb_lookup(data->kvsb, user_key, &result);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_TRUE(splinterdb_lookup_found(&result));
+   splinterdb_lookup_result_deinit(&result);
+}
+
+/*
+ * The configured disk size is an upper bound: the allocator only hands out
+ * extents from a range that grows as it fills up, so a small database in a
+ * device configured to be very large should only use a small file.
+ */
+CTEST2(splinterdb_quick, test_disk_grows_on_demand)
+{
+   splinterdb_close(&data->kvsb);
+   data->cfg.disk_size = 64 * Giga;
+   int rc              = splinterdb_create(&data->cfg, &data->kvsb);
+   ASSERT_EQUAL(0, rc);
+
+   const int num_inserts = 50;
+   rc                    = insert_some_keys(num_inserts, data->kvsb);
+   ASSERT_EQUAL(0, rc);
+
+   splinterdb_close(&data->kvsb);
+   struct stat file_stat;
+   ASSERT_EQUAL(0, stat(TEST_DB_NAME, &file_stat));
+   ASSERT_TRUE(file_stat.st_size < data->cfg.disk_size / 64,
+               "file size %ld should be well below the disk size %lu",
+               file_stat.st_size,
+               data->cfg.disk_size);
+
+   rc = splinterdb_open(&data->cfg, &data->kvsb);
+   ASSERT_EQUAL(0, rc);
+   splinterdb_iterator *it = NULL;
+   rc                      = splinterdb_iterator_init(data->kvsb, &it, NULL_SLICE);
+   ASSERT_EQUAL(0, rc);
+   int i = 0;
+   for (; splinterdb_iterator_valid(it); splinterdb_iterator_next(it)) {
+      rc = check_current_tuple(it, i);
+      ASSERT_EQUAL(0, rc);
+      i++;
+   }
+   ASSERT_EQUAL(num_inserts, i);
+   splinterdb_iterator_deinit(it);
+}
+
+static void
+test_async_lookup_callback(void *arg)
+{
+   *(bool *)arg = TRUE;
+}
+
+/*
+ * Async lookups of keys that are only on disk (after reopening, the cache is
+ * cold), with several lookups in flight from one thread.
+ */
+CTEST2(splinterdb_quick, test_lookup_async)
+{
+   const int num_inserts = 100;
+   int       rc          = insert_some_keys(num_inserts, data->kvsb);
+   ASSERT_EQUAL(0, rc);
+
+   splinterdb_close(&data->kvsb);
+   rc = splinterdb_open(&data->cfg, &data->kvsb);
+   ASSERT_EQUAL(0, rc);
+
+#define NUM_ASYNC_LOOKUPS 8
+   splinterdb_async_lookup *ctxts[NUM_ASYNC_LOOKUPS];
+   splinterdb_lookup_result results[NUM_ASYNC_LOOKUPS];
+   char                     keys[NUM_ASYNC_LOOKUPS][TEST_INSERT_KEY_LENGTH];
+   bool                     io_done[NUM_ASYNC_LOOKUPS];
+   bool                     in_flight[NUM_ASYNC_LOOKUPS] = {0};
+   int                      key_nums[NUM_ASYNC_LOOKUPS];
+   for (int c = 0; c < NUM_ASYNC_LOOKUPS; c++) {
+      rc = splinterdb_async_lookup_create(
+         data->kvsb, test_async_lookup_callback, &io_done[c], &ctxts[c]);
+      ASSERT_EQUAL(0, rc);
+      splinterdb_lookup_result_init(data->kvsb, &results[c], 0, NULL);
+   }
+
+   // one more than was inserted, which should not be found
+   int next_key = 0;
+   int found    = 0;
+   int finished = 0;
+   while (finished <= num_inserts) {
+      for (int c = 0; c < NUM_ASYNC_LOOKUPS; c++) {
+         if (!in_flight[c]) {
+            if (next_key > num_inserts) {
+               continue;
+            }
+            key_nums[c] = next_key++;
+            memset(keys[c], 0, sizeof(keys[c]));
+            snprintf(keys[c], sizeof(keys[c]), key_fmt, key_nums[c]);
+            in_flight[c] = TRUE;
+         } else if (!io_done[c]) {
+            continue;
+         }
+         io_done[c] = FALSE;
+         rc         = splinterdb_lookup_async(data->kvsb,
+                                      slice_create(sizeof(keys[c]), keys[c]),
+                                      &results[c],
+                                      ctxts[c]);
+         if (rc == SPLINTERDB_ASYNC_RETRY) {
+            io_done[c] = TRUE; // just try again
+         } else if (rc == 0) {
+            in_flight[c] = FALSE;
+            finished++;
+            if (key_nums[c] == num_inserts) {
+               ASSERT_FALSE(splinterdb_lookup_found(&results[c]));
+               continue;
+            }
+            ASSERT_TRUE(splinterdb_lookup_found(&results[c]));
+            char val[TEST_INSERT_VAL_LENGTH] = {0};
+            snprintf(val, sizeof(val), val_fmt, key_nums[c]);
+            slice value;
+            splinterdb_lookup_result_value(&results[c], &value);
+            ASSERT_EQUAL(sizeof(val), slice_length(value));
+            ASSERT_STREQN(val, slice_data(value), slice_length(value));
+            found++;
+         } else {
+            ASSERT_EQUAL(SPLINTERDB_ASYNC_IO_STARTED, rc);
+         }
+      }
+      splinterdb_async_poll(data->kvsb);
+   }
+   ASSERT_EQUAL(num_inserts, found);
+
+   for (int c = 0; c < NUM_ASYNC_LOOKUPS; c++) {
+      splinterdb_lookup_result_deinit(&results[c]);
+      splinterdb_async_lookup_destroy(data->kvsb, ctxts[c]);
+   }
+}
+
+/*
+ * With btree_compress_leaves, the branches that the memtables are flushed to
+ * (here, when closing) have compressed leaves. Values vary in size, up to
+ * more than a compression block (1KB) each, so that entries start and end in
+ * every position relative to the blocks, and each leaf has several blocks.
+ * Everything has to read back the same after reopening, both by lookups
+ * and by iterating over all of it.
+ */
+#define COMPRESSED_LEAVES_NUM_KEYS 5000
+#define COMPRESSED_LEAVES_KEY_FMT  "key-%08d"
+CTEST2(splinterdb_quick, test_compressed_leaves_round_trip)
+{
+   splinterdb_close(&data->kvsb);
+   data->cfg.btree_compress_leaves = TRUE;
+   int rc = splinterdb_create(&data->cfg, &data->kvsb);
+   ASSERT_EQUAL(0, rc);
+
+   char key[TEST_MAX_KEY_SIZE];
+   char val[MAX_INLINE_MESSAGE_SIZE(LAIO_DEFAULT_PAGE_SIZE)];
+   // inserted in reverse, so that they are only in order in the branches
+   for (int i = COMPRESSED_LEAVES_NUM_KEYS - 1; i >= 0; i--) {
+      snprintf(key, sizeof(key), COMPRESSED_LEAVES_KEY_FMT, i);
+      uint64 val_len = make_compressible_value(val, i);
+      rc             = splinterdb_insert(data->kvsb,
+                             slice_create(strlen(key), key),
+                             slice_create(val_len, val));
+      ASSERT_EQUAL(0, rc);
+   }
+
+   splinterdb_close(&data->kvsb);
+   rc = splinterdb_open(&data->cfg, &data->kvsb);
+   ASSERT_EQUAL(0, rc);
+
+   splinterdb_lookup_result result;
+   splinterdb_lookup_result_init(data->kvsb, &result, 0, NULL);
+   for (int i = 0; i < COMPRESSED_LEAVES_NUM_KEYS; i++) {
+      snprintf(key, sizeof(key), COMPRESSED_LEAVES_KEY_FMT, i);
+      rc = splinterdb_lookup(
+         data->kvsb, slice_create(strlen(key), key), &result);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_TRUE(splinterdb_lookup_found(&result), "key %d not found", i);
+
+      slice value;
+      rc = splinterdb_lookup_result_value(&result, &value);
+      ASSERT_EQUAL(0, rc);
+      uint64 val_len = make_compressible_value(val, i);
+      ASSERT_EQUAL(val_len, slice_length(value), "key %d", i);
+      ASSERT_EQUAL(0, memcmp(val, slice_data(value), val_len), "key %d", i);
+   }
+   // a key between two of them
+   const char *missing_key = "key-00002500!";
+   rc                      = splinterdb_lookup(
+      data->kvsb, slice_create(strlen(missing_key), missing_key), &result);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_FALSE(splinterdb_lookup_found(&result));
+   splinterdb_lookup_result_deinit(&result);
+
+   splinterdb_iterator *it = NULL;
+   rc = splinterdb_iterator_init(data->kvsb, &it, NULL_SLICE);
+   ASSERT_EQUAL(0, rc);
+   int i = 0;
+   for (; splinterdb_iterator_valid(it); splinterdb_iterator_next(it)) {
+      slice key_slice;
+      slice value;
+      splinterdb_iterator_get_current(it, &key_slice, &value);
+      snprintf(key, sizeof(key), COMPRESSED_LEAVES_KEY_FMT, i);
+      ASSERT_EQUAL(strlen(key), slice_length(key_slice), "entry %d", i);
+      ASSERT_EQUAL(0, memcmp(key, slice_data(key_slice), strlen(key)));
+      uint64 val_len = make_compressible_value(val, i);
+      ASSERT_EQUAL(val_len, slice_length(value), "entry %d", i);
+      ASSERT_EQUAL(0, memcmp(val, slice_data(value), val_len), "entry %d", i);
+      i++;
+   }
+   ASSERT_EQUAL(0, splinterdb_iterator_status(it));
+   ASSERT_EQUAL(COMPRESSED_LEAVES_NUM_KEYS, i);
+   splinterdb_iterator_deinit(it);
+}
+
 // Check that the value-oriented functions work sensibly with a custom
 // data_config
 CTEST2(splinterdb_quick, test_custom_data_config)
@@ -906,6 +1559,29 @@ CTEST2(splinterdb_quick, test_splinterdb_create_w_all_background_threads)
  * ********************************************************************************
  */
 
+/*
+ * Fills the buffer with the value of the i-th key, of a size between 16 bytes
+ * and a little over 1KB, made of text that repeats (so that it compresses),
+ * with the key's number in it.
+ *
+ * Returns: The length of the value
+ */
+static uint64
+make_compressible_value(char *buffer, const int i)
+{
+   uint64 length   = 16 + (i * 37) % 1100;
+   uint64 position = 0;
+   while (position < length) {
+      char fragment[32];
+      int  fragment_length =
+         snprintf(fragment, sizeof(fragment), "value of %08d, ", i);
+      uint64 copied = MIN(length - position, (uint64)fragment_length);
+      memcpy(buffer + position, fragment, copied);
+      position += copied;
+   }
+   return length;
+}
+
 static void
 create_default_cfg(splinterdb_config *out_cfg, data_config *default_data_cfg)
 {
@@ -0,0 +1,256 @@
+// Copyright 2022 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * tictoc_ts_cache_test.c --
+ *
+ *  Exercises the timestamp cache in tictoc_ts_cache.c from many threads at
+ *  once, with several keys per slot, so that fills, sets and evictions keep
+ *  racing for the same slots. Like in commit, the "stored" timestamps of a key
+ *  only change while its lock is held, and the cache must never return any
+ *  others, in particular never ones that a racing fill read before a change.
+ * -----------------------------------------------------------------------------
+ */
+#include <pthread.h>
+
+#include "splinterdb/public_platform.h"
+#include "splinterdb/default_data_config.h"
+#include "unit_tests.h"
+#include "tictoc_ts_cache.h"
+#include "../functional/random.h"
+#include "ctest.h" // This is required for all test-case files.
+
+#define TEST_MAX_KEY_SIZE 16
+
+// Several keys per slot, so that keys keep evicting each other
+#define NUM_KEYS    16
+#define NUM_SLOTS   4
+#define NUM_THREADS 8
+#define NUM_ROUNDS  100000
+
+// Hard-coded format string to generate keys
+static const char key_fmt[] = "key-%04d";
+#define TEST_KEY_LENGTH (8)
+
+/*
+ * What the test has "stored" for each key, which is what splinterdb has in
+ * commit: the rts of a key is its index (so that a mix-up of keys shows) and
+ * its wts a version, which is only changed under the lock of the key.
+ */
+typedef struct {
+   pthread_mutex_t          locks[NUM_KEYS];
+   volatile tictoc_timestamp versions[NUM_KEYS];
+} stored_keys;
+
+typedef enum {
+   // change the timestamps of keys, under their locks
+   WORKER_SET,
+   // look up keys without their locks, filling the cache on misses
+   WORKER_FILL,
+   // look up keys under their locks, and check that hits are up to date
+   WORKER_CHECK,
+} worker_type;
+
+// Configuration and results of each worker thread
+typedef struct {
+   tictoc_ts_cache *cache;
+   stored_keys     *stored;
+   uint64           seed;
+   worker_type      type;
+   uint64           hits;
+   // Times the cache returned timestamps that were not the stored ones
+   uint64 stale;
+} worker_config;
+
+static void *
+exec_worker(void *w);
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(tictoc_ts_cache)
+{
+   data_config      default_data_cfg;
+   tictoc_ts_cache *cache;
+   stored_keys      stored;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(tictoc_ts_cache)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   default_data_config_init(TEST_MAX_KEY_SIZE, &data->default_data_cfg);
+   data->cache = tictoc_ts_cache_create(&data->default_data_cfg, NUM_SLOTS);
+   for (int i = 0; i < NUM_KEYS; i++) {
+      pthread_mutex_init(&data->stored.locks[i], NULL);
+      data->stored.versions[i] = 0;
+   }
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(tictoc_ts_cache)
+{
+   for (int i = 0; i < NUM_KEYS; i++) {
+      pthread_mutex_destroy(&data->stored.locks[i]);
+   }
+   tictoc_ts_cache_destroy(data->cache);
+}
+
+/*
+ * A fill of timestamps that were read before a change of the key must be
+ * dropped, as must one for a slot that another key took meanwhile.
+ */
+CTEST2(tictoc_ts_cache, test_fill_after_change)
+{
+   // all keys share the one slot
+   tictoc_ts_cache *cache = tictoc_ts_cache_create(&data->default_data_cfg, 1);
+   char             key_buffer[TEST_MAX_KEY_SIZE];
+   char             other_key_buffer[TEST_MAX_KEY_SIZE];
+   snprintf(key_buffer, sizeof(key_buffer), key_fmt, 1);
+   snprintf(other_key_buffer, sizeof(other_key_buffer), key_fmt, 2);
+   slice key       = slice_create(TEST_KEY_LENGTH, key_buffer);
+   slice other_key = slice_create(TEST_KEY_LENGTH, other_key_buffer);
+
+   tictoc_timestamp_set ts_set;
+   uint64               fill_token;
+   tictoc_timestamp_set old_ts_set = {.rts = 1, .wts = 1};
+   tictoc_timestamp_set new_ts_set = {.rts = 1, .wts = 2};
+   ASSERT_FALSE(tictoc_ts_cache_lookup(cache, key, &ts_set, &fill_token));
+   // a commit changes the key between the read and the fill
+   tictoc_ts_cache_set(cache, key, new_ts_set);
+   tictoc_ts_cache_fill(cache, key, old_ts_set, fill_token);
+   ASSERT_TRUE(tictoc_ts_cache_lookup(cache, key, &ts_set, &fill_token));
+   ASSERT_EQUAL(new_ts_set.wts, ts_set.wts);
+
+   // another key evicts it between the read and the fill
+   tictoc_timestamp_set other_ts_set = {.rts = 2, .wts = 1};
+   ASSERT_FALSE(tictoc_ts_cache_lookup(cache, other_key, &ts_set, &fill_token));
+   tictoc_ts_cache_set(cache, key, old_ts_set);
+   tictoc_ts_cache_fill(cache, other_key, other_ts_set, fill_token);
+   ASSERT_FALSE(tictoc_ts_cache_lookup(cache, other_key, &ts_set, &fill_token));
+   ASSERT_TRUE(tictoc_ts_cache_lookup(cache, key, &ts_set, &fill_token));
+   ASSERT_EQUAL(old_ts_set.wts, ts_set.wts);
+
+   // and without a race, the fill evicts the key
+   ASSERT_FALSE(tictoc_ts_cache_lookup(cache, other_key, &ts_set, &fill_token));
+   tictoc_ts_cache_fill(cache, other_key, other_ts_set, fill_token);
+   ASSERT_TRUE(tictoc_ts_cache_lookup(cache, other_key, &ts_set, &fill_token));
+   ASSERT_EQUAL(other_ts_set.rts, ts_set.rts);
+   ASSERT_FALSE(tictoc_ts_cache_lookup(cache, key, &ts_set, &fill_token));
+
+   tictoc_ts_cache_destroy(cache);
+}
+
+/*
+ * Setters, fillers and checkers of overlapping keys all run at once. Checkers
+ * must only ever get the stored timestamps from the cache, and must get some.
+ */
+CTEST2(tictoc_ts_cache, test_concurrent_fill_and_evict)
+{
+   worker_config wcfg[NUM_THREADS];
+   pthread_t     thread_ids[NUM_THREADS];
+   for (int i = 0; i < NUM_THREADS; i++) {
+      wcfg[i] = (worker_config){.cache  = data->cache,
+                                .stored = &data->stored,
+                                .seed   = i + 1,
+                                .type   = i % 3};
+      int rc  = pthread_create(&thread_ids[i], NULL, &exec_worker, &wcfg[i]);
+      ASSERT_EQUAL(0, rc);
+   }
+   for (int i = 0; i < NUM_THREADS; i++) {
+      int rc = pthread_join(thread_ids[i], NULL);
+      ASSERT_EQUAL(0, rc);
+   }
+
+   uint64 check_hits = 0;
+   for (int i = 0; i < NUM_THREADS; i++) {
+      ASSERT_EQUAL(0, wcfg[i].stale, "Thread %d got stale timestamps\n", i);
+      if (wcfg[i].type == WORKER_CHECK) {
+         check_hits += wcfg[i].hits;
+      }
+   }
+   CTEST_LOG_INFO("%lu hits of checkers\n", check_hits);
+   ASSERT_NOT_EQUAL(0, check_hits);
+
+   // Once everything is quiet, each key is either not cached or up to date
+   char key_buffer[TEST_MAX_KEY_SIZE];
+   for (int i = 0; i < NUM_KEYS; i++) {
+      snprintf(key_buffer, sizeof(key_buffer), key_fmt, i);
+      tictoc_timestamp_set ts_set;
+      uint64               fill_token;
+      if (tictoc_ts_cache_lookup(data->cache,
+                                 slice_create(TEST_KEY_LENGTH, key_buffer),
+                                 &ts_set,
+                                 &fill_token))
+      {
+         ASSERT_EQUAL(i, ts_set.rts);
+         ASSERT_EQUAL(data->stored.versions[i], ts_set.wts);
+      }
+   }
+}
+
+static void *
+exec_worker(void *w)
+{
+   worker_config *wcfg   = (worker_config *)w;
+   stored_keys   *stored = wcfg->stored;
+   random_state   rand_state;
+   random_init(&rand_state, wcfg->seed, 0);
+
+   char key_buffer[TEST_MAX_KEY_SIZE];
+   for (int round = 0; round < NUM_ROUNDS; round++) {
+      int k = random_next_uint32(&rand_state) % NUM_KEYS;
+      snprintf(key_buffer, sizeof(key_buffer), key_fmt, k);
+      slice key = slice_create(TEST_KEY_LENGTH, key_buffer);
+
+      tictoc_timestamp_set ts_set;
+      uint64               fill_token;
+      switch (wcfg->type) {
+         case WORKER_SET:
+            pthread_mutex_lock(&stored->locks[k]);
+            ts_set = (tictoc_timestamp_set){.rts = k,
+                                            .wts = ++stored->versions[k]};
+            tictoc_ts_cache_set(wcfg->cache, key, ts_set);
+            pthread_mutex_unlock(&stored->locks[k]);
+            break;
+
+         case WORKER_FILL:
+            if (tictoc_ts_cache_lookup(wcfg->cache, key, &ts_set, &fill_token))
+            {
+               wcfg->hits++;
+               // may have changed since, but can't be newer than stored
+               if (ts_set.rts != k || ts_set.wts > stored->versions[k]) {
+                  wcfg->stale++;
+               }
+            } else {
+               // "read" the stored timestamps, which may change meanwhile
+               ts_set = (tictoc_timestamp_set){.rts = k,
+                                               .wts = stored->versions[k]};
+               platform_yield();
+               tictoc_ts_cache_fill(wcfg->cache, key, ts_set, fill_token);
+            }
+            break;
+
+         case WORKER_CHECK:
+            pthread_mutex_lock(&stored->locks[k]);
+            if (tictoc_ts_cache_lookup(wcfg->cache, key, &ts_set, &fill_token))
+            {
+               wcfg->hits++;
+               if (ts_set.rts != k || ts_set.wts != stored->versions[k]) {
+                  wcfg->stale++;
+               }
+            } else {
+               ts_set = (tictoc_timestamp_set){.rts = k,
+                                               .wts = stored->versions[k]};
+               tictoc_ts_cache_fill(wcfg->cache, key, ts_set, fill_token);
+            }
+            pthread_mutex_unlock(&stored->locks[k]);
+            break;
+      }
+   }
+   return NULL;
+}
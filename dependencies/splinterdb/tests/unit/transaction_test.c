@@ -0,0 +1,535 @@
+// Copyright 2021 VMware, Inc.
+// SPDX-License-Identifier: Apache-2.0
+
+/*
+ * -----------------------------------------------------------------------------
+ * transaction_test.c --
+ *
+ *  Exercises the transactional API in transaction.c: the validation of the
+ *  ranges a txn scans with a transactional_iterator, and of the keys that a
+ *  txn looks up and doesn't find.
+ * -----------------------------------------------------------------------------
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "splinterdb/public_platform.h"
+#include "splinterdb/default_data_config.h"
+#include "splinterdb/transaction.h"
+#include "unit_tests.h"
+#include "ctest.h" // This is required for all test-case files.
+
+#define TEST_MAX_KEY_SIZE 16
+
+// Hard-coded format string to generate keys, which sort in numeric order
+static const char key_fmt[] = "key-%04d";
+#define TEST_KEY_LENGTH (8)
+
+// Keys for the large txns, all after the ones above
+static const char big_key_fmt[] = "lot-%07d";
+#define BIG_KEY_LENGTH (11)
+
+static slice
+make_key(char *buffer, int i);
+
+static int
+write_committed(transactional_splinterdb *kvsb, int i, bool is_delete);
+
+static int
+scan(transactional_iterator *it, int max_keys);
+
+/*
+ * Global data declaration macro:
+ */
+CTEST_DATA(transaction)
+{
+   transactional_splinterdb *kvsb;
+   splinterdb_config         cfg;
+   data_config               default_data_cfg;
+};
+
+// Optional setup function for suite, called before every test in suite
+CTEST_SETUP(transaction)
+{
+   if (Ctest_verbose) {
+      platform_set_log_streams(stdout, stderr);
+   }
+
+   default_data_config_init(TEST_MAX_KEY_SIZE, &data->default_data_cfg);
+   data->cfg = (splinterdb_config){.filename   = TEST_DB_NAME,
+                                   .cache_size = 64 * Mega,
+                                   .disk_size  = 127 * Mega,
+                                   .data_cfg   = &data->default_data_cfg};
+
+   int rc = transactional_splinterdb_create(&data->cfg, &data->kvsb);
+   ASSERT_EQUAL(0, rc);
+
+   // keys 0, 10, ..., 90
+   for (int i = 0; i < 100; i += 10) {
+      rc = write_committed(data->kvsb, i, FALSE);
+      ASSERT_EQUAL(0, rc);
+   }
+}
+
+// Optional teardown function for suite, called after every test in suite
+CTEST_TEARDOWN(transaction)
+{
+   if (data->kvsb) {
+      transactional_splinterdb_close(&data->kvsb);
+   }
+}
+
+/*
+ * Scans [20, 60) in a txn that then writes, and commits with nothing else
+ * having written to the range.
+ */
+CTEST2(transaction, test_range_scan_commits)
+{
+   char        key_buffer[TEST_MAX_KEY_SIZE];
+   char        end_buffer[TEST_MAX_KEY_SIZE];
+   transaction txn;
+   int         rc = transactional_splinterdb_begin(data->kvsb, &txn);
+   ASSERT_EQUAL(0, rc);
+
+   transactional_iterator *it;
+   rc = transactional_iterator_init(data->kvsb,
+                                    &txn,
+                                    &it,
+                                    make_key(key_buffer, 20),
+                                    make_key(end_buffer, 60),
+                                    FALSE,
+                                    FALSE);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_EQUAL(4, scan(it, 100));
+   ASSERT_EQUAL(0, transactional_iterator_status(it));
+   transactional_iterator_deinit(it);
+
+   // writes after the range, and right at its (excluded) end, don't conflict
+   rc = write_committed(data->kvsb, 60, FALSE);
+   ASSERT_EQUAL(0, rc);
+   rc = write_committed(data->kvsb, 75, FALSE);
+   ASSERT_EQUAL(0, rc);
+
+   rc = transactional_splinterdb_insert(data->kvsb,
+                                        &txn,
+                                        make_key(key_buffer, 1000),
+                                        slice_create(5, "found"));
+   ASSERT_EQUAL(0, rc);
+   rc = transactional_splinterdb_commit(data->kvsb, &txn);
+   ASSERT_EQUAL(0, rc);
+}
+
+/*
+ * A txn may write into a range it has scanned itself.
+ */
+CTEST2(transaction, test_write_into_scanned_range)
+{
+   char        key_buffer[TEST_MAX_KEY_SIZE];
+   char        end_buffer[TEST_MAX_KEY_SIZE];
+   transaction txn;
+   int         rc = transactional_splinterdb_begin(data->kvsb, &txn);
+   ASSERT_EQUAL(0, rc);
+
+   transactional_iterator *it;
+   rc = transactional_iterator_init(data->kvsb,
+                                    &txn,
+                                    &it,
+                                    make_key(key_buffer, 20),
+                                    make_key(end_buffer, 60),
+                                    FALSE,
+                                    FALSE);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_EQUAL(4, scan(it, 100));
+   transactional_iterator_deinit(it);
+
+   rc = transactional_splinterdb_insert(data->kvsb,
+                                        &txn,
+                                        make_key(key_buffer, 45),
+                                        slice_create(5, "found"));
+   ASSERT_EQUAL(0, rc);
+   rc = transactional_splinterdb_commit(data->kvsb, &txn);
+   ASSERT_EQUAL(0, rc);
+}
+
+/*
+ * A key inserted into a scanned range by another txn before the scanning txn
+ * commits is a phantom, so the scanning txn can't commit.
+ */
+CTEST2(transaction, test_phantom_insert_aborts)
+{
+   char        key_buffer[TEST_MAX_KEY_SIZE];
+   char        end_buffer[TEST_MAX_KEY_SIZE];
+   transaction txn;
+   int         rc = transactional_splinterdb_begin(data->kvsb, &txn);
+   ASSERT_EQUAL(0, rc);
+
+   transactional_iterator *it;
+   rc = transactional_iterator_init(data->kvsb,
+                                    &txn,
+                                    &it,
+                                    make_key(key_buffer, 20),
+                                    make_key(end_buffer, 60),
+                                    FALSE,
+                                    FALSE);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_EQUAL(4, scan(it, 100));
+   transactional_iterator_deinit(it);
+
+   rc = write_committed(data->kvsb, 35, FALSE);
+   ASSERT_EQUAL(0, rc);
+
+   rc = transactional_splinterdb_insert(data->kvsb,
+                                        &txn,
+                                        make_key(key_buffer, 1000),
+                                        slice_create(5, "found"));
+   ASSERT_EQUAL(0, rc);
+   rc = transactional_splinterdb_commit(data->kvsb, &txn);
+   ASSERT_NOT_EQUAL(0, rc);
+}
+
+/*
+ * Like a phantom insert, a key deleted from a scanned range, or an update of
+ * one of its keys, fails the scanning txn.
+ */
+CTEST2(transaction, test_phantom_delete_aborts)
+{
+   char key_buffer[TEST_MAX_KEY_SIZE];
+   char end_buffer[TEST_MAX_KEY_SIZE];
+   for (int round = 0; round < 2; round++) {
+      transaction txn;
+      int         rc = transactional_splinterdb_begin(data->kvsb, &txn);
+      ASSERT_EQUAL(0, rc);
+
+      transactional_iterator *it;
+      rc = transactional_iterator_init(data->kvsb,
+                                       &txn,
+                                       &it,
+                                       make_key(key_buffer, 20),
+                                       make_key(end_buffer, 60),
+                                       FALSE,
+                                       FALSE);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_EQUAL(4 - round, scan(it, 100)); // 40 is gone in the second
+      transactional_iterator_deinit(it);
+
+      // the first round deletes 40, the second updates 30
+      rc = write_committed(data->kvsb, round ? 30 : 40, round == 0);
+      ASSERT_EQUAL(0, rc);
+
+      rc = transactional_splinterdb_insert(data->kvsb,
+                                           &txn,
+                                           make_key(key_buffer, 1000),
+                                           slice_create(5, "found"));
+      ASSERT_EQUAL(0, rc);
+      rc = transactional_splinterdb_commit(data->kvsb, &txn);
+      ASSERT_NOT_EQUAL(0, rc);
+   }
+}
+
+/*
+ * A reverse scan covers the range from its end down, so a phantom anywhere in
+ * it fails the txn too.
+ */
+CTEST2(transaction, test_reverse_phantom_insert_aborts)
+{
+   char        key_buffer[TEST_MAX_KEY_SIZE];
+   char        end_buffer[TEST_MAX_KEY_SIZE];
+   transaction txn;
+   int         rc = transactional_splinterdb_begin(data->kvsb, &txn);
+   ASSERT_EQUAL(0, rc);
+
+   transactional_iterator *it;
+   rc = transactional_iterator_init(data->kvsb,
+                                    &txn,
+                                    &it,
+                                    make_key(key_buffer, 20),
+                                    make_key(end_buffer, 60),
+                                    FALSE,
+                                    TRUE);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_EQUAL(4, scan(it, 100));
+   transactional_iterator_deinit(it);
+
+   rc = write_committed(data->kvsb, 25, FALSE);
+   ASSERT_EQUAL(0, rc);
+
+   rc = transactional_splinterdb_commit(data->kvsb, &txn);
+   ASSERT_NOT_EQUAL(0, rc);
+}
+
+/*
+ * Only the part of the range the iterator has stepped over is read, so a
+ * phantom in the part it never got to doesn't matter.
+ */
+CTEST2(transaction, test_partial_scan)
+{
+   char key_buffer[TEST_MAX_KEY_SIZE];
+   char end_buffer[TEST_MAX_KEY_SIZE];
+   for (int round = 0; round < 2; round++) {
+      transaction txn;
+      int         rc = transactional_splinterdb_begin(data->kvsb, &txn);
+      ASSERT_EQUAL(0, rc);
+
+      // reads 20 and 30, and stops at 40
+      transactional_iterator *it;
+      rc = transactional_iterator_init(data->kvsb,
+                                       &txn,
+                                       &it,
+                                       make_key(key_buffer, 20),
+                                       make_key(end_buffer, 60),
+                                       FALSE,
+                                       FALSE);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_EQUAL(2, scan(it, 2));
+      transactional_iterator_deinit(it);
+
+      // the first round inserts past where the scan stopped
+      rc = write_committed(data->kvsb, round ? 25 + round : 55, FALSE);
+      ASSERT_EQUAL(0, rc);
+
+      rc = transactional_splinterdb_commit(data->kvsb, &txn);
+      if (round == 0) {
+         ASSERT_EQUAL(0, rc);
+      } else {
+         ASSERT_NOT_EQUAL(0, rc);
+      }
+   }
+}
+
+/*
+ * After a seek, the keys read before it are still covered, and the keys the
+ * iterator jumped over are not.
+ */
+CTEST2(transaction, test_seek)
+{
+   char key_buffer[TEST_MAX_KEY_SIZE];
+   for (int round = 0; round < 3; round++) {
+      transaction txn;
+      int         rc = transactional_splinterdb_begin(data->kvsb, &txn);
+      ASSERT_EQUAL(0, rc);
+
+      // reads 0 and 10, then jumps to 70 and reads 70 and 80
+      transactional_iterator *it;
+      rc = transactional_iterator_init(
+         data->kvsb, &txn, &it, NULL_SLICE, NULL_SLICE, FALSE, FALSE);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_EQUAL(2, scan(it, 2));
+      transactional_iterator_release(it);
+      rc = transactional_iterator_seek(it, make_key(key_buffer, 70));
+      ASSERT_EQUAL(0, rc);
+      ASSERT_EQUAL(2, scan(it, 2));
+      transactional_iterator_deinit(it);
+
+      // into the gap, before the seek, and after it
+      static const int phantoms[] = {45, 5, 75};
+      rc = write_committed(data->kvsb, phantoms[round], FALSE);
+      ASSERT_EQUAL(0, rc);
+
+      rc = transactional_splinterdb_commit(data->kvsb, &txn);
+      if (round == 0) {
+         ASSERT_EQUAL(0, rc);
+      } else {
+         ASSERT_NOT_EQUAL(0, rc);
+      }
+   }
+}
+
+/*
+ * Scans of a read-only txn aren't recorded, there is nothing to validate.
+ */
+CTEST2(transaction, test_read_only_scan)
+{
+   transaction txn;
+   int         rc = transactional_splinterdb_begin_read_only(data->kvsb, &txn);
+   ASSERT_EQUAL(0, rc);
+
+   transactional_iterator *it;
+   rc = transactional_iterator_init(
+      data->kvsb, &txn, &it, NULL_SLICE, NULL_SLICE, FALSE, FALSE);
+   ASSERT_EQUAL(0, rc);
+   ASSERT_EQUAL(10, scan(it, 100));
+   transactional_iterator_deinit(it);
+   ASSERT_EQUAL(0, txn.tictoc.read_cnt);
+
+   rc = write_committed(data->kvsb, 35, FALSE);
+   ASSERT_EQUAL(0, rc);
+   rc = transactional_splinterdb_commit(data->kvsb, &txn);
+   ASSERT_EQUAL(0, rc);
+}
+
+/*
+ * A txn with a write set, and then one with a read set, far larger than the
+ * sets start out as, which grow to fit.
+ */
+CTEST2(transaction, test_large_txn)
+{
+   const int   num_keys = 200 * 1000;
+   char        key_buffer[TEST_MAX_KEY_SIZE];
+   transaction txn;
+   int         rc = transactional_splinterdb_begin(data->kvsb, &txn);
+   ASSERT_EQUAL(0, rc);
+
+   for (int i = 0; i < num_keys; i++) {
+      snprintf(key_buffer, sizeof(key_buffer), big_key_fmt, i);
+      slice key = slice_create(BIG_KEY_LENGTH, key_buffer);
+      rc        = transactional_splinterdb_insert(data->kvsb, &txn, key, key);
+      ASSERT_EQUAL(0, rc);
+   }
+   ASSERT_EQUAL(num_keys, txn.tictoc.write_cnt);
+   rc = transactional_splinterdb_commit(data->kvsb, &txn);
+   ASSERT_EQUAL(0, rc);
+
+   rc = transactional_splinterdb_begin(data->kvsb, &txn);
+   ASSERT_EQUAL(0, rc);
+   splinterdb_lookup_result result;
+   transactional_splinterdb_lookup_result_init(data->kvsb, &result, 0, NULL);
+   for (int i = 0; i < num_keys; i++) {
+      snprintf(key_buffer, sizeof(key_buffer), big_key_fmt, i);
+      slice key = slice_create(BIG_KEY_LENGTH, key_buffer);
+      rc = transactional_splinterdb_lookup(data->kvsb, &txn, key, &result);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_TRUE(splinterdb_lookup_found(&result));
+      slice value;
+      rc = splinterdb_lookup_result_value(&result, &value);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_EQUAL(BIG_KEY_LENGTH, slice_length(value));
+      ASSERT_EQUAL(0, memcmp(key_buffer, slice_data(value), BIG_KEY_LENGTH));
+   }
+   splinterdb_lookup_result_deinit(&result);
+   ASSERT_EQUAL(num_keys, txn.tictoc.read_cnt);
+
+   rc = transactional_splinterdb_insert(data->kvsb,
+                                        &txn,
+                                        make_key(key_buffer, 1000),
+                                        slice_create(5, "found"));
+   ASSERT_EQUAL(0, rc);
+   rc = transactional_splinterdb_commit(data->kvsb, &txn);
+   ASSERT_EQUAL(0, rc);
+}
+
+/*
+ * A txn that looks up a missing key and then inserts it (as a conditional
+ * write of a key that must not exist does) fails if another txn inserted the
+ * key in between, and commits otherwise.
+ */
+CTEST2(transaction, test_absent_key_insert_aborts)
+{
+   char        key_buffer[TEST_MAX_KEY_SIZE];
+   transaction txn;
+   for (int round = 0; round < 2; round++) {
+      int rc = transactional_splinterdb_begin(data->kvsb, &txn);
+      ASSERT_EQUAL(0, rc);
+
+      splinterdb_lookup_result result;
+      transactional_splinterdb_lookup_result_init(data->kvsb, &result, 0, NULL);
+      rc = transactional_splinterdb_lookup(
+         data->kvsb, &txn, make_key(key_buffer, 35 + round), &result);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_FALSE(splinterdb_lookup_found(&result));
+      splinterdb_lookup_result_deinit(&result);
+
+      bool concurrent_insert = round == 0;
+      if (concurrent_insert) {
+         rc = write_committed(data->kvsb, 35, FALSE);
+         ASSERT_EQUAL(0, rc);
+      }
+
+      rc = transactional_splinterdb_insert(data->kvsb,
+                                           &txn,
+                                           make_key(key_buffer, 35 + round),
+                                           slice_create(5, "mine!"));
+      ASSERT_EQUAL(0, rc);
+      rc = transactional_splinterdb_commit(data->kvsb, &txn);
+      if (concurrent_insert) {
+         ASSERT_NOT_EQUAL(0, rc);
+      } else {
+         ASSERT_EQUAL(0, rc);
+      }
+   }
+}
+
+/*
+ * A missing key that a txn only looked up fails it as well if it is inserted
+ * meanwhile, while a write of another key doesn't.
+ */
+CTEST2(transaction, test_absent_key_read_aborts)
+{
+   char        key_buffer[TEST_MAX_KEY_SIZE];
+   transaction txn;
+   for (int round = 0; round < 2; round++) {
+      int rc = transactional_splinterdb_begin(data->kvsb, &txn);
+      ASSERT_EQUAL(0, rc);
+
+      splinterdb_lookup_result result;
+      transactional_splinterdb_lookup_result_init(data->kvsb, &result, 0, NULL);
+      rc = transactional_splinterdb_lookup(
+         data->kvsb, &txn, make_key(key_buffer, 45), &result);
+      ASSERT_EQUAL(0, rc);
+      ASSERT_FALSE(splinterdb_lookup_found(&result));
+      splinterdb_lookup_result_deinit(&result);
+
+      // the key itself, or one next to it
+      rc = write_committed(data->kvsb, round == 0 ? 45 : 46, FALSE);
+      ASSERT_EQUAL(0, rc);
+
+      rc = transactional_splinterdb_insert(data->kvsb,
+                                           &txn,
+                                           make_key(key_buffer, 1000),
+                                           slice_create(5, "found"));
+      ASSERT_EQUAL(0, rc);
+      rc = transactional_splinterdb_commit(data->kvsb, &txn);
+      if (round == 0) {
+         ASSERT_NOT_EQUAL(0, rc);
+         rc = write_committed(data->kvsb, 45, TRUE);
+         ASSERT_EQUAL(0, rc);
+      } else {
+         ASSERT_EQUAL(0, rc);
+      }
+   }
+}
+
+static slice
+make_key(char *buffer, int i)
+{
+   snprintf(buffer, TEST_KEY_LENGTH + 1, key_fmt, i);
+   return slice_create(TEST_KEY_LENGTH, buffer);
+}
+
+/*
+ * Inserts (or deletes) key i in a txn of its own.
+ *
+ * Returns: the commit's return code, 0 if it committed
+ */
+static int
+write_committed(transactional_splinterdb *kvsb, int i, bool is_delete)
+{
+   char        key_buffer[TEST_MAX_KEY_SIZE];
+   slice       key = make_key(key_buffer, i);
+   transaction txn;
+   int         rc = transactional_splinterdb_begin(kvsb, &txn);
+   if (rc == 0) {
+      rc = is_delete
+              ? transactional_splinterdb_delete(kvsb, &txn, key)
+              : transactional_splinterdb_insert(kvsb, &txn, key, key);
+   }
+   if (rc != 0) {
+      transactional_splinterdb_abort(kvsb, &txn);
+      return rc;
+   }
+   return transactional_splinterdb_commit(kvsb, &txn);
+}
+
+/*
+ * Steps over up to max_keys keys, returning how many there were.
+ */
+static int
+scan(transactional_iterator *it, int max_keys)
+{
+   int count = 0;
+   for (; count < max_keys && transactional_iterator_valid(it);
+        transactional_iterator_next(it))
+   {
+      count++;
+   }
+   return count;
+}
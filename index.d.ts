@@ -31,6 +31,13 @@ declare namespace lmdb {
 		**/
 		getBinaryFast(id: K): Buffer | undefined
 
+		/**
+		* Asynchronously get the value stored by given id/key. The lookup is done by a reader thread, so reads
+		* that have to wait on disk don't block the main thread.
+		* @param id The key for the entry
+		**/
+		getAsync(id: K, options?: { txn?: any }, callback?: (error: any, value: V | undefined) => any): Promise<V | undefined>
+
 		/**
 		* Asynchronously fetch the values stored by the given ids and accesses all 
 		* pages to ensure that any hard page faults and disk I/O are performed
@@ -46,6 +53,7 @@ declare namespace lmdb {
 		* @param ids The keys for the entries to get
 		**/
 		getMany(ids: K[], callback?: (error: any, values: V[]) => any): Promise<(V | undefined)[]>
+		getMany(ids: K[], options?: { txn?: any }, callback?: (error: any, values: V[]) => any): Promise<(V | undefined)[]>
 
 		/**
 		* Store the provided value, using the provided id/key
@@ -150,6 +158,11 @@ declare namespace lmdb {
 		* @param options The options for the range/iterator
 		**/
 		getCount(options?: RangeOptions): number
+		/**
+		* Estimate the size in bytes of the keys and values in the given range, from the counts the database keeps
+		* @param options The options for the range
+		**/
+		getApproximateSize(options?: RangeOptions): number
 		/**
 		 * @deprecated since version 2.0, use transaction() instead
 		 */
@@ -306,8 +319,14 @@ declare namespace lmdb {
 		maxDbs?: number
 		/** Set a longer delay (in milliseconds) to wait longer before committing writes to increase the number of writes per transaction (higher latency, but more efficient) **/
 		commitDelay?: number
+		/** The maximum size of the database file, which only grows to this as needed (defaults to 1TB). The size a database was created with is retained when it is reopened. **/
 		mapSize?: number
+		/** The page size, SplinterDB only supports 4096 **/
 		pageSize?: number
+		/** The size of the page cache (defaults to 1/8 of physical memory, with a minimum of 64MB) **/
+		cacheSize?: number
+		/** Compress the leaves of the btrees the engine writes to disk when it compacts (by LZ4, across all the entries of a leaf), which takes less space on disk and in the cache for data with much in common across keys, at the cost of decompressing a leaf when it is read. This applies to what is written from then on, so it can be changed when reopening. **/
+		pageCompression?: boolean
 		overlappingSync?: boolean
 		separateFlushed?: boolean
 		remapChunks?: boolean
@@ -327,6 +346,8 @@ declare namespace lmdb {
 	interface CompressionOptions {
 		threshold?: number
 		dictionary?: Buffer
+		/** Train new dictionaries from the values that are written as they change, and save them under this key (in the root database). Values keep the id of the dictionary they were compressed with, so they can always be read. **/
+		dictionaryKey?: Key
 	}
 	interface RangeOptions {
 		/** Starting key for a range **/
@@ -343,6 +364,10 @@ declare namespace lmdb {
 		offset?: number
 		/** Use a snapshot of the database from when the iterator started **/
 		snapshot?: boolean
+		/** For counts, estimate the count from the counts the database keeps instead of reading through the range,
+		 * which is much faster for large ranges, but includes overwritten and deleted entries that haven't been
+		 * compacted yet **/
+		approximate?: boolean
 	}
 	interface PutOptions {
 		/* Append to the database using MDB_APPEND, which can be faster */
@@ -1,7 +1,7 @@
 import { dirname, join, default as pathModule } from 'path';
 import { fileURLToPath } from 'url';
 import loadNAPI from 'node-gyp-build-optional-packages';
-export let Env, Txn, Dbi, Compression, Cursor, getAddress, createBufferForAddress, clearKeptObjects, globalBuffer, setGlobalBuffer, arch, fs, os, onExit, tmpdir, lmdbError, path, EventEmitter, orderedBinary, MsgpackrEncoder, WeakLRUCache, setEnvMap, getEnvMap, getByBinary, detachBuffer, write, position, iterate, prefetch, resetTxn, getCurrentValue, getCurrentShared, getStringByBinary, getSharedByBinary, getSharedBuffer, compress;
+export let Env, Txn, Dbi, Compression, Cursor, getAddress, createBufferForAddress, clearKeptObjects, globalBuffer, setGlobalBuffer, arch, fs, os, onExit, tmpdir, lmdbError, path, EventEmitter, orderedBinary, MsgpackrEncoder, WeakLRUCache, setEnvMap, getEnvMap, getByBinary, getManyByBinary, startReading, getReadResult, detachBuffer, write, position, iterate, estimateRange, prefetch, resetTxn, getStringByBinary, getSharedByBinary, compress;
 
 path = pathModule;
 let dirName = (typeof __dirname == 'string' ? __dirname : // for bun, which doesn't have fileURLToPath
@@ -52,16 +52,17 @@ export function setNativeFunctions(externals) {
 	createBufferForAddress = externals.createBufferForAddress;
 	clearKeptObjects = externals.clearKeptObjects || function() {};
 	getByBinary = externals.getByBinary;
+	getManyByBinary = externals.getManyByBinary;
+	startReading = externals.startReading;
+	getReadResult = externals.getReadResult;
 	detachBuffer  = externals.detachBuffer;
 	setGlobalBuffer = externals.setGlobalBuffer;
 	globalBuffer = externals.globalBuffer;
-	getSharedBuffer = externals.getSharedBuffer;
 	prefetch = externals.prefetch;
 	iterate = externals.iterate;
 	position = externals.position;
+	estimateRange = externals.estimateRange;
 	resetTxn = externals.resetTxn;
-	getCurrentValue = externals.getCurrentValue;
-	getCurrentShared = externals.getCurrentShared;
 	getStringByBinary = externals.getStringByBinary;
 	getSharedByBinary = externals.getSharedByBinary;
 	write = externals.write;
@@ -9,16 +9,18 @@ export let v8AccelerationEnabled = false
 let versions = process.versions;
 let [ majorVersion, minorVersion ] = versions.node.split('.')
 
-if (versions.v8 && +majorVersion == nativeAddon.version.nodeCompiledVersion) {
+if (versions.v8 && !process.isBun && +majorVersion == nativeAddon.version.nodeCompiledVersion &&
+		!process.env.DISABLE_DIRECT_V8) {
+	// the direct V8 functions depend on the V8 ABI, so they are only used on the node version we were compiled for
 	let v8Funcs = {};
-/*	let fastApiCalls = (majorVersion == 17 || majorVersion == 18 || majorVersion == 16 && minorVersion > 6) &&
- !process.env.DISABLE_TURBO_CALLS;
+	let fastApiCalls = (majorVersion > 16 || majorVersion == 16 && minorVersion > 6) &&
+		!process.env.DISABLE_TURBO_CALLS;
 
-	if (fastApiCalls)
+	// returns whether this build has fast API calls (it only does where its copy of the header matches V8)
+	if (nativeAddon.enableDirectV8(v8Funcs, fastApiCalls))
 		setFlagsFromString('--turbo-fast-api-calls')
-	nativeAddon.enableDirectV8(v8Funcs, fastApiCalls);
 	Object.assign(nativeAddon, v8Funcs);
-	v8AccelerationEnabled = true;*/
+	v8AccelerationEnabled = true;
 } else if (majorVersion == 14) {
 	// node v14 only has ABI compatibility with node v16 for zero-arg clearKeptObjects
 	let v8Funcs = {};
@@ -1,7 +1,7 @@
 import { Compression, getAddress, arch, fs, path as pathModule, lmdbError, EventEmitter, MsgpackrEncoder, Env, Dbi, tmpdir, os, nativeAddon } from './native.js';
 import { CachingStore, setGetLastVersion } from './caching.js';
 import { addReadMethods, makeReusableBuffer } from './read.js';
-import { addWriteMethods } from './write.js';
+import { addWriteMethods, ABORT } from './write.js';
 import { applyKeyHandling } from './keys.js';
 let moduleRequire = typeof require == 'function' && require;
 export function setRequire(require) {
@@ -24,6 +24,8 @@ const MAX_KEY_SIZE = 4026;
 // 4KB (but is 16KB on M-series MacOS), and this keeps a consistent max key size when no page size specified.
 const DEFAULT_MAX_KEY_SIZE = 1978;
 const DEFAULT_COMMIT_DELAY = 0;
+// trained compression dictionary ids are a byte, and 250 and up are the compression status bytes
+const MAX_DICTIONARIES = 250;
 
 export const allDbs = new Map();
 let defaultCompression;
@@ -96,7 +98,9 @@ export function open(path, options) {
 		(options.noMemInit ? 0x1000000 : 0) |
 		(options.usePreviousSnapshot ? 0x2000000 : 0) |
 		(options.remapChunks ? 0x4000000 : 0) |
-		(options.safeRestore ? 0x8000000 : 0);
+		(options.safeRestore ? 0x8000000 : 0) |
+		(options.pageCompression ? 0x200 : 0) | // compress the engine's btree leaves
+		(options.useVersions ? 0x100 : 0); // values start with their version
 
 	let env = new Env();
 	let jsFlags = (options.overlappingSync ? 0x1000 : 0) |
@@ -144,6 +148,13 @@ export function open(path, options) {
 			else if (dbOptions.compression)
 				dbOptions.compression = makeCompression(dbOptions.compression);
 
+			// the env strips the version header of every value it reads (if it has versions), so the values of all its
+			// stores have to start with one, or none can
+			if (dbOptions.useVersions === undefined)
+				dbOptions.useVersions = options.useVersions;
+			else if (!dbOptions.useVersions != !options.useVersions)
+				throw new Error('The useVersions option of a database has to be the same as that of its environment (' +
+					!!options.useVersions + ')');
 			if (dbOptions.dupSort && (dbOptions.useVersions || dbOptions.cache)) {
 				throw new Error('The dupSort flag can not be combined with versions or caching');
 			}
@@ -212,6 +223,8 @@ export function open(path, options) {
 			this.maxKeySize = maxKeySize;
 			applyKeyHandling(this);
 			allDbs.set(dbName ? name + '-' + dbName : name, this);
+			if (this.isRoot && this.compression && this.compression.dictionaryKey)
+				this.setupDictionaries();
 		}
 		openDB(dbName, dbOptions) {
 			if (this.dupSort && this.name == null)
@@ -320,6 +333,90 @@ export function open(path, options) {
 				copyBuffers: true, // need to copy any embedded buffers that are found since we use unsafe buffers
 			};
 		}
+		setupDictionaries() {
+			// Trained dictionaries are saved under the dictionaryKey as a list of (id byte, uint32 length, dictionary),
+			// without compression, so that they can be read before any of them are loaded. Since ids are less than 250,
+			// the list is never taken for a compressed value.
+			let compression = this.compression;
+			let key = compression.dictionaryKey;
+			let dictionaryStore = this.openDB({ name: 'compression-dictionaries', compression: false, encoding: 'binary',
+				keyEncoding: this.keyEncoding, keyEncoder: this.keyEncoder, keyIsUint32: this.keyIsUint32,
+				keyIsBuffer: this.keyIsBuffer });
+			// other threads and processes train and save dictionaries too, the compression loads the list again when it
+			// reads a value compressed with one it doesn't have yet
+			compression.setDictionaryList(env.address, keyBytes.subarray(0, dictionaryStore.writeKey(key, keyBytes, 0)));
+			function addSaved(saved, compressWithLast) {
+				let lastId = 0;
+				for (let position = 0; saved && position < saved.length;) {
+					let id = saved[position];
+					let length = new DataView(saved.buffer, saved.byteOffset, saved.length).getUint32(position + 1, true);
+					position += 5 + length;
+					// values are compressed with the last one (the most recently trained)
+					compression.addDictionary(id, saved.subarray(position - length, position), compressWithLast && position >= saved.length);
+					lastId = id;
+				}
+				return lastId;
+			}
+			let lastId = addSaved(dictionaryStore.getBinary(key), true);
+			if (options.readOnly)
+				return;
+			let training;
+			compression.writesSinceTraining = 0;
+			compression.retrain = () => {
+				compression.writesSinceTraining = 0;
+				if (training || lastId + 1 >= MAX_DICTIONARIES)
+					return;
+				training = true;
+				compression.train((dictionary) => {
+					if (!dictionary) { // not enough better than the current one
+						training = false;
+						return;
+					}
+					try {
+						let id;
+						do {
+							// the id is the one after the last saved one, which the txn reads, so if another thread or
+							// process saves one meanwhile, the commit fails, and it goes after that one instead
+							dictionaryStore.transactionSync(() => {
+								let existing = dictionaryStore.getBinary(key);
+								let existingLength = existing ? existing.length : 0;
+								id = addSaved(existing, false) + 1;
+								if (id >= MAX_DICTIONARIES)
+									return ABORT;
+								let list = new Uint8Array(existingLength + 5 + dictionary.length);
+								if (existing)
+									list.set(existing);
+								list[existingLength] = id;
+								new DataView(list.buffer).setUint32(existingLength + 1, dictionary.length, true);
+								list.set(dictionary, existingLength + 5);
+								dictionaryStore.put(key, list);
+							});
+							lastId = id - 1;
+							if (id >= MAX_DICTIONARIES)
+								return;
+						} while (!isSavedAs(dictionaryStore.getBinary(key), id, dictionary));
+						lastId = id;
+						// only compress with it once it is saved, so that anything compressed with it can be read
+						compression.addDictionary(id, dictionary, true);
+					} catch (error) {
+						console.error(error);
+					} finally {
+						training = false;
+					}
+				});
+			};
+		}
+	}
+	// whether the list of saved dictionaries has the dictionary under the id
+	function isSavedAs(saved, id, dictionary) {
+		for (let position = 0; saved && position < saved.length;) {
+			let length = new DataView(saved.buffer, saved.byteOffset, saved.length).getUint32(position + 1, true);
+			if (saved[position] == id)
+				return length == dictionary.length &&
+					saved.subarray(position + 5, position + 5 + length).every((byte, i) => byte == dictionary[i]);
+			position += 5 + length;
+		}
+		return false;
 	}
 	// if caching class overrides putSync, don't want to double call the caching code
 	const putSync = SplinterDBStore.prototype.putSync;
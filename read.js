@@ -1,5 +1,5 @@
 import { RangeIterable }  from './util/RangeIterable.js';
-import { getAddress, Cursor, Txn, orderedBinary, lmdbError, getByBinary, detachBuffer, setGlobalBuffer, prefetch, iterate, position as doPosition, resetTxn, getCurrentValue, getCurrentShared, getStringByBinary, globalBuffer, getSharedBuffer } from './native.js';
+import { getAddress, Cursor, Txn, orderedBinary, lmdbError, getByBinary, getManyByBinary, startReading, getReadResult, detachBuffer, setGlobalBuffer, prefetch, iterate, position as doPosition, estimateRange, resetTxn, getStringByBinary, globalBuffer } from './native.js';
 import { saveKey }  from './keys.js';
 const ITERATOR_DONE = { done: true, value: undefined };
 const Uint8ArraySlice = Uint8Array.prototype.slice;
@@ -10,18 +10,29 @@ if (!getValueBytes.maxLength) {
 	getValueBytes.isGlobal = true;
 	Object.defineProperty(getValueBytes, 'length', { value: getValueBytes.length, writable: true, configurable: true });
 }
-const START_ADDRESS_POSITION = 4064;
 const NEW_BUFFER_THRESHOLD = 0x8000;
+const GET_MANY_NO_ROOM = -30002;
+let getManyBuffer, getManyView;
+// where the native iterator writes batches of entries, see src/cursor.cpp (it is never replaced, since cursors keep
+// its address)
+let rangeBuffer, rangeView;
+const RANGE_BUFFER_SIZE = 0x10000;
+const VALUE_NOT_INCLUDED = 0xffffffff;
+let textDecoder;
 export const UNMODIFIED = {};
 
-let unreadResolution, lastQueuedResolution, nextResolution;
+// read instructions that have been queued but not resolved yet, ending with an empty one to fill in next
+let unreadResolution = {}, nextResolution = unreadResolution;
+// status flags of read instructions, see ReadPool in src/reader.cpp
+const READ_REQUESTED = 0x10;
+const READ_DONE = 0x1000000;
+const READ_STOPPED = 0xf0000000;
 
 export function addReadMethods(LMDBStore, {
 	maxKeySize, env, keyBytes, keyBytesView, getLastVersion, getLastTxnId
 }) {
 	let readTxn, readTxnRenewed, asSafeBuffer = false;
 	let renewId = 1;
-	let mmaps = [];
 	Object.assign(LMDBStore.prototype, {
 		getString(id) {
 			(env.writeTxn || (readTxnRenewed ? readTxn : renewReadTxn(this)));
@@ -54,11 +65,7 @@ export function addReadMethods(LMDBStore, {
 					'Zero length key is not allowed in LMDB');
 				if (rc == -30000) // int32 overflow, read uint32
 					rc = this.lastSize = keyBytesView.getUint32(0, true);
-				else if (rc == -30001) {// shared buffer
-					this.lastSize = keyBytesView.getUint32(0, true);
-					let bufferId = keyBytesView.getUint32(4, true);
-					return getMMapBuffer(bufferId, this.lastSize);
-				} else
+				else
 					throw lmdbError(rc);
 			}
 			let compression = this.compression;
@@ -71,31 +78,36 @@ export function addReadMethods(LMDBStore, {
 			bytes.length = this.lastSize;
 			return bytes;
 		},
-		getBFAsync(id, callback, options) {
-			let txn = options.txn || (env.writeTxn || (readTxnRenewed ? readTxn : renewReadTxn(this)));
-			let address = recordReadInstruction(txn.address, this.db.dbi, id, this.writeKey, maxKeySize, ({ bufferId, offset, size }) => {
-				let buffer = mmaps[bufferId];
-				if (!buffer) {
-					buffer = mmaps[bufferId] = getSharedBuffer(bufferId, env.address);
+		getBFAsync(id, options, callback) {
+			if (options?.txn || env.writeTxn) {
+				// the reader threads can't see the writes of an open write txn, so get it directly
+				let bytes = this.getBinary(id, options);
+				return callback(null, bytes === UNMODIFIED ? undefined : bytes);
+			}
+			// queue the read for the reader threads, so a lookup that has to wait on disk doesn't block this thread
+			let address = recordReadInstruction(env, id, this.writeKey, maxKeySize, (error, bytes, compressed) => {
+				if (compressed) {
+					// decompression is done on this thread, and the pages for it are cached now
+					try {
+						bytes = this.getBinary(id);
+					} catch (getError) {
+						error = getError;
+					}
 				}
-				callback(buffer, offset, size);
+				callback(error, bytes);
 			});
-			if (address) {
-				startReading();
-			}
+			if (address)
+				startReading(env.address, address, resolveReads);
 		},
 		getAsync(id, options, callback) {
 			let promise;
 			if (!callback)
-				promise = new Promise(resolve => callback = resolve);
-			this.getBFAsync(id, options, (buffer, offset, size) => {
-				let bytes = new Uint8Array(buffer, offset, size);
-				if (this.encoding == 'binary')
-					callback(bytes);
-				else if (this.decoder) {
-					// the decoder potentially uses the data from the buffer in the future and needs a stable buffer
-					callback(bytes && this.decoder.decode(bytes));
-				}
+				promise = new Promise((resolve, reject) => callback = (error, value) => error ? reject(error) : resolve(value));
+			this.getBFAsync(id, options, (error, bytes) => {
+				if (error)
+					callback(error);
+				else
+					callback(null, bytes && this._decodeValue(bytes, true));
 			});
 			return promise;
 		},
@@ -103,9 +115,7 @@ export function addReadMethods(LMDBStore, {
 			if (!buffer)
 				return
 			if (!buffer.isGlobal && !env.writeTxn) {
-				buffer.txn = readTxn;
-				readTxn.refCount = (readTxn.refCount || 0) + 1;
-				return buffer;
+				return buffer; // has its own memory (see _returnLargeBuffer)
 			} else {
 				return Uint8ArraySlice.call(buffer, 0, this.lastSize);
 			}
@@ -184,9 +194,7 @@ export function addReadMethods(LMDBStore, {
 			if (fastBuffer) {
 				if (fastBuffer.isGlobal || writeTxn)
 					return Uint8ArraySlice.call(fastBuffer, 0, this.lastSize)
-				fastBuffer.txn = readTxn;
-				readTxn.refCount = (readTxn.refCount || 0) + 1;
-				return fastBuffer;
+				return fastBuffer; // has its own memory (see _returnLargeBuffer), so it doesn't depend on the txn
 			}
 		},
 		get(id, options) {
@@ -281,16 +289,36 @@ export function addReadMethods(LMDBStore, {
 		getCount(options) {
 			if (!options)
 				options = {};
+			if (options.approximate)
+				return this._estimateRange(options, 0);
 			options.onlyCount = true;
 			return this.getRange(options).iterate();
 		},
 		getKeysCount(options) {
 			if (!options)
 				options = {};
+			if (options.approximate)
+				return this._estimateRange(options, 0);
 			options.onlyCount = true;
 			options.values = false;
 			return this.getRange(options).iterate();
 		},
+		getApproximateSize(options) {
+			return this._estimateRange(options || {}, 0x20000);
+		},
+		_estimateRange(options, flags) {
+			// estimated from the counts the db keeps, without reading through the range (see estimateRange in
+			// src/cursor.cpp)
+			flags |= (options.reverse ? 0x400 : 0) | (options.inclusiveEnd ? 0x8000 : 0) |
+				(options.exclusiveStart ? 0x10000 : 0);
+			let keySize = options.start === undefined ? 0 : this.writeKey(options.start, keyBytes, 0);
+			let keyHolder = {}; // keeps the buffer the end key is saved in referenced during the call
+			let endAddress = saveKey(options.end, this.writeKey, keyHolder, maxKeySize);
+			let result = estimateRange(env.address, flags, keySize, endAddress);
+			if (result < 0)
+				lmdbError(result);
+			return result;
+		},
 		getValuesCount(key, options) {
 			if (!options)
 				options = {};
@@ -307,191 +335,108 @@ export function addReadMethods(LMDBStore, {
 			let includeVersions = options.versions;
 			let valuesForKey = options.valuesForKey;
 			let limit = options.limit;
-			let db = this.db;
-			let snapshot = options.snapshot;
-			let compression = this.compression;
+			let store = this;
 			iterable.iterate = () => {
 				let currentKey = valuesForKey ? options.key : options.start;
-				const reverse = options.reverse;
 				let count = 0;
-				let cursor, cursorRenewId, cursorAddress;
-				let txn;
-				let flags = (includeValues ? 0x100 : 0) | (reverse ? 0x400 : 0) |
-					(valuesForKey ? 0x800 : 0) | (options.exactMatch ? 0x4000 : 0) |
-					(options.inclusiveEnd ? 0x8000 : 0) |
+				let flags = (includeValues ? 0x100 : 0) | (options.reverse ? 0x400 : 0) | (valuesForKey ? 0x800 : 0) |
+					(options.exactMatch ? 0x4000 : 0) | (options.inclusiveEnd ? 0x8000 : 0) |
 					(options.exclusiveStart ? 0x10000 : 0);
-				let store = this;
-				function resetCursor() {
-					try {
-						if (cursor)
-							finishCursor();
-						let writeTxn = env.writeTxn;
-						if (writeTxn)
-							snapshot = false;
-						txn = writeTxn || (readTxnRenewed ? readTxn : renewReadTxn(store));
-						cursor = !writeTxn && db.availableCursor;
-						if (cursor) {
-							db.availableCursor = null;
-							flags |= 0x2000;
-						} else {
-							cursor = new Cursor(db);
-						}
-						cursorAddress = cursor.address;
-						txn.refCount = (txn.refCount || 0) + 1; // track transaction so we always use the same one
-						if (snapshot === false) {
-							cursorRenewId = renewId; // use shared read transaction
-							txn.renewingrefCount = (txn.renewingrefCount || 0) + 1; // need to know how many are renewing cursors
-						}
-					} catch(error) {
-						if (cursor) {
-							try {
-								cursor.close();
-							} catch(error) { }
-						}
-						throw error;
-					}
-				}
-				resetCursor();
+				// the native iterator writes a batch of entries at a time into the range buffer, which we decode right
+				// away, since reads in the loop body (or other ranges) use the same buffer
+				let entries = [];
+				let entryIndex = 0;
+				if (!rangeBuffer)
+					allocateRangeBuffer();
+				let cursor = env.availableCursor;
+				if (cursor)
+					env.availableCursor = null;
+				else
+					cursor = new Cursor(env, rangeBuffer);
+				let cursorAddress = cursor.address;
 				if (options.onlyCount) {
 					flags |= 0x1000;
 					let count = position(options.offset);
+					finishCursor();
 					if (count < 0)
 						lmdbError(count);
-					finishCursor();
 					return count;
 				}
 				function position(offset) {
 					let keySize = currentKey === undefined ? 0 : store.writeKey(currentKey, keyBytes, 0);
-					let endAddress;
-					if (valuesForKey) {
-						if (options.start === undefined && options.end === undefined)
-							endAddress = 0;
-						else {
-							let startAddress;
-							if (store.encoder.writeKey) {
-								startAddress = saveKey(options.start, store.encoder.writeKey, iterable, maxKeySize);
-								keyBytesView.setFloat64(START_ADDRESS_POSITION, startAddress, true);
-								endAddress = saveKey(options.end, store.encoder.writeKey, iterable, maxKeySize);
-							} else if ((!options.start || options.start instanceof Uint8Array) && (!options.end || options.end instanceof Uint8Array)) {
-								startAddress = saveKey(options.start, orderedBinary.writeKey, iterable, maxKeySize);
-								keyBytesView.setFloat64(START_ADDRESS_POSITION, startAddress, true);
-								endAddress = saveKey(options.end, orderedBinary.writeKey, iterable, maxKeySize);
-							} else {
-								throw new Error('Only key-based encoding is supported for start/end values');
-								let encoded = store.encoder.encode(options.start);
-								let bufferAddress = encoded.buffer.address || (encoded.buffer.address = getAddress(encoded) - encoded.byteOffset);
-								startAddress = bufferAddress + encoded.byteOffset;
-							}
-						}
-					} else
-						endAddress = saveKey(options.end, store.writeKey, iterable, maxKeySize);
+					let endAddress = valuesForKey ? 0 : saveKey(options.end, store.writeKey, iterable, maxKeySize);
+					setMaxEntries();
 					return doPosition(cursorAddress, flags, offset || 0, keySize, endAddress);
 				}
-
+				function setMaxEntries() {
+					rangeView.setUint32(0, limit === undefined ? 0xffffffff : Math.max(limit - count, 0), true);
+				}
 				function finishCursor() {
-					if (txn.isDone)
+					if (!cursor)
 						return;
-					if (cursorRenewId)
-						txn.renewingrefCount--;
-					if (--txn.refCount <= 0 && txn.onlyCursor) {
+					if (env.availableCursor)
 						cursor.close();
-						txn.abort(); // this is no longer main read txn, abort it now that we are done
-						txn.isDone = true;
-					} else {
-						if (db.availableCursor || txn != readTxn) {
-							cursor.close();
-						} else { // try to reuse it
-							db.availableCursor = cursor;
-							db.cursorTxn = txn;
-						}
+					else // reuse it for the next range
+						env.availableCursor = cursor;
+					cursor = null;
+				}
+				function readBatch(entryCount) {
+					if (entryCount < 0)
+						lmdbError(entryCount);
+					entries.length = 0;
+					entryIndex = 0;
+					let position = 8;
+					for (let i = 0; i < entryCount; i++) {
+						let keySize = rangeView.getUint32(position, true);
+						let valueSize = rangeView.getUint32(position + 4, true);
+						let keyStart = position + 16;
+						let key = store.readKey(rangeBuffer, keyStart, keyStart + keySize);
+						let entry = { key };
+						if (includeValues) {
+							let valueStart = keyStart + keySize + 1;
+							if (valueSize == VALUE_NOT_INCLUDED) {
+								// too large for the range buffer, get it by itself
+								entry.value = store.get(key);
+								valueSize = 0;
+							} else
+								entry.value = store._decodeValue(rangeBuffer.subarray(valueStart, valueStart + valueSize));
+						} else
+							valueSize = 0;
+						if (includeVersions)
+							entry.version = rangeView.getFloat64(position + 8, true);
+						entries.push(entry);
+						position = (keyStart + keySize + 1 + valueSize + 7) & ~7;
 					}
 				}
 				return {
 					next() {
-						let keySize, lastSize;
-						if (cursorRenewId && (cursorRenewId != renewId || txn.isDone)) {
-							resetCursor();
-							keySize = position(0);
-						}
-						if (count === 0) { // && includeValues) // on first entry, get current value if we need to
-							keySize = position(options.offset);
-						} else
-							keySize = iterate(cursorAddress);
-						if (keySize <= 0 ||
-								(count++ >= limit)) {
-							if (count < 0)
-								lmdbError(count);
-							finishCursor();
-							return ITERATOR_DONE;
-						}
-						if (!valuesForKey || snapshot === false) {
-							if (keySize > 20000) {
-								if (keySize > 0x1000000)
-									lmdbError(keySize - 0x100000000)
-								throw new Error('Invalid key size ' + keySize.toString(16))
+						if (entryIndex >= entries.length) {
+							if (!cursor || (limit !== undefined && count >= limit)) {
+								finishCursor();
+								return ITERATOR_DONE;
 							}
-							currentKey = store.readKey(keyBytes, 32, keySize + 32);
-						}
-						if (includeValues) {
-							let value;
-							lastSize = keyBytesView.getUint32(0, true);
-							let bufferId = keyBytesView.getUint32(4, true);
-							let bytes;
-							if (bufferId) {
-								bytes = getMMapBuffer(bufferId, lastSize);
-							} else {
-								bytes = compression ? compression.getValueBytes : getValueBytes;
-								if (lastSize > bytes.maxLength) {
-									store.lastSize = lastSize;
-									asSafeBuffer = store.encoding == 'binary';
-									try {
-										bytes = store._returnLargeBuffer(() => getCurrentValue(cursorAddress));
-									} finally {
-										asSafeBuffer = false;
-									}
-								} else
-									bytes.length = lastSize;
-							}
-							if (store.decoder) {
-								value = store.decoder.decode(bytes, lastSize);
-							} else if (store.encoding == 'binary')
-								value = bytes.isGlobal ? Uint8ArraySlice.call(bytes, 0, lastSize) : bytes;
+							if (count === 0)
+								readBatch(position(options.offset));
 							else {
-								value = bytes.toString('utf8', 0, lastSize);
-								if (store.encoding == 'json' && value)
-									value = JSON.parse(value);
+								setMaxEntries();
+								readBatch(iterate(cursorAddress));
+							}
+							if (entries.length === 0) {
+								finishCursor();
+								return ITERATOR_DONE;
 							}
-							if (includeVersions)
-								return {
-									value: {
-										key: currentKey,
-										value,
-										version: getLastVersion()
-									}
-								};
- 							else if (valuesForKey)
-								return {
-									value
-								};
-							else
-								return {
-									value: {
-										key: currentKey,
-										value,
-									}
-								};
-						} else if (includeVersions) {
-							return {
-								value: {
-									key: currentKey,
-									version: getLastVersion()
-								}
-							};
-						} else {
-							return {
-								value: currentKey
-							};
 						}
+						let entry = entries[entryIndex++];
+						count++;
+						if (includeValues) {
+							if (includeVersions)
+								return { value: entry };
+							else if (valuesForKey)
+								return { value: entry.value };
+							return { value: { key: entry.key, value: entry.value } };
+						} else if (includeVersions)
+							return { value: { key: entry.key, version: entry.version } };
+						return { value: entry.key };
 					},
 					return() {
 						finishCursor();
@@ -506,21 +451,70 @@ export function addReadMethods(LMDBStore, {
 			return iterable;
 		},
 
-		getMany(keys, callback) {
-			// this is an asynchronous get for multiple keys. It actually works by prefetching asynchronously,
-			// allowing a separate to absorb the potentially largest cost: hard page faults (and disk I/O).
-			// And then we just do standard sync gets (to deserialized data) to fulfil the callback/promise
-			// once the prefetch occurs
+		getMany(keys, options, callback) {
+			// this is an asynchronous get for multiple keys, but the lookups are all done natively in a single call (in one
+			// snapshot, sorted by key), with the values written into one shared result buffer that we decode from
+			if (typeof options == 'function') {
+				callback = options;
+				options = undefined;
+			}
 			let promise = callback ? undefined : new Promise(resolve => callback = (error, results) => resolve(results));
-			this.prefetch(keys, () => {
-				let results = new Array(keys.length);
+			let results = new Array(keys.length);
+			if (keys.length) {
+				// read in the same txn that get would, a write txn is resolved natively (with an address of 0)
+				let txn = options?.txn || env.writeTxn || (readTxnRenewed ? readTxn : renewReadTxn(this));
+				let buffers = []; // keep the key buffers referenced until the native call is done
+				let startPosition;
+				let bufferHolder = {};
+				let lastBuffer;
+				for (let key of keys) {
+					let position = saveKey(key, this.writeKey, bufferHolder, maxKeySize);
+					if (!startPosition)
+						startPosition = position;
+					if (bufferHolder.saveBuffer != lastBuffer) {
+						buffers.push(bufferHolder);
+						lastBuffer = bufferHolder.saveBuffer;
+						bufferHolder = { saveBuffer: lastBuffer };
+					}
+				}
+				saveKey(undefined, this.writeKey, bufferHolder, maxKeySize);
+				let neededSize = keys.length * 64;
+				if (!getManyBuffer || getManyBuffer.length < neededSize)
+					allocateGetManyBuffer(Math.max(neededSize, 0x10000));
+				let rc = getManyByBinary(env.address, startPosition, keys.length, getManyBuffer, txn.address || 0);
+				if (rc < 0)
+					throw lmdbError(rc);
+				let missedRoom;
 				for (let i = 0, l = keys.length; i < l; i++) {
-					results[i] = get.call(this, keys[i]);
+					let size = getManyView.getInt32(i << 3, true);
+					if (size >= 0) {
+						let offset = getManyView.getUint32((i << 3) + 4, true);
+						results[i] = this._decodeValue(getManyBuffer.subarray(offset, offset + size));
+					} else if (size == GET_MANY_NO_ROOM) {
+						// didn't fit in the shared buffer, get it by itself
+						missedRoom = true;
+						results[i] = get.call(this, keys[i], options);
+					} else if (size != -30798) // not found
+						throw lmdbError(size);
 				}
-				callback(null, results);
-			});
+				if (missedRoom && getManyBuffer.length < 0x4000000)
+					allocateGetManyBuffer(getManyBuffer.length * 2); // grow for next time
+			}
+			callback(null, results);
 			return promise;
 		},
+		_decodeValue(bytes, isOwnBuffer) {
+			if (this.encoding == 'binary')
+				return isOwnBuffer ? bytes : Uint8ArraySlice.call(bytes, 0, bytes.length);
+			if (this.decoder) {
+				// decoders that don't copy need a stable buffer, since the shared buffer is reused
+				return this.decoder.decode(this.decoderCopies || isOwnBuffer ? bytes : Uint8ArraySlice.call(bytes, 0, bytes.length));
+			}
+			let string = (textDecoder || (textDecoder = new TextDecoder())).decode(bytes);
+			if (this.encoding == 'json')
+				return JSON.parse(string);
+			return string;
+		},
 		getSharedBufferForGet(id) {
 			let txn = (env.writeTxn || (readTxnRenewed ? readTxn : renewReadTxn(this)));
 			this.lastSize = this.keyIsCompatibility ? txn.getBinaryShared(id) : this.db.get(this.writeKey(id, keyBytes, 0));
@@ -626,13 +620,13 @@ export function addReadMethods(LMDBStore, {
 	});
 	let get = LMDBStore.prototype.get;
 	let lastReadTxnRef;
-	function getMMapBuffer(bufferId, size) {
-		let buffer = mmaps[bufferId];
-		if (!buffer) {
-			buffer = mmaps[bufferId] = getSharedBuffer(bufferId, env.address);
-		}
-		let offset = keyBytesView.getUint32(8, true);
-		return new Uint8Array(buffer, offset, size);
+	function allocateRangeBuffer() {
+		rangeBuffer = new Uint8A(RANGE_BUFFER_SIZE);
+		rangeView = rangeBuffer.dataView = new DataView(rangeBuffer.buffer, rangeBuffer.byteOffset, rangeBuffer.byteLength);
+	}
+	function allocateGetManyBuffer(size) {
+		getManyBuffer = new Uint8A(size);
+		getManyView = new DataView(getManyBuffer.buffer, getManyBuffer.byteOffset, getManyBuffer.byteLength);
 	}
 	function renewReadTxn(store) {
 		if (!readTxn) {
@@ -657,9 +651,9 @@ export function addReadMethods(LMDBStore, {
 						throw error;
 				}
 			} while (retries++ < 100);
-		}
-		// we actually don't renew here, we let the renew take place in the next 
-		// lmdb native read/call so as to avoid an extra native call
+			// a new txn has just begun its snapshot
+		} else // a kept txn was reset at the end of the last turn, start its new snapshot
+			readTxn.renew();
 		readTxnRenewed = setTimeout(resetReadTxn, 0);
 		store.emit('begin-transaction');
 		return readTxn;
@@ -672,7 +666,8 @@ export function addReadMethods(LMDBStore, {
 				readTxn.onlyCursor = true;
 				lastReadTxnRef = new WeakRef(readTxn);
 				readTxn = null;
-			}
+			} else // keep the txn, it will be renewed (natively) on the next read
+				resetTxn(readTxn.address);
 		}
 	}
 }
@@ -692,71 +687,108 @@ export function makeReusableBuffer(size) {
 }*/
 
 
-let readInstructions, uint32Instructions, instructionsDataView = { setFloat64() {}, setUint32() {} }, instructionsAddress;
-let savePosition = 8000;
-let DYNAMIC_KEY_BUFFER_SIZE = 8192;
-function allocateInstructionsBuffer() {
-	readInstructions = typeof Buffer != 'undefined' ? Buffer.alloc(DYNAMIC_KEY_BUFFER_SIZE) : new Uint8Array(DYNAMIC_KEY_BUFFER_SIZE);
-	uint32Instructions = new Uint32Array(readInstructions.buffer, 0, readInstructions.buffer.byteLength >> 2);
-	uint32Instructions[2] = 0xf0000000; // indicates a new read task must be started
-	instructionsAddress = readInstructions.buffer.address = getAddress(readInstructions);
-	readInstructions.dataView = instructionsDataView = new DataView(readInstructions.buffer, readInstructions.byteOffset, readInstructions.byteLength);
-	savePosition = 0;
+const INSTRUCTIONS_BUFFER_SIZE = 8192;
+// Each env has its own queue of read instructions, since its reader threads look up every instruction they come
+// across in it, in their own db
+function allocateInstructionsBuffer(queue) {
+	if (queue.instructions) {
+		// mark the end of this buffer, so a reader following the queue stops here, and keep it referenced until the
+		// reader has had a chance to get past it
+		Atomics.or(queue.uint32, (queue.position >> 2) + 2, READ_STOPPED);
+		queue.lastInstructions = queue.instructions;
+	}
+	let instructions = queue.instructions = typeof Buffer != 'undefined' ? Buffer.alloc(INSTRUCTIONS_BUFFER_SIZE) : new Uint8Array(INSTRUCTIONS_BUFFER_SIZE);
+	queue.uint32 = new Uint32Array(instructions.buffer, 0, instructions.buffer.byteLength >> 2);
+	queue.uint32[2] = READ_STOPPED; // indicates a new read task must be started
+	queue.address = instructions.buffer.address = getAddress(instructions);
+	instructions.dataView = queue.dataView = new DataView(instructions.buffer, instructions.byteOffset, instructions.byteLength);
+	queue.position = 0;
 }
-export function recordReadInstruction(txn, dbi, key, writeKey, maxKeySize, callback) {
-	if (savePosition > 7800) {
-		allocateInstructionsBuffer();
+// Each instruction is the env address (float64), status, key length, and then the key. Returns the address of the
+// instruction if a reader needs to be started for it.
+export function recordReadInstruction(env, key, writeKey, maxKeySize, callback) {
+	let queue = env.readQueue || (env.readQueue = { position: 8000 });
+	if (queue.position > 7800) {
+		allocateInstructionsBuffer(queue);
 	}
-	let start = savePosition;
-	let keyPosition = savePosition + 16;
+	let start = queue.position;
+	let keyPosition = start + 16;
+	let end;
 	try {
-		savePosition = key === undefined ? keyPosition :
-			writeKey(key, readInstructions, keyPosition);
+		end = key === undefined ? keyPosition :
+			writeKey(key, queue.instructions, keyPosition);
 	} catch (error) {
 		if (error.name == 'RangeError') {
 			if (8180 - start < maxKeySize) {
-				allocateInstructionsBuffer(); // try again:
-				return recordReadInstruction(key, writeKey, saveTo, maxKeySize);
+				allocateInstructionsBuffer(queue); // try again:
+				return recordReadInstruction(env, key, writeKey, maxKeySize, callback);
 			}
 			throw new Error('Key was too large, max key size is ' + maxKeySize);
 		} else
 			throw error;
 	}
-	let length = savePosition - keyPosition;
+	let length = end - keyPosition;
 	if (length > maxKeySize) {
-		savePosition = start;
 		throw new Error('Key of size ' + length + ' was too large, max key size is ' + maxKeySize);
 	}
-	uint32Instructions[start >> 2] =  length; // save the length
-	savePosition = (savePosition + 12) & 0xfffffc;
-	nextResolution.callback = callback;
-	nextResolution.uint32 = uint32Instructions;
-	nextResolution.position = start >> 2;
-	nextResolution = nextResolution.next;
-	instructionsDataView.setFloat64(start, txn.address, true);
-	if (Atomics.or(uint32Instructions, (start >> 2) + 2, dbi)) {
-		return start + instructionsAddress;
+	if (end > 8160) { // need to leave room for the status of the next instruction
+		allocateInstructionsBuffer(queue); // try again:
+		return recordReadInstruction(env, key, writeKey, maxKeySize, callback);
+	}
+	let uint32 = queue.uint32;
+	uint32[(start >> 2) + 3] = length; // save the length
+	queue.position = (end + 12) & 0xfffffc;
+	queue.dataView.setFloat64(start, env.address, true);
+	let resolution = nextResolution;
+	resolution.callback = callback;
+	resolution.uint32 = uint32;
+	resolution.dataView = queue.dataView;
+	resolution.position = start >> 2;
+	nextResolution = resolution.next = {};
+	if (Atomics.or(uint32, (start >> 2) + 2, READ_REQUESTED) & READ_STOPPED) {
+		return start + queue.address;
 	}
 	// else we are writing to an active queue, don't have to start a new task
 }
 
-function resolveReads(async) {
-	let instructionStatus;
-	while ((instructionStatus = unreadResolution.uint32[unreadResolution.position + 2]) & 0x1000000) {
-		let size = unreadResolution.uint32[unreadResolution.position + 3];
-		let reference;
-		switch(instructionStatus & 0xf) {
-			case 0:
-				reference = {
-					bufferId: unreadResolution.uint32[unreadResolution.position],
-					offset: unreadResolution.uint32[unreadResolution.position + 1],
-					size
-				};
+// called by the reader threads when reads have finished, which may be out of order
+function resolveReads() {
+	let previous;
+	for (let resolution = unreadResolution; resolution != nextResolution; resolution = resolution.next) {
+		let { uint32, position } = resolution;
+		let status = Atomics.load(uint32, position + 2);
+		if (!(status & READ_DONE)) {
+			previous = resolution;
+			continue;
+		}
+		if (previous)
+			previous.next = resolution.next;
+		else
+			unreadResolution = resolution.next;
+		let size = uint32[position + 3];
+		let callback = resolution.callback;
+		switch (status & 0xf) {
+			case 1: // in its own buffer
+				callback(null, new Uint8Array(getReadResult(resolution.dataView.getFloat64(position << 2, true), size)));
+				break;
+			case 2: // not found
+				callback(null, undefined);
+				break;
+			case 3: {
+				let error;
+				try {
+					lmdbError(size | 0); // throws the error for the code
+				} catch (thrown) {
+					error = thrown;
+				}
+				callback(error);
+				break;
+			}
+			case 4: // compressed
+				callback(null, undefined, true);
 				break;
 			default:
-				throw new Error('Unknown read response');
+				callback(new Error('Unknown read response'));
 		}
-		unreadResolution.callback(reference);
-		unreadResolution = unreadResolution.next;
 	}
-}
\ No newline at end of file
+}
@@ -1,9 +1,21 @@
 #include "lz4.h"
 #include "splinterdb-js.h"
 #include <atomic>
+#include <queue>
 
 using namespace Napi;
 
+// every this many compressed values, one is sampled for training dictionaries (a power of 2)
+#define DICTIONARY_SAMPLE_INTERVAL 8
+// how much of the start of a value is sampled, and how many samples are kept (the most recent)
+#define DICTIONARY_SAMPLE_SIZE 1024
+#define DICTIONARY_SAMPLES 1024
+#define DICTIONARY_MIN_SAMPLES 64
+// size of trained dictionaries, every compression loads the whole dictionary, so this is kept small
+#define DICTIONARY_TRAINING_SIZE 0x2000
+#define DICTIONARY_SEGMENT_SIZE 64
+#define DICTIONARY_HASH_BITS 18
+
 thread_local LZ4_stream_t* Compression::stream = nullptr;
 Compression::Compression(const CallbackInfo& info) : ObjectWrap<Compression>(info) {
 	unsigned int compressionThreshold = 1000;
@@ -23,16 +35,36 @@ Compression::Compression(const CallbackInfo& info) : ObjectWrap<Compression>(inf
 		if (thresholdOption.IsNumber()) {
 			compressionThreshold = thresholdOption.As<Number>();
 		}
-	}
+		// with a key to save trained dictionaries under, sample values to train them from
+		sampling = !info[0].As<Object>().Get("dictionaryKey").IsUndefined();
+	} else
+		sampling = false;
 	this->dictionary = this->compressDictionary = dictionary;
 	this->dictionarySize = dictSize;
 	this->decompressTarget = dictionary + dictSize;
 	this->decompressSize = 0;
 	this->acceleration = 1;
 	this->compressionThreshold = compressionThreshold;
+	for (int i = 0; i < MAX_DICTIONARIES; i++)
+		this->dictionaries[i] = nullptr;
+	this->compressDictionaryId = 0;
+	this->dictionaryEnv = nullptr;
+	this->sampleCounter = 0;
+	this->nextSample = 0;
+	pthread_mutex_init(&samplesLock, nullptr);
 	info.This().As<Object>().Set("address", Number::New(info.Env(), (double) (size_t) this));
 }
 
+Compression::~Compression() {
+	for (int i = 1; i < MAX_DICTIONARIES; i++) {
+		if (dictionaries[i]) {
+			delete[] dictionaries[i]->data;
+			delete dictionaries[i];
+		}
+	}
+	pthread_mutex_destroy(&samplesLock);
+}
+
 Napi::Value Compression::setBuffer(const CallbackInfo& info) {
 	size_t length;
 	napi_get_buffer_info(info.Env(), info[0], (void**) &this->decompressTarget, &length);
@@ -46,6 +78,8 @@ void Compression::decompress(slice& data, bool &isValid, bool canAllocate) {
 	int compressionHeaderSize;
 	uint32_t compressedLength = data.length;
 	unsigned char* charData = (unsigned char*) data.data;
+	char* dictionary = this->dictionary;
+	unsigned int dictionarySize = this->dictionarySize;
 
 	if (charData[0] == 254) {
 		uncompressedLength = ((uint32_t)charData[1] << 16) | ((uint32_t)charData[2] << 8) | (uint32_t)charData[3];
@@ -55,6 +89,27 @@ void Compression::decompress(slice& data, bool &isValid, bool canAllocate) {
 		uncompressedLength = ((uint32_t)charData[4] << 24) | ((uint32_t)charData[5] << 16) | ((uint32_t)charData[6] << 8) | (uint32_t)charData[7];
 		compressionHeaderSize = 8;
 	}
+	else if (charData[0] == 253 || charData[0] == 252) {
+		// compressed with a trained dictionary, by the id that follows
+		CompressionDictionary* trained = charData[1] < MAX_DICTIONARIES ? dictionaries[charData[1]] : nullptr;
+		// trained (and saved) by another thread or process since this one loaded them
+		if (!trained && charData[1] < MAX_DICTIONARIES && loadDictionaries())
+			trained = dictionaries[charData[1]];
+		if (!trained) {
+			fprintf(stderr, "Unknown compression dictionary %u\n", charData[1]);
+			isValid = false;
+			return;
+		}
+		dictionary = trained->data;
+		dictionarySize = trained->size;
+		if (charData[0] == 253) {
+			uncompressedLength = ((uint32_t)charData[2] << 16) | ((uint32_t)charData[3] << 8) | (uint32_t)charData[4];
+			compressionHeaderSize = 5;
+		} else {
+			uncompressedLength = ((uint32_t)charData[4] << 24) | ((uint32_t)charData[5] << 16) | ((uint32_t)charData[6] << 8) | (uint32_t)charData[7];
+			compressionHeaderSize = 8;
+		}
+	}
 	else {
 		fprintf(stderr, "Unknown status byte %u\n", charData[0]);
 		//if (canAllocate)
@@ -116,20 +171,43 @@ argtokey_callback_t Compression::compress(slice* value, void (*freeValue)(slice&
 	char* data = (char*)value->data;
 	if (value->length < compressionThreshold && !(value->length > 0 && ((uint8_t*)data)[0] >= 250))
 		return freeValue; // don't compress if less than threshold (but we must compress if the first byte is the compression indicator)
+	if (sampling && (sampleCounter++ & (DICTIONARY_SAMPLE_INTERVAL - 1)) == 0)
+		addSample(data, dataLength);
+	uint8_t dictionaryId = compressDictionaryId.load(std::memory_order_acquire);
 	bool longSize = dataLength >= 0x1000000;
-	int prefixSize = (longSize ? 8 : 4);
+	int prefixSize = longSize ? 8 : dictionaryId ? 5 : 4;
 	int maxCompressedSize = LZ4_COMPRESSBOUND(dataLength);
 	char* compressed = new char[maxCompressedSize + prefixSize];
 	//fprintf(stdout, "compressing %u\n", dataLength);
 	if (!stream)
 		stream = LZ4_createStream();
-	LZ4_loadDict(stream, compressDictionary, dictionarySize);
+	if (dictionaryId)
+		LZ4_loadDict(stream, dictionaries[dictionaryId]->data, dictionaries[dictionaryId]->size);
+	else
+		LZ4_loadDict(stream, compressDictionary, dictionarySize);
 	int compressedSize = LZ4_compress_fast_continue(stream, data, compressed + prefixSize, dataLength, maxCompressedSize, acceleration);
 	if (compressedSize > 0) {
 		if (freeValue)
 			freeValue(*value);
 		uint8_t* compressedData = (uint8_t*)compressed;
-		if (longSize) {
+		if (dictionaryId) {
+			// the dictionary id follows the status byte (which is unused in the 255 header)
+			compressedData[0] = longSize ? 252 : 253;
+			compressedData[1] = dictionaryId;
+			if (longSize) {
+				compressedData[2] = (uint8_t)(dataLength >> 40u);
+				compressedData[3] = (uint8_t)(dataLength >> 32u);
+				compressedData[4] = (uint8_t)(dataLength >> 24u);
+				compressedData[5] = (uint8_t)(dataLength >> 16u);
+				compressedData[6] = (uint8_t)(dataLength >> 8u);
+				compressedData[7] = (uint8_t)dataLength;
+			} else {
+				compressedData[2] = (uint8_t)(dataLength >> 16u);
+				compressedData[3] = (uint8_t)(dataLength >> 8u);
+				compressedData[4] = (uint8_t)dataLength;
+			}
+		}
+		else if (longSize) {
 			compressedData[0] = 255;
 			compressedData[2] = (uint8_t)(dataLength >> 40u);
 			compressedData[3] = (uint8_t)(dataLength >> 32u);
@@ -156,43 +234,342 @@ argtokey_callback_t Compression::compress(slice* value, void (*freeValue)(slice&
 	}
 }
 
-class CompressionWorker : public AsyncWorker {
-  public:
-	CompressionWorker(DbWrap* env, double* compressionAddress, const Function& callback)
-	  : AsyncWorker(callback), env(env), compressionAddress(compressionAddress) {}
+void Compression::addSample(const char* data, size_t length) {
+	if (length > DICTIONARY_SAMPLE_SIZE)
+		length = DICTIONARY_SAMPLE_SIZE; // the start of a value is where records most have in common
+	pthread_mutex_lock(&samplesLock);
+	if (samples.size() < DICTIONARY_SAMPLES)
+		samples.emplace_back(data, length);
+	else
+		samples[nextSample].assign(data, length);
+	nextSample = (nextSample + 1) % DICTIONARY_SAMPLES;
+	pthread_mutex_unlock(&samplesLock);
+}
 
+// hash of the 8 bytes at the position, to count how often they occur
+static inline uint32_t hashKmer(const char* data) {
+	uint64_t bytes;
+	memcpy(&bytes, data, 8);
+	return (uint32_t) ((bytes * 0x9E3779B185EBCA87ull) >> (64 - DICTIONARY_HASH_BITS));
+}
 
-	void Execute() {
-		uint64_t compressionPointer;
-		compressionPointer = std::atomic_exchange((std::atomic<int64_t>*) compressionAddress, (int64_t) 2);
-		if (compressionPointer > 1) {
-			Compression* compression = (Compression*)(size_t) * ((double*)&compressionPointer);
-			compression->compressInstruction(env, compressionAddress);
+static uint64_t scoreSegment(const std::string& sample, size_t start, std::vector<uint32_t>& frequencies) {
+	uint64_t score = 0;
+	size_t end = std::min(start + DICTIONARY_SEGMENT_SIZE, sample.size()) - 7;
+	for (size_t i = start; i < end; i++) {
+		uint32_t frequency = frequencies[hashKmer(sample.data() + i)];
+		if (frequency > 1) // only what other samples have too
+			score += frequency;
+	}
+	return score;
+}
+
+/*
+	Builds a dictionary out of the segments of the samples that have the most in common with the other samples:
+	each segment is scored by how many samples each 8 bytes of it occur in, and the best are picked greedily, with
+	what a picked segment has covered no longer counting for the rest. Since scores only go down as segments are
+	picked, a segment is only rescored when it comes to the top of the queue. The best segments go last, closest to
+	the values.
+*/
+static std::string buildDictionary(const std::vector<std::string>& samples, size_t dictionarySize) {
+	std::vector<uint32_t> frequencies(1 << DICTIONARY_HASH_BITS);
+	std::vector<uint32_t> lastSample(1 << DICTIONARY_HASH_BITS, UINT32_MAX);
+	for (uint32_t s = 0; s < samples.size(); s++) {
+		const std::string& sample = samples[s];
+		for (size_t i = 0; i + 8 <= sample.size(); i++) {
+			uint32_t hash = hashKmer(sample.data() + i);
+			if (lastSample[hash] != s) { // count each sample once
+				lastSample[hash] = s;
+				frequencies[hash]++;
+			}
+		}
+	}
+	// (score, sample, segment start)
+	std::priority_queue<std::tuple<uint64_t, uint32_t, uint32_t>> segments;
+	for (uint32_t s = 0; s < samples.size(); s++) {
+		for (size_t start = 0; start + 8 <= samples[s].size(); start += DICTIONARY_SEGMENT_SIZE) {
+			uint64_t score = scoreSegment(samples[s], start, frequencies);
+			if (score > 0)
+				segments.emplace(score, s, (uint32_t) start);
+		}
+	}
+	std::vector<std::pair<uint32_t, uint32_t>> picked;
+	size_t size = 0;
+	while (size < dictionarySize && !segments.empty()) {
+		auto top = segments.top();
+		segments.pop();
+		const std::string& sample = samples[std::get<1>(top)];
+		size_t start = std::get<2>(top);
+		uint64_t score = scoreSegment(sample, start, frequencies);
+		if (score == 0)
+			continue;
+		if (!segments.empty() && score < std::get<0>(segments.top())) {
+			segments.emplace(score, std::get<1>(top), (uint32_t) start); // has gone down, put it back in its place
+			continue;
 		}
+		size_t end = std::min(start + DICTIONARY_SEGMENT_SIZE, sample.size());
+		for (size_t i = start; i + 8 <= end; i++)
+			frequencies[hashKmer(sample.data() + i)] = 0;
+		picked.emplace_back(std::get<1>(top), (uint32_t) start);
+		size += end - start;
+	}
+	std::string dictionary;
+	dictionary.reserve(size);
+	for (auto segment = picked.rbegin(); segment != picked.rend(); segment++) {
+		const std::string& sample = samples[segment->first];
+		dictionary.append(sample, segment->second, DICTIONARY_SEGMENT_SIZE);
+	}
+	if (dictionary.size() > dictionarySize)
+		dictionary.erase(0, dictionary.size() - dictionarySize);
+	dictionary.resize((dictionary.size() >> 3) << 3); // word-aligned, like the dictionaries from the options
+	return dictionary;
+}
+
+// the total size the samples compress to with a dictionary
+static size_t compressedSize(const std::vector<std::string>& samples, const char* dictionary, unsigned int dictionarySize,
+		LZ4_stream_t* stream) {
+	std::vector<char> target(LZ4_COMPRESSBOUND(DICTIONARY_SAMPLE_SIZE));
+	size_t total = 0;
+	for (auto& sample : samples) {
+		LZ4_loadDict(stream, dictionary, dictionarySize);
+		int size = LZ4_compress_fast_continue(stream, sample.data(), target.data(), sample.size(), target.size(), 1);
+		total += size > 0 ? size : sample.size();
+	}
+	return total;
+}
+
+class TrainDictionaryWorker : public AsyncWorker {
+  public:
+	TrainDictionaryWorker(Compression* compression, const Function& callback)
+	  : AsyncWorker(callback), compression(compression) {}
+
+	void Execute() {
+		pthread_mutex_lock(&compression->samplesLock);
+		std::vector<std::string> samples = compression->samples;
+		pthread_mutex_unlock(&compression->samplesLock);
+		if (samples.size() < DICTIONARY_MIN_SAMPLES)
+			return;
+		std::string trained = buildDictionary(samples, DICTIONARY_TRAINING_SIZE);
+		uint8_t currentId = compression->compressDictionaryId;
+		const char* current = currentId ? compression->dictionaries[currentId]->data : compression->compressDictionary;
+		unsigned int currentSize = currentId ? compression->dictionaries[currentId]->size : compression->dictionarySize;
+		LZ4_stream_t* stream = LZ4_createStream();
+		size_t before = compressedSize(samples, current, currentSize, stream);
+		size_t after = compressedSize(samples, trained.data(), trained.size(), stream);
+		LZ4_freeStream(stream);
+		// only worth switching (and keeping another dictionary around) if it is clearly better
+		if (after * 10 < before * 9)
+			dictionary = std::move(trained);
 	}
 	void OnOK() {
-		// don't actually call the callback, no need
+		if (dictionary.empty())
+			Callback().Call({ Env().Undefined() });
+		else
+			Callback().Call({ Buffer<char>::Copy(Env(), dictionary.data(), dictionary.size()) });
 	}
 
   private:
-	DbWrap* env;
-	double* compressionAddress;
+	Compression* compression;
+	std::string dictionary;
 };
 
-NAPI_FUNCTION(DbWrap::compress) {
-	ARGS(3)
-   GET_INT64_ARG(0);
-   DbWrap* ew = (DbWrap*) i64;
-   napi_get_value_int64(env, args[1], &i64);
-   double* compressionAddress = (double*) i64;
-	CompressionWorker* worker = new CompressionWorker(ew, (double*) compressionAddress, Function(env, args[2]));
+Napi::Value Compression::train(const CallbackInfo& info) {
+	TrainDictionaryWorker* worker = new TrainDictionaryWorker(this, info[0].As<Function>());
 	worker->Queue();
+	return info.Env().Undefined();
+}
+
+Napi::Value Compression::addDictionary(const CallbackInfo& info) {
+	uint32_t id = info[0].As<Number>();
+	if (id == 0 || id >= MAX_DICTIONARIES)
+		return throwError(info.Env(), "Invalid dictionary id");
+	// it may have been loaded already, by a read of a value compressed with it (ids are never reused)
+	if (!dictionaries[id]) {
+		char* data;
+		size_t size;
+		napi_get_buffer_info(info.Env(), info[1], (void**) &data, &size);
+		registerDictionary(id, data, size);
+	}
+	if (info[2].ToBoolean())
+		compressDictionaryId.store(id, std::memory_order_release);
+	return info.Env().Undefined();
+}
+
+void Compression::registerDictionary(uint8_t id, const char* data, size_t size) {
+	CompressionDictionary* added = new CompressionDictionary;
+	added->data = new char[size];
+	memcpy(added->data, data, size);
+	added->size = size;
+	dictionaries[id] = added;
+}
+
+Napi::Value Compression::setDictionaryList(const CallbackInfo& info) {
+	dictionaryEnv = (DbWrap*) (size_t) info[0].As<Number>().Int64Value();
+	char* key;
+	size_t keySize;
+	napi_get_buffer_info(info.Env(), info[1], (void**) &key, &keySize);
+	dictionaryListKey.assign(key, keySize);
+	return info.Env().Undefined();
+}
+
+// Reads the saved list of dictionaries (in the format setupDictionaries saves it in: id byte, uint32 LE length,
+// dictionary) and registers the ones that aren't yet. This is only done by the JS thread (which is the one that
+// decompresses), and the pool threads only use the dictionary they compress with, which is already registered.
+bool Compression::loadDictionaries() {
+	DbWrap* dw = dictionaryEnv;
+	if (!dw || !dw->db)
+		return false;
+	transaction txn;
+	// this is called while decompressing a value read from another db, which goes on using the id it set
+	transactional_splinterdb* previousDb = DbWrap::useThreadId(dw->db);
+	if (transactional_splinterdb_begin_read_only(dw->db, &txn)) {
+		DbWrap::useThreadId(previousDb);
+		return false;
+	}
+	splinterdb_lookup_result result;
+	transactional_splinterdb_lookup_result_init(dw->db, &result, 0, nullptr);
+	slice key = slice_create(dictionaryListKey.size(), dictionaryListKey.data());
+	bool added = false;
+	if (transactional_splinterdb_lookup(dw->db, &txn, key, &result) == 0 && splinterdb_lookup_found(&result)) {
+		slice data;
+		splinterdb_lookup_result_value(&result, &data);
+		unsigned char* list = (unsigned char*) data.data;
+		size_t length = data.length;
+		size_t position = 0;
+		if (dw->hasVersions)
+			position = 8; // skip the version header
+		while (position + 5 <= length) {
+			uint8_t id = list[position];
+			uint32_t size = (uint32_t) list[position + 1] | ((uint32_t) list[position + 2] << 8) |
+				((uint32_t) list[position + 3] << 16) | ((uint32_t) list[position + 4] << 24);
+			position += 5;
+			if (size > length - position)
+				break;
+			if (id > 0 && id < MAX_DICTIONARIES && !dictionaries[id]) {
+				registerDictionary(id, (char*) list + position, size);
+				added = true;
+			}
+			position += size;
+		}
+	}
+	splinterdb_lookup_result_deinit(&result);
+	transactional_splinterdb_abort(dw->db, &txn);
+	DbWrap::useThreadId(previousDb);
+	return added;
+}
+
+// the most values a pool thread claims at a time, so a burst of writes is still spread over the threads
+#define COMPRESSION_BATCH_SIZE 16
+
+CompressionPool::CompressionPool(DbWrap* dw) {
+	this->dw = dw;
+	this->idle = 0;
+	this->closing = false;
+	pthread_mutex_init(&jobsLock, nullptr);
+	pthread_cond_init(&jobReady, nullptr);
+	unsigned int threadCount = std::thread::hardware_concurrency();
+	// leave a core for the JS and write threads
+	if (threadCount > 1)
+		threadCount--;
+	if (threadCount < 1)
+		threadCount = 1;
+	else if (threadCount > 8)
+		threadCount = 8;
+	for (unsigned int i = 0; i < threadCount; i++)
+		threads.push_back(std::thread(runWorker, this));
+}
+
+void CompressionPool::runWorker(CompressionPool* pool) {
+	double* batch[COMPRESSION_BATCH_SIZE];
+	Compression* compressions[COMPRESSION_BATCH_SIZE];
+	pthread_mutex_lock(&pool->jobsLock);
+	while (true) {
+		if (pool->jobs.empty()) {
+			if (pool->closing)
+				break;
+			pool->idle++;
+			pthread_cond_wait(&pool->jobReady, &pool->jobsLock);
+			pool->idle--;
+			continue;
+		}
+		// take an even share of what is queued, so the other threads get some of it too
+		size_t count = (pool->jobs.size() + pool->threads.size() - 1) / pool->threads.size();
+		if (count > COMPRESSION_BATCH_SIZE)
+			count = COMPRESSION_BATCH_SIZE;
+		int claimed = 0;
+		for (size_t i = 0; i < count; i++) {
+			double* compressionAddress = pool->jobs.front();
+			pool->jobs.pop_front();
+			// the write thread claims a value it reaches first (setting 1) without this lock, and then finishes it
+			// (setting 0), so only claim it while it still holds the pointer to the compression, or the 2 would be
+			// left in place of the finished value (and the write thread would wait for it forever)
+			int64_t compressionPointer = std::atomic_load((std::atomic<int64_t>*) compressionAddress);
+			if (compressionPointer > 2 && std::atomic_compare_exchange_strong((std::atomic<int64_t>*) compressionAddress,
+					&compressionPointer, (int64_t) 2)) {
+				batch[claimed] = compressionAddress;
+				compressions[claimed++] = (Compression*)(size_t) * ((double*)&compressionPointer);
+			}
+		}
+		pthread_mutex_unlock(&pool->jobsLock);
+		for (int i = 0; i < claimed; i++)
+			compressions[i]->compressInstruction(pool->dw, batch[i]);
+		pthread_mutex_lock(&pool->jobsLock);
+	}
+	pthread_mutex_unlock(&pool->jobsLock);
+	if (Compression::stream) {
+		LZ4_freeStream(Compression::stream);
+		Compression::stream = nullptr;
+	}
+}
+
+void CompressionPool::add(double* compressionAddress) {
+	pthread_mutex_lock(&jobsLock);
+	jobs.push_back(compressionAddress);
+	if (idle > 0)
+		pthread_cond_signal(&jobReady);
+	pthread_mutex_unlock(&jobsLock);
+}
+
+void CompressionPool::remove(double* compressionAddress) {
+	pthread_mutex_lock(&jobsLock);
+	// values are queued and written in the same order, so if it is still queued, it is the oldest
+	if (!jobs.empty() && jobs.front() == compressionAddress)
+		jobs.pop_front();
+	pthread_mutex_unlock(&jobsLock);
+}
+
+void CompressionPool::stop() {
+	pthread_mutex_lock(&jobsLock);
+	closing = true;
+	jobs.clear();
+	pthread_cond_broadcast(&jobReady);
+	pthread_mutex_unlock(&jobsLock);
+	for (auto& thread : threads)
+		thread.join();
+	pthread_mutex_destroy(&jobsLock);
+	pthread_cond_destroy(&jobReady);
+}
+
+NAPI_FUNCTION(DbWrap::compress) {
+	ARGS(2)
+	GET_INT64_ARG(0);
+	DbWrap* dw = (DbWrap*) i64;
+	napi_get_value_int64(env, args[1], &i64);
+	double* compressionAddress = (double*) i64;
+	if (!dw->db)
+		RETURN_UNDEFINED; // the write thread is gone too, nothing will read it
+	if (!dw->compressionPool)
+		dw->compressionPool = new CompressionPool(dw);
+	dw->compressionPool->add(compressionAddress);
 	RETURN_UNDEFINED;
 }
 
 void Compression::setupExports(Napi::Env env, Object exports) {
 	Function CompressionClass = DefineClass(env, "Compression", {
 		Compression::InstanceMethod("setBuffer", &Compression::setBuffer),
+		Compression::InstanceMethod("addDictionary", &Compression::addDictionary),
+		Compression::InstanceMethod("setDictionaryList", &Compression::setDictionaryList),
+		Compression::InstanceMethod("train", &Compression::train),
 	});
 	exports.Set("Compression", CompressionClass);
 //	compressionTpl->InstanceTemplate()->SetInternalFieldCount(1);
@@ -11,334 +11,328 @@ const int RENEW_CURSOR = 0x2000;
 const int EXACT_MATCH = 0x4000;
 const int INCLUSIVE_END = 0x8000;
 const int EXCLUSIVE_START = 0x10000;
+const int APPROXIMATE_SIZE = 0x20000;
+
+/*
+	The batch buffer starts with the maximum number of entries to return (written by JS before each call), and the
+	entries follow, each 8-byte aligned and laid out as:
+	0: key size (uint32)
+	4: value size (uint32), VALUE_NOT_INCLUDED if the value didn't fit and JS needs to get it by key
+	8: version (double), if the db has versions
+	16: key, with a null terminator (for ordered-binary), followed by the value
+*/
+const int BATCH_HEADER_SIZE = 8;
+const int ENTRY_HEADER_SIZE = 16;
+const uint32_t VALUE_NOT_INCLUDED = 0xffffffff;
 
 IteratorWrap::IteratorWrap(const CallbackInfo& info) : Napi::ObjectWrap<IteratorWrap>(info) {
-	this->keyType = LmdbKeyType::StringKey;
-	this->freeKey = nullptr;
-	this->endKey.length = 0; // indicates no end key (yet)
-	if (info.Length() < 1) {
+	this->dw = nullptr;
+	this->batchBuffer = nullptr;
+	this->atEnd = true;
+	this->reverse = false;
+	this->hasEnd = false;
+	this->iterator = nullptr;
+	this->iteratorTxn = nullptr;
+	if (info.Length() < 2) {
 		throwError(info.Env(), "Wrong number of arguments");
 		return;
 	}
-
-	DbWrap *dw;
-	napi_unwrap(info.Env(), info[0], (void**)&dw);
-
-	// Open the iterator
-	splinterdb_iterator *iterator;
-	transaction *txn = dw->ew->getReadTxn();
-	int rc = splinterdb_iterator_init(txn, dw->db->kvsb, &iterator);
-	if (rc != 0) {
-		throwLmdbError(info.Env(), rc);
-		return;
-	}
+	napi_unwrap(info.Env(), info[0], (void**) &dw);
+	napi_get_buffer_info(info.Env(), info[1], (void**) &batchBuffer, &batchSize);
 	info.This().As<Object>().Set("address", Number::New(info.Env(), (size_t) this));
-	this->iterator = iterator;
-	this->dw = dw;
-	this->txn = txn;
-	this->keyType = keyType;
 }
 
 IteratorWrap::~IteratorWrap() {
-	if (this->iterator) {
-		// Don't close iterator here, it is possible that the environment may already be closed, which causes it to crash
-		//splinterdb_iterator_close(this->iterator);
-	}
-	if (this->freeKey) {
-		this->freeKey(this->key);
-	}
+	freeIterator();
+}
+
+void IteratorWrap::freeIterator() {
+	if (!iterator)
+		return;
+	dw->useThreadId();
+	transactional_iterator_deinit(iterator);
+	iterator = nullptr;
+	iteratorTxn = nullptr;
+	auto it = std::find(dw->keptIterators.begin(), dw->keptIterators.end(), this);
+	if (it != dw->keptIterators.end())
+		dw->keptIterators.erase(it);
 }
 
 Value IteratorWrap::close(const CallbackInfo& info) {
-	if (!this->iterator) {
-	  return throwError(info.Env(), "iterator.close: Attempt to close a closed iterator!");
+	if (!this->dw) {
+		return throwError(info.Env(), "iterator.close: Attempt to close a closed iterator!");
 	}
-	splinterdb_iterator_close(this->iterator);
-	this->iterator = nullptr;
+	freeIterator();
+	this->dw = nullptr;
 	return info.Env().Undefined();
 }
 
-Value IteratorWrap::del(const CallbackInfo& info) {
-	int flags = 0;
-
-	if (info.Length() == 1) {
-		if (!info[0].IsObject()) {
-			return throwError(info.Env(), "iterator.del: Invalid options argument. It should be an object.");
+// Position the kept iterator at the first key from the given key on (or, in reverse, the last key up to it), or at
+// the start of the range for a null key. The iterator covers the whole range from its fixed bound (the end key, or
+// in reverse the lower bound), so it only needs to be created again when that changes, or the txn does
+int IteratorWrap::seek(slice key, bool sameRange) {
+	// the iterator reads in the same txn as a get would (and renews the read txn like it)
+	transaction* txn = dw->getReadTxn(0);
+	if (!txn)
+		return EINVAL;
+	if (iterator && (!sameRange || txn != iteratorTxn))
+		freeIterator();
+	if (!iterator) {
+		slice end = hasEnd ? slice_create(endKeySize, endKey) : NULL_SLICE;
+		// the iterator stops at the end key itself, so it never reads past the range. In reverse the range is from
+		// the end key up (always including it), read from the top down
+		int rc = reverse ?
+			transactional_iterator_init(dw->db, txn, &iterator, end, NULL_SLICE, false, true) :
+			transactional_iterator_init(dw->db, txn, &iterator, NULL_SLICE, end, inclusiveEnd, false);
+		if (rc) {
+			iterator = nullptr;
+			return rc;
 		}
-		
-		auto options = info[0].As<Object>();
-		setFlagFromValue(&flags, splinterdb_NODUPDATA, "noDupData", false, options);
+		iteratorTxn = txn;
+		dw->keptIterators.push_back(this);
+		if (slice_is_null(key))
+			return 0; // already at the start
 	}
+	return transactional_iterator_seek(iterator, key);
+}
 
-	int rc = splinterdb_iterator_del(this->iterator, flags);
-	if (rc != 0) {
-		return throwLmdbError(info.Env(), rc);
+// Whether the iterator is on an entry in the range. The iterator stops at the end key by itself, except going in
+// reverse, where the end key is its (always inclusive) start key
+bool IteratorWrap::isValid(transactional_iterator* iterator) {
+	if (!transactional_iterator_valid(iterator))
+		return false;
+	if (reverse && hasEnd && !inclusiveEnd) {
+		slice key, data;
+		transactional_iterator_get_current(iterator, &key, &data);
+		data_config* config = dw->dataConfig;
+		if (!config->key_compare(config, key, slice_create(endKeySize, endKey)))
+			return false;
 	}
-	return info.Env().Undefined();
+	return true;
 }
-int IteratorWrap::returnEntry(int lastRC, slice &key, slice &data) {
-	if (lastRC) {
-		if (lastRC == splinterdb_NOTFOUND)
-			return 0;
-		else {
-			return lastRC > 0 ? -lastRC : lastRC;
-		}
-	}
-	if (endKey.length > 0) {
-		int comparison;
-		if (flags & VALUES_FOR_KEY)
-			comparison = splinterdb_dcmp(txn, dw->dbi, &endKey, &data);
-		else
-			comparison = splinterdb_cmp(txn, dw->dbi, &endKey, &key);
-		if ((flags & REVERSE) ? comparison >= 0 : (comparison <= 0)) {
-			if (!((flags & INCLUSIVE_END) && comparison == 0))
-				return 0;
-		}
-	}
-	char* keyBuffer = dw->ew->keyBuffer;
-	if (flags & INCLUDE_VALUES) {
-		int result = getVersionAndUncompress(data, dw);
-		bool fits = true;
-		if (result) {
-			fits = valToBinaryFast(data, dw); // it fit in the global/compression-target buffer
+
+// Write the entries from the iterator's position on into the batch buffer, returning the number of entries
+int32_t IteratorWrap::fillBatch(transactional_iterator* iterator) {
+	uint32_t maxEntries = *((uint32_t*) batchBuffer);
+	size_t position = BATCH_HEADER_SIZE;
+	int32_t count = 0;
+	while ((uint32_t) count < maxEntries) {
+		if (!isValid(iterator)) {
+			atEnd = true;
+			int rc = transactional_iterator_status(iterator);
+			if (rc)
+				return rc > 0 ? -rc : rc;
+			break;
 		}
-		if (fits || result == 2 || data.length < SHARED_BUFFER_THRESHOLD) {// if it was decompressed
-			*((uint32_t*)keyBuffer) = data.length;
-			*((uint32_t*)(keyBuffer + 4)) = 0; // buffer id of 0
-		} else {
-			DbWrap::toSharedBuffer(dw->ew->env, (uint32_t*) dw->ew->keyBuffer, data);
+		slice key, data;
+		transactional_iterator_get_current(iterator, &key, &data);
+		char* entry = batchBuffer + position;
+		uint32_t valueSize = 0;
+		if (flags & INCLUDE_VALUES) {
+			if (getVersionAndUncompress(data, dw)) {
+				valueSize = data.length;
+				if (dw->hasVersions)
+					memcpy(entry + 8, dw->keyBuffer + 16, 8);
+			} else // couldn't decompress, let a get report it
+				valueSize = VALUE_NOT_INCLUDED;
+		} else if (dw->hasVersions && data.length >= 8)
+			memcpy(entry + 8, data.data, 8);
+		size_t entrySize = ENTRY_HEADER_SIZE + key.length + 1 + (valueSize == VALUE_NOT_INCLUDED ? 0 : valueSize);
+		if (position + entrySize > batchSize) {
+			if (count > 0)
+				break; // goes in the next batch
+			// the value can't fit in the batch buffer by itself, JS gets it by key
+			valueSize = VALUE_NOT_INCLUDED;
+			entrySize = ENTRY_HEADER_SIZE + key.length + 1;
 		}
+		((uint32_t*) entry)[0] = key.length;
+		((uint32_t*) entry)[1] = valueSize;
+		memcpy(entry + ENTRY_HEADER_SIZE, key.data, key.length);
+		entry[ENTRY_HEADER_SIZE + key.length] = 0;
+		if (valueSize && valueSize != VALUE_NOT_INCLUDED)
+			memcpy(entry + ENTRY_HEADER_SIZE + key.length + 1, data.data, valueSize);
+		position = (position + entrySize + 7) & ~((size_t) 7);
+		memcpy(lastKey, key.data, key.length);
+		lastKeySize = key.length;
+		count++;
+		transactional_iterator_next(iterator);
 	}
-	if (!(flags & VALUES_FOR_KEY)) {
-		memcpy(keyBuffer + 32, key.data, key.length);
-		*(keyBuffer + 32 + key.length) = 0; // make sure it is null terminated for the sake of better ordered-binary performance
-	}
-
-	return key.length;
+	return count;
 }
 
-const int START_ADDRESS_POSITION = 4064;
 int32_t IteratorWrap::doPosition(uint32_t offset, uint32_t keySize, uint64_t endKeyAddress) {
-	//char* keyBuffer = dw->ew->keyBuffer;
-	slice key, data;
-	int rc;
-	if (flags & RENEW_CURSOR) { // TODO: check the txn_id to determine if we need to renew
-		rc = splinterdb_iterator_renew(txn = dw->ew->getReadTxn(), iterator);
-		if (rc) {
-			if (rc > 0)
-				rc = -rc;
-			return rc;
-		}
-	}
-	if (endKeyAddress) {
-		uint32_t* keyBuffer = (uint32_t*) endKeyAddress;
-		endKey.length = *keyBuffer;
-		endKey.data = (char*)(keyBuffer + 1);
-	} else
-		endKey.length = 0;
-	iteratingOp = (flags & REVERSE) ?
-		(flags & INCLUDE_VALUES) ?
-			(flags & VALUES_FOR_KEY) ? splinterdb_PREV_DUP : splinterdb_PREV :
-			splinterdb_PREV_NODUP :
-		(flags & INCLUDE_VALUES) ?
-			(flags & VALUES_FOR_KEY) ? splinterdb_NEXT_DUP : splinterdb_NEXT :
-			splinterdb_NEXT_NODUP;
-	key.length = keySize;
-	key.data = dw->ew->keyBuffer;
-	if (keySize == 0) {
-		rc = splinterdb_iterator_get(iterator, &key, &data, flags & REVERSE ? splinterdb_LAST : splinterdb_FIRST);  
+	if (!dw || !dw->db)
+		return -EINVAL;
+	char* keyBuffer = dw->keyBuffer;
+	bool wasReverse = reverse;
+	bool hadEnd = hasEnd;
+	bool wasInclusiveEnd = inclusiveEnd;
+	char* newEndKey = nullptr;
+	uint32_t newEndKeySize = 0;
+	if (flags & (EXACT_MATCH | VALUES_FOR_KEY)) {
+		// there is a single value per key, so the range is just the start key
+		hasEnd = true;
+		inclusiveEnd = true;
+		newEndKey = keyBuffer;
+		newEndKeySize = keySize;
 	} else {
-		if (flags & VALUES_FOR_KEY) { // only values for this key
-			// take the next part of the key buffer as a pointer to starting data
-			uint32_t* startValueBuffer = (uint32_t*)(size_t)(*(double*)(dw->ew->keyBuffer + START_ADDRESS_POSITION));
-			data.length = endKeyAddress ? *((uint32_t*)startValueBuffer) : 0;
-			data.data = startValueBuffer + 1;
-			slice startValue;
-			if (flags & EXCLUSIVE_START)
-				startValue = data; // save it for comparison
-			if (flags & REVERSE) {// reverse through values
-				startValue = data; // save it for comparison
-				rc = splinterdb_iterator_get(iterator, &key, &data, data.length ? splinterdb_GET_BOTH_RANGE : splinterdb_SET_KEY);
-				if (rc) {
-					if (startValue.length) {
-						// value specified, but not found, so find key and go to last item
-						rc = splinterdb_iterator_get(iterator, &key, &data, splinterdb_SET_KEY);
-						if (!rc)
-							rc = splinterdb_iterator_get(iterator, &key, &data, splinterdb_LAST_DUP);
-					} // else just couldn't find the key
-				} else { // found entry
-					if (startValue.length == 0) // no value specified, so go to last value
-						rc = splinterdb_iterator_get(iterator, &key, &data, splinterdb_LAST_DUP);
-					else if (splinterdb_dcmp(txn, dw->dbi, &startValue, &data)) // the range found the next value *after* the start
-						rc = splinterdb_iterator_get(iterator, &key, &data, splinterdb_PREV_DUP);
-				}
-			} else // forward, just do a get by range
-				rc = splinterdb_iterator_get(iterator, &key, &data, data.length ?
-					(flags & EXACT_MATCH) ? splinterdb_GET_BOTH : splinterdb_GET_BOTH_RANGE : splinterdb_SET_KEY);
-
-			if (rc == splinterdb_NOTFOUND)
-				return 0;
-			if (flags & ONLY_COUNT && (!endKeyAddress || (flags & EXACT_MATCH))) {
-				size_t count;
-				rc = splinterdb_iterator_count(iterator, &count);
-				if (rc)
-					return rc > 0 ? -rc : rc;
-				return count;
-			}
-			if (flags & EXCLUSIVE_START) {
-				while(!rc) {
-					if (splinterdb_dcmp(txn, dw->dbi, &startValue, &data))
-						break;
-					rc = splinterdb_iterator_get(iterator, &key, &data, iteratingOp);
-				}
-			}
-		} else {
-			slice firstKey;
-			if (flags & EXCLUSIVE_START)
-				firstKey = key; // save it for comparison
-			if (flags & REVERSE) {// reverse
-				firstKey = key; // save it for comparison
-				rc = splinterdb_iterator_get(iterator, &key, &data, splinterdb_SET_RANGE);
-				if (rc)
-					rc = splinterdb_iterator_get(iterator, &key, &data, splinterdb_LAST);
-				else if (splinterdb_cmp(txn, dw->dbi, &firstKey, &key)) // the range found the next entry *after* the start
-					rc = splinterdb_iterator_get(iterator, &key, &data, splinterdb_PREV);
-				else if (dw->flags & splinterdb_DUPSORT)
-					// we need to go to the last value of this key
-					rc = splinterdb_iterator_get(iterator, &key, &data, splinterdb_LAST_DUP);
-			} else // forward, just do a get by range
-				rc = splinterdb_iterator_get(iterator, &key, &data, (flags & EXACT_MATCH) ? splinterdb_SET_KEY : splinterdb_SET_RANGE);
-			if (flags & EXCLUSIVE_START) {
-				while(!rc) {
-					if (splinterdb_cmp(txn, dw->dbi, &firstKey, &key))
-						break;
-					rc = splinterdb_iterator_get(iterator, &key, &data, iteratingOp);
-				}
-			}
+		uint32_t* endKeyBuffer = (uint32_t*) endKeyAddress;
+		hasEnd = endKeyBuffer && *endKeyBuffer > 0;
+		inclusiveEnd = flags & INCLUSIVE_END;
+		if (hasEnd) {
+			newEndKey = (char*) (endKeyBuffer + 1);
+			newEndKeySize = *endKeyBuffer;
 		}
 	}
-
-	while (offset-- > 0 && !rc) {
-		rc = splinterdb_iterator_get(iterator, &key, &data, iteratingOp);
+	atEnd = false;
+	reverse = (flags & REVERSE) && !(flags & (EXACT_MATCH | VALUES_FOR_KEY));
+	// whether the kept iterator covers this range too (in reverse the end key is always included by the iterator)
+	bool sameRange = reverse == wasReverse && hasEnd == hadEnd && (reverse || inclusiveEnd == wasInclusiveEnd) &&
+		(!hasEnd || (newEndKeySize == endKeySize && !memcmp(newEndKey, endKey, endKeySize)));
+	if (hasEnd)
+		memcpy(endKey, newEndKey, endKeySize = newEndKeySize);
+	slice start = keySize ? slice_create(keySize, keyBuffer) : NULL_SLICE;
+	int rc = seek(start, sameRange);
+	if (rc)
+		return rc > 0 ? -rc : rc;
+	slice key, data;
+	data_config* config = dw->dataConfig;
+	if ((flags & EXCLUSIVE_START) && keySize) {
+		while (transactional_iterator_valid(iterator)) {
+			transactional_iterator_get_current(iterator, &key, &data);
+			if (config->key_compare(config, key, start))
+				break;
+			transactional_iterator_next(iterator);
+		}
 	}
+	int32_t result;
 	if (flags & ONLY_COUNT) {
-		uint32_t count = 0;
-		bool useIteratorCount = false;
-		// if we are in a dupsort database, and we are iterating over all entries, we can just count all the values for each key
-		if (dw->flags & splinterdb_DUPSORT) {
-			if (iteratingOp == splinterdb_PREV) {
-				iteratingOp = splinterdb_PREV_NODUP;
-				useIteratorCount = true;
-			}
-			if (iteratingOp == splinterdb_NEXT) {
-				iteratingOp = splinterdb_NEXT_NODUP;
-				useIteratorCount = true;
-			}
+		result = 0;
+		while (isValid(iterator)) {
+			if (offset > 0)
+				offset--;
+			else
+				result++;
+			transactional_iterator_next(iterator);
 		}
+	} else {
+		while (offset-- > 0 && isValid(iterator))
+			transactional_iterator_next(iterator);
+		result = fillBatch(iterator);
+	}
+	if (result >= 0) {
+		rc = transactional_iterator_status(iterator);
+		if (rc)
+			result = rc > 0 ? -rc : rc;
+	}
+	// let go of the pages and branches it is on, so it doesn't hold up writes between calls
+	transactional_iterator_release(iterator);
+	return result;
+}
 
-		while (!rc) {
-			if (endKey.length > 0) {
-				int comparison;
-				if (flags & VALUES_FOR_KEY)
-					comparison = splinterdb_dcmp(txn, dw->dbi, &endKey, &data);
-				else
-					comparison = splinterdb_cmp(txn, dw->dbi, &endKey, &key);
-				if ((flags & REVERSE) ? comparison >= 0 : (comparison <=0)) {
-					if (!((flags & INCLUSIVE_END) && comparison == 0))
-						return count;
-				}
-			}
-			if (useIteratorCount) {
-				size_t countForKey;
-				rc = splinterdb_iterator_count(iterator, &countForKey);
-				if (rc) {
-					if (rc > 0)
-						rc = -rc;
-					return rc;
-				}
-				count += countForKey;
-			} else
-				count++;
-			rc = splinterdb_iterator_get(iterator, &key, &data, iteratingOp);
-		}
-		return count;
+int32_t IteratorWrap::doIterate() {
+	if (!dw || !dw->db)
+		return -EINVAL;
+	if (atEnd)
+		return 0;
+	// resume after the last key we returned
+	slice last = slice_create(lastKeySize, lastKey);
+	int rc = seek(last, true);
+	if (rc)
+		return rc > 0 ? -rc : rc;
+	if (transactional_iterator_valid(iterator)) {
+		slice key, data;
+		transactional_iterator_get_current(iterator, &key, &data);
+		data_config* config = dw->dataConfig;
+		if (!config->key_compare(config, key, last))
+			transactional_iterator_next(iterator);
 	}
-	// TODO: Handle count?
-	return returnEntry(rc, key, data);
+	int32_t result = fillBatch(iterator);
+	transactional_iterator_release(iterator);
+	return result;
 }
+
 NAPI_FUNCTION(position) {
 	ARGS(5)
-    GET_INT64_ARG(0);
-    IteratorWrap* cw = (IteratorWrap*) i64;
+	GET_INT64_ARG(0);
+	IteratorWrap* cw = (IteratorWrap*) i64;
 	GET_UINT32_ARG(cw->flags, 1);
 	uint32_t offset;
 	GET_UINT32_ARG(offset, 2);
 	uint32_t keySize;
 	GET_UINT32_ARG(keySize, 3);
-    napi_get_value_int64(env, args[4], &i64);
-    int64_t endKeyAddress = i64;
+	napi_get_value_int64(env, args[4], &i64);
+	int64_t endKeyAddress = i64;
 	int32_t result = cw->doPosition(offset, keySize, endKeyAddress);
 	RETURN_INT32(result);
 }
 int32_t positionFFI(double cwPointer, uint32_t flags, uint32_t offset, uint32_t keySize, uint64_t endKeyAddress) {
 	IteratorWrap* cw = (IteratorWrap*) (size_t) cwPointer;
-	DbWrap* dw = cw->dw;
-	dw->getFast = true;
 	cw->flags = flags;
 	return cw->doPosition(offset, keySize, endKeyAddress);
 }
 
 NAPI_FUNCTION(iterate) {
 	ARGS(1)
-    GET_INT64_ARG(0);
-    IteratorWrap* cw = (IteratorWrap*) i64;
-	slice key, data;
-	int rc = splinterdb_iterator_get(cw->iterator, &key, &data, cw->iteratingOp);
-	RETURN_INT32(cw->returnEntry(rc, key, data));
+	GET_INT64_ARG(0);
+	IteratorWrap* cw = (IteratorWrap*) i64;
+	RETURN_INT32(cw->doIterate());
 }
 
 int32_t iterateFFI(double cwPointer) {
 	IteratorWrap* cw = (IteratorWrap*) (size_t) cwPointer;
-	DbWrap* dw = cw->dw;
-	dw->getFast = true;
-	slice key, data;
-	int rc = splinterdb_iterator_get(cw->iterator, &key, &data, cw->iteratingOp);
-	return cw->returnEntry(rc, key, data);
+	return cw->doIterate();
 }
 
-
-NAPI_FUNCTION(getCurrentValue) {
-	ARGS(1)
-    GET_INT64_ARG(0);
-    IteratorWrap* cw = (IteratorWrap*) i64;
-	slice key, data;
-	int rc = splinterdb_iterator_get(cw->iterator, &key, &data, splinterdb_GET_CURRENT);
-	RETURN_INT32(cw->returnEntry(rc, key, data));
-}
-
-napi_finalize noopIterator = [](napi_env, void *, void *) {
-	// Data belongs to Lsplinterdb, we shouldn't free it here
-};
-NAPI_FUNCTION(getCurrentShared) {
-	ARGS(1)
-    GET_INT64_ARG(0);
-    IteratorWrap* cw = (IteratorWrap*) i64;
-	slice key, data;
-	int rc = splinterdb_iterator_get(cw->iterator, &key, &data, splinterdb_GET_CURRENT);
+/*
+	Estimate the number of entries in a range without reading through it, from the counts the db keeps of the entries
+	in its trees (which include overwritten and deleted entries, until they are compacted away), or with
+	APPROXIMATE_SIZE, the size of the range's keys and values in bytes. Returns a negative error code on failure.
+*/
+static double estimateRange(DbWrap* dw, int flags, uint32_t keySize, uint64_t endKeyAddress) {
+	if (!dw->db)
+		return -EINVAL;
+	uint32_t* endKeyBuffer = (uint32_t*) endKeyAddress;
+	slice start = keySize ? slice_create(keySize, dw->keyBuffer) : NULL_SLICE;
+	slice end = endKeyBuffer && *endKeyBuffer > 0 ? slice_create(*endKeyBuffer, (char*) (endKeyBuffer + 1)) : NULL_SLICE;
+	// the lower bound is always included by the db, and the upper bound optionally
+	bool reverse = flags & REVERSE;
+	slice lower = reverse ? end : start;
+	slice upper = reverse ? start : end;
+	bool lowerIncluded = reverse ? (flags & INCLUSIVE_END) : !(flags & EXCLUSIVE_START);
+	bool upperIncluded = reverse ? !(flags & EXCLUSIVE_START) : (flags & INCLUSIVE_END);
+	uint64 result;
+	int rc;
+	dw->useThreadId();
+	if (flags & APPROXIMATE_SIZE)
+		rc = transactional_splinterdb_approximate_size(dw->db, lower, upper, &result);
+	else {
+		rc = transactional_splinterdb_count_range(dw->db, lower, upper, upperIncluded, SPLINTERDB_COUNT_APPROXIMATE,
+			&result);
+		if (!rc && !lowerIncluded && !slice_is_null(lower)) {
+			uint64 lowerCount; // 1 if the lower bound exists
+			rc = transactional_splinterdb_count_range(dw->db, lower, lower, true, SPLINTERDB_COUNT_APPROXIMATE,
+				&lowerCount);
+			if (result >= lowerCount)
+				result -= lowerCount;
+		}
+	}
 	if (rc)
-		RETURN_INT32(cw->returnEntry(rc, key, data));
-	getVersionAndUncompress(data, cw->dw);
-	napi_create_external_buffer(env, data.length,
-		(char*) data.data, noopIterator, nullptr, &returnValue);
-	return returnValue;
+		return rc > 0 ? -rc : rc;
+	return (double) result;
 }
 
-NAPI_FUNCTION(renew) {
-	ARGS(1)
-    GET_INT64_ARG(0);
-    IteratorWrap* cw = (IteratorWrap*) i64;
-	splinterdb_iterator_renew(cw->txn = cw->dw->ew->getReadTxn(), cw->iterator);
-	RETURN_UNDEFINED;
+NAPI_FUNCTION(estimateRange) {
+	ARGS(4)
+	GET_INT64_ARG(0);
+	DbWrap* dw = (DbWrap*) i64;
+	int flags;
+	GET_UINT32_ARG(flags, 1);
+	uint32_t keySize;
+	GET_UINT32_ARG(keySize, 2);
+	napi_get_value_int64(env, args[3], &i64);
+	napi_create_double(env, estimateRange(dw, flags, keySize, i64), &returnValue);
+	return returnValue;
 }
 
 void IteratorWrap::setupExports(Napi::Env env, Object exports) {
@@ -346,19 +340,14 @@ void IteratorWrap::setupExports(Napi::Env env, Object exports) {
 	Function IteratorClass = DefineClass(env, "Iterator", {
 	// IteratorWrap: Add functions to the prototype
 		IteratorWrap::InstanceMethod("close", &IteratorWrap::close),
-		IteratorWrap::InstanceMethod("del", &IteratorWrap::del),
 	});
 	EXPORT_NAPI_FUNCTION("position", position);
 	EXPORT_NAPI_FUNCTION("iterate", iterate);
-	EXPORT_NAPI_FUNCTION("getCurrentValue", getCurrentValue);
-	EXPORT_NAPI_FUNCTION("getCurrentShared", getCurrentShared);
-	EXPORT_NAPI_FUNCTION("renew", renew);
+	EXPORT_NAPI_FUNCTION("estimateRange", estimateRange);
 	EXPORT_FUNCTION_ADDRESS("positionPtr", positionFFI);
 	EXPORT_FUNCTION_ADDRESS("iteratePtr", iterateFFI);
 
-	exports.Set("Iterator", IteratorClass);
-
-//	iteratorTpl->InstanceTemplate()->SetInternalFieldCount(1);
+	exports.Set("Cursor", IteratorClass);
 }
 
 // This file contains code from the node-lmdb project
@@ -15,6 +15,8 @@ using namespace Napi;
 
 env_tracking_t* DbWrap::envTracking = DbWrap::initTracking();
 thread_local std::vector<DbWrap*>* DbWrap::openDbWraps = nullptr;
+thread_local std::unordered_map<transactional_splinterdb*, ThreadEnvRef>* DbWrap::threadEnvRefs = nullptr;
+thread_local transactional_splinterdb* DbWrap::threadIdDb = nullptr;
 thread_local std::unordered_map<void*, buffer_info_t>* DbWrap::sharedBuffers = nullptr;
 void* getSharedBuffers() {
 	return (void*) DbWrap::sharedBuffers;
@@ -42,7 +44,11 @@ DbWrap::DbWrap(const CallbackInfo& info) : ObjectWrap<DbWrap>(info) {
 	this->currentReadTxn = nullptr;
 	this->writeTxn = nullptr;
 	this->writeWorker = nullptr;
+	this->readPool = nullptr;
+	this->compressionPool = nullptr;
 	this->readTxnRenewed = false;
+	this->db = nullptr;
+	this->dataConfig = nullptr;
 	this->writingLock = new pthread_mutex_t;
 	this->writingCond = new pthread_cond_t;
 	info.This().As<Object>().Set("address", Number::New(info.Env(), (size_t) this));
@@ -73,8 +79,8 @@ void cleanup(void* data) {
 Napi::Value DbWrap::open(const CallbackInfo& info) {
 	int rc;
 	// Get the wrapper
-	if (!this->db) {
-		return throwError(info.Env(), "The environment is already closed.");
+	if (this->db) {
+		return throwError(info.Env(), "The environment is already open.");
 	}
 	Object options = info[0].As<Object>();
 	int flags = info[1].As<Number>();
@@ -116,6 +122,13 @@ Napi::Value DbWrap::open(const CallbackInfo& info) {
 	option = options.Get("maxReaders");
 	if (option.IsNumber())
 		maxReaders = option.As<Number>();
+	size_t cacheSize = 0;
+	// Parse the cacheSize option
+	option = options.Get("cacheSize");
+	if (option.IsNumber())
+		cacheSize = option.As<Number>().Int64Value();
+	if (pageSize && (size_t) pageSize != SPLINTERDB_PAGE_SIZE)
+		return throwError(info.Env(), "SplinterDB only supports a pageSize of 4096");
 
 	Napi::Value encryptionKey = options.Get("encryptionKey");
 	std::string encryptKey;
@@ -130,35 +143,128 @@ Napi::Value DbWrap::open(const CallbackInfo& info) {
 	}
 
 	napiEnv = info.Env();
-	rc = openDB(flags, jsFlags, (const char*)pathString.c_str(), (char*) keyBuffer, compression, maxDbs, maxReaders, mapSize, pageSize, encryptKey.empty() ? nullptr : (char*)encryptKey.c_str());
-	//delete[] pathBytes;
-	//if (rc < 0)
-	//	return throwLmdbError(info.Env(), rc);
+	rc = openDB(flags, jsFlags, (const char*)pathString.c_str(), (char*) keyBuffer, compression, maxDbs, maxReaders, mapSize, pageSize, cacheSize, encryptKey.empty() ? nullptr : (char*)encryptKey.c_str());
+	if (rc)
+		return throwLmdbError(info.Env(), rc);
 	napi_add_env_cleanup_hook(napiEnv, cleanup, this);
 	return info.Env().Undefined();
 }
 int DbWrap::openDB(int flags, int jsFlags, const char* path, char* keyBuffer, Compression* compression, int maxDbs,
-		int maxReaders, size_t mapSize, int pageSize, char* encryptionKey) {
+		int maxReaders, size_t mapSize, int pageSize, size_t cacheSize, char* encryptionKey) {
 	this->keyBuffer = keyBuffer;
+	this->pageSize = pageSize ? pageSize : SPLINTERDB_PAGE_SIZE;
 	this->compression = compression;
 	this->jsFlags = jsFlags;
-	this->hasVersions = false;
+	// all the values of a store with versions start with an 8 byte version header, see putWithVersion
+	this->hasVersions = flags & HAS_VERSIONS;
+	this->db = NULL; // To a running SplinterDB instance
+	if (!threadEnvRefs)
+		threadEnvRefs = new std::unordered_map<transactional_splinterdb*, ThreadEnvRef>;
+
+	// A store file can only be mounted once, so if another thread (or another open of this thread) already has it
+	// mounted, share that instance, registering this thread with it. Its configuration is the one it was opened with.
+	pthread_mutex_lock(envTracking->dbsLock);
+#ifdef _WIN32
+	struct _stat64 fileStat;
+	bool exists = _stat64(path, &fileStat) == 0 && fileStat.st_size > 0;
+#else
+	struct stat fileStat;
+	bool exists = stat(path, &fileStat) == 0 && fileStat.st_size > 0;
+#endif
+	if (exists) {
+		for (auto envRef = envTracking->dbs.begin(); envRef != envTracking->dbs.end(); ++envRef) {
+			if (envRef->dev == (uint64_t) fileStat.st_dev && envRef->inode == (uint64_t) fileStat.st_ino) {
+				if (envRef->hasVersions != hasVersions) {
+					pthread_mutex_unlock(envTracking->dbsLock);
+					return EINVAL;
+				}
+				envRef->count++;
+				db = envRef->env;
+				dataConfig = envRef->dataConfig;
+				ThreadEnvRef& threadRef = (*threadEnvRefs)[db];
+				if (threadRef.count++ == 0) {
+					// the instance gives the thread an id of its own, which it only does for a thread without one
+					splinterdb_set_thread_id(SPLINTERDB_NO_THREAD_ID);
+					transactional_splinterdb_register_thread(db);
+					threadRef.tid = splinterdb_get_thread_id();
+					threadIdDb = db;
+				}
+				pthread_mutex_unlock(envTracking->dbsLock);
+				useThreadId();
+				transactional_splinterdb_begin_read_only(db, &defaultReadTxn);
+				return 0;
+			}
+		}
+	}
 
-	// Initialize data configuration, using default key-comparison handling.
-	auto splinter_data_cfg = new data_config; // TODO: Free this on close
-	default_data_config_init(USER_MAX_KEY_SIZE, splinter_data_cfg);
+	// Initialize data configuration, using default key-comparison handling. splinterdb holds on to this for as long
+	// as it is open, so it is freed in closeEnv
+	dataConfig = new data_config;
+	default_data_config_init(USER_MAX_KEY_SIZE, dataConfig);
 
 	// Basic configuration of a SplinterDB instance
 	splinterdb_config splinterdb_cfg;
 	memset(&splinterdb_cfg, 0, sizeof(splinterdb_cfg));
 	splinterdb_cfg.filename	= path;
-	splinterdb_cfg.disk_size  = 1024*1024*1024;
-	splinterdb_cfg.cache_size = (64 * 1024 * 1024);
-	splinterdb_cfg.data_cfg	= splinter_data_cfg;
-
-	this->db = NULL; // To a running SplinterDB instance
-
-	int rc = transactional_splinterdb_create(&splinterdb_cfg, &db);
+	// The disk size is only an upper bound, the file grows as extents are used, so the default can be generous. It
+	// has to be a whole number of extents. Note that the size a store was created with is kept when it is mounted.
+	if (!mapSize)
+		mapSize = DEFAULT_MAP_SIZE;
+	splinterdb_cfg.disk_size = (mapSize + SPLINTERDB_EXTENT_SIZE - 1) / SPLINTERDB_EXTENT_SIZE * SPLINTERDB_EXTENT_SIZE;
+	// The cache is the only caching layer (there is no OS-level memory map like LMDB), so by default use a share of
+	// the physical memory, rounded to whole MBs (which keeps it a multiple of the cache's page batches)
+	if (!cacheSize) {
+		cacheSize = DEFAULT_CACHE_SIZE;
+#ifndef _WIN32
+		size_t physicalMemory = (size_t) sysconf(_SC_PHYS_PAGES) * (size_t) sysconf(_SC_PAGESIZE);
+		if (physicalMemory / 8 > cacheSize)
+			cacheSize = physicalMemory / 8;
+#endif
+	}
+	splinterdb_cfg.cache_size = (cacheSize + 0xfffff) & ~(size_t) 0xfffff;
+	splinterdb_cfg.page_size = this->pageSize;
+	splinterdb_cfg.data_cfg	= dataConfig;
+	// Only applies to the btrees written from here on, the existing ones are read either way, so this can be
+	// changed from one open to the next
+	splinterdb_cfg.btree_compress_leaves = flags & PAGE_COMPRESSION;
+
+	// If the file already exists, mount it. Mounting only reads the allocator meta page and ref counts and the trunk
+	// super block (the trunk root and everything below it is paged in on demand), so it doesn't scan any data.
+	// We only create (and format) a new store when there is no existing file. Either one registers this thread with
+	// the new instance, which has to start without the id of any other instance this thread has open.
+	splinterdb_set_thread_id(SPLINTERDB_NO_THREAD_ID);
+	threadIdDb = nullptr;
+	int rc = exists ?
+		transactional_splinterdb_open(&splinterdb_cfg, &db) :
+		transactional_splinterdb_create(&splinterdb_cfg, &db);
+#ifdef _WIN32
+	if (!rc && _stat64(path, &fileStat))
+#else
+	if (!rc && stat(path, &fileStat))
+#endif
+	{
+		transactional_splinterdb_close(&db);
+		rc = errno;
+	}
+	if (rc) {
+		pthread_mutex_unlock(envTracking->dbsLock);
+		db = nullptr;
+		delete dataConfig;
+		dataConfig = nullptr;
+		return rc;
+	}
+	(*threadEnvRefs)[db] = { 1, splinterdb_get_thread_id() };
+	threadIdDb = db;
+	SharedEnv envRef;
+	envRef.env = db;
+	envRef.dataConfig = dataConfig;
+	envRef.hasVersions = hasVersions;
+	envRef.dev = fileStat.st_dev;
+	envRef.inode = fileStat.st_ino;
+	envRef.count = 1;
+	envTracking->dbs.push_back(envRef);
+	pthread_mutex_unlock(envTracking->dbsLock);
+	transactional_splinterdb_begin_read_only(db, &defaultReadTxn);
 	return rc;
 }
 #ifdef _WIN32
@@ -197,48 +303,6 @@ NAPI_FUNCTION(setEnvsPointer) {
 	RETURN_UNDEFINED;
 }
 
-napi_finalize cleanupExternal = [](napi_env env, void *, void * size) {
-	// Data belongs to LMDB, we shouldn't free it here
-	int64_t result;
-	napi_adjust_external_memory(env, (int64_t) size, &result);
-	//fprintf(stderr, "adjust memory back up %i\n", result);
-};
-
-NAPI_FUNCTION(getSharedBuffer) {
-	ARGS(2)
-	uint32_t bufferId;
-	GET_UINT32_ARG(bufferId, 0);
-	GET_INT64_ARG(1);
-	DbWrap* ew = (DbWrap*) i64;
-	for (auto bufferRef = DbWrap::sharedBuffers->begin(); bufferRef != DbWrap::sharedBuffers->end(); bufferRef++) {
-		if (bufferRef->second.id == bufferId) {
-			void* start = bufferRef->first;
-			buffer_info_t* buffer = &bufferRef->second;
-			if (buffer->db == ew->db) {
-				//fprintf(stderr, "found exiting buffer for %u\n", bufferId);
-				napi_get_reference_value(env, buffer->ref, &returnValue);
-				return returnValue;
-			}
-			if (buffer->db) {
-				fprintf(stderr, "env changed");
-				// if for some reason it is different env that didn't get cleaned up
-				napi_value arrayBuffer;
-				napi_get_reference_value(env, buffer->ref, &arrayBuffer);
-				napi_detach_arraybuffer(env, arrayBuffer);
-				napi_delete_reference(env, buffer->ref);
-			}
-			size_t end = buffer->end;
-			buffer->db = ew->db;
-			size_t size = end - (size_t) start;
-			napi_create_external_arraybuffer(env, start, size, cleanupExternal, (void*) size, &returnValue);
-			int64_t result;
-			napi_create_reference(env, returnValue, 1, &buffer->ref);
-			napi_adjust_external_memory(env, -(int64_t) size, &result);
-			return returnValue;
-		}
-	}
-	RETURN_UNDEFINED;
-}
 NAPI_FUNCTION(setTestRef) {
 	ARGS(1)
 	napi_create_reference(env, args[0], 1, &testRef);
@@ -256,33 +320,73 @@ NAPI_FUNCTION(getTestRef) {
 
 Napi::Value DbWrap::beginTxn(const CallbackInfo& info) {
 	int flags = info[0].As<Number>();
+	useThreadId();
 	int rc = transactional_splinterdb_begin(db, &txn);
+	if (rc == 0) {
+		// track it as the current write txn, so reads on this thread read (and validate) in it
+		TxnTracked *tracked = new TxnTracked(&txn, flags);
+		tracked->parent = writeTxn;
+		writeTxn = tracked;
+	}
 	return Number::New(info.Env(), rc);
 }
+void DbWrap::freeIterators(transaction* txn) {
+	// an iterator records its scans in the txn's read set, so it can't outlive it
+	useThreadId();
+	for (size_t i = keptIterators.size(); i-- > 0;) {
+		if (keptIterators[i]->iteratorTxn == txn)
+			keptIterators[i]->freeIterator();
+	}
+}
+void DbWrap::endWriteTxn() {
+	TxnTracked *currentTxn = this->writeTxn;
+	if (currentTxn && currentTxn->txn == &txn) {
+		writeTxn = currentTxn->parent;
+		delete currentTxn;
+	}
+}
 Napi::Value DbWrap::commitTxn(const CallbackInfo& info) {
-//	TxnTracked *currentTxn = this->writeTxn;
+	freeIterators(&txn);
 	int rc = transactional_splinterdb_commit(db, &txn);
+	endWriteTxn();
 	return Number::New(info.Env(), rc);
 }
+Napi::Value DbWrap::abortTxn(const CallbackInfo& info) {
+	freeIterators(&txn);
+	transactional_splinterdb_abort(db, &txn);
+	endWriteTxn();
+	return info.Env().Undefined();
+}
 transaction* DbWrap::getReadTxn(int64_t tw_address) {
 	transaction* txn;
+	useThreadId();
 	if (tw_address) // explicit txn
-		txn = &((TxnWrap*)tw_address)->txn;
-	/*else if (writeTxn && (txn = writeTxn->txn)) {
+		return &((TxnWrap*)tw_address)->txn;
+	else if (writeTxn && (txn = writeTxn->txn)) {
 		return txn; // no need to renew write txn
-	} */else // default to current read txn
-		txn = currentReadTxn;
-	txn = new transaction;
-	int rc = transactional_splinterdb_begin(db, txn);
-	if (rc) {
-		if (!txn)
-			fprintf(stderr, "No current read transaction available");
-		if (rc != EINVAL)
-			return nullptr; // if there was a real error, signal with nullptr and let error propagate with last_error
 	}
+	// default to current read txn (from JS), or our own if there isn't one. These are read-only, so renewing is just
+	// restarting them, which we do at most once per turn, until JS calls resetTxn/resetCurrentReadTxn
+	txn = currentReadTxn ? currentReadTxn : &defaultReadTxn;
+	if (readTxnRenewed)
+		return txn;
+	transactional_splinterdb_abort(db, txn);
+	int rc = transactional_splinterdb_begin_read_only(db, txn);
+	if (rc)
+		return nullptr; // if there was a real error, signal with nullptr and let error propagate with last_error
+	readTxnRenewed = true;
 	return txn;
 }
 
+Napi::Value DbWrap::resetCurrentReadTxn(const CallbackInfo& info) {
+	if (currentReadTxn || readTxnRenewed) {
+		useThreadId();
+		transactional_splinterdb_abort(db, currentReadTxn ? currentReadTxn : &defaultReadTxn);
+		readTxnRenewed = false;
+	}
+	return info.Env().Undefined();
+}
+
 int32_t DbWrap::doGetByBinary(uint32_t keySize, uint32_t ifNotTxnId, int64_t txnWrapAddress) {
 	transaction* txn = getReadTxn(txnWrapAddress);
 	slice key;
@@ -291,31 +395,114 @@ int32_t DbWrap::doGetByBinary(uint32_t keySize, uint32_t ifNotTxnId, int64_t txn
 	key.data = (void*) keyBuffer;
 	uint32_t* currentTxnId = (uint32_t*) (keyBuffer + 32);
 	splinterdb_lookup_result result;
-	transactional_splinterdb_lookup_result_init(db, &result, 0, NULL);
+	// look up directly into the global buffer, so that (without compression) the value is already where JS reads it
+	// from. The lookup result only allocates if the value doesn't fit.
+	transactional_splinterdb_lookup_result_init(db, &result, getGlobalUnsafeSize(), getGlobalUnsafePtr());
 
+	int32_t returnValue;
 	int rc = transactional_splinterdb_lookup(db, txn, key, &result);
-	if (splinterdb_lookup_found(&result))
-		rc = splinterdb_lookup_result_value(&result, &data);
-	else
-		rc = -30798;
-	if (rc) {
-		if (rc > 0)
-			return -rc;
-		return rc;
+	if (rc)
+		returnValue = rc > 0 ? -rc : rc;
+	else if (!splinterdb_lookup_found(&result))
+		returnValue = -30798; // not found
+	else {
+		splinterdb_lookup_result_value(&result, &data);
+		rc = getVersionAndUncompress(data, this);
+		// copy it to the global/compression-target buffer. One that doesn't fit is left for JS to get again, once it
+		// has a buffer big enough (see _returnLargeBuffer)
+		if (rc)
+			valToBinaryFast(data, this);
+		if (data.length < 0x80000000)
+			returnValue = data.length;
+		else {
+			*((uint32_t*)keyBuffer) = data.length;
+			returnValue = -30000;
+		}
 	}
-	rc = getVersionAndUncompress(data, this);
-	bool fits = true;
-	if (rc) {
-		fits = valToBinaryFast(data, this); // it fits in the global/compression-target buffer
+	splinterdb_lookup_result_deinit(&result);
+	return returnValue;
+}
+
+int32_t DbWrap::doGetMany(char* keys, uint32_t count, char* target, size_t targetSize, int64_t txnWrapAddress) {
+	transaction* txn = getReadTxn(txnWrapAddress);
+	// read the key sequence that saveKey writes: each key is preceded by its length, a length of 0xffffffff means the
+	// sequence continues at the address that follows it, and a length of 0 ends it
+	std::vector<std::pair<slice, uint32_t>> sortedKeys;
+	sortedKeys.reserve(count);
+	char* position = keys;
+	while (sortedKeys.size() < count) {
+		uint32_t size = *(uint32_t*) position;
+		if (size == 0xffffffff) {
+			position = (char*) (size_t) *((double*) (position + 4));
+			continue;
+		}
+		if (size == 0)
+			break;
+		sortedKeys.push_back(std::make_pair(slice_create(size, position + 4), (uint32_t) sortedKeys.size()));
+		position = (char*) (((size_t) position + size + 16) & ~((size_t) 3));
 	}
-	if (fits || rc == 2 || data.length < SHARED_BUFFER_THRESHOLD) {// result = 2 if it was decompressed
-		if (data.length < 0x80000000)
-			return data.length;
-		*((uint32_t*)keyBuffer) = data.length;
-		return -30000;
-	} else {
-		return DbWrap::toSharedBuffer(db, (uint32_t*) keyBuffer, data);
+	count = sortedKeys.size();
+	if ((size_t) count * 8 > targetSize)
+		return GET_MANY_NO_ROOM;
+	// look the keys up in key order, so consecutive lookups mostly walk the same trunk and branch pages
+	data_config* config = dataConfig;
+	std::sort(sortedKeys.begin(), sortedKeys.end(), [config](const std::pair<slice, uint32_t>& a, const std::pair<slice, uint32_t>& b) {
+		return config->key_compare(config, a.first, b.first) < 0;
+	});
+	int32_t* entries = (int32_t*) target;
+	size_t offset = (size_t) count * 8;
+	for (auto& key : sortedKeys) {
+		int32_t* entry = entries + key.second * 2;
+		entry[1] = 0;
+		char* valueTarget = target + offset;
+		splinterdb_lookup_result result;
+		transactional_splinterdb_lookup_result_init(db, &result, targetSize - offset, valueTarget);
+		int rc = transactional_splinterdb_lookup(db, txn, key.first, &result);
+		if (rc) {
+			splinterdb_lookup_result_deinit(&result);
+			return rc > 0 ? -rc : rc;
+		}
+		if (!splinterdb_lookup_found(&result))
+			entry[0] = -30798; // not found
+		else {
+			slice data;
+			splinterdb_lookup_result_value(&result, &data);
+			size_t storedLength = data.length;
+			// the lookup result only leaves the value in place if it fit in the remaining space
+			if (data.data != valueTarget || !getVersionAndUncompress(data, this))
+				entry[0] = GET_MANY_NO_ROOM;
+			else if ((char*) data.data >= valueTarget && (char*) data.data < valueTarget + storedLength) {
+				entry[0] = data.length;
+				entry[1] = (char*) data.data - target;
+				offset += storedLength;
+			} else if (data.length <= targetSize - offset) {
+				// decompressed into the decompression target, copy it over the compressed value
+				memcpy(valueTarget, data.data, data.length);
+				entry[0] = data.length;
+				entry[1] = offset;
+				offset += data.length;
+			} else
+				entry[0] = GET_MANY_NO_ROOM;
+		}
+		splinterdb_lookup_result_deinit(&result);
 	}
+	return count;
+}
+
+NAPI_FUNCTION(getManyByBinary) {
+	ARGS(5)
+	GET_INT64_ARG(0);
+	DbWrap* dw = (DbWrap*) i64;
+	double keysAddress;
+	napi_get_value_double(env, args[1], &keysAddress);
+	uint32_t count;
+	GET_UINT32_ARG(count, 2);
+	char* target;
+	size_t targetSize;
+	napi_get_buffer_info(env, args[3], (void**) &target, &targetSize);
+	int64_t txnAddress = 0;
+	napi_get_value_int64(env, args[4], &txnAddress);
+	RETURN_INT32(dw->doGetMany((char*) (size_t) keysAddress, count, target, targetSize, txnAddress));
 }
 
 NAPI_FUNCTION(getByBinary) {
@@ -336,7 +523,48 @@ thread_local int nextSharedId = 1;
 void DbWrap::closeEnv(bool hasLock) {
 	if (!db)
 		return;
+	if (readPool) {
+		readPool->stop();
+		readPool = nullptr;
+	}
+	if (compressionPool) {
+		compressionPool->stop();
+		delete compressionPool;
+		compressionPool = nullptr;
+	}
+	if (compression && compression->dictionaryEnv == this)
+		compression->dictionaryEnv = nullptr;
+	useThreadId();
+	while (!keptIterators.empty())
+		keptIterators.back()->freeIterator();
+	transactional_splinterdb_abort(db, &defaultReadTxn);
+	readTxnRenewed = false;
+	pthread_mutex_lock(envTracking->dbsLock);
+	bool isLast = true;
+	for (auto envRef = envTracking->dbs.begin(); envRef != envTracking->dbs.end(); ++envRef) {
+		if (envRef->env == db) {
+			isLast = --envRef->count == 0;
+			if (isLast)
+				envTracking->dbs.erase(envRef);
+			break;
+		}
+	}
+	bool isLastOfThread = --(*threadEnvRefs)[db].count == 0;
+	if (isLastOfThread) {
+		threadEnvRefs->erase(db);
+		// closing or deregistering leaves the thread without an id
+		threadIdDb = nullptr;
+	}
+	if (isLast) {
+		// unmounting writes back the trunk super block and the allocator ref counts, which is what allows the store
+		// to be mounted (rather than re-created) on the next open. This also deregisters this thread.
+		transactional_splinterdb_close(&db);
+		delete dataConfig;
+	} else if (isLastOfThread)
+		transactional_splinterdb_deregister_thread(db);
+	pthread_mutex_unlock(envTracking->dbsLock);
 	db = nullptr;
+	dataConfig = nullptr;
 }
 
 Napi::Value DbWrap::close(const CallbackInfo& info) {
@@ -354,12 +582,15 @@ void DbWrap::setupExports(Napi::Env env, Object exports) {
 		DbWrap::InstanceMethod("close", &DbWrap::close),
 		DbWrap::InstanceMethod("beginTxn", &DbWrap::beginTxn),
 		DbWrap::InstanceMethod("commitTxn", &DbWrap::commitTxn),
+		DbWrap::InstanceMethod("abortTxn", &DbWrap::abortTxn),
 		DbWrap::InstanceMethod("startWriting", &DbWrap::startWriting),
+		DbWrap::InstanceMethod("resetCurrentReadTxn", &DbWrap::resetCurrentReadTxn),
 	});
 	//envTpl->InstanceTemplate()->SetInternalFieldCount(1);
-	//EXPORT_NAPI_FUNCTION("compress", compress);
+	EXPORT_NAPI_FUNCTION("compress", compress);
 	EXPORT_NAPI_FUNCTION("write", write);
 	EXPORT_NAPI_FUNCTION("getByBinary", getByBinary);
+	EXPORT_NAPI_FUNCTION("getManyByBinary", getManyByBinary);
 	exports.Set("Env", EnvClass);
 }
 
@@ -22,7 +22,8 @@ void setupExportMisc(Napi::Env env, Object exports) {
 	exports.Set("version", versionObj);
 	EXPORT_NAPI_FUNCTION("setGlobalBuffer", setGlobalBuffer);
 	exports.Set("lmdbError", Function::New(env, lmdbError));
-	//exports.Set("enableDirectV8", Function::New(env, enableDirectV8));
+	EXPORT_NAPI_FUNCTION("enableDirectV8", enableDirectV8);
+	EXPORT_NAPI_FUNCTION("noop", noop);
 	EXPORT_NAPI_FUNCTION("createBufferForAddress", createBufferForAddress);
 	EXPORT_NAPI_FUNCTION("getAddress", getViewAddress);
 	EXPORT_NAPI_FUNCTION("detachBuffer", detachBuffer);
@@ -32,6 +33,13 @@ void setupExportMisc(Napi::Env env, Object exports) {
 	exports.Set("globalBuffer", Object(env, globalBuffer));
 }
 
+char* getGlobalUnsafePtr() {
+	return globalUnsafePtr;
+}
+size_t getGlobalUnsafeSize() {
+	return globalUnsafeSize;
+}
+
 void setFlagFromValue(int *flags, int flag, const char *name, bool defaultValue, Object options) {
 	Value opt = options.Get(name);
 	if (opt.IsBoolean() ? opt.As<Boolean>().Value() : defaultValue)
@@ -82,7 +90,10 @@ bool valToBinaryFast(slice &data, DbWrap* dw) {
 			// indicates we could not copy, won't fit
 			return false;
 		}
-		memcpy(globalUnsafePtr, data.data, data.length);
+		// values are usually looked up directly into the global buffer, so this is a no-op or a short move (past
+		// a version)
+		if (data.data != globalUnsafePtr)
+			memmove(globalUnsafePtr, data.data, data.length);
 	}
 	return true;
 }
@@ -150,6 +161,12 @@ NAPI_FUNCTION(getViewAddress) {
 	return returnValue;
 }
 
+// the cost of a native call through N-API, to compare with the direct V8 one (see benchmark/fast-api.js)
+NAPI_FUNCTION(noop) {
+	napi_value returnValue;
+	RETURN_UNDEFINED;
+}
+
 NAPI_FUNCTION(detachBuffer) {
 	ARGS(1)
 	#if (NAPI_VERSION > 6)
@@ -181,18 +198,9 @@ int putWithVersion(transactional_splinterdb* db, transaction *   txn,
 		slice   key,
 		slice   data,
 		unsigned int	flags, double version) {
-	// leave 8 header bytes available for version and copy in with reserved memory
-	char* sourceData = (char*) data.data;
-	int size = data.length;
-	data.length = size + 8;
-	int rc = transactional_splinterdb_insert(db, txn, key, data);
-	if (rc == 0) {
-		// if put is successful, data.data will point into the database where we copy the data to
-		memcpy((char*) data.data + 8, sourceData, size);
-		*((double*) data.data) = version;
-	}
-	data.data = sourceData; // restore this so that if it points to data that needs to be freed, it points to the right place
-	return rc;
+	// the version is an 8 byte header before the data, which the txn puts together in its own copy of the value (see
+	// getVersionAndUncompress for reading it)
+	return transactional_splinterdb_insert_with_prefix(db, txn, key, slice_create(8, &version), data);
 }
 
 
@@ -290,7 +298,7 @@ int cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, uint64_t cms)
 	clock_gettime(CLOCK_REALTIME, &ts);
 	uint64_t ns = ts.tv_nsec + cms * 10000;
 	ts.tv_sec += ns / 1000000000;
-	ts.tv_nsec += ns % 1000000000;
+	ts.tv_nsec = ns % 1000000000;
 	return pthread_cond_timedwait(cond, mutex, &ts);
 }
 
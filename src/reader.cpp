@@ -0,0 +1,319 @@
+#include "splinterdb-js.h"
+#include <string.h>
+
+using namespace Napi;
+
+// values are looked up into a buffer of this size, which is handed to JS as is when the value fits
+const size_t READ_BUFFER_SIZE = 4096;
+// lookups each thread keeps in flight, while the others wait on the disk
+const int LOOKUPS_PER_THREAD = 32;
+// the longest wait for IO (in the 10us units of cond_timedwait) before polling for completions again
+const uint64_t MAX_IO_WAIT = 100;
+
+static void asyncReadIoDone(void* arg) {
+	AsyncRead* read = (AsyncRead*) arg;
+	read->pool->ioDone(read);
+}
+
+void ReadPool::ioDone(AsyncRead* read) {
+	// the lookup itself is continued by its own thread, which may be waiting for this (or any) completion
+	pthread_mutex_lock(&jobsLock);
+	read->ioDone = true;
+	pthread_cond_broadcast(&jobReady);
+	pthread_mutex_unlock(&jobsLock);
+}
+
+void ReadPool::waitForIo(uint64_t* delay) {
+	// completions are only processed by polling, so a completion that nobody else polls for is only seen once
+	// the wait times out, the delay backs off so that a thread waiting on a slow disk doesn't spin
+	cond_timedwait(&jobReady, &jobsLock, *delay);
+	if (*delay < MAX_IO_WAIT)
+		*delay <<= 1;
+}
+
+static void callResolveReads(napi_env env, napi_value callback, void* context, void* data) {
+	ReadPool* pool = (ReadPool*) context;
+	pool->notifying = false;
+	if (!env)
+		return; // shutting down
+	if (pool->outstanding == 0 && pool->isRef) {
+		// nothing in flight, don't hold the process open
+		napi_unref_threadsafe_function(env, pool->resolveReads);
+		pool->isRef = false;
+	}
+	napi_value undefined;
+	napi_get_undefined(env, &undefined);
+	napi_call_function(env, undefined, callback, 0, nullptr, nullptr);
+}
+
+static void finalizeReadPool(napi_env env, void* data, void* context) {
+	delete (ReadPool*) context;
+}
+
+ReadPool::ReadPool(DbWrap* dw, napi_env env, napi_value callback) {
+	this->dw = dw;
+	this->env = env;
+	this->outstanding = 0;
+	this->notifying = false;
+	this->closing = false;
+	pthread_mutex_init(&jobsLock, nullptr);
+	pthread_cond_init(&jobReady, nullptr);
+	napi_value name;
+	napi_create_string_utf8(env, "splinterdb-read", NAPI_AUTO_LENGTH, &name);
+	napi_create_threadsafe_function(env, callback, nullptr, name, 0, 1, nullptr, finalizeReadPool, this,
+		callResolveReads, &resolveReads);
+	napi_unref_threadsafe_function(env, resolveReads);
+	isRef = false;
+	unsigned int threadCount = std::thread::hardware_concurrency();
+	if (threadCount < 2)
+		threadCount = 2;
+	else if (threadCount > 4)
+		threadCount = 4; // each thread takes a slot of the db's MAX_THREADS, and keeps many lookups in flight anyway
+	for (unsigned int i = 0; i < threadCount; i++)
+		threads.push_back(std::thread(runWorker, this));
+}
+
+void ReadPool::runWorker(ReadPool* pool) {
+	transactional_splinterdb* db = pool->dw->db;
+	transactional_splinterdb_register_thread(db);
+	// a read-only txn doesn't track anything, so each thread can keep using its own
+	transaction txn;
+	transactional_splinterdb_begin_read_only(db, &txn);
+	AsyncRead reads[LOOKUPS_PER_THREAD];
+	for (int i = 0; i < LOOKUPS_PER_THREAD; i++) {
+		reads[i].pool = pool;
+		reads[i].instruction = nullptr;
+		reads[i].buffer = nullptr;
+		reads[i].ioDone = false;
+		transactional_splinterdb_async_lookup_create(db, asyncReadIoDone, &reads[i], &reads[i].ctxt);
+	}
+	int inFlight = 0;
+	uint64_t ioDelay = 1;
+	pthread_mutex_lock(&pool->jobsLock);
+	while (true) {
+		while (pool->jobs.empty() && !pool->closing && inFlight == 0)
+			pthread_cond_wait(&pool->jobReady, &pool->jobsLock);
+		if (pool->jobs.empty() && inFlight == 0)
+			break; // closing, and all the queued reads are done
+		if (!pool->jobs.empty() && (inFlight < LOOKUPS_PER_THREAD || pool->jobs.front().second)) {
+			std::pair<uint32_t*, bool> job = pool->jobs.front();
+			pool->jobs.pop_front();
+			pthread_mutex_unlock(&pool->jobsLock);
+			if (job.second)
+				pool->walk(job.first);
+			else {
+				AsyncRead* read = reads;
+				while (read->instruction)
+					read++;
+				read->instruction = job.first;
+				if (!pool->read(read, &txn))
+					inFlight++; // waiting on the disk, meanwhile we can start other lookups
+			}
+			pthread_mutex_lock(&pool->jobsLock);
+			continue;
+		}
+		pthread_mutex_unlock(&pool->jobsLock);
+		// everything we can take on is waiting on the disk, see what has completed (the completions may be
+		// for other threads' lookups, any thread can process them)
+		transactional_splinterdb_async_poll(db);
+		bool progressed = false;
+		for (int i = 0; i < LOOKUPS_PER_THREAD; i++) {
+			AsyncRead* read = &reads[i];
+			if (read->instruction && read->ioDone) {
+				read->ioDone = false;
+				progressed = true;
+				// a lookup has to be continued by the thread that started it
+				if (pool->read(read, &txn))
+					inFlight--;
+			}
+		}
+		pthread_mutex_lock(&pool->jobsLock);
+		if (progressed)
+			ioDelay = 1;
+		else if (pool->jobs.empty() || (inFlight == LOOKUPS_PER_THREAD && !pool->jobs.front().second)) {
+			// nothing to do until an IO completes, ioDone is set under the lock, so checking for it here can't
+			// miss the wake up
+			bool anyDone = false;
+			for (int i = 0; i < LOOKUPS_PER_THREAD; i++) {
+				if (reads[i].instruction && reads[i].ioDone)
+					anyDone = true;
+			}
+			if (!anyDone)
+				pool->waitForIo(&ioDelay);
+		}
+	}
+	pthread_mutex_unlock(&pool->jobsLock);
+	for (int i = 0; i < LOOKUPS_PER_THREAD; i++)
+		transactional_splinterdb_async_lookup_destroy(db, reads[i].ctxt);
+	transactional_splinterdb_abort(db, &txn);
+	transactional_splinterdb_deregister_thread(db);
+}
+
+void ReadPool::addJob(uint32_t* instruction, bool isWalk) {
+	pthread_mutex_lock(&jobsLock);
+	jobs.push_back(std::make_pair(instruction, isWalk));
+	pthread_cond_signal(&jobReady);
+	pthread_mutex_unlock(&jobsLock);
+}
+
+void ReadPool::startWalk(uint32_t* instruction) {
+	outstanding++;
+	if (!isRef) {
+		napi_ref_threadsafe_function(env, resolveReads);
+		isRef = true;
+	}
+	addJob(instruction, true);
+}
+
+/*
+	Each read instruction is laid out as (in uint32s):
+	0-1: the DbWrap address as a double (always this pool's, each env has its own queue), replaced with the result
+	address (or buffer id and offset)
+	2: status flags
+	3: key size, replaced with the value size (or error code)
+	4+: key, with the next instruction following at the next 4-byte boundary, 12 bytes after the key
+*/
+void ReadPool::walk(uint32_t* instruction) {
+	while (true) {
+		uint32_t status = 0;
+		// if nothing has been written here yet, mark that we stopped following the queue here, and the
+		// next instruction written here will start a new walk
+		if (std::atomic_compare_exchange_strong((std::atomic<uint32_t>*) (instruction + 2), &status, READ_STOPPED))
+			break;
+		if (!(status & READ_REQUESTED))
+			break; // end of this instruction buffer
+		uint32_t keySize = instruction[3];
+		outstanding++;
+		addJob(instruction, false);
+		instruction = (uint32_t*) (((size_t) instruction + 28 + keySize) & ~((size_t) 3));
+	}
+	finished();
+}
+
+// Start or continue the lookup for a read instruction, returning whether it is done (or false if it is waiting on IO)
+bool ReadPool::read(AsyncRead* read, transaction* txn) {
+	uint32_t* instruction = read->instruction;
+	slice key = slice_create(instruction[3], (char*) (instruction + 4));
+	if (!read->buffer) {
+		read->buffer = (char*) malloc(READ_BUFFER_SIZE);
+		transactional_splinterdb_lookup_result_init(dw->db, &read->result, READ_BUFFER_SIZE, read->buffer);
+	}
+	int rc;
+	uint64_t retryDelay = 1;
+	while ((rc = transactional_splinterdb_lookup_async(dw->db, txn, key, &read->result, read->ctxt)) == SPLINTERDB_ASYNC_RETRY) {
+		// raced with a writer (or ran out of IO requests), try again once others have made progress
+		transactional_splinterdb_async_poll(dw->db);
+		pthread_mutex_lock(&jobsLock);
+		waitForIo(&retryDelay);
+		pthread_mutex_unlock(&jobsLock);
+	}
+	if (rc == SPLINTERDB_ASYNC_IO_STARTED)
+		return false;
+	char* buffer = read->buffer;
+	uint32_t type;
+	if (rc) {
+		instruction[3] = rc > 0 ? -rc : rc;
+		type = READ_ERROR;
+	} else if (!splinterdb_lookup_found(&read->result))
+		type = READ_NOT_FOUND;
+	else {
+		slice data;
+		splinterdb_lookup_result_value(&read->result, &data);
+		char* value = (char*) data.data;
+		size_t length = data.length;
+		if (dw->hasVersions) {
+			value += 8;
+			length -= 8;
+		}
+		if (data.data != buffer) {
+			// didn't fit, the lookup result allocated its own space
+			buffer = (char*) realloc(buffer, length);
+			memcpy(buffer, value, length);
+		} else if (value != buffer)
+			memmove(buffer, value, length);
+		if (dw->compression && length > 0 && (unsigned char) buffer[0] >= 250) {
+			// decompression needs the compression buffers of the JS thread, so compressed values are left for
+			// it to get (the pages it needs are cached now)
+			type = READ_COMPRESSED;
+		} else {
+			type = READ_IN_OWN_BUFFER;
+			*((double*) instruction) = (double) (size_t) buffer;
+			instruction[3] = length;
+			buffer = nullptr; // owned by JS now
+		}
+	}
+	splinterdb_lookup_result_deinit(&read->result);
+	if (buffer)
+		free(buffer);
+	read->buffer = nullptr;
+	read->instruction = nullptr;
+	std::atomic_fetch_or((std::atomic<uint32_t>*) (instruction + 2), READ_DONE | type);
+	finished();
+	return true;
+}
+
+void ReadPool::finished() {
+	outstanding--;
+	if (!notifying.exchange(true))
+		napi_call_threadsafe_function(resolveReads, nullptr, napi_tsfn_nonblocking);
+}
+
+void ReadPool::stop() {
+	pthread_mutex_lock(&jobsLock);
+	closing = true;
+	pthread_cond_broadcast(&jobReady);
+	pthread_mutex_unlock(&jobsLock);
+	for (auto& thread : threads)
+		thread.join();
+	pthread_mutex_destroy(&jobsLock);
+	pthread_cond_destroy(&jobReady);
+	// the pool is deleted by the finalizer, once any pending calls have been made
+	napi_release_threadsafe_function(resolveReads, napi_tsfn_release);
+}
+
+NAPI_FUNCTION(startReading) {
+	ARGS(3)
+	GET_INT64_ARG(0);
+	DbWrap* dw = (DbWrap*) i64;
+	double instructionAddress;
+	napi_get_value_double(env, args[1], &instructionAddress);
+	if (!dw->db)
+		THROW_ERROR("The environment is already closed.");
+	if (!dw->readPool)
+		dw->readPool = new ReadPool(dw, env, args[2]);
+	dw->readPool->startWalk((uint32_t*) (size_t) instructionAddress);
+	RETURN_UNDEFINED;
+}
+
+static void freeReadResult(napi_env env, void* data, void* size) {
+	free(data);
+	int64_t result;
+	napi_adjust_external_memory(env, -(int64_t) (size_t) size, &result);
+}
+
+NAPI_FUNCTION(getReadResult) {
+	ARGS(2)
+	double address;
+	napi_get_value_double(env, args[0], &address);
+	uint32_t size;
+	GET_UINT32_ARG(size, 1);
+	// hand the value over without copying, it is freed when the buffer is collected, and counted as external memory
+	// until then, so the GC knows what collecting it frees
+	void* buffer = (void*) (size_t) address;
+	if (napi_create_external_arraybuffer(env, buffer, size, freeReadResult, (void*) (size_t) size, &returnValue) == napi_ok) {
+		int64_t result;
+		napi_adjust_external_memory(env, (int64_t) size, &result);
+	} else {
+		// runtimes that don't allow external buffers get a copy
+		void* data;
+		napi_create_arraybuffer(env, size, &data, &returnValue);
+		memcpy(data, buffer, size);
+		free(buffer);
+	}
+	return returnValue;
+}
+
+void setupExportReader(Napi::Env env, Object exports) {
+	EXPORT_NAPI_FUNCTION("startReading", startReading);
+	EXPORT_NAPI_FUNCTION("getReadResult", getReadResult);
+}
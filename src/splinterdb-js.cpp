@@ -17,11 +17,10 @@ Object InitAll(Napi::Env env, Object exports) {
 	// Export Env as constructor for DbWrap
 	DbWrap::setupExports(env, exports);
 	TxnWrap::setupExports(env, exports);
+	setupExportReader(env, exports);
+	// Export Cursor as constructor for IteratorWrap
+	IteratorWrap::setupExports(env, exports);
 /*
-	// Export Cursor as constructor for CursorWrap
-	CursorWrap::setupExports(env, exports);
-	DbWrap::setupExports(env, exports);
-	CursorWrap::setupExports(env, exports);
 	Compression::setupExports(env, exports);
 
 	// Export misc things*/
@@ -25,8 +25,11 @@
 #define SPLINTERDB_JS_H
 
 #include <vector>
+#include <deque>
 #include <unordered_map>
 #include <algorithm>
+#include <atomic>
+#include <thread>
 #include <ctime>
 #include <napi.h>
 #include <node_api.h>
@@ -41,6 +44,15 @@ using namespace Napi;
 
 // set the threshold of when to use shared buffers (for uncompressed entries larger than this value)
 const size_t SHARED_BUFFER_THRESHOLD = 0x4000;
+// getMany entry code for a value that didn't fit in the remaining space of the target
+const int32_t GET_MANY_NO_ROOM = -30002;
+// page and extent sizes of the splinterdb io layer (these are the only sizes it supports)
+const size_t SPLINTERDB_PAGE_SIZE = 4096;
+const size_t SPLINTERDB_EXTENT_SIZE = 32 * SPLINTERDB_PAGE_SIZE;
+// default upper bound on the size of the db file (it only grows as needed)
+const size_t DEFAULT_MAP_SIZE = (size_t) 1 << 40;
+// minimum default size of the page cache
+const size_t DEFAULT_CACHE_SIZE = 64 * 1024 * 1024;
 typedef int dbi_t;
 
 #ifndef __CPTHREAD_H__
@@ -142,6 +154,7 @@ class Compression;
 
 // Exports misc stuff to the module
 void setupExportMisc(Env env, Object exports);
+void setupExportReader(Env env, Object exports);
 
 // Helper callback
 typedef void (*argtokey_callback_t)(slice &key);
@@ -159,9 +172,10 @@ Value lmdbError(const CallbackInfo& info);
 napi_value createBufferForAddress(napi_env env, napi_callback_info info);
 napi_value getViewAddress(napi_env env, napi_callback_info info);
 napi_value detachBuffer(napi_env env, napi_callback_info info);
+napi_value noop(napi_env env, napi_callback_info info);
 Value getAddress(const CallbackInfo& info);
 Value lmdbNativeFunctions(const CallbackInfo& info);
-Value enableDirectV8(const CallbackInfo& info);
+napi_value enableDirectV8(napi_env env, napi_callback_info info);
 
 #ifndef thread_local
 #ifdef __GNUC__
@@ -176,6 +190,9 @@ Value enableDirectV8(const CallbackInfo& info);
 #endif
 
 bool valToBinaryFast(slice &data, DbWrap* ew);
+// the (thread's) global buffer that values are returned to JS in
+char* getGlobalUnsafePtr();
+size_t getGlobalUnsafeSize();
 Value valToUtf8(Env env, slice &data);
 Value valToString(slice &data);
 Value valToStringUnsafe(slice &data);
@@ -196,10 +213,20 @@ class IteratorWrap;
 class SharedEnv {
   public:
 	transactional_splinterdb* env;
+	// the instance holds on to its data config until it is closed
+	data_config* dataConfig;
+	// whether all its values start with a version header, which every open of it has to agree on
+	bool hasVersions;
 	uint64_t dev;
 	uint64_t inode;
 	int count;
 };
+// A thread's registration with an instance: how many DbWraps of the thread have it open (the thread is registered
+// while it has any), and the id the instance gave the thread
+struct ThreadEnvRef {
+	int count;
+	threadid tid;
+};
 
 const int INTERRUPT_BATCH = 9998;
 const int WORKER_WAITING = 9997;
@@ -227,6 +254,14 @@ class WriteWorker {
 	uint32_t* instructions;
 	int progressStatus;
 	transactional_splinterdb* db;
+	// A batch that fails to commit because of a conflicting write is run again, so the results of its instructions
+	// (and the freeing of its compressed values) wait until it is done, see FinishBatch. It can only be run again if
+	// JS hasn't been involved in it (callbacks, or sync txns that joined it), see canRetry.
+	std::vector<std::pair<uint32_t*, uint32_t>> pendingResults;
+	std::vector<void*> pendingFrees;
+	uint32_t* batchEnd;
+	bool canRetry;
+	void FinishBatch();
 	static int DoWrites(transaction* txn, DbWrap* envForTxn, uint32_t* instruction, WriteWorker* worker);
 };
 class AsyncWriteWorker : public WriteWorker, public AsyncProgressWorker<char> {
@@ -268,13 +303,108 @@ typedef struct buffer_info_t {
 	transactional_splinterdb* db;
 	napi_ref ref;
 } buffer_info_t;
+// status flags of a read instruction (the third uint32), see recordReadInstruction in read.js
+const uint32_t READ_REQUESTED = 0x10;
+const uint32_t READ_DONE = 0x1000000;
+// no reader is following the queue at this instruction, so writing one here must start a new walk
+const uint32_t READ_STOPPED = 0xf0000000;
+// types of read results (the low bits of the status)
+const uint32_t READ_IN_OWN_BUFFER = 1;
+const uint32_t READ_NOT_FOUND = 2;
+const uint32_t READ_ERROR = 3;
+const uint32_t READ_COMPRESSED = 4;
+
+// A lookup for a read instruction, which may be waiting on the disk
+class ReadPool;
+struct AsyncRead {
+	ReadPool* pool;
+	uint32_t* instruction;
+	char* buffer;
+	splinterdb_lookup_result result;
+	splinterdb_async_lookup* ctxt;
+	std::atomic<bool> ioDone;
+};
+
+/*
+	`ReadPool`
+	Threads (registered with the db) that drain the read instruction queue that read.js writes for the env, so that
+	lookups that miss the cache (and wait on disk) don't block the JS thread. Every env has its own queue, since
+	the threads look up whatever they find in it in their own db. Each thread uses async lookups, so it can
+	keep many of them waiting on the disk at once.
+*/
+class ReadPool {
+public:
+	ReadPool(DbWrap* dw, napi_env env, napi_value resolveReads);
+	// start following the queue from this instruction
+	void startWalk(uint32_t* instruction);
+	// wait for the outstanding reads and stop the threads, the pool is freed once the JS callback is released
+	void stop();
+	// called (from whichever thread polls for it) when the IO of a lookup completes, wakes the threads waiting for IO
+	void ioDone(AsyncRead* read);
+	napi_threadsafe_function resolveReads;
+	// walks and lookups that haven't finished yet
+	std::atomic<int> outstanding;
+	std::atomic<bool> notifying;
+	bool isRef;
+	napi_env env;
+private:
+	void walk(uint32_t* instruction);
+	bool read(AsyncRead* read, transaction* txn);
+	void finished();
+	void addJob(uint32_t* instruction, bool isWalk);
+	static void runWorker(ReadPool* pool);
+	// wait (up to the delay, which backs off to MAX_IO_WAIT) for an IO completion or a new job
+	void waitForIo(uint64_t* delay);
+	DbWrap* dw;
+	std::vector<std::thread> threads;
+	// queued instructions to walk from or to look up
+	std::deque<std::pair<uint32_t*, bool>> jobs;
+	pthread_mutex_t jobsLock;
+	pthread_cond_t jobReady;
+	bool closing;
+};
+
+/*
+	`CompressionPool`
+	Threads that compress the values of queued (not txn) writes, in the order they were written, so that they are
+	usually compressed by the time the write thread gets to them. Each thread takes a batch of the oldest values at a
+	time and claims them (see compressInstruction), and a value the write thread gets to first is compressed by the
+	write thread itself, and taken out of the queue.
+*/
+class CompressionPool {
+public:
+	CompressionPool(DbWrap* dw);
+	// queue the compression of the value of a write instruction (the address of its compression slot)
+	void add(double* compressionAddress);
+	// take a value that the write thread claimed out of the queue, so the pool doesn't touch it again
+	void remove(double* compressionAddress);
+	// stop and join the threads, any values still queued are left for the write thread
+	void stop();
+private:
+	static void runWorker(CompressionPool* pool);
+	DbWrap* dw;
+	std::vector<std::thread> threads;
+	std::deque<double*> jobs;
+	pthread_mutex_t jobsLock;
+	pthread_cond_t jobReady;
+	unsigned int idle;
+	bool closing;
+};
+
 class DbWrap : public ObjectWrap<DbWrap> {
 private:
 	// List of open read transactions
 	std::vector<TxnWrap*> readTxns;
+	// Cursors that are keeping an iterator for reuse, which has to be freed before the db is closed, or the txn it
+	// reads in ends
+	std::vector<IteratorWrap*> keptIterators;
 	static env_tracking_t* initTracking();
 	napi_env napiEnv;
 	static thread_local std::vector<DbWrap*>* openDbWraps;
+	// the instances this thread is registered with
+	static thread_local std::unordered_map<transactional_splinterdb*, ThreadEnvRef>* threadEnvRefs;
+	// the instance whose id is the current one of this thread
+	static thread_local transactional_splinterdb* threadIdDb;
 
 	// Cleans up stray transactions
 	void cleanupStrayTxns();
@@ -282,12 +412,15 @@ private:
 	static void cleanupDbWraps(void* data);
 
 	friend class TxnWrap;
+	friend class IteratorWrap;
 
 public:
 	DbWrap(const CallbackInfo&);
 	~DbWrap();
 	// The wrapped object
 	transactional_splinterdb* db;
+	// Data config for the db, must live as long as the db is open
+	data_config* dataConfig;
 	// Current write transaction
 	static thread_local std::unordered_map<void*, buffer_info_t>* sharedBuffers;
 	static env_tracking_t* envTracking;
@@ -299,13 +432,38 @@ public:
 	std::vector<AsyncWorker*> workers;
 
 	transaction* currentReadTxn;
+	// read txn used when there is no current read txn from JS, renewed like it
+	transaction defaultReadTxn;
 	WriteWorker* writeWorker;
+	// threads for off-thread reads, started on the first async read
+	ReadPool* readPool;
+	// threads for compressing written values, started on the first compressed write
+	CompressionPool* compressionPool;
 	bool readTxnRenewed;
 	unsigned int jsFlags;
 	char* keyBuffer;
 	int pageSize;
 	time_t lastReaderCheck;
 	transaction* getReadTxn(int64_t tw_address);
+	// A thread only has one current id, though each instance it is registered with gives it one of its own, so this is
+	// called before using a db on the JS thread, to switch to the id it gave this thread (if another one was used since).
+	// Returns the db whose id it switched from, to switch back to.
+	static transactional_splinterdb* useThreadId(transactional_splinterdb* db) {
+		transactional_splinterdb* previousDb = threadIdDb;
+		if (previousDb != db) {
+			auto threadRef = threadEnvRefs->find(db);
+			if (threadRef != threadEnvRefs->end()) {
+				splinterdb_set_thread_id(threadRef->second.tid);
+				threadIdDb = db;
+			}
+		}
+		return previousDb;
+	}
+	void useThreadId() {
+		useThreadId(db);
+	}
+	// frees the iterators kept by cursors that read in this txn, which is ending
+	void freeIterators(transaction* txn);
 	bool hasVersions;
 	// compression settings and space
 	Compression *compression;
@@ -314,7 +472,7 @@ public:
 	static void setupExports(Napi::Env env, Object exports);
 	void closeEnv(bool hasLock = false);
 	int openDB(int flags, int jsFlags, const char* path, char* keyBuffer, Compression* compression, int maxDbs,
-		int maxReaders, size_t mapSize, int pageSize, char* encryptionKey);
+		int maxReaders, size_t mapSize, int pageSize, size_t cacheSize, char* encryptionKey);
 
 	/*
 		Opens the database environment with the specified options. The options will be used to configure the environment before opening it.
@@ -328,7 +486,9 @@ public:
 
 		* maxDbs: the maximum number of named databases you can have in the environment (default is 1)
 		* maxReaders: the maximum number of concurrent readers of the environment (default is 126)
-		* mapSize: maximal size of the memory map (the full environment) in bytes (default is 10485760 bytes)
+		* mapSize: maximal size of the database file in bytes, which grows up to this as needed (default is 1TB)
+		* pageSize: page size, SplinterDB only supports 4096 (the default)
+		* cacheSize: size of the page cache in bytes (default is 1/8 of physical memory, and at least 64MB)
 		* path: path to the database environment
 	*/
 	Napi::Value open(const CallbackInfo& info);
@@ -336,7 +496,16 @@ public:
 
 	Napi::Value beginTxn(const CallbackInfo& info);
 	Napi::Value commitTxn(const CallbackInfo& info);
+	Napi::Value abortTxn(const CallbackInfo& info);
+	// ends the sync write txn (txn) as the current write txn
+	void endWriteTxn();
 	int32_t doGetByBinary(uint32_t keySize, uint32_t ifNotTxnId, int64_t txnWrapAddress);
+	/*
+		Looks up a sequence of keys (as written by saveKey) in one snapshot, in key order. The target starts with an
+		(int32 length or error code, uint32 offset) pair for each key, in the order given, followed by the values.
+		Returns the number of keys, or an error code.
+	*/
+	int32_t doGetMany(char* keys, uint32_t count, char* target, size_t targetSize, int64_t txnWrapAddress);
 
 	/*
 		Performs a set of operations asynchronously, automatically wrapping it in its own transaction
@@ -350,12 +519,12 @@ public:
 	static napi_value write(napi_env env, napi_callback_info info);
 	static napi_value onExit(napi_env env, napi_callback_info info);
 	Napi::Value resetCurrentReadTxn(const CallbackInfo& info);
-	static int32_t toSharedBuffer(transactional_splinterdb* env, uint32_t* keyBuffer, slice data);
 };
 
 const int TXN_ABORTABLE = 1;
 const int TXN_SYNCHRONOUS_COMMIT = 2;
 const int TXN_FROM_WORKER = 4;
+const int TXN_READ_ONLY = 0x20000;
 
 /*
 	`Txn`
@@ -416,12 +585,38 @@ public:
 };
 
 const int HAS_VERSIONS = 0x100;
+// the leaves of the btrees the engine writes when it compacts are compressed, see btree_compress_leaves
+const int PAGE_COMPRESSION = 0x200;
+
+// the most dictionaries (by the id byte of the header of the values compressed with them), ids 250 and up are
+// left out so that a list of dictionaries that starts with an id is never taken for a compressed value
+const int MAX_DICTIONARIES = 250;
+// a trained dictionary, kept for as long as the compression, since values compressed with it can still be read
+struct CompressionDictionary {
+	char* data;
+	unsigned int size;
+};
 
 class Compression : public ObjectWrap<Compression> {
 public:
 	char* dictionary; // dictionary to use to decompress
 	char* compressDictionary; // separate dictionary to use to compress since the decompression dictionary can move around in the main thread
 	unsigned int dictionarySize;
+	// trained dictionaries by id, id 0 is the dictionary above (from the options), which the headers without an id
+	// (254 and 255) refer to
+	CompressionDictionary* dictionaries[MAX_DICTIONARIES];
+	// the dictionary that values are compressed with now
+	std::atomic<uint8_t> compressDictionaryId;
+	// the env and (encoded) key that trained dictionaries are saved under, so that the ones that other threads or
+	// processes trained since can be loaded when a value compressed with one of them is read
+	DbWrap* dictionaryEnv;
+	std::string dictionaryListKey;
+	// when training, every few values that are compressed are sampled (their start) into a ring of samples
+	bool sampling;
+	std::atomic<uint32_t> sampleCounter;
+	std::vector<std::string> samples;
+	size_t nextSample;
+	pthread_mutex_t samplesLock;
 	char* decompressTarget;
 	unsigned int decompressSize;
 	unsigned int compressionThreshold;
@@ -433,7 +628,19 @@ public:
 	int compressInstruction(DbWrap* env, double* compressionAddress);
 	Napi::Value ctor(const CallbackInfo& info);
 	Napi::Value setBuffer(const CallbackInfo& info);
+	// registers a trained dictionary by id (once it has been saved), and optionally starts compressing with it
+	Napi::Value addDictionary(const CallbackInfo& info);
+	void registerDictionary(uint8_t id, const char* data, size_t size);
+	// sets where the dictionaries are saved, see loadDictionaries
+	Napi::Value setDictionaryList(const CallbackInfo& info);
+	// registers the saved dictionaries that aren't yet, returns whether there were any
+	bool loadDictionaries();
+	// trains a dictionary from the samples on another thread, and calls back with it, or with undefined if it
+	// wouldn't compress the samples much better than the current one
+	Napi::Value train(const CallbackInfo& info);
+	void addSample(const char* data, size_t length);
 	Compression(const CallbackInfo& info);
+	~Compression();
 	friend class DbWrap;
 	//NAN_METHOD(Compression::startCompressing);
 	static void setupExports(Napi::Env env, Object exports);
@@ -441,28 +648,42 @@ public:
 
 /*
 	`Iterator`
-	Represents a cursor instance that is assigned to a transaction and a database instance
-	(Wrapper for `splinterdb_iterator`)
+	Reads a range of entries in batches, each `iterate` call packing as many of the next entries as fit (and were
+	asked for) into the batch buffer the cursor was created with. The underlying `transactional_iterator` is kept from
+	one call to the next, in the txn the reads are in, but it is released at the end of each call, so an unfinished
+	range doesn't hold up writes, and the next batch seeks it to just after the last key that was returned (which,
+	unless a memtable was added to the tree in between, only repositions it in the leaf it was released in).
+	(Wrapper for `transactional_iterator`)
 */
 class IteratorWrap : public ObjectWrap<IteratorWrap> {
 
 private:
-
-	// Key/data pair where the cursor is at, and ending key
-	slice key, data, endKey;
-	// Free function for the current key
-	argtokey_callback_t freeKey;
+	// Last key returned, which the next batch starts after, and the (optional) ending key
+	char lastKey[USER_MAX_KEY_SIZE];
+	uint32_t lastKeySize;
+	char endKey[USER_MAX_KEY_SIZE];
+	uint32_t endKeySize;
+	bool hasEnd;
+	bool inclusiveEnd;
+	// the range has been read to its end
+	bool atEnd;
+	// iterating in descending order (so the end key is the lower bound)
+	bool reverse;
+	// where the entries are written, see fillBatch
+	char* batchBuffer;
+	size_t batchSize;
+	// kept from one call to the next (released, so it doesn't hold anything in the db) and repositioned with seek,
+	// it is only created again when the range's fixed bound (or direction), or the txn it reads in, changes. The
+	// scans are reads of the txn, so a txn that writes based on them still commits serializably
+	transactional_iterator* iterator;
+	int seek(slice key, bool sameRange);
+	int32_t fillBatch(transactional_iterator* iterator);
+	bool isValid(transactional_iterator* iterator);
 
 public:
-	int iteratingOp;
-	splinterdb_iterator *cursor;
-	// Stores how key is represented
-	LmdbKeyType keyType;
+	DbWrap* dw;
 	int flags;
-	transaction *txn;
 
-	// The wrapped object
-	IteratorWrap(splinterdb_iterator* cursor);
 	IteratorWrap(const CallbackInfo& info);
 	~IteratorWrap();
 
@@ -470,24 +691,16 @@ public:
 	static void setupExports(Napi::Env env, Object exports);
 
 	/*
-		Closes the cursor.
-		(Wrapper for `mdb_cursor_close`)
-
-		Parameters:
-
-		* Resource object
-		* Database instance object
+		Closes the cursor, it can't be positioned again.
 	*/
 	Napi::Value close(const CallbackInfo& info);
-	/*
-		Deletes the key/data pair to which the cursor refers.
-		(Wrapper for `mdb_cursor_del`)
-	*/
-	Napi::Value del(const CallbackInfo& info);
 
-	int returnEntry(int lastRC, slice &key, slice &data);
 	int32_t doPosition(uint32_t offset, uint32_t keySize, uint64_t endKeyAddress);
-	//Value getStringByBinary(const CallbackInfo& info);
+	int32_t doIterate();
+	// frees the kept iterator
+	void freeIterator();
+	// the txn the kept iterator reads in
+	transaction* iteratorTxn;
 };
 
 #endif // SPLINTERDB_JS_H
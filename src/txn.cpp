@@ -14,8 +14,9 @@ TxnTracked::~TxnTracked() {
 
 TxnWrap::TxnWrap(const Napi::CallbackInfo& info) : ObjectWrap<TxnWrap>(info) {
 	DbWrap *ew;
-	db = ew->db;
 	napi_unwrap(info.Env(), info[0], (void**)&ew);
+	db = ew->db;
+	DbWrap::useThreadId(db);
 	int flags = 0;
 	TxnWrap *parentTw;
 	if (info[1].IsBoolean() && ew->writeWorker) { // this is from a transaction callback
@@ -51,7 +52,10 @@ TxnWrap::TxnWrap(const Napi::CallbackInfo& info) : ObjectWrap<TxnWrap>(info) {
 			}
 			parentTxn = nullptr;
 		}*/
-		int rc = transactional_splinterdb_begin(db, &txn);
+		// read-only txns (like the shared read txn) don't track their reads, so they can be renewed and reused
+		int rc = (flags & TXN_READ_ONLY) ?
+			transactional_splinterdb_begin_read_only(db, &txn) :
+			transactional_splinterdb_begin(db, &txn);
 		if (rc != 0) {
 		//	txn = nullptr;
 //			throwLmdbError(info.Env(), rc);
@@ -77,6 +81,9 @@ TxnWrap::TxnWrap(const Napi::CallbackInfo& info) : ObjectWrap<TxnWrap>(info) {
 TxnWrap::~TxnWrap() {
 	// Close if not closed already
 	//if (this->txn) {
+		DbWrap::useThreadId(db);
+		if (ew)
+			ew->freeIterators(&txn);
 		transactional_splinterdb_abort(db, &txn);
 		this->removeFromDbWrap();
 	//}
@@ -92,6 +99,10 @@ void TxnWrap::removeFromDbWrap() {
 			if (it != ew->readTxns.end()) {
 				ew->readTxns.erase(it);
 			}
+			if (ew->currentReadTxn == &txn) {
+				ew->currentReadTxn = nullptr;
+				ew->readTxnRenewed = false;
+			}
 		}
 		this->ew = nullptr;
 	}
@@ -103,6 +114,8 @@ Value TxnWrap::commit(const Napi::CallbackInfo& info) {
 		return throwError(info.Env(), "The transaction is already closed.");
 	}*/
 	int rc;
+	DbWrap::useThreadId(db);
+	this->ew->freeIterators(&txn);
 	WriteWorker* writeWorker = this->ew->writeWorker;
 	if (writeWorker) {
 		// if (writeWorker->txn && env->writeMap)
@@ -124,11 +137,38 @@ Value TxnWrap::commit(const Napi::CallbackInfo& info) {
 }
 
 Value TxnWrap::abort(const Napi::CallbackInfo& info) {
-
+	DbWrap::useThreadId(db);
+	if (ew)
+		ew->freeIterators(&txn);
 	transactional_splinterdb_abort(db, &txn);
 	this->removeFromDbWrap();
 	return info.Env().Undefined();
 }
+
+void TxnWrap::reset() {
+	// ends the read snapshot, it is renewed by the next read (in DbWrap::getReadTxn)
+	DbWrap::useThreadId(db);
+	transactional_splinterdb_abort(db, &txn);
+	if (ew && ew->currentReadTxn == &txn)
+		ew->readTxnRenewed = false;
+}
+
+Value TxnWrap::renew(const Napi::CallbackInfo& info) {
+	if (!(flags & TXN_READ_ONLY))
+		return throwError(info.Env(), "Only read-only transactions can be renewed");
+	// restarts the read snapshot, so the next read doesn't have to (in DbWrap::getReadTxn)
+	DbWrap::useThreadId(db);
+	transactional_splinterdb_abort(db, &txn);
+	int rc = transactional_splinterdb_begin_read_only(db, &txn);
+	if (rc != 0)
+		return throwLmdbError(info.Env(), rc);
+	if (ew) {
+		ew->currentReadTxn = &txn;
+		ew->readTxnRenewed = true;
+	}
+	return info.Env().Undefined();
+}
+
 NAPI_FUNCTION(resetTxn) {
 	ARGS(1)
 	GET_INT64_ARG(0);
@@ -147,8 +187,11 @@ void TxnWrap::setupExports(Napi::Env env, Object exports) {
 		// TxnWrap: Add functions to the prototype
 		TxnWrap::InstanceMethod("commit", &TxnWrap::commit),
 		TxnWrap::InstanceMethod("abort", &TxnWrap::abort),
+		TxnWrap::InstanceMethod("renew", &TxnWrap::renew),
 	});
 	exports.Set("Txn", TxnClass);
+	EXPORT_NAPI_FUNCTION("resetTxn", resetTxn);
+	EXPORT_FUNCTION_ADDRESS("resetTxnPtr", resetTxnFFI);
 	//txnTpl->InstanceTemplate()->SetInternalFieldCount(1);
 }
 // This file contains code from the node-lmdb project
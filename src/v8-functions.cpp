@@ -5,7 +5,12 @@
 #include <v8.h>
 #include <node.h>
 
-#if NODE_VERSION_AT_LEAST(16,6,0)
+// Node doesn't ship the fast API header, so these are copies of it, and their type codes only match the V8 of node 16
+// to 18. Newer V8s number the types differently, so there a fast call's return value doesn't check out, and the
+// optimized code deoptimizes on every call, which makes it several times slower than N-API. Those versions only get
+// the plain direct V8 functions.
+#if ENABLE_FAST_API_CALLS && NODE_VERSION_AT_LEAST(16,6,1) && !NODE_VERSION_AT_LEAST(19,0,0)
+#define USE_FAST_API 1
 #if NODE_VERSION_AT_LEAST(17,0,0)
 #include "../dependencies/v8/v8-fast-api-calls.h"
 #else
@@ -14,104 +19,115 @@
 #endif
 
 using namespace v8;
-int32_t getByBinaryFast(Local<v8::Object> instance, double dwPointer, uint32_t keySize, uint32_t ifNotTxnId, int64_t txnAddress) {
+
+/*
+	Direct V8 versions of the hottest native functions (see the N-API versions in env.cpp, cursor.cpp, writer.cpp and
+	txn.cpp, which these have to match argument for argument). The plain V8 callbacks skip the N-API layer, and the
+	fast API ones (CFunction) are called straight from optimized code, without any handle scope or argument
+	conversion. The addresses of the wrapped objects are passed as doubles, since that is how JS has them.
+*/
+
+#if USE_FAST_API
+int32_t getByBinaryFast(Local<v8::Object> receiver, double dwPointer, uint32_t keySize, uint32_t ifNotTxnId,
+		double txnAddress) {
 	DbWrap* dw = (DbWrap*) (size_t) dwPointer;
-	return dw->doGetByBinary(keySize, ifNotTxnId, txnAddress);
+	return dw->doGetByBinary(keySize, ifNotTxnId, (int64_t) txnAddress);
 }
-
-//class NanWrap : public Nan::ObjectWrap {};
+#endif
 void getByBinaryV8(const FunctionCallbackInfo<v8::Value>& info) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = info.GetIsolate();
 	auto context = isolate->GetCurrentContext();
 	DbWrap* dw = (DbWrap*) (size_t) info[0]->NumberValue(context).FromJust();
-	info.GetReturnValue().Set(v8::Number::New(isolate, dw->doGetByBinary(
+	info.GetReturnValue().Set(dw->doGetByBinary(
 		info[1]->Uint32Value(context).FromJust(),
 		info[2]->Uint32Value(context).FromJust(),
-		info[3]->NumberValue(context).FromJust())));
+		(int64_t) info[3]->NumberValue(context).FromJust()));
 }
-int32_t positionFast(Local<v8::Object> instance, double cwPointer, uint32_t flags, uint32_t offset, uint32_t keySize, uint64_t endKeyAddress) {
-	CursorWrap* cw = (CursorWrap*) (size_t) cwPointer;
-	DbWrap* dw = cw->dw;
-	dw->getFast = true;
+
+#if USE_FAST_API
+int32_t positionFast(Local<v8::Object> receiver, double cwPointer, uint32_t flags, uint32_t offset, uint32_t keySize,
+		double endKeyAddress) {
+	IteratorWrap* cw = (IteratorWrap*) (size_t) cwPointer;
 	cw->flags = flags;
-	return cw->doPosition(offset, keySize, endKeyAddress);
+	return cw->doPosition(offset, keySize, (uint64_t) endKeyAddress);
 }
+#endif
 void positionV8(const FunctionCallbackInfo<v8::Value>& info) {
-	Isolate* isolate = Isolate::GetCurrent();
-	CursorWrap* cw = (CursorWrap*) (size_t) info[0]->NumberValue(isolate->GetCurrentContext()).FromJust();
-	cw->flags = info[1]->Uint32Value(isolate->GetCurrentContext()).FromJust();
-	uint32_t offset = info[2]->Uint32Value(isolate->GetCurrentContext()).FromJust();
-	uint32_t keySize = info[3]->Uint32Value(isolate->GetCurrentContext()).FromJust();
-	uint64_t endKeyAddress = info[4]->IntegerValue(isolate->GetCurrentContext()).FromJust();
-	info.GetReturnValue().Set(v8::Number::New(isolate, cw->doPosition(offset, keySize, endKeyAddress)));
+	Isolate* isolate = info.GetIsolate();
+	auto context = isolate->GetCurrentContext();
+	IteratorWrap* cw = (IteratorWrap*) (size_t) info[0]->NumberValue(context).FromJust();
+	cw->flags = info[1]->Uint32Value(context).FromJust();
+	uint32_t offset = info[2]->Uint32Value(context).FromJust();
+	uint32_t keySize = info[3]->Uint32Value(context).FromJust();
+	uint64_t endKeyAddress = info[4]->IntegerValue(context).FromJust();
+	info.GetReturnValue().Set(cw->doPosition(offset, keySize, endKeyAddress));
 }
 
-int32_t iterateFast(Local<v8::Object> instance, double cwPointer) {
-	CursorWrap* cw = (CursorWrap*) (size_t) cwPointer;
-	DbWrap* dw = cw->dw;
-	dw->getFast = true;
-	slice key, data;
-	int rc = mdb_cursor_get(cw->cursor, &key, &data, cw->iteratingOp);
-	return cw->returnEntry(rc, key, data);
+#if USE_FAST_API
+int32_t iterateFast(Local<v8::Object> receiver, double cwPointer) {
+	IteratorWrap* cw = (IteratorWrap*) (size_t) cwPointer;
+	return cw->doIterate();
 }
+#endif
 void iterateV8(const FunctionCallbackInfo<v8::Value>& info) {
-	Isolate* isolate = Isolate::GetCurrent();
-	CursorWrap* cw = (CursorWrap*) (size_t) info[0]->NumberValue(isolate->GetCurrentContext()).FromJust();
-	DbWrap* dw = cw->dw;
-	dw->getFast = true;
-	slice key, data;
-	int rc = mdb_cursor_get(cw->cursor, &key, &data, cw->iteratingOp);
-	info.GetReturnValue().Set(v8::Number::New(isolate, cw->returnEntry(rc, key, data)));
+	Isolate* isolate = info.GetIsolate();
+	IteratorWrap* cw = (IteratorWrap*) (size_t) info[0]->NumberValue(isolate->GetCurrentContext()).FromJust();
+	info.GetReturnValue().Set(cw->doIterate());
 }
 
-int32_t writeFast(Local<v8::Object> instance, double ewPointer, uint64_t instructionAddress) {
-	DbWrap* ew = (DbWrap*) (size_t) ewPointer;
-	int rc;
+static void writeInstructions(DbWrap* ew, uint32_t* instructionAddress) {
 	if (instructionAddress)
-		rc = WriteWorker::DoWrites(ew->writeTxn->txn, ew, (uint32_t*)instructionAddress, nullptr);
-	else {
+		WriteWorker::DoWrites(&ew->txn, ew, instructionAddress, nullptr);
+	else if (ew->writeWorker)
 		pthread_cond_signal(ew->writingCond);
-		rc = 0;
+}
+#if USE_FAST_API
+void writeFast(Local<v8::Object> receiver, double ewPointer, double instructionAddress,
+		FastApiCallbackOptions& options) {
+	DbWrap* ew = (DbWrap*) (size_t) ewPointer;
+	if (!ew->db) {
+		// let the regular callback throw the error
+		options.fallback = true;
+		return;
 	}
-	return rc;
-//	if (rc && !(rc == MDB_KEYEXIST || rc == MDB_NOTFOUND))
-	//	options.fallback = true;
+	writeInstructions(ew, (uint32_t*) (size_t) instructionAddress);
 }
+#endif
 void writeV8(const v8::FunctionCallbackInfo<v8::Value>& info) {
-	Isolate* isolate = Isolate::GetCurrent();
-	DbWrap* ew = (DbWrap*) (size_t) info[0]->NumberValue(isolate->GetCurrentContext()).FromJust();
-	uint64_t instructionAddress = info[1]->IntegerValue(isolate->GetCurrentContext()).FromJust();
-	int rc;
-	if (instructionAddress)
-		rc = WriteWorker::DoWrites(ew->writeTxn->txn, ew, (uint32_t*)instructionAddress, nullptr);
-	else {
-		pthread_cond_signal(ew->writingCond);
-		rc = 0;
+	Isolate* isolate = info.GetIsolate();
+	auto context = isolate->GetCurrentContext();
+	DbWrap* ew = (DbWrap*) (size_t) info[0]->NumberValue(context).FromJust();
+	if (!ew->db) {
+		isolate->ThrowException(v8::Exception::Error(
+			v8::String::NewFromUtf8(isolate, "The environment is already closed.").ToLocalChecked()));
+		return;
 	}
-	info.GetReturnValue().Set(v8::Number::New(isolate, rc));
+	writeInstructions(ew, (uint32_t*) (size_t) info[1]->NumberValue(context).FromJust());
 }
 
-void resetTxnFast(Local<v8::Object> instance, double twPointer) {
+#if USE_FAST_API
+void resetTxnFast(Local<v8::Object> receiver, double twPointer) {
 	TxnWrap* tw = (TxnWrap*) (size_t) twPointer;
 	tw->reset();
 }
-
+#endif
 void resetTxnV8(const FunctionCallbackInfo<v8::Value>& info) {
-	Isolate* isolate = Isolate::GetCurrent();
+	Isolate* isolate = info.GetIsolate();
 	TxnWrap* tw = (TxnWrap*) (size_t) info[0]->NumberValue(isolate->GetCurrentContext()).FromJust();
 	tw->reset();
 }
 
-void noopFast(Local<v8::Object> instance) {
+// for measuring the cost of the call itself, see benchmark/fast-api.js
+#if USE_FAST_API
+void noopFast(Local<v8::Object> receiver) {
 }
-
+#endif
 void noopV8(const FunctionCallbackInfo<v8::Value>& info) {
 }
 
-
 void clearKeptObjects(const FunctionCallbackInfo<v8::Value>& info) {
 	#if NODE_VERSION_AT_LEAST(14,0,0)
-	v8::Isolate::GetCurrent()->ClearKeptObjects();
+	info.GetIsolate()->ClearKeptObjects();
 	#endif
 }
 void detachBuffer(const FunctionCallbackInfo<v8::Value>& info) {
@@ -121,32 +137,36 @@ void detachBuffer(const FunctionCallbackInfo<v8::Value>& info) {
 	#endif
 }
 
-#endif
-
-
 #define EXPORT_FAST(exportName, slowName, fastName) {\
 	auto fast = CFunction::Make(fastName);\
 	exports->Set(isolate->GetCurrentContext(), v8::String::NewFromUtf8(isolate, exportName, NewStringType::kInternalized).ToLocalChecked(), FunctionTemplate::New(\
 			isolate, slowName, Local<v8::Value>(),\
 			Local<Signature>(), 0, ConstructorBehavior::kThrow,\
-			SideEffectType::kHasNoSideEffect, &fast)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked());\
+			SideEffectType::kHasSideEffect, &fast)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked());\
 }
 #define EXPORT_FUNCTION(exportName, funcName) \
 	exports->Set(isolate->GetCurrentContext(), v8::String::NewFromUtf8(isolate, exportName, NewStringType::kInternalized).ToLocalChecked(), FunctionTemplate::New(\
 			isolate, funcName, Local<v8::Value>(),\
 			Local<Signature>(), 0, ConstructorBehavior::kThrow,\
-			SideEffectType::kHasNoSideEffect)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked());
+			SideEffectType::kHasSideEffect)->GetFunction(isolate->GetCurrentContext()).ToLocalChecked());
+
+#endif
 
-napi_value enableDirectV8(napi_env env, napi_callback_info info);
-	ARGS(1)
+/*
+	Puts the direct V8 versions of the functions on the given object (the first argument), with fast API calls if the
+	second argument is true and this build has them, and returns whether it has them. This depends on the V8 ABI, so it
+	is only called when running on the node version the addon was compiled for (see node-index.js).
+*/
+NAPI_FUNCTION(enableDirectV8) {
+	ARGS(2)
+	bool useFastApi = false;
 	#if ENABLE_V8_API
 	Isolate* isolate = Isolate::GetCurrent();
 	napi_value exportsValue = args[0];
 	Local<v8::Object> exports;
 	memcpy((void*) &exports, (void*) &exportsValue, sizeof(exportsValue));
-	#if NODE_VERSION_AT_LEAST(16,6,1)
-	bool useFastApi;
-	napi_get_value_bool(info.Env(), info[1], &useFastApi);
+	#if USE_FAST_API
+	napi_get_value_bool(env, args[1], &useFastApi);
 	if (useFastApi) {
 		EXPORT_FAST("getByBinary", getByBinaryV8, getByBinaryFast);
 		EXPORT_FAST("position", positionV8, positionFast);
@@ -160,12 +180,14 @@ napi_value enableDirectV8(napi_env env, napi_callback_info info);
 	EXPORT_FUNCTION("position", positionV8);
 	EXPORT_FUNCTION("iterate", iterateV8);
 	EXPORT_FUNCTION("write", writeV8);
+	EXPORT_FUNCTION("resetTxn", resetTxnV8);
 	EXPORT_FUNCTION("noop", noopV8);
-	#if NODE_VERSION_AT_LEAST(16,6,1)
+	#if USE_FAST_API
 	}
 	#endif
 	EXPORT_FUNCTION("clearKeptObjects", clearKeptObjects);
 	EXPORT_FUNCTION("detachBuffer", detachBuffer);
 	#endif
-	RETURN_UNDEFINED
+	napi_get_boolean(env, useFastApi, &returnValue);
+	return returnValue;
 }
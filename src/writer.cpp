@@ -13,6 +13,7 @@ inline value?
 */
 #include "splinterdb-js.h"
 #include <atomic>
+#include <algorithm>
 #include <ctime>
 #ifndef _WIN32
 #include <unistd.h>
@@ -51,6 +52,7 @@ const int IF_NO_EXISTS = 0x10;
 const int FAILED_CONDITION = 0x4000000;
 const int FINISHED_OPERATION = 0x1000000;
 const double ANY_VERSION = 3.542694326329068e-103; // special marker for any version
+const int MAX_BATCH_RETRIES = 10;
 
 
 WriteWorker::~WriteWorker() {
@@ -66,6 +68,8 @@ WriteWorker::WriteWorker(transactional_splinterdb* db, DbWrap* envForTxn, uint32
 	//fprintf(stdout, "nextCompressibleArg %p\n", nextCompressibleArg);
 		interruptionStatus = 0;
 		txn = nullptr;
+		batchEnd = nullptr;
+		canRetry = false;
 	}
 
 AsyncWriteWorker::AsyncWriteWorker(transactional_splinterdb* db, DbWrap* envForTxn, uint32_t* instructions, const Function& callback)
@@ -77,7 +81,11 @@ AsyncWriteWorker::AsyncWriteWorker(transactional_splinterdb* db, DbWrap* envForT
 
 void AsyncWriteWorker::Execute(const AsyncProgressWorker::ExecutionProgress& execution) {
 	executionProgress = (AsyncProgressWorker::ExecutionProgress*) &execution;
+	// this runs on a libuv pool thread, which the engine needs to have registered (for its per-thread state) while it
+	// writes. The thread can write to other dbs next (and thread ids are per db), so it is only registered for the batch.
+	transactional_splinterdb_register_thread(db);
 	Write();
+	transactional_splinterdb_deregister_thread(db);
 }
 void WriteWorker::SendUpdate() {
 	fprintf(stderr, "This SendUpdate does not work!\n");
@@ -90,6 +98,8 @@ transaction* WriteWorker::AcquireTxn(int* flags) {
 	
 	// TODO: if the conditionDepth is 0, we could allow the current worker's txn to be continued, committed and restarted
 	pthread_mutex_lock(envForTxn->writingLock);
+	// either way, JS writes in (or commits) the batch's txn, which can't be replayed
+	canRetry = false;
 	retry:
 	if (commitSynchronously && interruptionStatus == WORKER_WAITING) {
 		//fprintf(stderr, "acquire interupting lock %p %u\n", this, commitSynchronously);
@@ -174,6 +184,27 @@ int WriteWorker::WaitForCallbacks(transaction* txn, bool allowCommit, uint32_t*
 		interruptionStatus = 0;
 	return 0;
 }
+// Looks up an entry in the batch's txn for a conditional write, getting its version from the header of its value
+// (0 if the db doesn't have versions). Since the txn reads it (found or not), the txn fails to commit if it is written
+// in between, and Write runs the batch again.
+static int getEntryVersion(transactional_splinterdb* db, DbWrap* envForTxn, transaction* txn, slice key,
+		bool* found, double* version) {
+	char buffer[64]; // only the version is needed, so larger values can allocate
+	splinterdb_lookup_result result;
+	transactional_splinterdb_lookup_result_init(db, &result, sizeof(buffer), buffer);
+	int rc = transactional_splinterdb_lookup(db, txn, key, &result);
+	*found = rc == 0 && splinterdb_lookup_found(&result);
+	*version = 0;
+	if (*found && envForTxn->hasVersions) {
+		slice data;
+		splinterdb_lookup_result_value(&result, &data);
+		if (data.length >= 8)
+			memcpy(version, data.data, 8);
+	}
+	splinterdb_lookup_result_deinit(&result);
+	return rc;
+}
+
 int WriteWorker::DoWrites(transaction* txn, DbWrap* envForTxn, uint32_t* instruction, WriteWorker* worker) {
 	slice key;
 	slice value;
@@ -186,6 +217,11 @@ int WriteWorker::DoWrites(transaction* txn, DbWrap* envForTxn, uint32_t* instruc
 	transactional_splinterdb* db = envForTxn->db;
 	do {
 next_inst:	start = instruction++;
+		if (worker && start == worker->batchEnd) {
+			// running a batch again, which ends where it did the first time
+			worker->instructions = start;
+			return 0;
+		}
 		uint32_t flags = *start;
 		int dbi = 0;
 		bool validated = conditionDepth == validatedDepth;
@@ -214,6 +250,8 @@ next_inst:	start = instruction++;
 						worker->interruptionStatus = 0;
 					} else if (status > 2) {
 						//fprintf(stderr, "doing the compression ourselves\n");
+						if (envForTxn->compressionPool)
+							envForTxn->compressionPool->remove((double*) (instruction + 2));
 						((Compression*) (size_t) *((double*)&status))->compressInstruction(nullptr, (double*) (instruction + 2));
 					} // else status is 0 and compression is done
 					// compressed
@@ -231,25 +269,29 @@ next_inst:	start = instruction++;
 			if (flags & CONDITIONAL_VERSION) {
 				conditionalVersion = *((double*) instruction);
 				instruction += 2;
-				slice conditionalValue;
-				rc = 0;//transactional_splinterdb_lookup(txn, dbi, &key, &conditionalValue);
-				if (rc) {
-				    // not found counts as version 0, so this is acceptable for conditional less than,
-				    // otherwise does not validate
-                    validated = rc == 0;//MDB_NOTFOUND && (flags & CONDITIONAL_ALLOW_NOTFOUND);
-				} else if (conditionalVersion != ANY_VERSION) {
-					double version;
-					memcpy(&version, conditionalValue.data, 8);
-					validated = validated && ((flags & CONDITIONAL_VERSION_LESS_THAN) ? version <= conditionalVersion : (version == conditionalVersion));
-				}
 			}
 			if (flags & SET_VERSION) {
 				setVersion = *((double*) instruction);
 				instruction += 2;
 			}
-			if ((flags & IF_NO_EXISTS) && (flags & START_CONDITION_BLOCK)) {
-				rc = 0;// mdb_get(txn, dbi, &key, &value);
-				validated = validated && rc == 0;//MDB_NOTFOUND;
+			if (flags & (CONDITIONAL_VERSION | IF_NO_EXISTS)) {
+				// one lookup serves both conditions
+				bool found;
+				double version;
+				rc = getEntryVersion(db, envForTxn, txn, key, &found, &version);
+				if (rc)
+					validated = false;
+				else if (flags & IF_NO_EXISTS) // an ifNoExists block, or a put with noOverwrite
+					validated = validated && !found;
+				if (rc == 0 && (flags & CONDITIONAL_VERSION)) {
+					if (!found) {
+						// not found counts as version 0, so this is acceptable for conditional less than,
+						// otherwise does not validate (JS uses the same flag for both)
+						validated = validated && (flags & (CONDITIONAL_VERSION_LESS_THAN | CONDITIONAL_ALLOW_NOTFOUND));
+					} else if (conditionalVersion != ANY_VERSION) {
+						validated = validated && ((flags & CONDITIONAL_VERSION_LESS_THAN) ? version <= conditionalVersion : (version == conditionalVersion));
+					}
+				}
 			}
 		} else
 			instruction++;
@@ -289,8 +331,12 @@ next_inst:	start = instruction++;
 					rc = putWithVersion(db, txn, key, value, flags, setVersion);
 				else
 					rc = transactional_splinterdb_insert(db, txn, key, value);
-				if (flags & COMPRESSIBLE)
-					free((void*) value.data);
+				if (flags & COMPRESSIBLE) {
+					if (worker)
+						worker->pendingFrees.push_back((void*) value.data);
+					else
+						free((void*) value.data);
+				}
 				//fprintf(stdout, "put %u \n", key.length);
 				break;
 			case DEL:
@@ -298,8 +344,12 @@ next_inst:	start = instruction++;
 				break;
 			case DEL_VALUE:
 				rc = transactional_splinterdb_delete(db, txn, key);
-				if (flags & COMPRESSIBLE)
-					free((void*) value.data);
+				if (flags & COMPRESSIBLE) {
+					if (worker)
+						worker->pendingFrees.push_back((void*) value.data);
+					else
+						free((void*) value.data);
+				}
 				break;
 			case START_BLOCK: case START_CONDITION_BLOCK:
 				rc = 0;//validated ? 0 : MDB_NOTFOUND;
@@ -308,6 +358,9 @@ next_inst:	start = instruction++;
 				conditionDepth++;
 				break;
 			case USER_CALLBACK:
+				// JS finds the callbacks by walking the finished instructions
+				worker->FinishBatch();
+				worker->canRetry = false;
 				worker->finishedProgress = false;
 				worker->progressStatus = 2;
 				rc = 0;
@@ -345,7 +398,9 @@ next_inst:	start = instruction++;
 		} else
 			flags = FINISHED_OPERATION | FAILED_CONDITION;
 		//fprintf(stderr, "finished flag %p\n", flags);
-		if (overlappedWord) {
+		if (worker)
+			worker->pendingResults.push_back(std::make_pair(start, flags));
+		else if (overlappedWord) {
 			std::atomic_fetch_or((std::atomic<uint32_t>*) start, flags);
 			overlappedWord = false;
 		} else
@@ -354,16 +409,30 @@ next_inst:	start = instruction++;
 	return rc;
 }
 
+// Hands the results of the instructions run so far over to JS, and frees their compressed values
+void WriteWorker::FinishBatch() {
+	for (auto& result : pendingResults)
+		std::atomic_fetch_or((std::atomic<uint32_t>*) result.first, result.second);
+	pendingResults.clear();
+	// a batch that ran again wrote the same values again
+	std::sort(pendingFrees.begin(), pendingFrees.end());
+	pendingFrees.erase(std::unique(pendingFrees.begin(), pendingFrees.end()), pendingFrees.end());
+	for (void* value : pendingFrees)
+		free(value);
+	pendingFrees.clear();
+}
+
 const int READER_CHECK_INTERVAL = 600; // ten minutes
 void WriteWorker::Write() {
 	int rc;
 	finishedProgress = true;
 	unsigned int envFlags;
 	pthread_mutex_lock(envForTxn->writingLock);
-	#ifndef _WIN32
+	uint32_t* batchStart = instructions;
+	batchEnd = nullptr;
 	int retries = 0;
 	retry:
-	#endif
+	canRetry = true;
 	txn = new transaction;
 	rc = transactional_splinterdb_begin(db, txn);
 	if (rc != 0) {
@@ -374,9 +443,22 @@ void WriteWorker::Write() {
 	uint32_t txnId = 0;// (uint32_t) transaction_id(txn);
 	if (rc || hasError)
 		transactional_splinterdb_abort(db, txn);
-	else
+	else {
 		rc = transactional_splinterdb_commit(db, txn);
+		if (rc && canRetry && retries++ < MAX_BATCH_RETRIES) {
+			// a txn wrote to what the batch read (for its conditions) before it could commit, so it runs again, with
+			// the conditions checked again. Nothing of it has been handed to JS yet.
+			delete txn;
+			pendingResults.clear();
+			batchEnd = instructions;
+			instructions = batchStart;
+			goto retry;
+		}
+	}
+	delete txn;
 	txn = nullptr;
+	batchEnd = nullptr;
+	FinishBatch();
 	pthread_mutex_unlock(envForTxn->writingLock);
 	if (rc || hasError) {
 		std::atomic_fetch_or((std::atomic<uint32_t>*) instructions, (uint32_t) TXN_HAD_ERROR);
@@ -403,6 +485,8 @@ void AsyncWriteWorker::OnProgress(const char* data, size_t count) {
 	napi_value result, arg; // we use direct napi call here because node-addon-api interface with throw a fatal error if a worker thread is terminating, and bun doesn't support escapable scopes yet
 	napi_create_int32(Env(), progressStatus, &arg);
 	napi_call_function(Env(), Env().Undefined(), Callback().Value(), 1, &arg, &result);
+	// the worker goes on to commit the txn, the cursors can't keep reading in it
+	envForTxn->freeIterators(txn);
 	delete envForTxn->writeTxn;
 	envForTxn->writeTxn = nullptr;
 	pthread_cond_signal(envForTxn->writingCond);
@@ -439,9 +523,10 @@ NAPI_FUNCTION(DbWrap::write) {
 	napi_get_value_int64(env, args[1], &i64);
 	uint32_t* instructionAddress = (uint32_t*) i64;
 	int rc = 0;
-	if (instructionAddress)
+	if (instructionAddress) {
+		ew->useThreadId();
 		rc = WriteWorker::DoWrites(&ew->txn, ew, instructionAddress, nullptr);
-	else if (ew->writeWorker) {
+	} else if (ew->writeWorker) {
 		pthread_cond_signal(ew->writingCond);
 	}
 	/*if (rc && !(rc == MDB_KEYEXIST || rc == MDB_NOTFOUND)) {
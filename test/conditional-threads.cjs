@@ -0,0 +1,77 @@
+var assert = require('assert');
+const { Worker, isMainThread, parentPort, threadId } = require('worker_threads');
+var path = require('path');
+var fs = require('fs');
+
+const { open } = require('../dist/index.cjs');
+// Several threads race to write the same (missing) keys with ifNoExists, so their batches keep failing to commit
+// because of each other, and have to run again. Each key has to end up written by exactly one of them, with every
+// thread agreeing on which one.
+const testPath = path.resolve(__dirname, './testdata-conditional');
+const KEY_COUNT = 500;
+const WORKER_COUNT = 4;
+
+function openStore() {
+  return open({
+    path: testPath,
+    name: 'race',
+  });
+}
+
+async function writeKeys(db) {
+  let won = [];
+  let results = [];
+  for (let i = 0; i < KEY_COUNT; i++) {
+    let key = 'key' + i;
+    results.push(db.ifNoExists(key, () => {
+      db.put(key, threadId);
+    }).then((written) => {
+      if (written)
+        won.push(key);
+    }));
+  }
+  await Promise.all(results);
+  return won;
+}
+
+if (isMainThread) {
+  if (fs.existsSync(testPath))
+    fs.unlinkSync(testPath);
+  let db = openStore();
+  let winners = new Map();
+  var workers = [];
+  for (var i = 0; i < WORKER_COUNT; i++) {
+    workers.push(new Worker(__filename));
+  }
+  var finished = 0;
+  workers.forEach(function(worker) {
+    worker.on('error', function(error) {
+      console.error(error);
+      process.exit(1);
+    });
+    worker.on('message', function(msg) {
+      for (let key of msg.won) {
+        assert(!winners.has(key), key + ' was written by two threads');
+        winners.set(key, msg.threadId);
+      }
+      worker.terminate();
+      if (++finished === WORKER_COUNT) {
+        assert.equal(winners.size, KEY_COUNT);
+        for (let [key, winner] of winners) {
+          assert.equal(db.get(key), winner);
+        }
+        db.close();
+        console.log('done', winners.size);
+      }
+    });
+  });
+} else {
+  // The worker thread
+  let db = openStore();
+  writeKeys(db).then((won) => {
+    parentPort.postMessage({ won, threadId });
+  }, (error) => {
+    console.error(error);
+    process.exit(1);
+  });
+}
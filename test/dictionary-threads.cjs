@@ -0,0 +1,105 @@
+var assert = require('assert');
+const { Worker, isMainThread, parentPort } = require('worker_threads');
+var path = require('path');
+var fs = require('fs');
+
+const { open } = require('../dist/index.cjs');
+// Two threads train compression dictionaries for the same database. Each has to read the values compressed with the
+// one the other thread trained (after it opened the database), the two have to be saved under different ids, and
+// everything has to be readable after a reopen.
+const testPath = path.resolve(__dirname, './testdata-dictionaries');
+const VALUE_COUNT = 1000;
+
+function openStore() {
+  return open({
+    path: testPath,
+    name: 'values',
+    compression: { dictionaryKey: 'dictionaries', threshold: 100 },
+  });
+}
+
+function makeValue(prefix, i) {
+  return '{"' + prefix + 'Identifier":' + i + ',"' + prefix + 'Description":"an entry that is long enough to be ' +
+    'compressed, made of the same words as all the others of ' + prefix + '","' + prefix + 'Sequence":' + (i * 7919) +
+    ',"' + prefix + 'Category":"category-' + (i % 13) + '","' + prefix + 'Status":"' + (i % 2 ? 'active' : 'inactive') +
+    '"}';
+}
+
+async function writeValues(db, prefix) {
+  for (let i = 0; i < VALUE_COUNT; i++)
+    db.put(prefix + i, makeValue(prefix, i));
+  await db.committed;
+}
+
+function checkValues(db, prefix) {
+  for (let i = 0; i < VALUE_COUNT; i++)
+    assert.equal(db.get(prefix + i), makeValue(prefix, i));
+}
+
+// the ids of the saved dictionaries
+function savedIds(db) {
+  let saved = db.openDB({ name: 'compression-dictionaries', compression: false, encoding: 'binary' })
+    .getBinary('dictionaries');
+  let ids = [];
+  for (let position = 0; saved && position < saved.length;) {
+    ids.push(saved[position]);
+    position += 5 + saved.readUInt32LE(position + 1);
+  }
+  return ids;
+}
+
+// samples values, trains a dictionary from them, and writes more values, which are compressed with it
+async function trainDictionary(db, prefix) {
+  await writeValues(db, prefix + 'sample');
+  let count = savedIds(db).length;
+  db.compression.retrain();
+  while (savedIds(db).length == count)
+    await new Promise((resolve) => setTimeout(resolve, 10));
+  await writeValues(db, prefix);
+}
+
+if (isMainThread) {
+  if (fs.existsSync(testPath))
+    fs.unlinkSync(testPath);
+  let db = openStore();
+  let worker = new Worker(__filename);
+  worker.on('error', function(error) {
+    console.error(error);
+    process.exit(1);
+  });
+  worker.on('message', async function(msg) {
+    try {
+      if (msg == 'opened') {
+        await trainDictionary(db, 'main');
+        worker.postMessage('trained');
+      } else if (msg == 'done') {
+        worker.terminate();
+        checkValues(db, 'worker');
+        assert.deepEqual(savedIds(db), [1, 2]);
+        db.close();
+        db = openStore();
+        checkValues(db, 'main');
+        checkValues(db, 'worker');
+        db.close();
+        console.log('done');
+      }
+    } catch (error) {
+      console.error(error);
+      process.exit(1);
+    }
+  });
+} else {
+  // The worker thread, which opens the database before the main thread trains its dictionary
+  let db = openStore();
+  parentPort.on('message', async function(msg) {
+    try {
+      checkValues(db, 'main');
+      await trainDictionary(db, 'worker');
+      parentPort.postMessage('done');
+    } catch (error) {
+      console.error(error);
+      process.exit(1);
+    }
+  });
+  parentPort.postMessage('opened');
+}
@@ -285,6 +285,40 @@ describe('lmdb-js', function() {
 			result = await db2.remove('key-no-exists', IF_EXISTS);
 			should.equal(result, false);
 		});
+		it('useVersions of a database has to match its environment', async function() {
+			(() => db.openDB({ name: 'with-versions', useVersions: true })).should.throw(/useVersions/);
+			let inherited = db.openDB({ name: 'inherits-versions' });
+			should.equal(!!inherited.useVersions, !!db.useVersions);
+			await inherited.put('versions-key', 'value', 3);
+			inherited.get('versions-key').should.equal('value');
+			db.get('versions-key').should.equal('value');
+
+			let versionedDb = open({ name: 'versioned', useVersions: true });
+			(() => versionedDb.openDB({ name: 'without-versions', useVersions: false })).should.throw(/useVersions/);
+			let versionedInherited = versionedDb.openDB({ name: 'inherits-versions' });
+			await versionedInherited.put('versions-key', 'value', 3);
+			let entry = versionedDb.getEntry('versions-key');
+			entry.value.should.equal('value');
+			entry.version.should.equal(3);
+			versionedInherited.get('versions-key').should.equal('value');
+			await versionedDb.close();
+		});
+		it('writes batches from pool threads to more than one database', async function() {
+			// batches are written on libuv pool threads, which are only registered with a database while they write one,
+			// so they can go on to write to another one, and more batches than there are thread ids can be written
+			let firstDb = open({ name: 'pool-writes-1' });
+			let secondDb = open({ name: 'pool-writes-2' });
+			for (let i = 0; i < 1100; i++) {
+				await firstDb.put('key' + i, i);
+				await secondDb.put('key' + i, -i);
+			}
+			for (let i = 0; i < 1100; i++) {
+				firstDb.get('key' + i).should.equal(i);
+				secondDb.get('key' + i).should.equal(-i);
+			}
+			await firstDb.close();
+			await secondDb.close();
+		});
 		it('repeated ifNoExists', async function() {
 			let keyBase = 'c333f4e0-f692-4bca-ad45-f805923f974f-c333f4e0-f692-4bca-ad45-f805923f974f-c333f4e0-f692-4bca-ad45-f805923f974f'
 			let result;
@@ -340,6 +374,50 @@ describe('lmdb-js', function() {
 			dataOut.should.deep.equal(dataIn);
 			db.removeSync('not-there').should.equal(false);
 		});
+		it('get asynchronously', async function() {
+			let dataIn = {foo: 5, bar: true}
+			await db.put('async-key', dataIn);
+			let gets = [];
+			for (let i = 0; i < 100; i++)
+				gets.push(db.getAsync(i % 2 ? 'async-key' : 'async-missing-' + i));
+			let results = await Promise.all(gets);
+			for (let i = 0; i < 100; i++) {
+				if (i % 2)
+					results[i].should.deep.equal(dataIn);
+				else
+					should.equal(results[i], undefined);
+			}
+		});
+		it('get asynchronously from more than one database', async function() {
+			// each database's reads are queued separately, and looked up by its own reader threads
+			let firstDb = open({ name: 'async-reads-1' });
+			let secondDb = open({ name: 'async-reads-2' });
+			for (let i = 0; i < 20; i++) {
+				firstDb.put('key' + i, i);
+				await secondDb.put('key' + i, -i);
+			}
+			await firstDb.committed;
+			let gets = [];
+			for (let i = 0; i < 20; i++) {
+				gets.push(firstDb.getAsync('key' + i));
+				gets.push(secondDb.getAsync('key' + i));
+			}
+			let results = await Promise.all(gets);
+			for (let i = 0; i < 20; i++) {
+				results[i * 2].should.equal(i);
+				results[i * 2 + 1].should.equal(-i);
+			}
+			await firstDb.close();
+			await secondDb.close();
+		});
+		it('renews the read txn between turns', async function() {
+			db.putSync('renew-key', 1);
+			db.get('renew-key').should.equal(1);
+			await new Promise(resolve => setTimeout(resolve, 1));
+			// the kept read txn was reset, the next read renews it and sees later writes
+			db.putSync('renew-key', 2);
+			db.get('renew-key').should.equal(2);
+		});
 		it('store binary', async function() {
 			let dataIn = {foo: 4, bar: true}
 			let buffer = db.encoder.encode(dataIn);
@@ -476,6 +554,46 @@ describe('lmdb-js', function() {
 			}
 			count.should.equal(1)
 		});
+		it('should iterate over a range larger than a batch', async function() {
+			let lastPromise
+			for (let i = 0; i < 10000; i++)
+				lastPromise = db.put(['batch', i], { index: i, padding: 'some data to fill up the batches' })
+			await lastPromise
+			let count = 0
+			for (let { key, value } of db.getRange({ start: ['batch'], end: ['batch', 20000] })) {
+				key[1].should.equal(count)
+				value.index.should.equal(count)
+				// reads in the loop don't disturb the batch being iterated
+				db.get(['batch', 0]).index.should.equal(0)
+				count++
+			}
+			count.should.equal(10000)
+			Array.from(db.getKeys({ start: ['batch', 100], end: ['batch', 20000], limit: 3 })).should.deep.equal(
+				[ ['batch', 100], ['batch', 101], ['batch', 102] ])
+			db.getCount({ start: ['batch'], end: ['batch', 20000] }).should.equal(10000)
+			// estimated without reading the range, overwritten versions that haven't been compacted are included
+			db.getCount({ start: ['batch'], end: ['batch', 20000], approximate: true }).should.be.at.least(10000)
+			db.getCount({ start: ['batch', 100], end: ['batch', 100], inclusiveEnd: true, approximate: true }).should.equal(1)
+			db.getApproximateSize({ start: ['batch'], end: ['batch', 20000] }).should.be.above(10000 * 40)
+		});
+		it('should reverse iterate over a range larger than a batch', async function() {
+			let lastPromise
+			for (let i = 0; i < 10000; i++)
+				lastPromise = db.put(['reverse-batch', i], { index: i, padding: 'some data to fill up the batches' })
+			await lastPromise
+			let count = 0
+			for (let { key, value } of db.getRange({ start: ['reverse-batch', 20000], end: ['reverse-batch'], reverse: true })) {
+				key[1].should.equal(9999 - count)
+				value.index.should.equal(9999 - count)
+				count++
+			}
+			count.should.equal(10000)
+			Array.from(db.getKeys({ start: ['reverse-batch', 100], end: ['reverse-batch', 98], reverse: true })).should.deep.equal(
+				[ ['reverse-batch', 100], ['reverse-batch', 99] ])
+			Array.from(db.getKeys({ start: ['reverse-batch', 100], end: ['reverse-batch'], reverse: true, offset: 1, limit: 2 })).should.deep.equal(
+				[ ['reverse-batch', 99], ['reverse-batch', 98] ])
+			db.getCount({ start: ['reverse-batch', 20000], end: ['reverse-batch'], reverse: true }).should.equal(10000)
+		});
     it('should iterate over query with inclusiveEnd/exclusiveStart', async function() {
       let data1 = {foo: 1, bar: true}
       let data2 = {foo: 2, bar: false}
@@ -716,6 +834,38 @@ describe('lmdb-js', function() {
 			values = await db.getMany([]);
 			should.equal(values.length, 0);
 		});
+		it('getMany with many keys', async function() {
+			let keys = [];
+			for (let i = 0; i < 2000; i++) {
+				keys.push('many-' + ((i * 7919) % 2000)); // out of key order
+				if (i % 3)
+					db.put('many-' + i, 'value-' + i);
+			}
+			await db.put('many-missing-done', true);
+			keys.push('many-missing');
+			keys.push(keys[0]); // duplicate
+			let values = await db.getMany(keys);
+			should.equal(values.length, 2002);
+			for (let i = 0; i < 2000; i++) {
+				let n = (i * 7919) % 2000;
+				should.equal(values[i], n % 3 ? 'value-' + n : undefined);
+			}
+			should.equal(values[2000], undefined);
+			should.equal(values[2001], values[0]);
+		});
+		it('getMany in a transaction', async function() {
+			await db.put('many-txn-1', 'before');
+			let values;
+			db.transactionSync(() => {
+				db.put('many-txn-1', 'in txn');
+				db.put('many-txn-2', 'new in txn');
+				values = db.getMany(['many-txn-1', 'many-txn-2', 'many-txn-missing']);
+			});
+			values = await values;
+			should.equal(values[0], 'in txn');
+			should.equal(values[1], 'new in txn');
+			should.equal(values[2], undefined);
+		});
 
 		it('invalid key', async function() {
 			expect(() => db.get(Buffer.from([]))).to.throw();
@@ -1244,6 +1394,38 @@ describe('lmdb-js', function() {
 			});
 		});
 	});
+	describe('Conditional writes in threads', function() {
+		this.timeout(1000000);
+		it('will race ifNoExists writes of the same keys between threads', function(done) {
+			var child = spawn('node', [fileURLToPath(new URL('./conditional-threads.cjs', import.meta.url))]);
+			child.stdout.on('data', function(data) {
+				console.log(data.toString());
+			});
+			child.stderr.on('data', function(data) {
+				console.error(data.toString());
+			});
+			child.on('close', function(code) {
+				code.should.equal(0);
+				done();
+			});
+		});
+	});
+	describe('Compression dictionaries in threads', function() {
+		this.timeout(1000000);
+		it('will read values compressed with dictionaries trained by other threads', function(done) {
+			var child = spawn('node', [fileURLToPath(new URL('./dictionary-threads.cjs', import.meta.url))]);
+			child.stdout.on('data', function(data) {
+				console.log(data.toString());
+			});
+			child.stderr.on('data', function(data) {
+				console.error(data.toString());
+			});
+			child.on('close', function(code) {
+				code.should.equal(0);
+				done();
+			});
+		});
+	});
 	describe('Read-only Threads', function() {
 	this.timeout(1000000);
 	it('will run a group of threads with read-only transactions', function(done) {
@@ -29,6 +29,8 @@ const ByteArray = typeof Buffer != 'undefined' ? function(buffer) { return Buffe
 const queueTask = typeof setImmediate != 'undefined' ? setImmediate : setTimeout; // TODO: Or queueMicrotask?
 //let debugLog = []
 const WRITE_BUFFER_SIZE = 0x10000;
+// how many compressed values to write between training new compression dictionaries (when there is a dictionaryKey)
+const DICTIONARY_TRAINING_INTERVAL = 50000;
 var log = [];
 export function addWriteMethods(LMDBStore, { env, fixedBuffer, resetReadTxn, useWritemap, maxKeySize,
 	eventTurnBatching, txnStartThreshold, batchStartThreshold, overlappingSync, commitDelay, separateFlushed, maxFlushDelay }) {
@@ -192,13 +194,13 @@ export function addWriteMethods(LMDBStore, { env, fixedBuffer, resetReadTxn, use
 				if (store.compression && (valueSize >= store.compression.threshold || mustCompress)) {
 					flags |= 0x100000;
 					float64[position] = store.compression.address;
+					if (store.compression.retrain &&
+							++store.compression.writesSinceTraining >= DICTIONARY_TRAINING_INTERVAL)
+						store.compression.retrain();
 					if (!writeTxn)
-						compress(env.address, uint32.address + (position << 3), () => {
-							// this is never actually called in NodeJS, just use to pin the buffer in memory until it is finished
-							// and is a no-op in Deno
-							if (!float64)
-								throw new Error('No float64 available');
-						});
+						// queued for the compression threads, which never touch it after the write thread has passed it, so
+						// the buffer doesn't need to be pinned for them
+						compress(env.address, uint32.address + (position << 3));
 					position++;
 				}
 			}